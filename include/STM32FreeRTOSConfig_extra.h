@@ -0,0 +1,26 @@
+#ifndef STM32_FREERTOS_CONFIG_EXTRA_H
+#define STM32_FREERTOS_CONFIG_EXTRA_H
+
+/*
+ * Bổ sung cho cấu hình mặc định của STM32duino FreeRTOS (chỉ dùng ở env bluepill_f103c8_rtos)
+ *
+ * Run-time stats: kernel cộng thời gian chạy của task mỗi lần switch context → CPU time thật của
+ * từng task (rtos_get_task_stats), không tính lúc task bị preempt hay chờ trong lúc đang "bận".
+ * Bộ đếm là bus timebase TIM2 1MHz (đã chạy từ system_init, không cần cấu hình thêm).
+ */
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+uint32_t rtos_run_time_counter(void);
+#ifdef __cplusplus
+}
+#endif
+
+#define configUSE_TRACE_FACILITY 1          // vTaskGetInfo()
+#define configGENERATE_RUN_TIME_STATS 1
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE() rtos_run_time_counter()
+
+#endif // STM32_FREERTOS_CONFIG_EXTRA_H
@@ -0,0 +1,222 @@
+#include "bench.h"
+
+#if KNX_BENCH
+#include <stdio.h>
+#include <string.h>
+#include "frame_validator.h"
+#include "knx_tx.h"
+#include "logger.h"
+#include "metrics.h"
+#include "hal/hal.h"
+#include "tpuart/tpuart.h"
+#include "tpuart/host_link.h"
+#include "tpuart/rx_filter.h"
+
+#if KNX_NATIVE
+#include <time.h>
+#define BENCH_ITERATIONS 20000
+#define BENCH_UNIT "ns"
+typedef uint64_t bench_time_t;
+
+static bench_time_t bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#else
+#define BENCH_ITERATIONS 256
+#define BENCH_UNIT "cyc"
+typedef uint32_t bench_time_t;  // DWT CYCCNT 32 bit, 1 lô << 59s nên trừ không bị wrap
+
+static bench_time_t bench_now(void) {
+    return hal_cycles();
+}
+#endif
+
+#define BENCH_BATCHES 5
+#define BENCH_FILTER_ADDR 0x0001   // RX filter chỉ có địa chỉ nhóm này → frame bench (nhóm 2/1/2) không được forward
+
+typedef struct {
+    const char *name;
+    uint8_t ops;            // Số op trong 1 lần gọi run() (vd. số byte của frame)
+    void (*setup)(void);
+    void (*run)(void);
+} bench_case_t;
+
+// Frame chuẩn 9 byte: 1.1.1 → 1.1.2, A_GroupValue_Write 1 bit
+static const uint8_t frame9[9] = {0xBC, 0x11, 0x01, 0x11, 0x02, 0xE1, 0x00, 0x80, 0x21};
+static uint8_t frame23[KNX_MAX_FRAME_LEN];
+static uint8_t host_stream[2 * sizeof(frame9)];
+static uint16_t pulses[KNX_MAX_FRAME_LEN * 13];
+static logger_config_t saved_log_config;
+static volatile uint32_t bench_sink = 0;
+
+// State giao thức về mặc định sau khởi động
+static void bench_reset(void) {
+    reset_tx_state();
+    reset_rx_state();
+    reset_pending_ack();
+    queue_clear();
+    host_link_configure(0);
+    rx_filter_enable(false);
+    rx_filter_clear();
+}
+
+// ===== Case =====
+static void run_empty(void) {
+    bench_sink++;
+}
+
+// [U_L_DATA_START_REQ] [b0] [CONT|1] [b1] ... [END|8] [checksum]
+static void setup_host(void) {
+    bench_reset();
+    for (uint8_t i = 0; i < sizeof(frame9); i++) {
+        host_stream[2 * i] = i == 0 ? U_L_DATA_START_REQ
+                             : i == sizeof(frame9) - 1 ? (U_L_DATA_END_REQ | i) : (U_L_DATA_CONT_REQ | i);
+        host_stream[2 * i + 1] = frame9[i];
+    }
+}
+
+static void run_host(void) {
+    for (uint8_t i = 0; i < sizeof(host_stream); i++) {
+        knx_parse_MCU_byte(host_stream[i]);
+    }
+    dequeue_frame(nullptr, nullptr); // Giữ queue rỗng
+}
+
+// Frame + ký tự ACK; RX filter chặn frame để không ghi ra host serial (target sẽ block theo baud)
+static void setup_bus(void) {
+    bench_reset();
+    rx_filter_add(BENCH_FILTER_ADDR);
+    rx_filter_enable(true);
+}
+
+static void run_bus(void) {
+    for (uint8_t i = 0; i < sizeof(frame9); i++) {
+        knx_parse_BUS_byte(frame9[i]);
+    }
+    knx_parse_BUS_byte(KNX_BUS_ACK);
+}
+
+static void run_queue(void) {
+    uint8_t out[KNX_BUFFER_MAX_SIZE];
+    uint8_t len = 0;
+    enqueue_frame(frame9, sizeof(frame9));
+    dequeue_frame(out, &len);
+    bench_sink += len;
+}
+
+static void run_encode_frame(void) {
+    bench_sink += knx_tx_encode(pulses, sizeof(pulses) / sizeof(pulses[0]), frame9, sizeof(frame9));
+}
+
+static void run_encode_byte(void) {
+    bench_sink += knx_tx_encode(pulses, 13, &frame9[bench_sink & 7], 1);
+}
+
+static void setup_frame23(void) {
+    bench_reset();
+    for (uint8_t i = 0; i < sizeof(frame23) - 1; i++) {
+        frame23[i] = frame9[i % 8];
+    }
+    frame23[5] = 0x60 | (sizeof(frame23) - 8);
+    frame23[sizeof(frame23) - 1] = knx_calc_checksum(frame23, sizeof(frame23));
+}
+
+static void run_validate9(void) {
+    bench_sink += validate_knx_frame(frame9, sizeof(frame9));
+}
+
+static void run_validate23(void) {
+    bench_sink += validate_knx_frame(frame23, sizeof(frame23));
+}
+
+// Không giới hạn rate (logger đã mute trong lúc bench): chỉ đo phần check + format
+static void setup_log(void) {
+    logger_config_t cfg = saved_log_config;
+    cfg.max_logs_per_second = UINT32_MAX;
+    logger_set_config(&cfg);
+}
+
+static void run_log_off(void) {
+    logger_log(LOG_LEVEL_TRACE, LOG_CAT_KNX_RX, "RX frame %d byte from %04X", 9, 0x1101);
+}
+
+static void run_log(void) {
+    logger_log(LOG_LEVEL_INFO, LOG_CAT_KNX_RX, "RX frame %d byte from %04X", 9, 0x1101);
+}
+
+static const bench_case_t cases[] = {
+    {"empty",                 1,                  bench_reset,   run_empty},
+    {"knx_parse_MCU_byte",    sizeof(host_stream), setup_host,   run_host},
+    {"knx_parse_BUS_byte",    sizeof(frame9) + 1, setup_bus,     run_bus},
+    {"enqueue+dequeue_frame", 1,                  bench_reset,   run_queue},
+    {"prepare_frame_9",       1,                  bench_reset,   run_encode_frame},
+    {"encode_byte",           1,                  bench_reset,   run_encode_byte},
+    {"validate_knx_frame_9",  1,                  setup_frame23, run_validate9},
+    {"validate_knx_frame_23", 1,                  setup_frame23, run_validate23},
+    {"logger_log_filtered",   1,                  setup_log,     run_log_off},
+    {"logger_log",            1,                  setup_log,     run_log},
+};
+
+static void bench_print(const char *line) {
+    hal_debug_write((const uint8_t *)line, strlen(line));
+}
+
+static void bench_case(const bench_case_t *c) {
+    c->setup();
+    bench_time_t best = 0;
+    for (uint8_t b = 0; b <= BENCH_BATCHES; b++) {
+        bench_time_t start = bench_now();
+        for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+            c->run();
+        }
+        bench_time_t elapsed = bench_now() - start;
+        if (b > 0 && (b == 1 || elapsed < best)) { // Lô 0 = warm-up (cache / branch predictor trên native)
+            best = elapsed;
+        }
+    }
+
+    // Số nguyên x10 (newlib-nano không có printf float)
+    uint64_t ops = (uint64_t)BENCH_ITERATIONS * c->ops;
+    uint64_t x10 = (uint64_t)best * 10 / ops;
+    char line[96];
+#if KNX_NATIVE
+    snprintf(line, sizeof(line), "BENCH %-22s %6lu.%lu %s/op\r\n", c->name,
+             (unsigned long)(x10 / 10), (unsigned long)(x10 % 10), BENCH_UNIT);
+#else
+    uint64_t bit = (uint64_t)KNX_BIT_PERIOD_US * hal_cycles_per_us();
+    uint64_t pct_x10 = (uint64_t)best * 1000 / (ops * bit);
+    snprintf(line, sizeof(line), "BENCH %-22s %6lu.%lu %s/op %3lu.%lu%%bit\r\n", c->name,
+             (unsigned long)(x10 / 10), (unsigned long)(x10 % 10), BENCH_UNIT,
+             (unsigned long)(pct_x10 / 10), (unsigned long)(pct_x10 % 10));
+#endif
+    bench_print(line);
+}
+
+void bench_run_all(void) {
+    char line[96];
+    hal_cycles_init();
+    logger_get_config(&saved_log_config);
+    logger_set_muted(true); // Log do chính các hàm được đo sinh ra không ghi ra serial
+    snprintf(line, sizeof(line), "BENCH_BEGIN unit=%s iterations=%u batches=%u\r\n", BENCH_UNIT,
+             (unsigned)BENCH_ITERATIONS, (unsigned)BENCH_BATCHES);
+    bench_print(line);
+#if !KNX_NATIVE
+    snprintf(line, sizeof(line), "BENCH_BIT %lu cyc\r\n", (unsigned long)(KNX_BIT_PERIOD_US * hal_cycles_per_us()));
+    bench_print(line);
+#endif
+
+    for (uint8_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        bench_case(&cases[i]);
+    }
+
+    logger_set_config(&saved_log_config);
+    logger_set_muted(false);
+    bench_reset();
+    metrics_init(); // Bỏ counter do bench tạo ra
+    bench_print("BENCH_END\r\n");
+    hal_debug_flush();
+}
+
+#endif // KNX_BENCH
@@ -0,0 +1,26 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include "config.h"
+
+/*
+ * Microbenchmark các hàm giao thức nóng (KNX_BENCH = 1)
+ *
+ * - Target (env bluepill_f103c8_bench): chạy 1 lần trong setup(), đơn vị DWT cycle / op,
+ *   kèm % của 1 bit time (104µs = 7488 cycle ở 72MHz) - ngân sách cho code chạy trong ISR / giữa 2 bit
+ * - Native (env native_bench): ns / op theo CLOCK_MONOTONIC
+ *
+ * Mỗi case chạy BENCH_BATCHES lô, lấy lô nhanh nhất (loại nhiễu của interrupt / scheduler).
+ * Output qua debug serial, mỗi case 1 dòng cố định để so sánh với baseline (tools/bench_compare.py):
+ *   BENCH <tên> <giá trị> <đơn vị>/op [<% bit time>]
+ *
+ * Bench thay đổi state của parser / queue / host link / RX filter / metrics rồi reset về mặc định,
+ * nên phải chạy trước recovery_start() (frame giữ qua warm restart bị bỏ trong bench build).
+ */
+
+#if KNX_BENCH
+void bench_run_all(void);
+#endif
+
+#endif // BENCH_H
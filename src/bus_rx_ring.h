@@ -0,0 +1,53 @@
+#ifndef BUS_RX_RING_H
+#define BUS_RX_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+#include "metrics.h"
+
+/*
+ * Ring byte bus từ callback knx_rx (ISR) tới main loop, 1 ring cho mỗi line
+ *
+ * - Cờ parity được lấy ngay trong ISR và lưu ở bit 8: byte sau ghi đè cờ của knx_rx trước khi loop kịp đọc
+ * - 1 bên ghi (ISR), 1 bên đọc (main loop) → không cần khoá
+ * - Đầy → bỏ byte, đếm METRIC_RX_RING_OVERRUNS (frame đang nhận sẽ sai checksum / độ dài)
+ */
+
+static_assert((KNX_BUS_RX_RING & (KNX_BUS_RX_RING - 1)) == 0 && KNX_BUS_RX_RING <= 256,
+              "KNX_BUS_RX_RING phải là luỹ thừa của 2, tối đa 256");
+
+typedef struct {
+    volatile uint16_t buf[KNX_BUS_RX_RING];
+    volatile uint8_t head;
+    volatile uint8_t tail;
+} bus_rx_ring_t;
+
+static inline void bus_rx_ring_reset(bus_rx_ring_t *r) {
+    r->head = r->tail = 0;
+}
+
+// Gọi từ ISR
+static inline bool bus_rx_ring_put(bus_rx_ring_t *r, uint8_t byte, bool parity_error) {
+    uint8_t next = (r->head + 1) & (KNX_BUS_RX_RING - 1);
+    if (next == r->tail) {
+        metric_inc(METRIC_RX_RING_OVERRUNS);
+        return false;
+    }
+    r->buf[r->head] = byte | (parity_error ? 0x100 : 0);
+    r->head = next;
+    return true;
+}
+
+static inline bool bus_rx_ring_get(bus_rx_ring_t *r, uint8_t *byte, bool *parity_error) {
+    if (r->tail == r->head) {
+        return false;
+    }
+    uint16_t v = r->buf[r->tail];
+    r->tail = (r->tail + 1) & (KNX_BUS_RX_RING - 1);
+    *byte = (uint8_t)v;
+    *parity_error = (v & 0x100) != 0;
+    return true;
+}
+
+#endif // BUS_RX_RING_H
@@ -0,0 +1,218 @@
+#include "capture.h"
+
+#if KNX_CAPTURE
+
+#include <string.h>
+#include "crc_ccitt.h"
+#include "logger.h"
+#include "hal/hal.h"
+
+#if defined(SERIAL_TX_BUFFER_SIZE) && SERIAL_TX_BUFFER_SIZE < CAPTURE_BLOCK_MAX + 9
+#error "KNX_CAPTURE cần SERIAL_TX_BUFFER_SIZE >= CAPTURE_BLOCK_MAX + 9 (xem env bluepill_f103c8_capture)"
+#endif
+
+#define CAPTURE_MASK (CAPTURE_RING_SIZE - 1)
+#define CAPTURE_ENTRY_HDR 6   // Entry trong ring: [n] [hdr] [t u32] [payload] (n gồm cả 6 byte này)
+#define CAPTURE_BLOCK_HDR 7   // [sync] [len] [seq] [t0 u32]
+#define CAPTURE_BLOCK_SIZE_MAX (CAPTURE_BLOCK_HDR + CAPTURE_BLOCK_MAX + 2)
+
+static uint8_t cap_ring[CAPTURE_RING_SIZE];
+static volatile uint32_t cap_head = 0;   // Producer (trong critical section)
+static volatile uint32_t cap_tail = 0;   // Consumer: capture_drain
+static volatile uint32_t cap_dropped = 0;
+static uint32_t dropped_reported = 0;
+static uint8_t cap_seq = 0;
+static bool cap_active = false;
+
+static void ring_write(uint32_t pos, const uint8_t *data, uint8_t len) {
+    for (uint8_t i = 0; i < len; i++) {
+        cap_ring[(pos + i) & CAPTURE_MASK] = data[i];
+    }
+}
+
+static uint8_t ring_byte(uint32_t pos) {
+    return cap_ring[pos & CAPTURE_MASK];
+}
+
+static uint32_t ring_u32(uint32_t pos) {
+    return (uint32_t)ring_byte(pos) | ((uint32_t)ring_byte(pos + 1) << 8) |
+           ((uint32_t)ring_byte(pos + 2) << 16) | ((uint32_t)ring_byte(pos + 3) << 24);
+}
+
+// Timestamp lấy trong critical section → thứ tự entry trong ring cũng là thứ tự thời gian
+static void capture_put(uint8_t hdr, const uint8_t *pre, uint8_t pre_len, const uint8_t *data, uint8_t len) {
+    if (!cap_active) {
+        return;
+    }
+    uint32_t n = CAPTURE_ENTRY_HDR + pre_len + len;
+    uint32_t irq = hal_irq_save();
+    uint32_t head = cap_head;
+    if (head - cap_tail + n > CAPTURE_RING_SIZE) {
+        cap_dropped++;
+        hal_irq_restore(irq);
+        return;
+    }
+    uint32_t t = hal_micros();
+    uint8_t entry[CAPTURE_ENTRY_HDR] = {(uint8_t)n, hdr, (uint8_t)t, (uint8_t)(t >> 8), (uint8_t)(t >> 16), (uint8_t)(t >> 24)};
+    ring_write(head, entry, CAPTURE_ENTRY_HDR);
+    ring_write(head + CAPTURE_ENTRY_HDR, pre, pre_len);
+    ring_write(head + CAPTURE_ENTRY_HDR + pre_len, data, len);
+    __atomic_store_n(&cap_head, head + n, __ATOMIC_RELEASE);
+    hal_irq_restore(irq);
+}
+
+void capture_init(void) {
+    cap_head = 0;
+    cap_tail = 0;
+    cap_dropped = 0;
+    dropped_reported = 0;
+    cap_seq = 0;
+    cap_active = true;
+    logger_set_muted(true); // DEBUG_SERIAL chỉ chở block capture
+
+    uint32_t flags = hal_reset_flags();
+    uint8_t start[5] = {CAPTURE_VERSION, (uint8_t)flags, (uint8_t)(flags >> 8), (uint8_t)(flags >> 16), (uint8_t)(flags >> 24)};
+    capture_put(CAP_REC_START << 4, start, sizeof(start), nullptr, 0);
+}
+
+void capture_bus_rx(uint8_t byte, bool parity_error) {
+    capture_put((CAP_REC_BUS_RX << 4) | (parity_error ? CAP_FLAG_PARITY : 0), &byte, 1, nullptr, 0);
+}
+
+void capture_host_rx(uint8_t byte) {
+    capture_put(CAP_REC_HOST_RX << 4, &byte, 1, nullptr, 0);
+}
+
+void capture_host_tx(const uint8_t *data, uint16_t len) {
+    uint8_t hdr = CAP_REC_HOST_TX << 4;
+    if (len > CAPTURE_DATA_MAX) {
+        len = CAPTURE_DATA_MAX;
+        hdr |= CAP_FLAG_TRUNC;
+    }
+    uint8_t n = (uint8_t)len;
+    capture_put(hdr, &n, 1, data, n);
+}
+
+void capture_bus_tx(uint8_t result, const uint8_t *data, uint8_t len, bool ack) {
+    uint8_t hdr = (CAP_REC_BUS_TX << 4) | (ack ? CAP_FLAG_ACK : 0);
+    if (len > CAPTURE_DATA_MAX) {
+        len = CAPTURE_DATA_MAX;
+        hdr |= CAP_FLAG_TRUNC;
+    }
+    uint8_t pre[2] = {result, len};
+    capture_put(hdr, pre, sizeof(pre), data, len);
+}
+
+static uint8_t put_varint(uint8_t *out, uint32_t v) {
+    uint8_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+// Ghép 1 block từ các entry đầu ring (không xoá khỏi ring); trả về số byte, *tail_out = tail sau block
+static uint16_t capture_build_block(uint8_t *block, uint32_t *tail_out, uint32_t *reported_out) {
+    uint32_t tail = cap_tail;
+    uint32_t head = __atomic_load_n(&cap_head, __ATOMIC_ACQUIRE);
+    uint32_t t0 = tail != head ? ring_u32(tail + 2) : hal_micros();
+    uint32_t prev = t0;
+    uint8_t *rec = block + CAPTURE_BLOCK_HDR;
+    uint8_t len = 0;
+
+    // Record mất (ring đầy) báo trước các record còn lại, cùng thời điểm với record đầu
+    uint32_t reported = dropped_reported;
+    uint32_t lost = cap_dropped - reported;
+    if (lost) {
+        if (lost > 0xFFFF) {
+            lost = 0xFFFF;
+        }
+        rec[len++] = CAP_REC_DROP << 4;
+        rec[len++] = 0;
+        rec[len++] = (uint8_t)lost;
+        rec[len++] = (uint8_t)(lost >> 8);
+        reported += lost;
+    }
+
+    while (tail != head) {
+        uint8_t n = ring_byte(tail);
+        uint8_t payload = n - CAPTURE_ENTRY_HDR;
+        uint32_t t = ring_u32(tail + 2);
+        uint8_t delta[5];
+        uint8_t dn = put_varint(delta, t - prev);
+        if (len + 1 + dn + payload > CAPTURE_BLOCK_MAX) {
+            break;
+        }
+        rec[len++] = ring_byte(tail + 1);
+        memcpy(&rec[len], delta, dn);
+        len += dn;
+        for (uint8_t i = 0; i < payload; i++) {
+            rec[len++] = ring_byte(tail + CAPTURE_ENTRY_HDR + i);
+        }
+        prev = t;
+        tail += n;
+    }
+    if (len == 0) {
+        return 0;
+    }
+
+    block[0] = CAPTURE_SYNC;
+    block[1] = len;
+    block[2] = cap_seq;
+    block[3] = (uint8_t)t0;
+    block[4] = (uint8_t)(t0 >> 8);
+    block[5] = (uint8_t)(t0 >> 16);
+    block[6] = (uint8_t)(t0 >> 24);
+    uint16_t crc = crc_ccitt(&block[1], CAPTURE_BLOCK_HDR - 1 + len);
+    block[CAPTURE_BLOCK_HDR + len] = (uint8_t)(crc >> 8);
+    block[CAPTURE_BLOCK_HDR + len + 1] = (uint8_t)crc;
+    *tail_out = tail;
+    *reported_out = reported;
+    return CAPTURE_BLOCK_HDR + len + 2;
+}
+
+static bool capture_pending(bool force) {
+    uint32_t tail = cap_tail;
+    uint32_t used = __atomic_load_n(&cap_head, __ATOMIC_ACQUIRE) - tail;
+    if (cap_dropped != dropped_reported) {
+        return true;
+    }
+    if (used == 0) {
+        return false;
+    }
+    // Gom record thành block lớn (overhead 9 byte / block), trừ khi record cũ nhất đã chờ quá lâu
+    return force || used >= CAPTURE_BLOCK_MAX / 2 || hal_micros() - ring_u32(tail + 2) >= CAPTURE_FLUSH_MS * 1000u;
+}
+
+static void capture_send(bool force) {
+    uint8_t block[CAPTURE_BLOCK_SIZE_MAX];
+    while (capture_pending(force) && hal_debug_write_space() >= CAPTURE_BLOCK_SIZE_MAX) {
+        uint32_t tail = 0;
+        uint32_t reported = 0;
+        uint16_t size = capture_build_block(block, &tail, &reported);
+        if (size == 0) {
+            return;
+        }
+        hal_debug_write(block, size);
+        __atomic_store_n(&cap_tail, tail, __ATOMIC_RELEASE);
+        dropped_reported = reported;
+        cap_seq++;
+    }
+}
+
+void capture_drain(void) {
+    capture_send(false);
+}
+
+void capture_flush(void) {
+    capture_send(true);
+    hal_debug_flush();
+}
+
+uint32_t capture_dropped_count(void) {
+    return cap_dropped;
+}
+
+#endif // KNX_CAPTURE
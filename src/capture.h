@@ -0,0 +1,80 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+
+/*
+ * Capture traffic của gateway để replay trên PC (KNX_CAPTURE = 1, env bluepill_f103c8_capture)
+ *
+ * Ghi lại mọi input (byte từ bus, byte từ host) và output (byte gửi host, frame / ACK gửi xuống bus)
+ * kèm timestamp µs vào ring CAPTURE_RING_SIZE byte; capture_drain() gửi ring ra DEBUG_SERIAL
+ * (CAPTURE_SERIAL_BAUD, 8N1) khi loop() rảnh. File capture = byte nhận được trên serial, không cần chuyển đổi.
+ * Replay trên Linux: env:native_replay (src/native/replay/).
+ *
+ * Stream gồm các block (little-endian):
+ *   [0xC5] [len] [seq] [t0 u32 µs] [len byte record] [CRC-CCITT hi] [lo]
+ *   CRC tính từ byte len tới hết record; seq tăng 1 mỗi block → PC phát hiện block mất / hỏng và đồng bộ lại ở 0xC5 kế tiếp.
+ *
+ * Record: [hdr] [delta µs, varint 7 bit/byte, bit 7 = còn tiếp] [payload]
+ *   hdr: bit 7-4 = capture_rec_t, bit 3-0 = cờ; delta tính từ record trước trong block (record đầu: từ t0)
+ *   CAP_REC_START   [version] [reset flags u32]       - capture_init(), trạng thái firmware sạch từ đây
+ *   CAP_REC_BUS_RX  [byte]                            - cờ CAP_FLAG_PARITY
+ *   CAP_REC_HOST_RX [byte]                            - host → gateway
+ *   CAP_REC_HOST_TX [n] [n byte]                      - 1 lần ghi ra MCU_SERIAL, cờ CAP_FLAG_TRUNC nếu bị cắt
+ *   CAP_REC_BUS_TX  [knx_error_t] [n] [n byte]        - frame / ACK (cờ CAP_FLAG_ACK) gateway gửi xuống bus
+ *   CAP_REC_DROP    [số record mất u16]               - ring đầy (serial không kịp)
+ *
+ * Timestamp là thời điểm loop() xử lý byte (không phải lúc ISR nhận), giống cách firmware thấy input.
+ * Ghi record: tắt interrupt vài chục cycle, gọi được từ ISR và mọi task.
+ */
+
+#define CAPTURE_SYNC        0xC5
+#define CAPTURE_VERSION     1
+#define CAPTURE_BLOCK_MAX   128   // Byte record tối đa trong 1 block (TX buffer DEBUG_SERIAL phải chứa được cả block)
+#define CAPTURE_DATA_MAX    56    // Byte dữ liệu tối đa của 1 record HOST_TX / BUS_TX
+
+typedef enum {
+    CAP_REC_START = 0,
+    CAP_REC_BUS_RX,
+    CAP_REC_HOST_RX,
+    CAP_REC_HOST_TX,
+    CAP_REC_BUS_TX,
+    CAP_REC_DROP,
+    CAP_REC_COUNT
+} capture_rec_t;
+
+#define CAP_FLAG_PARITY 0x01  // BUS_RX: sai parity
+#define CAP_FLAG_ACK    0x01  // BUS_TX: ký tự ACK / NACK / BUSY, không phải frame
+#define CAP_FLAG_TRUNC  0x08  // HOST_TX / BUS_TX: dữ liệu dài hơn CAPTURE_DATA_MAX bị cắt
+
+#if KNX_CAPTURE
+
+// Bắt đầu capture: tắt log text trên DEBUG_SERIAL, ghi CAP_REC_START
+void capture_init(void);
+void capture_bus_rx(uint8_t byte, bool parity_error);
+void capture_host_rx(uint8_t byte);
+void capture_host_tx(const uint8_t *data, uint16_t len);
+void capture_bus_tx(uint8_t result, const uint8_t *data, uint8_t len, bool ack);
+// Gửi block khi đủ dữ liệu hoặc record cũ nhất quá CAPTURE_FLUSH_MS, không block
+void capture_drain(void);
+// Gửi hết ring (kết thúc capture trên native)
+void capture_flush(void);
+uint32_t capture_dropped_count(void);
+
+#define CAPTURE_BUS_RX(byte, parity) capture_bus_rx((byte), (parity))
+#define CAPTURE_HOST_RX(byte) capture_host_rx(byte)
+#define CAPTURE_HOST_TX(data, len) capture_host_tx((data), (len))
+#define CAPTURE_BUS_TX(result, data, len, ack) capture_bus_tx((uint8_t)(result), (data), (len), (ack))
+
+#else
+
+#define CAPTURE_BUS_RX(byte, parity)
+#define CAPTURE_HOST_RX(byte)
+#define CAPTURE_HOST_TX(data, len)
+#define CAPTURE_BUS_TX(result, data, len, ack)
+
+#endif // KNX_CAPTURE
+
+#endif // CAPTURE_H
@@ -7,9 +7,83 @@
 extern HardwareSerial DEBUG_SERIAL;
 extern HardwareSerial MCU_SERIAL;
 
+// Native build (env:native, Linux): protocol core chạy trên HAL giả lập (src/native)
+#ifndef KNX_NATIVE
+#define KNX_NATIVE 0
+#endif
+
+// Fuzz build (env:native_fuzz_*): 1 = link với libFuzzer (clang), 0 = driver ngẫu nhiên src/native/fuzz/fuzz_driver.cpp
+#ifndef KNX_LIBFUZZER
+#define KNX_LIBFUZZER 0
+#endif
+
+// FreeRTOS build: 1 = chạy RX / TX scheduling / host link / log trong các task riêng
+// (bật bằng env bluepill_f103c8_rtos trong platformio.ini)
+#ifndef KNX_USE_FREERTOS
+#define KNX_USE_FREERTOS 0
+#endif
+
+// ISR gọi API *FromISR của FreeRTOS phải có priority >= configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY (5)
+#if KNX_USE_FREERTOS
+#define KNX_NVIC_PRIO_BASE 5
+#else
+#define KNX_NVIC_PRIO_BASE 0
+#endif
+
+// Priority map NVIC (preempt priority, cộng KNX_NVIC_PRIO_BASE; số nhỏ = ưu tiên cao hơn)
+// MX_NVIC_Init() áp dụng cả bảng; override bằng -D khi tinh chỉnh theo số liệu latency của profiler
+#ifndef KNX_NVIC_PRIO_TIM2
+#define KNX_NVIC_PRIO_TIM2 0         // Timebase: lấy mẫu bit RX, ACK deadline, bus rảnh
+#endif
+#ifndef KNX_NVIC_PRIO_EXTI
+#define KNX_NVIC_PRIO_EXTI 0         // Sườn bus RX (PB6, EXTI9_5)
+#endif
+#ifndef KNX_NVIC_PRIO_DMA_TX
+#define KNX_NVIC_PRIO_DMA_TX 0       // DMA1_Channel2 (line 1: Channel3): kết thúc chuỗi xung TX
+#endif
+#ifndef KNX_NVIC_PRIO_USART_HOST
+#define KNX_NVIC_PRIO_USART_HOST 1   // USART1 (MCU_SERIAL)
+#endif
+#ifndef KNX_NVIC_PRIO_USART_DEBUG
+#define KNX_NVIC_PRIO_USART_DEBUG 2  // USART3 (DEBUG_SERIAL)
+#endif
+
+// Profiler theo DWT cycle cho stage của loop() và ISR (xem profiler.h)
+// 0 = compile out hoàn toàn (bật bằng env bluepill_f103c8_profile)
+#ifndef KNX_PROFILER_ENABLE
+#define KNX_PROFILER_ENABLE 0
+#endif
+#define KNX_PROFILER_REPORT_MS 10000  // Chu kỳ log báo cáo từ system_health_check
+
+// Microbenchmark hàm giao thức lúc khởi động (xem bench.h), bật bằng env bluepill_f103c8_bench / native_bench
+#ifndef KNX_BENCH
+#define KNX_BENCH 0
+#endif
+
+// Capture traffic bus / host ra DEBUG_SERIAL để replay trên PC (xem capture.h), bật bằng env bluepill_f103c8_capture
+// DEBUG_SERIAL chỉ chở capture (log text bị tắt), không dùng cùng LOGGER_DEFERRED
+#ifndef KNX_CAPTURE
+#define KNX_CAPTURE 0
+#endif
+#define CAPTURE_RING_SIZE 2048       // byte, phải là luỹ thừa của 2
+#define CAPTURE_SERIAL_BAUD 460800   // 8N1; bus + host ở tải tối đa cần ~15 kB/s
+#define CAPTURE_FLUSH_MS 20          // Record cũ nhất chờ tối đa bao lâu trước khi gửi block chưa đầy
+
+// Trace ring sự kiện giao thức trong .noinit (xem trace.h) - đủ rẻ để bật ở production
+#ifndef KNX_TRACE_ENABLE
+#define KNX_TRACE_ENABLE 1
+#endif
+#define KNX_TRACE_DEPTH 128         // Số entry (8 byte), phải là luỹ thừa của 2
+#define KNX_TRACE_POST_TRIGGER 16   // Số entry ghi thêm sau trigger rồi mới freeze
+#define KNX_TRACE_TRIGGER_MASK (TRACE_TRIG_BIT(TRACE_TRIG_ECHO_TIMEOUT) | TRACE_TRIG_BIT(TRACE_TRIG_ACK_MISS) | \
+                                TRACE_TRIG_BIT(TRACE_TRIG_ECHO_LOST) | TRACE_TRIG_BIT(TRACE_TRIG_HOST))
+
+// Chip được giả lập (bật các lệnh chỉ có trên NCN51xx: U_CONFIGURE_REQ...)
+#define NCN5120
+
 // KNX Configuration - Cải thiện với constants rõ ràng
 #define KNX_TX_MODE 1 // 1: PWM, 0: OC
-#define KNX_RX_MODE 0 // 1: Gửi Frame, 0: Gửi Byte
+#define KNX_RX_MODE 0 // 1: Gửi Frame (1 lần write + U_FRAME_STATE_IND), 0: Gửi Byte
 
 // Timing constants (microseconds)
 #define KNX_BIT_PERIOD_US 104
@@ -17,24 +91,86 @@ extern HardwareSerial MCU_SERIAL;
 #define KNX_BIT0_MAX_US 55
 #define KNX_FRAME_TIMEOUT_US 1500
 #define KNX_BUS_BUSY_TIMEOUT_MS 4
+#define KNX_RX_IDLE_US 2800        // Không có byte mới sau stop bit của byte cuối → hết frame (knx_BUS_gap_timeout)
+// Gateway bắt đầu frame khi bus đã rảnh KNX_TX_IDLE_BITS bit time tính từ sườn cuối (quy tắc 50 bit của TP1,
+// cùng lúc với device khác → tranh bus bằng arbitration). 0: chờ bus rảnh KNX_BUS_BUSY_TIMEOUT_MS + backoff 2-3ms
+// ngẫu nhiên như cũ. Đổi lúc chạy bằng gateway_set_tx_idle_bits(); giá trị < 40 bit bị chặn bởi KNX_BUS_BUSY_TIMEOUT_MS
+#ifndef KNX_TX_IDLE_BITS
+#define KNX_TX_IDLE_BITS 0
+#endif
 
 // Buffer sizes
 #define KNX_BUFFER_MAX_SIZE 23
 #define KNX_MAX_FRAME_LEN 23
-#define KNX_MAX_QUEUE_SIZE 50
+#define KNX_TX_QUEUE_BYTES 1024   // Queue TX: record 4 byte header + data (frame 9 byte → 78 frame)
+#define KNX_BUS_RX_RING 64        // Byte bus chờ main loop (mỗi line, bus_rx_ring.h), phải là luỹ thừa của 2
 
+// RX forwarding filter - lọc telegram theo địa chỉ đích trước khi gửi lên MCU
+#define KNX_RX_FILTER_ENABLE 0      // Trạng thái mặc định khi khởi động
+#define KNX_RX_FILTER_MAX_ADDR 256  // Số địa chỉ đích tối đa trong bảng lọc
+
+// RX repeat suppression - bỏ bản lặp lại (repeat flag = 0) của telegram vừa forward (tpuart/rx_dedup.h)
+#ifndef KNX_RX_DEDUP_ENABLE
+#define KNX_RX_DEDUP_ENABLE 0       // Trạng thái mặc định khi khởi động
+#endif
+#define KNX_RX_DEDUP_SLOTS 8        // Số telegram gần nhất được nhớ
+#define KNX_RX_DEDUP_WINDOW_MS 250  // Bản lặp tới sau khoảng này (tính từ bản đầu) vẫn được forward
+
+// Coupler 2 line TP1 (xem coupler.h): line 0 = line chính (TPUART / host như cũ), line 1 = kênh TP1 thứ 2
+// RX PB7 (EXTI7), TX TIM3 CH4 / PB1 + DMA1_Channel3, lấy mẫu bit bằng compare HAL_TB_SAMPLE_LINE1 (TIM2 CH4)
+// Bật bằng env bluepill_f103c8_coupler / native_coupler
+#ifndef KNX_COUPLER_ENABLE
+#define KNX_COUPLER_ENABLE 0
+#endif
+#define KNX_LINE_MAIN 0
+#define KNX_LINE_SUB 1
+#if KNX_COUPLER_ENABLE
+#define KNX_LINE_COUNT 2
+#else
+#define KNX_LINE_COUNT 1
+#endif
+#ifndef KNX_COUPLER_LINE1_ADDR
+#define KNX_COUPLER_LINE1_ADDR 0x11     // Area.line của line 1 (byte cao địa chỉ cá nhân, 1.1.x)
+#endif
+#ifndef KNX_COUPLER_FILTER_ENABLE
+#define KNX_COUPLER_FILTER_ENABLE 0     // Trạng thái mặc định: 1 = chỉ route địa chỉ nhóm có trong bảng, 0 = route tất cả
+#endif
+#define KNX_COUPLER_FILTER_MAX_ADDR 256 // Số địa chỉ nhóm tối đa trong bảng route
+#define KNX_COUPLER_QUEUE_SLOTS 4       // Frame chờ gửi cho mỗi line đích
+#define KNX_COUPLER_IND_SLOTS 4         // Frame line 1 chờ gửi lên host (host link đang bận frame line 0)
+#define KNX_COUPLER_RETRIES 3           // Số lần gửi lại khi không có ACK / NACK / BUSY
 
 // UART Configuration
 #define UART_BAUD_RATE 19200
 #define UART_TIMEOUT_MS 100
 
-// Watchdog Configuration 500000=500ms
-#define WATCHDOG_TIMEOUT_US 5000000
+// Transport của host link (hal/host_transport.h): 0 = USART1 (UART_BAUD_RATE 8E1), 1 = USB CDC (cần USBCON)
+// Đổi lúc chạy bằng hal_host_select(); bản build không có CDC thì về USART
+#ifndef KNX_HOST_TRANSPORT
+#define KNX_HOST_TRANSPORT 0
+#endif
+#define HOST_CDC_PACKET_SIZE 64     // USB full-speed bulk: tối đa 64 byte / packet
+
+// Echo ACK: thời gian tối đa chờ echo của frame đã gửi trước khi trả L_DATA_CON âm
+#define ECHO_ACK_TIMEOUT_MS 100
+
+// Watchdog Configuration 1000000=1s (reload từ recovery_service mỗi tick)
+#define WATCHDOG_TIMEOUT_US 1000000
 
 // Error Recovery
 #define MAX_ERROR_RETRY_COUNT 5
 #define RECOVERY_TIMEOUT_MS 10
 
+// Supervisor: phát hiện subsystem bị treo và khởi động lại tại chỗ (xem recovery.h)
+#define RECOVERY_RX_STALL_MS 3            // RX_flag bật mà không có sườn nào (1 byte = 13 bit = 1.35ms)
+#define RECOVERY_TX_STALL_MS 50           // DMA TX chưa xong (frame dài nhất ~31ms)
+#define RECOVERY_HOST_TX_STALL_MS 100     // TX buffer của host transport không giảm
+#define RECOVERY_PARSER_STALL_MS 50       // Frame từ host dở dang, không có byte mới
+#define RECOVERY_ESCALATE_COUNT 5         // Số lần recover 1 subsystem trong window → warm restart
+#define RECOVERY_ESCALATE_WINDOW_MS 1000
+#define RECOVERY_STABLE_MS 10000          // Chạy ổn định bao lâu thì xoá chuỗi warm restart
+#define RECOVERY_MAX_WARM_STREAK 3        // Warm restart liên tiếp quá số này → bỏ queue (frame độc)
+
 // Logger Configuration
 #define LOGGER_DEFAULT_LEVEL LOG_LEVEL_INFO
 #define LOGGER_ENABLE_TIMESTAMP 1
@@ -43,6 +179,16 @@ extern HardwareSerial MCU_SERIAL;
 #define LOGGER_ENABLE_COLOR 1
 #define LOGGER_MAX_LOGS_PER_SECOND 100
 
+// Deferred logging: LOG_* ghi record nhị phân vào ring, drain ra DEBUG_SERIAL khi rảnh
+// Giải mã trên PC: tools/log_decode.py <firmware.elf> <port|file>
+#ifndef LOGGER_DEFERRED
+#define LOGGER_DEFERRED 0
+#endif
+#define LOGGER_RING_SIZE 1024  // byte, phải là luỹ thừa của 2
+#if LOGGER_DEFERRED && KNX_CAPTURE
+#error "LOGGER_DEFERRED và KNX_CAPTURE cùng cần DEBUG_SERIAL"
+#endif
+
 // Legacy Debug Configuration (deprecated - use logger instead)
 #define ENABLE_DEBUG_PRINTS 1
 #define ENABLE_ERROR_LOGGING 1
@@ -0,0 +1,393 @@
+#include "coupler.h"
+#include "config.h"
+
+#if KNX_COUPLER_ENABLE
+
+#include <string.h>
+#include "knx_frame.h"
+#include "knx_rx.h"
+#include "bus_rx_ring.h"
+#include "knx_tx.h"
+#include "event_loop.h"
+#include "logger.h"
+#include "metrics.h"
+#include "tpuart/tpuart.h"
+#include "tpuart/host_link.h"
+#include "tpuart/rx_filter.h"
+#include "tpuart/addr_table.h"
+#include "hal/hal.h"
+
+#define KNX_BROADCAST_ADDR 0x0000
+#define KNX_HOP_UNLIMITED  7
+
+// Cùng ACK window với gateway_service_ack: 13-15 bit time từ điểm lấy mẫu stop bit của checksum
+#define COUPLER_ACK_START_US (KNX_BIT_PERIOD_US * 13)
+// Ký tự ACK bắt đầu muộn nhất ở bit time 15 → stop bit được lấy mẫu trước ~26 bit time
+#define COUPLER_ACK_WAIT_US  (KNX_BIT_PERIOD_US * 30)
+
+typedef enum {
+    COUPLER_TX_IDLE = 0,
+    COUPLER_TX_SENT,      // DMA đang phát / chờ echo
+    COUPLER_TX_WAIT_ACK,  // Echo khớp, chờ ký tự ACK
+} coupler_tx_state_t;
+
+typedef struct {
+    uint8_t len;
+    uint8_t state;        // U_FRAME_STATE_IND flags (frame lên host)
+    uint8_t data[KNX_MAX_FRAME_LEN];
+} coupler_frame_t;
+
+typedef struct {
+    // Frame đang nhận trên line
+    uint8_t rx_buf[KNX_MAX_FRAME_LEN];
+    uint8_t rx_len;
+    uint8_t rx_expect;    // Độ dài theo byte LG, 0 = chưa có header
+    uint8_t rx_state;     // PARITY_BIT_ERROR | CHECKSUM_LENGTH_ERROR
+    // Frame chờ gửi xuống line, đầu queue là frame đang gửi
+    coupler_frame_t queue[KNX_COUPLER_QUEUE_SLOTS];
+    uint8_t q_head;
+    uint8_t q_count;
+    coupler_tx_state_t tx_state;
+    uint8_t tx_tries;     // Số lần đã gửi frame đầu queue
+    uint32_t tx_ms;       // hal_millis() lúc gửi
+} coupler_line_t;
+
+static coupler_line_t lines[KNX_LINE_COUNT];
+
+// Byte line 1 từ ISR
+static bus_rx_ring_t rx_ring;
+
+// Frame line 1 chờ gửi lên host
+static coupler_frame_t ind_queue[KNX_COUPLER_IND_SLOTS];
+static uint8_t ind_head = 0;
+static uint8_t ind_count = 0;
+
+// Bảng lọc địa chỉ nhóm, luôn giữ sắp xếp tăng dần
+static uint16_t filter_storage[KNX_COUPLER_FILTER_MAX_ADDR];
+static addr_table_t filter_table = ADDR_TABLE_INIT(filter_storage);
+static bool filter_enabled = KNX_COUPLER_FILTER_ENABLE;
+
+// ===== Bảng lọc =====
+void coupler_filter_enable(bool enable) {
+    filter_enabled = enable;
+    LOG_INFO(LOG_CAT_KNX_RX, "Coupler filter %s (%d addresses)", enable ? "enabled" : "disabled", filter_table.count);
+}
+
+bool coupler_filter_is_enabled(void) {
+    return filter_enabled;
+}
+
+void coupler_filter_clear(void) {
+    addr_table_clear(&filter_table);
+}
+
+bool coupler_filter_add(uint16_t group_addr) {
+    if (!addr_table_add(&filter_table, group_addr)) {
+        LOG_WARN(LOG_CAT_KNX_RX, "Coupler filter full - address %04X not added", group_addr);
+        return false;
+    }
+    return true;
+}
+
+bool coupler_filter_remove(uint16_t group_addr) {
+    return addr_table_remove(&filter_table, group_addr);
+}
+
+uint16_t coupler_filter_load(const uint16_t *addrs, uint16_t count) {
+    uint16_t n = addr_table_load(&filter_table, addrs, count);
+    LOG_INFO(LOG_CAT_KNX_RX, "Coupler filter loaded %d addresses", n);
+    return n;
+}
+
+uint16_t coupler_filter_count(void) {
+    return filter_table.count;
+}
+
+static bool filter_match(uint16_t group_addr) {
+    if (!filter_enabled || group_addr == KNX_BROADCAST_ADDR) {
+        return true;
+    }
+    return addr_table_contains(&filter_table, group_addr);
+}
+
+// ===== Route =====
+// Frame hợp lệ nhận trên line from có cần sang line kia không
+static bool coupler_should_route(uint8_t from, knx_frame_view_t f) {
+    uint16_t dest = f.destination();
+    bool route;
+    if (f.is_group()) {
+        route = filter_match(dest);
+    } else {
+        bool dest_on_sub = (dest >> 8) == KNX_COUPLER_LINE1_ADDR;
+        route = from == KNX_LINE_MAIN ? dest_on_sub : !dest_on_sub;
+    }
+    if (!route) {
+        metric_inc(METRIC_COUPLER_FILTERED);
+        return false;
+    }
+    if (f.hop_count() == 0) {
+        metric_inc(METRIC_COUPLER_HOP_LIMIT);
+        return false;
+    }
+    return true;
+}
+
+// Copy frame vào queue line đích, giảm hop count (7 = không giới hạn, giữ nguyên)
+static bool coupler_enqueue(uint8_t to, const uint8_t *data, uint8_t len) {
+    coupler_line_t *l = &lines[to];
+    if (l->q_count >= KNX_COUPLER_QUEUE_SLOTS) {
+        metric_inc(METRIC_COUPLER_QUEUE_FULL);
+        return false;
+    }
+    coupler_frame_t *q = &l->queue[(l->q_head + l->q_count) % KNX_COUPLER_QUEUE_SLOTS];
+    memcpy(q->data, data, len);
+    q->len = len;
+    q->state = 0;
+    knx_frame_view_t f(q->data, len);
+    uint8_t hop = f.hop_count();
+    if (hop != KNX_HOP_UNLIMITED) {
+        uint8_t off = knx_frame_route_offset(f.is_extended());
+        uint8_t old = q->data[off];
+        q->data[off] = (uint8_t)((old & 0x8F) | ((hop - 1) << 4));
+        // Checksum = NOT(XOR các byte) → đổi 1 byte thì XOR cùng độ chênh vào checksum
+        q->data[len - 1] ^= old ^ q->data[off];
+    }
+    l->q_count++;
+    return true;
+}
+
+static void coupler_dequeue(coupler_line_t *l) {
+    l->q_head = (l->q_head + 1) % KNX_COUPLER_QUEUE_SLOTS;
+    l->q_count--;
+    l->tx_state = COUPLER_TX_IDLE;
+    l->tx_tries = 0;
+}
+
+// Frame đầu queue không tới được line (NACK / BUSY / không ACK / echo sai): gửi lại dưới dạng lặp
+static void coupler_tx_retry(uint8_t line) {
+    coupler_line_t *l = &lines[line];
+    coupler_frame_t *head = &l->queue[l->q_head];
+    l->tx_state = COUPLER_TX_IDLE;
+    if (l->tx_tries > KNX_COUPLER_RETRIES) {
+        metric_inc(METRIC_COUPLER_TX_FAILED);
+        LOG_DEBUG(LOG_CAT_KNX_TX, "Coupler: line %d frame dropped after %d tries", line, l->tx_tries);
+        coupler_dequeue(l);
+        return;
+    }
+    metric_inc(METRIC_COUPLER_TX_RETRIES);
+    knx_frame_mark_repeated(head->data, head->len);
+}
+
+static void coupler_ack_char(uint8_t line, uint8_t ack) {
+    coupler_line_t *l = &lines[line];
+    if (l->tx_state != COUPLER_TX_WAIT_ACK) {
+        return; // ACK cho frame của node khác / của tpuart
+    }
+    if (ack != KNX_BUS_ACK) {
+        coupler_tx_retry(line);
+        return;
+    }
+    metric_inc(line == KNX_LINE_SUB ? METRIC_COUPLER_ROUTED_0_1 : METRIC_COUPLER_ROUTED_1_0);
+    coupler_dequeue(l);
+}
+
+// ACK telegram line 1 mà coupler route: ký tự ACK bắt đầu ở bit time 13-14 sau stop bit của checksum
+static void coupler_ack_line1(uint8_t ack) {
+    uint32_t elapsed = hal_timebase_now() - knx_rx_last_byte_time(KNX_LINE_SUB);
+    if (elapsed >= COUPLER_ACK_START_US) {
+        metric_inc(METRIC_ACK_MISSED);
+        return;
+    }
+    uint8_t idle_bits = (COUPLER_ACK_START_US - elapsed + KNX_BIT_PERIOD_US - 1) / KNX_BIT_PERIOD_US;
+    if (knx_send_ack_char(KNX_LINE_SUB, ack, idle_bits) != KNX_OK) {
+        metric_inc(METRIC_ACK_MISSED);
+    }
+}
+
+// Frame line 1 lên host (giữ trong ind_queue tới khi host link rảnh)
+static void coupler_indicate(const coupler_line_t *l) {
+    knx_frame_view_t f(l->rx_buf, l->rx_len);
+    if (f.has_header()) {
+        bool forward = rx_filter_match(f.destination(), f.is_group());
+        rx_filter_record(forward);
+        if (!forward) {
+            return;
+        }
+    }
+    if (ind_count >= KNX_COUPLER_IND_SLOTS) {
+        metric_add(METRIC_HOST_TX_DROPPED, l->rx_len);
+        return;
+    }
+    coupler_frame_t *ind = &ind_queue[(ind_head + ind_count) % KNX_COUPLER_IND_SLOTS];
+    memcpy(ind->data, l->rx_buf, l->rx_len);
+    ind->len = l->rx_len;
+    ind->state = l->rx_state;
+    ind_count++;
+}
+
+static void coupler_indicate_flush(void) {
+    while (ind_count && !host_link_frame_active()) {
+        coupler_frame_t *ind = &ind_queue[ind_head];
+        host_link_frame_begin(KNX_LINE_SUB);
+        host_link_frame_bytes(ind->data, ind->len);
+        host_link_frame_end(ind->state);
+        ind_head = (ind_head + 1) % KNX_COUPLER_IND_SLOTS;
+        ind_count--;
+    }
+}
+
+// Đã nhận đủ frame trên line
+static void coupler_rx_frame(uint8_t line) {
+    coupler_line_t *l = &lines[line];
+    knx_frame_view_t f(l->rx_buf, l->rx_len);
+    uint8_t x = 0;
+    for (uint8_t i = 0; i < l->rx_len; i++) {
+        x ^= l->rx_buf[i];
+    }
+    if (!f.well_formed() || x != 0xFF) {
+        l->rx_state |= CHECKSUM_LENGTH_ERROR;
+    }
+    bool ok = l->rx_state == 0;
+    if (line == KNX_LINE_SUB) {
+        coupler_indicate(l);
+    }
+
+    // Echo của frame coupler vừa gửi
+    if (l->tx_state == COUPLER_TX_SENT) {
+        const coupler_frame_t *head = &l->queue[l->q_head];
+        if (ok && l->rx_len == head->len && memcmp(l->rx_buf, head->data, head->len) == 0) {
+            l->tx_state = COUPLER_TX_WAIT_ACK;
+            return;
+        }
+        // Frame khác chiếm bus (thua arbitration / collision) → gửi lại, frame này xử lý như thường
+        coupler_tx_retry(line);
+    }
+    if (!ok || !coupler_should_route(line, f)) {
+        return;
+    }
+
+    // Echo frame của host (tpuart đang chờ echo) vẫn được route nhưng không ACK chính mình
+    bool queued = coupler_enqueue(line ^ 1, l->rx_buf, l->rx_len);
+    uint8_t ack = queued ? U_ACK_REQ_ADRESSED : U_ACK_REQ_BUSY;
+    if (line == KNX_LINE_MAIN) {
+        if (!is_get_echo_frame()) {
+            set_pending_ack(ack);
+        }
+    } else {
+        coupler_ack_line1(queued ? KNX_BUS_ACK : KNX_BUS_BUSY);
+    }
+}
+
+static void coupler_rx_byte(uint8_t line, uint8_t byte, bool parity_error) {
+    coupler_line_t *l = &lines[line];
+    if (l->rx_len == 0) {
+        if (byte == KNX_BUS_ACK || byte == KNX_BUS_NACK || byte == KNX_BUS_BUSY) {
+            coupler_ack_char(line, byte);
+            return;
+        }
+        if ((byte & L_DATA_MASK) != L_DATA_STANDARD_IND && (byte & L_DATA_MASK) != L_DATA_EXTENDED_IND) {
+            return; // Byte rời / nhiễu
+        }
+        l->rx_expect = 0;
+        l->rx_state = 0;
+    }
+    if (parity_error) {
+        l->rx_state |= PARITY_BIT_ERROR;
+    }
+    l->rx_buf[l->rx_len++] = byte;
+    knx_frame_view_t f(l->rx_buf, l->rx_len);
+    if (l->rx_expect == 0 && f.has_header()) {
+        uint16_t total = f.frame_len();
+        if (total > KNX_MAX_FRAME_LEN) {
+            l->rx_state |= CHECKSUM_LENGTH_ERROR;
+            total = KNX_MAX_FRAME_LEN;
+        }
+        l->rx_expect = (uint8_t)total;
+    }
+    if (l->rx_expect && l->rx_len >= l->rx_expect) {
+        coupler_rx_frame(line);
+        l->rx_len = 0;
+    }
+}
+
+// Line đích rảnh để gửi frame đầu queue
+static bool coupler_line_free(uint8_t line) {
+    if (hal_tx_busy(line) || get_knx_rx_flag(line) || lines[line].rx_len) {
+        return false;
+    }
+    // Line 0: không chen vào frame tpuart đang chờ echo / ACK của frame vừa nhận
+    return line != KNX_LINE_MAIN || (!is_get_echo_frame() && !is_pending_ack());
+}
+
+static void coupler_tx_service(uint8_t line, uint32_t now_us) {
+    coupler_line_t *l = &lines[line];
+    switch (l->tx_state) {
+        case COUPLER_TX_SENT:
+            if (hal_millis() - l->tx_ms >= ECHO_ACK_TIMEOUT_MS) {
+                coupler_tx_retry(line);
+            }
+            break;
+        case COUPLER_TX_WAIT_ACK:
+            if (now_us - knx_rx_last_byte_time(line) > COUPLER_ACK_WAIT_US) {
+                coupler_tx_retry(line);
+            }
+            break;
+        case COUPLER_TX_IDLE:
+            if (l->q_count && coupler_line_free(line)) {
+                coupler_frame_t *head = &l->queue[l->q_head];
+                knx_error_t result = knx_send_frame(line, head->data, head->len);
+                if (result == KNX_OK) {
+                    l->tx_state = COUPLER_TX_SENT;
+                    l->tx_tries++;
+                    l->tx_ms = hal_millis();
+                } else if (result != KNX_ERROR_BUS_BUSY) {
+                    metric_inc(METRIC_COUPLER_TX_FAILED);
+                    coupler_dequeue(l);
+                }
+            }
+            break;
+    }
+}
+
+void coupler_init(void) {
+    memset(lines, 0, sizeof(lines));
+    bus_rx_ring_reset(&rx_ring);
+    ind_head = ind_count = 0;
+    LOG_INFO(LOG_CAT_SYSTEM, "Coupler: line 1 = %d.%d, filter %s", KNX_COUPLER_LINE1_ADDR >> 4,
+             KNX_COUPLER_LINE1_ADDR & 0x0F, filter_enabled ? "on" : "off");
+}
+
+void coupler_line1_byte_isr(const uint8_t byte) {
+    bus_rx_ring_put(&rx_ring, byte, knx_rx_take_parity_error(KNX_LINE_SUB));
+    event_post(EVT_LINE1_RX);
+}
+
+void coupler_on_bus_byte(uint8_t line, uint8_t byte, bool parity_error) {
+    coupler_rx_byte(line, byte, parity_error);
+}
+
+void coupler_service(void) {
+    uint8_t byte;
+    bool parity_error;
+    while (bus_rx_ring_get(&rx_ring, &byte, &parity_error)) {
+        coupler_rx_byte(KNX_LINE_SUB, byte, parity_error);
+    }
+
+    uint32_t now_us = hal_timebase_now();
+    for (uint8_t line = 0; line < KNX_LINE_COUNT; line++) {
+        coupler_line_t *l = &lines[line];
+        // Frame bị cắt ngang: line im lặng quá lâu sau byte cuối
+        if (l->rx_len && !get_knx_rx_flag(line) && now_us - knx_rx_last_byte_time(line) > KNX_RX_IDLE_US) {
+            if (line == KNX_LINE_SUB) {
+                l->rx_state |= TIMING_ERROR | CHECKSUM_LENGTH_ERROR;
+                coupler_indicate(l);
+            }
+            l->rx_len = 0;
+        }
+        coupler_tx_service(line, now_us);
+    }
+
+    coupler_indicate_flush();
+}
+
+#endif // KNX_COUPLER_ENABLE
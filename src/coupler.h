@@ -0,0 +1,57 @@
+#ifndef COUPLER_H
+#define COUPLER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+
+/*
+ * Coupler 2 line TP1 trong gateway (KNX_COUPLER_ENABLE = 1, env bluepill_f103c8_coupler / native_coupler)
+ *
+ * Line 0 (KNX_LINE_MAIN) là line chính như trước: TPUART, queue TX từ host, ACK theo U_ACK_REQ.
+ * Line 1 (KNX_LINE_SUB) có decoder knx_rx / encoder knx_tx riêng, do coupler sở hữu hoàn toàn.
+ * Telegram được route giữa 2 line ngay trong main loop, không qua host:
+ *
+ * - Chỉ route frame hợp lệ (parity, độ dài, checksum), không route echo của chính coupler
+ * - Địa chỉ nhóm: broadcast 0x0000 luôn route; bảng lọc bật → chỉ địa chỉ có trong bảng
+ *   (sắp xếp tăng dần, binary search), tắt → route tất cả
+ * - Địa chỉ cá nhân: theo area.line KNX_COUPLER_LINE1_ADDR (byte cao) - đích thuộc line 1 thì 0 → 1, không thì 1 → 0
+ * - Hop count: 0 → không route; 7 → giữ nguyên; còn lại giảm 1, sửa checksum theo
+ * - Line nguồn: coupler ACK telegram nó route (BUSY nếu queue line đích đầy). Line 0 qua cơ chế
+ *   U_ACK_REQ của tpuart (set_pending_ack), line 1 bằng knx_send_ack_char (bit im lặng + ký tự ACK)
+ * - Line đích: queue KNX_COUPLER_QUEUE_SLOTS frame, gửi khi line rảnh (line 0: tpuart không có frame
+ *   chờ echo / ACK), chờ echo + ký tự ACK; NACK / BUSY / không ACK / echo sai → gửi lại với repeat flag = 0,
+ *   tối đa KNX_COUPLER_RETRIES lần
+ *
+ * Byte line 1: ISR (knx_rx callback) ghi vào ring KNX_BUS_RX_RING (bus_rx_ring.h) + EVT_LINE1_RX, main loop xử lý.
+ * Hết frame xác định theo byte LG; frame dở dang bị bỏ khi line im lặng KNX_RX_IDLE_US.
+ *
+ * Host thấy cả 2 line: mỗi frame bus bắt đầu bằng U_CHANNEL_IND | line (host_link.h). Frame line 1 được
+ * giữ tới khi nhận đủ rồi mới gửi lên (không chen vào frame line 0 đang forward), qua bộ lọc rx_filter
+ * như line 0. Bản route xuất hiện trên cả 2 kênh đúng như trên bus. Ký tự ACK của line 1 không gửi lên host.
+ * Host chỉ gửi được xuống line 0 (queue TPUART), coupler route tiếp sang line 1 nếu cần.
+ */
+
+#if KNX_COUPLER_ENABLE
+
+void coupler_init(void);
+
+// Callback knx_rx của line 1 (trong ISR)
+void coupler_line1_byte_isr(const uint8_t byte);
+// Byte line 0 sau khi tpuart đã parse (gateway_on_bus_byte)
+void coupler_on_bus_byte(uint8_t line, uint8_t byte, bool parity_error);
+// Xử lý byte line 1, timeout echo / ACK, gửi frame đầu queue, frame line 1 lên host
+void coupler_service(void);
+
+// Bảng lọc địa chỉ nhóm
+void coupler_filter_enable(bool enable);
+bool coupler_filter_is_enabled(void);
+void coupler_filter_clear(void);
+bool coupler_filter_add(uint16_t group_addr);
+bool coupler_filter_remove(uint16_t group_addr);
+uint16_t coupler_filter_load(const uint16_t *addrs, uint16_t count);
+uint16_t coupler_filter_count(void);
+
+#endif // KNX_COUPLER_ENABLE
+
+#endif // COUPLER_H
@@ -0,0 +1,12 @@
+#ifndef CRC_CCITT_H
+#define CRC_CCITT_H
+
+#include <stdint.h>
+
+// CRC-CCITT (poly 0x1021, init 0xFFFF, không đảo bit) - dùng cho framing trên host link
+#define CRC_CCITT_INIT 0xFFFF
+
+uint16_t crc_ccitt_update(uint16_t crc, uint8_t byte);
+uint16_t crc_ccitt(const uint8_t *data, uint16_t len);
+
+#endif // CRC_CCITT_H
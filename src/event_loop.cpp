@@ -0,0 +1,134 @@
+#include "event_loop.h"
+#include "config.h"
+#include "rtos_tasks.h"
+#include "logger.h"
+#include "capture.h"
+#include "hal/hal.h"
+
+// TIM4: tick 1ms; ACK deadline là compare HAL_TB_ACK của bus timebase (TIM2)
+static HardwareTimer tick_timer(TIM4);
+
+static volatile uint32_t event_mask = 0;
+static volatile uint32_t event_posted_at[EVT_COUNT];  // DWT cycle lúc event được post
+static uint32_t event_max_latency[EVT_COUNT];         // cycle
+
+static void tick_isr(void) {
+    event_post(EVT_TICK);
+}
+
+static void deadline_isr(void) {
+    event_post(EVT_ACK_DEADLINE);
+}
+
+void event_loop_init(void) {
+    // DWT cycle counter dùng để đo latency
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    tick_timer.setOverflow(1000, MICROSEC_FORMAT);
+    tick_timer.attachInterrupt(tick_isr);
+    tick_timer.resume();
+
+    event_reset_latency();
+}
+
+void event_post(uint32_t events) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    uint32_t fresh = events & ~event_mask;
+    event_mask |= events;
+    if (fresh) {
+        uint32_t now = DWT->CYCCNT;
+        for (uint8_t i = 0; i < EVT_COUNT; i++) {
+            if (fresh & (1u << i)) {
+                event_posted_at[i] = now;
+            }
+        }
+    }
+    __set_PRIMASK(primask);
+#if KNX_USE_FREERTOS
+    // FreeRTOS build: event được chuyển thành task notification cho tx_sched,
+    // event_mask chỉ còn giữ mốc post để đo latency (event_taken)
+    rtos_post_events(events);
+#endif
+}
+
+// Gọi khi IRQ đang tắt: xoá event đã lấy khỏi mask, cập nhật latency lớn nhất
+static void event_record_latency(uint32_t events) {
+    event_mask &= ~events;
+    uint32_t now = DWT->CYCCNT;
+    for (uint8_t i = 0; i < EVT_COUNT; i++) {
+        if (events & (1u << i)) {
+            uint32_t latency = now - event_posted_at[i];
+            if (latency > event_max_latency[i]) {
+                event_max_latency[i] = latency;
+            }
+        }
+    }
+}
+
+#if KNX_USE_FREERTOS
+void event_taken(uint32_t events) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    event_record_latency(events & event_mask);
+    __set_PRIMASK(primask);
+}
+#else
+uint32_t event_wait(void) {
+    for (;;) {
+        if (hal_host_available()) {
+            event_post(EVT_HOST_RX);
+        }
+#if LOGGER_DEFERRED
+        // Rảnh: đẩy log record ra DEBUG_SERIAL (không block)
+        if (!event_mask) {
+            logger_drain();
+        }
+#endif
+#if KNX_CAPTURE
+        // Rảnh: gửi block capture ra DEBUG_SERIAL (không block)
+        if (!event_mask) {
+            capture_drain();
+        }
+#endif
+        __disable_irq();
+        if (event_mask) {
+            break;
+        }
+        // WFI vẫn thức dậy khi có IRQ pending dù PRIMASK đang set → không mất event
+        __WFI();
+        __enable_irq();
+    }
+    uint32_t events = event_mask;
+    event_record_latency(events);
+    __enable_irq();
+    return events;
+}
+#endif
+
+void event_arm_ack_deadline(uint32_t at_us) {
+    hal_timebase_arm(HAL_TB_ACK, at_us, deadline_isr);
+}
+
+void event_cancel_ack_deadline(void) {
+    hal_timebase_cancel(HAL_TB_ACK);
+}
+
+uint32_t event_get_max_latency_us(uint8_t event_idx) {
+    if (event_idx >= EVT_COUNT) {
+        return 0;
+    }
+    return event_max_latency[event_idx] / (SystemCoreClock / 1000000);
+}
+
+void event_reset_latency(void) {
+#if KNX_USE_FREERTOS
+    // Mốc post chưa được tx_sched lấy (vd. event trước khi scheduler chạy) không tính vào latency
+    event_mask = 0;
+#endif
+    for (uint8_t i = 0; i < EVT_COUNT; i++) {
+        event_max_latency[i] = 0;
+    }
+}
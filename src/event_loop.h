@@ -0,0 +1,53 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+
+/*
+ * Event mask cho main loop
+ *
+ * ISR set bit tương ứng bằng event_post(), loop() gọi event_wait() để lấy và xoá mask.
+ * Khi không có event nào, core ngủ bằng __WFI cho đến interrupt tiếp theo.
+ *
+ * - EVT_RX_BYTE:      knx_rx đã giải mã xong 1 byte từ bus
+ * - EVT_HOST_RX:      có byte từ MCU (USART1 ISR thuộc Arduino core → kiểm tra khi thức dậy)
+ * - EVT_ACK_DEADLINE: tới thời điểm gửi ACK (compare HAL_TB_ACK của bus timebase)
+ * - EVT_TX_DONE:      DMA gửi frame xong
+ * - EVT_TICK:         tick 1ms (TIM4) cho timeout, backoff, health check
+ * - EVT_BUS_IDLE:     bus rảnh KNX_RX_IDLE_US sau byte cuối (compare HAL_TB_IDLE) → hết frame
+ * - EVT_LINE1_RX:     coupler: có byte mới của line 1 trong ring (coupler_line1_byte_isr)
+ */
+#define EVT_RX_BYTE       (1u << 0)
+#define EVT_HOST_RX       (1u << 1)
+#define EVT_ACK_DEADLINE  (1u << 2)
+#define EVT_TX_DONE       (1u << 3)
+#define EVT_TICK          (1u << 4)
+#define EVT_BUS_IDLE      (1u << 5)
+#define EVT_LINE1_RX      (1u << 6)
+#define EVT_COUNT         7
+
+void event_loop_init(void);
+
+// ISR-safe
+void event_post(uint32_t events);
+
+#if KNX_USE_FREERTOS
+// tx_sched đã nhận events qua task notification (rtos_post_events) → đo latency như event_wait
+void event_taken(uint32_t events);
+#else
+// Ngủ (WFI) đến khi có event, trả về mask và xoá
+uint32_t event_wait(void);
+#endif
+
+// ACK deadline: one-shot tại at_us (bus timebase, hal_timebase_now())
+void event_arm_ack_deadline(uint32_t at_us);
+void event_cancel_ack_deadline(void);
+
+// Latency lớn nhất từ lúc post event đến lúc loop() (FreeRTOS: tx_sched) lấy được event (µs)
+uint32_t event_get_max_latency_us(uint8_t event_idx);
+void event_reset_latency(void);
+
+#endif // EVENT_LOOP_H
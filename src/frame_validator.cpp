@@ -1,35 +1,41 @@
 #include "frame_validator.h"
 #include "config.h"
+#include "knx_frame.h"
+
+// Checksum KNX TP1: NOT XOR các byte trước checksum (data[0..len-2])
+uint8_t knx_calc_checksum(const uint8_t *data, uint8_t len) {
+    uint8_t x = 0;
+    for (uint8_t i = 0; i + 1 < len; i++) {
+        x ^= data[i];
+    }
+    return (uint8_t)~x;
+}
 
 frame_validation_result_t validate_knx_frame(const uint8_t *data, uint8_t len) {
     // Basic length check
-    if (len < 7 || len > KNX_BUFFER_MAX_SIZE) {
+    if (len < KNX_FRAME_MIN_LEN || len > KNX_BUFFER_MAX_SIZE) {
         return FRAME_ERROR_INVALID_LENGTH;
     }
     
-    // Extract frame components
-    uint8_t control = data[0];
-    uint8_t data_length = data[5] & 0x0F;
-    uint8_t expected_length = 6 + data_length + 1 + 1 ; // header + data + checksum
-    
-    // Validate total length
-    if (len != expected_length) {
+    // Standard / extended theo control byte; độ dài theo byte LG
+    knx_frame_view_t frame(data, len);
+    if (!frame.well_formed()) {
         return FRAME_ERROR_INVALID_LENGTH;
     }
     
     // Validate control field
-    // if (!is_valid_knx_control(control)) {
+    // if (!is_valid_knx_control(frame.control())) {
     //     return FRAME_ERROR_INVALID_CONTROL;
     // }
     
     // Validate addresses
-    // if (!is_valid_knx_address(&data[1]) || !is_valid_knx_address(&data[3])) {
+    // if (!is_valid_knx_address(&data[knx_frame_src_offset(frame.is_extended())]) ||
+    //     !is_valid_knx_address(&data[knx_frame_dest_offset(frame.is_extended())])) {
     //     return FRAME_ERROR_INVALID_ADDRESS;
     // }
     
     // Validate checksum
-    extern uint8_t knx_calc_checksum(const uint8_t *data, uint8_t len);
-    if (data[len-1] != knx_calc_checksum(data, len)) {
+    if (frame.checksum() != knx_calc_checksum(data, len)) {
         return FRAME_ERROR_CHECKSUM;
         // DEBUG_SERIAL.printf(" | Expected: %02X, Calculated: %02X
     }
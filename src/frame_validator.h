@@ -4,15 +4,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-// KNX Frame structure
-typedef struct {
-    uint8_t control;        // Control field
-    uint8_t source[2];      // Source address
-    uint8_t dest[2];        // Destination address
-    uint8_t data_length;    // Data length
-    uint8_t data[15];       // Data payload
-    uint8_t checksum;       // Checksum
-} knx_frame_t;
+// Truy cập field của frame: knx_frame_view_t (knx_frame.h), đọc thẳng trên buffer
 
 // Validation results
 typedef enum {
@@ -25,6 +17,7 @@ typedef enum {
 } frame_validation_result_t;
 
 // Function prototypes
+uint8_t knx_calc_checksum(const uint8_t *data, uint8_t len);
 frame_validation_result_t validate_knx_frame(const uint8_t *data, uint8_t len);
 bool is_valid_knx_address(const uint8_t *address);
 bool is_valid_knx_control(uint8_t control);
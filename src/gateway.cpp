@@ -0,0 +1,296 @@
+#include "gateway.h"
+#include "config.h"
+#include "knx_tx.h"
+#include "knx_rx.h"
+#include "system_utils.h"
+#include "event_loop.h"
+#include "logger.h"
+#include "tpuart/tpuart.h"
+#include "tpuart/host_link.h"
+#include "tpuart/host_diag.h"
+#include "trace.h"
+#include "metrics.h"
+#include "recovery.h"
+#include "profiler.h"
+#include "capture.h"
+#include "coupler.h"
+#include "bus_rx_ring.h"
+#include "hal/hal.h"
+
+// ACK window tính từ điểm lấy mẫu stop bit của checksum (13-15 bit time), theo bus timebase
+#define ACK_WINDOW_START_US (KNX_BIT_PERIOD_US * 13)
+#define ACK_WINDOW_END_US   (KNX_BIT_PERIOD_US * 15)
+
+static uint32_t last_byte_time = 0;
+static uint32_t checksum_rx_time = 0;
+static bool ack_armed = false;
+
+// Byte line 0 từ ISR, xử lý ở EVT_RX_BYTE
+static bus_rx_ring_t bus_rx_ring;
+
+static_assert(EVT_COUNT == METRIC_EVT_LATENCY_LINE1_US - METRIC_EVT_LATENCY_RX_US + 1,
+              "Mỗi event cần 1 gauge METRIC_EVT_LATENCY_*");
+
+// =================== Random Function ===================
+static uint64_t seed = 1;
+uint8_t random_num(uint8_t a, uint8_t b) {
+    seed = (seed * 1664525ULL + 1013904223ULL) & 0xFFFFFFFFULL;
+    return (seed % (b - a + 1)) + a;  // [a..b]
+
+}
+
+// ========== 1. RX từ bus KNX ==========
+void gateway_bus_byte_isr(uint8_t byte) {
+  bus_rx_ring_put(&bus_rx_ring, byte, knx_rx_take_parity_error(KNX_LINE_MAIN));
+  event_post(EVT_RX_BYTE);
+}
+
+void gateway_on_bus_byte(uint8_t byte, bool parity_error) {
+  metric_inc(METRIC_RX_BYTES);
+  CAPTURE_BUS_RX(byte, parity_error);
+  if (parity_error) {
+    metric_inc(METRIC_RX_PARITY_ERRORS);
+    knx_mark_BUS_error(PARITY_BIT_ERROR);
+  }
+  knx_parse_BUS_byte(byte);
+#if KNX_COUPLER_ENABLE
+  // Sau tpuart: ACK mà coupler yêu cầu ở checksum áp dụng cho frame tpuart vừa nhận xong
+  coupler_on_bus_byte(KNX_LINE_MAIN, byte, parity_error);
+#endif
+}
+
+// Bus rảnh KNX_RX_IDLE_US sau byte cuối (compare HAL_TB_IDLE) → kết thúc frame đang nhận (echo thiếu ACK → L_DATA_CON âm)
+void gateway_service_bus_gap(void) {
+  if (knx_rx_take_idle(KNX_LINE_MAIN)) {
+    knx_BUS_gap_timeout();
+  }
+}
+
+//============================================================================================
+// NOTE: ACK Timing - CRITICAL (1352-1560µs window) ==========
+void gateway_service_ack(bool deadline_reached) {
+  if (!is_pending_ack()) {
+    if (ack_armed) {
+      event_cancel_ack_deadline();
+      ack_armed = false;
+    }
+    return;
+  }
+
+  // MCU đã yêu cầu ACK: arm deadline khi frame đã nhận xong checksum.
+  // Mốc là timestamp của checksum trong ISR, không phải lúc loop xử lý → latency của loop không làm lệch window
+  if (!ack_armed) {
+    if (is_rx_waiting_ack()) {
+      checksum_rx_time = knx_rx_last_byte_time(KNX_LINE_MAIN);
+      ack_armed = true;
+      TRACE(TRACE_ACK_ARM, get_ack_value(), hal_timebase_now() - checksum_rx_time);
+      event_arm_ack_deadline(checksum_rx_time + ACK_WINDOW_START_US);
+    }
+    return;
+  }
+
+  if (!deadline_reached) {
+    return;
+  }
+
+  uint32_t elapsed = hal_timebase_now() - checksum_rx_time;
+  if (!is_get_echo_frame() && elapsed < ACK_WINDOW_END_US) {
+    // Nếu có U_ACK_REQ từ MCU → gửi ACK xuống bus KNX
+    TRACE(TRACE_ACK_SEND, get_ack_value(), elapsed);
+    uint8_t ack = get_ack_value();
+    knx_error_t result = knx_send_ack_byte(ack);
+    CAPTURE_BUS_TX(result, &ack, 1, true);
+    if (result == KNX_OK) {
+      ack_sent(ack);
+      metric_inc(METRIC_ACK_SENT);
+      if (elapsed > ACK_WINDOW_START_US + KNX_BIT_PERIOD_US) {
+        metric_inc(METRIC_ACK_LATE);
+      }
+      metric_min(METRIC_ACK_LATENCY_MIN_US, elapsed);
+      metric_max(METRIC_ACK_LATENCY_MAX_US, elapsed);
+    } else {
+      metric_inc(METRIC_ACK_MISSED);
+    }
+  } else {
+    TRACE(TRACE_ACK_MISS, get_ack_value(), elapsed);
+    if (elapsed >= ACK_WINDOW_END_US) {
+      metric_inc(METRIC_ACK_MISSED);
+      TRACE_TRIGGER(TRACE_TRIG_ACK_MISS);
+    }
+    LOG_DEBUG(LOG_CAT_KNX_TX, "ACK window missed (%lu us)", elapsed);
+  }
+  reset_pending_ack();
+  ack_armed = false;
+}
+//============================================================================================
+
+// ========== 3. UART từ MCU ==========
+void gateway_on_host_bytes(void) {
+  while (hal_host_available()) {
+    // Nếu gap > 5ms → reset TX state (frame mới)
+    // Chế độ marker: ranh giới frame do U_FRAME_END_IND quyết định, không dựa vào khoảng nghỉ
+    if (!host_link_marker_enabled() && hal_micros() - last_byte_time > 2600) {
+      if (is_tx_frame_pending()) {
+        metric_inc(METRIC_HOST_GAP_RESETS);
+      }
+      reset_tx_state();
+    }
+
+    uint8_t b = (uint8_t)hal_host_read();
+    metric_inc(METRIC_HOST_BYTES);
+    CAPTURE_HOST_RX(b);
+    knx_parse_MCU_byte(b);
+    last_byte_time = hal_micros();
+  }
+}
+
+// ========== 4. KNX TX: gửi frame nếu queue có dữ liệu ==========
+static uint8_t tx_idle_bits = KNX_TX_IDLE_BITS;
+
+void gateway_set_tx_idle_bits(uint8_t bits) {
+  tx_idle_bits = bits;
+}
+
+static void gateway_send_head(Frame *f, uint8_t lead_bits) {
+  LOG_HEX_DEBUG(LOG_CAT_KNX_TX, "Sent frame", f->data, f->len);
+  knx_error_t result = knx_send_frame_lead(KNX_LINE_MAIN, f->data, f->len, lead_bits);
+  TRACE(TRACE_TX_RESULT, result, f->len);
+  CAPTURE_BUS_TX(result, f->data, f->len, false);
+  if (result == KNX_OK) {
+    set_echo_frame();
+  } else if (result != KNX_ERROR_BUS_BUSY) {
+    metric_inc(METRIC_TX_INVALID);
+    // Frame không gửi được (sai tham số/độ dài) → bỏ, báo host
+    confirm_frame(false);
+  }
+}
+
+void gateway_service_tx(void) {
+  static bool waiting_backoff = false;
+  static uint32_t backoff_time = 0;
+
+  Frame *f = peek_frame();
+  if (f == nullptr) {
+    return;
+  }
+  if (f->state == FRAME_SENT) {
+    // Frame đầu queue đang chờ echo → hết thời gian thì trả L_DATA_CON âm
+    if (hal_millis() - frame_sent_time() >= ECHO_ACK_TIMEOUT_MS) {
+      TRACE(TRACE_ECHO_TIMEOUT, 0, q_count);
+      metric_inc(METRIC_ECHO_TIMEOUTS);
+      TRACE_TRIGGER(TRACE_TRIG_ECHO_TIMEOUT);
+      LOG_WARN(LOG_CAT_ECHO_ACK, "Echo timeout - negative confirmation");
+      confirm_frame(false);
+    }
+  } else if (tx_idle_bits) {
+    // Quy tắc idle của TP1: frame bắt đầu khi bus rảnh đủ tx_idle_bits bit time, phần còn thiếu (≤ 1 tick)
+    // phát thành bit im lặng trước frame → cùng bit time với device khác, tranh bus bằng arbitration.
+    // Làm tròn tới bit gần nhất: TIM3 chạy tự do nên DMA nào cũng lệch pha tới 1 bit
+    uint32_t idle_us = knx_rx_idle_us(KNX_LINE_MAIN);
+    uint32_t need_us = (uint32_t)tx_idle_bits * KNX_BIT_PERIOD_US;
+    if (idle_us > 0 && idle_us + KNX_TX_LEAD_BITS_MAX * KNX_BIT_PERIOD_US >= need_us) {
+      uint32_t lead_us = idle_us < need_us ? need_us - idle_us : 0;
+      gateway_send_head(f, (lead_us + KNX_BIT_PERIOD_US / 2) / KNX_BIT_PERIOD_US);
+    }
+  } else if (!get_knx_rx_flag(KNX_LINE_MAIN)) {
+    if (!waiting_backoff) {
+      backoff_time = hal_millis() + random_num(2, 3);
+      waiting_backoff = true;
+    } else if (hal_millis() >= backoff_time) {
+      if (!get_knx_rx_flag(KNX_LINE_MAIN)) {
+        gateway_send_head(f, 0);
+      }
+      waiting_backoff = false;
+    }
+  } else {
+    waiting_backoff = false;
+  }
+}
+
+// ========== 5. System health check (mỗi 200ms) ==========
+void gateway_service_health(void) {
+  static uint32_t last_system_check = 0;
+  if (hal_millis() - last_system_check >= 200) {
+    system_health_check();
+    last_system_check = hal_millis();
+    // Latency lớn nhất từ ISR đến handler → gauge, host đọc qua DIAG_METRICS_READ
+    for (uint8_t i = 0; i < EVT_COUNT; i++) {
+      metric_set((metric_id_t)(METRIC_EVT_LATENCY_RX_US + i), event_get_max_latency_us(i));
+    }
+  }
+}
+
+// ========== 6. Lệnh chẩn đoán từ host ==========
+void gateway_service_diag(void) {
+  host_diag_service();
+}
+
+// ========== 7. Supervisor ==========
+void gateway_service_recovery(void) {
+  recovery_service(hal_millis());
+}
+
+// ========== 8. Coupler: byte line 1, route / gửi lại, frame line 1 lên host ==========
+void gateway_service_coupler(void) {
+#if KNX_COUPLER_ENABLE
+  coupler_service();
+#endif
+}
+
+// =================== 1 lượt xử lý theo event mask ===================
+// Gọi từ loop() (target) và native/main.cpp với mask lấy từ event_wait()
+void gateway_dispatch(uint32_t events) {
+  // ========== 1. RX từ bus KNX ==========
+  if (events & EVT_RX_BYTE) {
+    PROF_BEGIN(PROF_STAGE_RX_PARSE);
+    uint8_t byte;
+    bool parity_error;
+    while (bus_rx_ring_get(&bus_rx_ring, &byte, &parity_error)) {
+      gateway_on_bus_byte(byte, parity_error);
+    }
+    PROF_END(PROF_STAGE_RX_PARSE);
+  }
+  if (events & EVT_BUS_IDLE) {
+    gateway_service_bus_gap();
+  }
+  if (events & EVT_TICK) {
+    gateway_service_recovery();
+  }
+
+  // ========== 2. UART từ MCU ==========
+  if (events & EVT_HOST_RX) {
+    PROF_BEGIN(PROF_STAGE_HOST_UART);
+    gateway_on_host_bytes();
+    PROF_END(PROF_STAGE_HOST_UART);
+  }
+  if (events & EVT_TICK) {
+    hal_host_service(); // USB CDC: gửi tiếp packet chưa vào được queue
+  }
+
+  // ========== 3. ACK Timing ==========
+  PROF_BEGIN(PROF_STAGE_ACK);
+  gateway_service_ack(events & EVT_ACK_DEADLINE);
+  PROF_END(PROF_STAGE_ACK);
+
+  // ========== 4. KNX TX ==========
+  PROF_BEGIN(PROF_STAGE_TX);
+  gateway_service_tx();
+  PROF_END(PROF_STAGE_TX);
+
+  // ========== 5. System health check ==========
+  if (events & EVT_TICK) {
+    PROF_BEGIN(PROF_STAGE_HEALTH);
+    gateway_service_health();
+    PROF_END(PROF_STAGE_HEALTH);
+  }
+
+  // ========== 6. Lệnh chẩn đoán từ host ==========
+  if (events & (EVT_HOST_RX | EVT_TICK)) {
+    gateway_service_diag();
+  }
+
+  // ========== 8. Coupler ==========
+  if (events & (EVT_LINE1_RX | EVT_RX_BYTE | EVT_TX_DONE | EVT_TICK)) {
+    gateway_service_coupler();
+  }
+}
@@ -0,0 +1,40 @@
+#ifndef GATEWAY_H
+#define GATEWAY_H
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Các bước xử lý của gateway, được loop() gọi theo event (xem event_loop.h)
+ */
+
+// 1 lượt xử lý các bước dưới đây theo event mask từ event_wait()
+void gateway_dispatch(uint32_t events);
+
+// Callback knx_rx của line 0 (ISR): byte + cờ parity vào ring, post EVT_RX_BYTE
+void gateway_bus_byte_isr(uint8_t byte);
+// Byte từ bus KNX (EVT_RX_BYTE, lấy từ ring)
+void gateway_on_bus_byte(uint8_t byte, bool parity_error);
+// Đọc hết byte đang chờ từ MCU (EVT_HOST_RX)
+void gateway_on_host_bytes(void);
+// ACK timing: arm deadline khi cần ACK, gửi ACK khi tới deadline (EVT_ACK_DEADLINE)
+void gateway_service_ack(bool deadline_reached);
+// Kết thúc frame RX khi bus im lặng quá lâu
+void gateway_service_bus_gap(void);
+// Gửi frame đầu queue / timeout echo
+void gateway_service_tx(void);
+// Bus rảnh bao nhiêu bit time thì gateway bắt đầu frame (KNX_TX_IDLE_BITS; 0 = RX flag hết + backoff 2-3ms)
+void gateway_set_tx_idle_bits(uint8_t bits);
+// System health check (mỗi 200ms)
+void gateway_service_health(void);
+// Phản hồi lệnh chẩn đoán từ host (U_DIAG_REQ), hoãn nếu đang forward frame
+void gateway_service_diag(void);
+// Supervisor: recover subsystem bị treo + reload watchdog (mỗi tick)
+void gateway_service_recovery(void);
+// Coupler (KNX_COUPLER_ENABLE): byte line 1, gửi frame đã route, frame line 1 lên host
+void gateway_service_coupler(void);
+
+uint8_t random_num(uint8_t a, uint8_t b);
+
+#endif // GATEWAY_H
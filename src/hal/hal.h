@@ -0,0 +1,103 @@
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * HAL mỏng giữa protocol core (tpuart, queue, encoder / decoder, logger...) và phần cứng
+ *
+ * Target (STM32F103, stm32duino): hal_stm32.cpp + hal_stm32_tx.cpp + hal_stm32_host.cpp
+ * Native (env:native, Linux):     native/hal_native.cpp - thời gian ảo, bus / serial giả lập
+ *
+ * Protocol core không được đọc thanh ghi, HardwareTimer / HardwareSerial trực tiếp - chỉ qua đây.
+ */
+
+// ===== Clock =====
+uint32_t hal_millis(void);
+uint32_t hal_micros(void);
+// Cycle counter (DWT CYCCNT trên target), hal_cycles_init() bật counter
+void hal_cycles_init(void);
+uint32_t hal_cycles(void);
+uint32_t hal_cycles_per_us(void);
+
+// ===== Critical section (tắt interrupt, lồng nhau được) =====
+uint32_t hal_irq_save(void);
+void hal_irq_restore(uint32_t state);
+
+// ===== Nguyên nhân reset (bit theo layout RCC_CSR, đọc 1 lần rồi xoá cờ phần cứng) =====
+#define HAL_RESET_FLAG_PIN      (1u << 26)
+#define HAL_RESET_FLAG_POR      (1u << 27)
+#define HAL_RESET_FLAG_SOFTWARE (1u << 28)
+#define HAL_RESET_FLAG_IWDG     (1u << 29)
+#define HAL_RESET_FLAG_WWDG     (1u << 30)
+#define HAL_RESET_FLAG_LPWR     (1u << 31)
+uint32_t hal_reset_flags(void);
+
+// ===== Watchdog =====
+void hal_watchdog_start(uint32_t timeout_us);
+void hal_watchdog_reload(void);
+
+// ===== Bus timebase: TIM2 chạy tự do 1 count / µs, mở rộng lên 32 bit bằng ngắt overflow =====
+// Mọi timing của bus (sườn RX, điểm lấy mẫu bit, ACK deadline, bus rảnh) đọc cùng 1 đồng hồ.
+// Timestamp wrap sau ~71 phút: chỉ so sánh bằng hiệu (int32_t)(a - b).
+// Compare channel: cb gọi 1 lần trong ISR khi timebase tới at_us (đã qua → gọi ngay); arm lại trong cb để lặp.
+typedef enum {
+    HAL_TB_SAMPLE = 0,   // knx_rx: điểm lấy mẫu bit, mỗi KNX_BIT_PERIOD_US từ sườn start bit
+    HAL_TB_ACK,          // event_loop: ACK deadline
+    HAL_TB_IDLE,         // knx_rx: bus rảnh KNX_RX_IDLE_US sau byte cuối → hết frame
+    HAL_TB_SAMPLE_LINE1, // knx_rx line 1 (coupler): điểm lấy mẫu bit
+    HAL_TB_CHANNEL_COUNT
+} hal_tb_channel_t;
+void hal_timebase_init(void);
+uint32_t hal_timebase_now(void);   // ISR-safe
+void hal_timebase_arm(hal_tb_channel_t ch, uint32_t at_us, void (*cb)(void));
+void hal_timebase_cancel(hal_tb_channel_t ch);
+bool hal_timebase_armed(hal_tb_channel_t ch);
+
+// ===== Bus RX: line 0 chân PB6, line 1 (coupler) chân PB7 (1 = có xung trên bus) =====
+// edge_isr: mỗi sườn trên chân RX của line (timestamp bằng hal_timebase_now())
+void hal_bus_rx_init(uint8_t line, void (*edge_isr)(void));
+bool hal_bus_pin_level(uint8_t line);
+
+// ===== Bus TX: PWM TIM3 (line 0 CH3 / PB0, line 1 CH4 / PB1) + DMA, mỗi phần tử buffer = độ rộng xung (µs) của 1 bit =====
+// 2 line dùng chung chu kỳ 104µs của TIM3, mỗi line 1 DMA channel riêng
+// done_isr: DMA gửi xong buffer (PWM của line đã dừng)
+void hal_tx_init(uint8_t line, void (*done_isr)(void));
+bool hal_tx_start(uint8_t line, const uint16_t *pulses, uint16_t count);
+bool hal_tx_busy(uint8_t line);
+// Dừng và khởi tạo lại channel TIM3 / DMA của line khi bị treo
+void hal_tx_recover(uint8_t line);
+
+// ===== Host link: USART1 (MCU_SERIAL) hoặc USB CDC, xem hal/host_transport.h =====
+#define HAL_HOST_USART 0
+#define HAL_HOST_CDC   1
+#define HAL_HOST_TRANSPORT_COUNT 2
+// Đổi transport (mặc định KNX_HOST_TRANSPORT); đang chạy thì đóng transport cũ, mở transport mới.
+// false = transport không có trong bản build
+bool hal_host_select(uint8_t transport);
+uint8_t hal_host_transport(void);
+const char *hal_host_transport_name(void);
+void hal_host_begin(void);
+// end() + begin() khi transport bị treo (recovery), bỏ packet đang gom
+void hal_host_restart(void);
+int hal_host_available(void);
+int hal_host_read(void);
+void hal_host_write(const uint8_t *data, uint16_t len);
+// Như hal_host_write cho byte dịch vụ: transport không bỏ khi đang tạm đầy (xem host_transport.h)
+void hal_host_write_service(const uint8_t *data, uint16_t len);
+int hal_host_write_space(void);
+// Hết 1 đơn vị dữ liệu (frame, byte dịch vụ): transport theo packet gửi ngay phần đang gom
+void hal_host_flush(void);
+// Mỗi tick: transport gửi tiếp dữ liệu chưa vào được driver (USB CDC queue đầy)
+void hal_host_service(void);
+// write_space() khi TX rảnh / RX interrupt còn bật - recovery phát hiện transport bị treo
+int hal_host_write_capacity(void);
+bool hal_host_rx_enabled(void);
+
+// ===== Debug serial (USART3 - DEBUG_SERIAL) =====
+void hal_debug_write(const uint8_t *data, uint16_t len);
+int hal_debug_write_space(void);
+void hal_debug_flush(void);
+
+#endif // HAL_H
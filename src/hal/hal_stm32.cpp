@@ -0,0 +1,222 @@
+#include "hal/hal.h"
+#include "config.h"
+#include "profiler.h"
+
+#if !KNX_NATIVE
+
+#include <HardwareTimer.h>
+#include <IWatchdog.h>
+
+// Chân RX theo line: PB6 (EXTI6) / PB7 (EXTI7), cùng EXTI9_5_IRQn
+static const uint32_t bus_rx_pin[KNX_LINE_COUNT] = {
+    PB6,
+#if KNX_COUPLER_ENABLE
+    PB7,
+#endif
+};
+static const uint16_t bus_rx_mask[KNX_LINE_COUNT] = {
+    1 << 6,
+#if KNX_COUPLER_ENABLE
+    1 << 7,
+#endif
+};
+
+// TIM2: timebase 1µs/count chạy tự do, CH1..CH4 = compare channel HAL_TB_*
+static HardwareTimer tb_timer(TIM2);
+
+// ===== Clock =====
+uint32_t hal_millis(void) {
+    return millis();
+}
+
+uint32_t hal_micros(void) {
+    return micros();
+}
+
+void hal_cycles_init(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+uint32_t hal_cycles(void) {
+    return DWT->CYCCNT;
+}
+
+uint32_t hal_cycles_per_us(void) {
+    return SystemCoreClock / 1000000;
+}
+
+// ===== Critical section =====
+uint32_t hal_irq_save(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    return primask;
+}
+
+void hal_irq_restore(uint32_t state) {
+    __set_PRIMASK(state);
+}
+
+// ===== Reset flags =====
+uint32_t hal_reset_flags(void) {
+    static bool captured = false;
+    static uint32_t flags = 0;
+    if (!captured) {
+        flags = RCC->CSR & (RCC_CSR_LPWRRSTF | RCC_CSR_WWDGRSTF | RCC_CSR_IWDGRSTF |
+                            RCC_CSR_SFTRSTF | RCC_CSR_PORRSTF | RCC_CSR_PINRSTF);
+        RCC->CSR |= RCC_CSR_RMVF;
+        captured = true;
+    }
+    return flags;
+}
+
+// ===== Watchdog =====
+void hal_watchdog_start(uint32_t timeout_us) {
+    IWatchdog.begin(timeout_us);
+}
+
+void hal_watchdog_reload(void) {
+    IWatchdog.reload();
+}
+
+// ===== Bus timebase =====
+// CNT 16 bit + tb_high (bội số 0x10000, cộng trong ngắt update). Đích xa hơn 1 vòng counter:
+// compare khớp 16 bit thấp mỗi 65.536ms, ISR so đủ 32 bit rồi mới gọi callback.
+typedef struct {
+    volatile uint32_t at;
+    void (*volatile cb)(void);
+    volatile bool armed;
+    volatile bool forced;  // Đích đã qua lúc arm → sự kiện tạo bằng EGR, không tính độ trễ ngắt
+} tb_channel_t;
+
+static volatile uint32_t tb_high = 0;
+static tb_channel_t tb_ch[HAL_TB_CHANNEL_COUNT];
+
+// CCxIE / CCxIF / CCxG của CH1..CH4 nằm liên tiếp từ bit 1
+static inline uint32_t tb_ch_bit(hal_tb_channel_t ch) {
+    return TIM_DIER_CC1IE << ch;
+}
+
+static inline volatile uint32_t *tb_ccr(hal_tb_channel_t ch) {
+    return &TIM2->CCR1 + ch;
+}
+
+static void tb_overflow_isr(void) {
+    tb_high += 0x10000;
+}
+
+static void tb_compare_isr(hal_tb_channel_t ch) {
+    tb_channel_t *c = &tb_ch[ch];
+    uint32_t now = hal_timebase_now();
+    if (!c->armed || (int32_t)(now - c->at) < 0) {
+        return; // Chưa tới vòng counter của đích
+    }
+#if KNX_PROFILER_ENABLE
+    if (!c->forced) {
+        profiler_record_latency_us(PROF_LAT_TIM2, now - c->at);
+    }
+#endif
+    c->armed = false;
+    TIM2->DIER &= ~tb_ch_bit(ch);
+    c->cb();
+}
+
+static void tb_sample_isr(void) {
+    tb_compare_isr(HAL_TB_SAMPLE);
+}
+
+static void tb_ack_isr(void) {
+    tb_compare_isr(HAL_TB_ACK);
+}
+
+static void tb_idle_isr(void) {
+    tb_compare_isr(HAL_TB_IDLE);
+}
+
+static void tb_sample_line1_isr(void) {
+    tb_compare_isr(HAL_TB_SAMPLE_LINE1);
+}
+
+void hal_timebase_init(void) {
+    static void (*const isr[HAL_TB_CHANNEL_COUNT])(void) = {tb_sample_isr, tb_ack_isr, tb_idle_isr,
+                                                           tb_sample_line1_isr};
+    tb_timer.setPrescaleFactor((SystemCoreClock / 1000000) - 1); // CK_CNT = 1MHz
+    tb_timer.setOverflow(0x10000);
+    tb_timer.attachInterrupt(tb_overflow_isr);
+    for (uint8_t ch = 0; ch < HAL_TB_CHANNEL_COUNT; ch++) {
+        tb_timer.setMode(ch + 1, TIMER_OUTPUT_COMPARE);  // Timing mode, không ra chân
+        tb_timer.attachInterrupt(ch + 1, isr[ch]);
+    }
+    tb_timer.resume();
+    // resume() bật ngắt mọi channel có callback → chỉ bật lại khi arm
+    for (uint8_t ch = 0; ch < HAL_TB_CHANNEL_COUNT; ch++) {
+        tb_ch[ch].armed = false;
+        TIM2->DIER &= ~tb_ch_bit((hal_tb_channel_t)ch);
+    }
+}
+
+uint32_t hal_timebase_now(void) {
+    uint32_t irq = hal_irq_save();
+    uint32_t high = tb_high;
+    uint32_t cnt = TIM2->CNT;
+    // Counter đã tràn nhưng ngắt update chưa chạy (đang trong ISR khác / IRQ tắt)
+    if ((TIM2->SR & TIM_SR_UIF) && cnt < 0x8000) {
+        high += 0x10000;
+    }
+    hal_irq_restore(irq);
+    return high | cnt;
+}
+
+void hal_timebase_arm(hal_tb_channel_t ch, uint32_t at_us, void (*cb)(void)) {
+    uint32_t irq = hal_irq_save();
+    tb_channel_t *c = &tb_ch[ch];
+    c->at = at_us;
+    c->cb = cb;
+    c->armed = true;
+    c->forced = false;
+    *tb_ccr(ch) = at_us & 0xFFFF;
+    TIM2->SR = ~tb_ch_bit(ch);     // Bỏ lần khớp cũ (rc_w0)
+    TIM2->DIER |= tb_ch_bit(ch);
+    // Compare đã bật trước khi đọc counter: đích chưa qua thì phần cứng sẽ khớp, đã qua thì tự tạo sự kiện
+    if ((int32_t)(hal_timebase_now() - at_us) >= 0) {
+        c->forced = true;
+        TIM2->EGR = tb_ch_bit(ch);
+    }
+    hal_irq_restore(irq);
+}
+
+void hal_timebase_cancel(hal_tb_channel_t ch) {
+    uint32_t irq = hal_irq_save();
+    tb_ch[ch].armed = false;
+    TIM2->DIER &= ~tb_ch_bit(ch);
+    hal_irq_restore(irq);
+}
+
+bool hal_timebase_armed(hal_tb_channel_t ch) {
+    return tb_ch[ch].armed;
+}
+
+// ===== Bus RX =====
+void hal_bus_rx_init(uint8_t line, void (*edge_isr)(void)) {
+    attachInterrupt(digitalPinToInterrupt(bus_rx_pin[line]), edge_isr, CHANGE);
+    pinMode(bus_rx_pin[line], INPUT);
+}
+
+bool hal_bus_pin_level(uint8_t line) {
+    return (GPIOB->IDR & bus_rx_mask[line]) != 0;
+}
+
+// ===== Debug serial =====
+void hal_debug_write(const uint8_t *data, uint16_t len) {
+    DEBUG_SERIAL.write(data, len);
+}
+
+int hal_debug_write_space(void) {
+    return DEBUG_SERIAL.availableForWrite();
+}
+
+void hal_debug_flush(void) {
+    DEBUG_SERIAL.flush();
+}
+
+#endif // !KNX_NATIVE
@@ -0,0 +1,151 @@
+#include "hal/hal.h"
+#include "hal/host_transport.h"
+#include <string.h>
+#include "config.h"
+#include "metrics.h"
+
+#if !KNX_NATIVE
+
+// ===== USART1 (MCU_SERIAL) =====
+static void usart_begin(void) {
+    MCU_SERIAL.begin(UART_BAUD_RATE, SERIAL_8E1);
+}
+
+static void usart_end(void) {
+    MCU_SERIAL.end();
+}
+
+static int usart_available(void) {
+    return MCU_SERIAL.available();
+}
+
+static int usart_read(void) {
+    return MCU_SERIAL.read();
+}
+
+static void usart_write(const uint8_t *data, uint16_t len, bool service) {
+    (void)service; // Buffer TX đầy thì write() chờ UART, không bỏ byte
+    MCU_SERIAL.write(data, len);
+}
+
+static int usart_write_space(void) {
+    return MCU_SERIAL.availableForWrite();
+}
+
+// Lỗi ORE / FE trong HAL UART có thể tắt RXNEIE mà không bật lại
+static bool usart_rx_enabled(void) {
+    return (USART1->CR1 & USART_CR1_RXNEIE) != 0;
+}
+
+static const host_transport_t host_usart = {
+    "usart",
+    usart_begin, usart_end, usart_available, usart_read, usart_write, usart_write_space,
+    SERIAL_TX_BUFFER_SIZE - 1,
+    0,
+    usart_rx_enabled,
+    nullptr,
+};
+
+#if defined(USBCON) && defined(USBD_USE_CDC)
+// ===== USB CDC (SerialUSB, PA11 / PA12) =====
+// Main loop không được block: queue CDC đầy (host đọc chậm) → giữ packet trong cdc_pending, cdc_service() gửi tiếp
+// mỗi tick. Chỉ bỏ khi host đóng cổng (DTR = 0) hoặc pending đầy; CDC_SERVICE_RESERVE byte cuối của pending chỉ
+// dành cho packet có byte dịch vụ → frame bus dồn lại không đẩy L_DATA_CON ra ngoài
+#define CDC_PENDING_SIZE (HOST_CDC_PACKET_SIZE * 4)
+#define CDC_SERVICE_RESERVE HOST_CDC_PACKET_SIZE
+
+static uint8_t cdc_pending[CDC_PENDING_SIZE];
+static uint16_t cdc_pending_len = 0;
+
+static void cdc_drop_pending(void) {
+    if (cdc_pending_len) {
+        metric_add(METRIC_HOST_TX_DROPPED, cdc_pending_len);
+        cdc_pending_len = 0;
+    }
+}
+
+static void cdc_begin(void) {
+    cdc_pending_len = 0;
+    SerialUSB.begin();
+}
+
+static void cdc_end(void) {
+    cdc_drop_pending();
+    SerialUSB.end();
+}
+
+static int cdc_available(void) {
+    return SerialUSB.available();
+}
+
+static int cdc_read(void) {
+    return SerialUSB.read();
+}
+
+static void cdc_service(void) {
+    if (!SerialUSB) {
+        cdc_drop_pending();
+        return;
+    }
+    int space = SerialUSB.availableForWrite();
+    if (cdc_pending_len == 0 || space <= 0) {
+        return;
+    }
+    uint16_t n = space < cdc_pending_len ? (uint16_t)space : cdc_pending_len;
+    SerialUSB.write(cdc_pending, n);
+    metric_inc(METRIC_HOST_TX_PACKETS);
+    cdc_pending_len -= n;
+    memmove(cdc_pending, cdc_pending + n, cdc_pending_len);
+}
+
+static void cdc_write(const uint8_t *data, uint16_t len, bool service) {
+    cdc_service();
+    if (!SerialUSB) {
+        metric_add(METRIC_HOST_TX_DROPPED, len);
+        return;
+    }
+    if (cdc_pending_len == 0 && SerialUSB.availableForWrite() >= len) {
+        SerialUSB.write(data, len);
+        metric_inc(METRIC_HOST_TX_PACKETS);
+        return;
+    }
+    uint16_t limit = service ? CDC_PENDING_SIZE : CDC_PENDING_SIZE - CDC_SERVICE_RESERVE;
+    if (cdc_pending_len + len > limit) {
+        metric_add(METRIC_HOST_TX_DROPPED, len);
+        return;
+    }
+    memcpy(cdc_pending + cdc_pending_len, data, len);
+    cdc_pending_len += len;
+}
+
+// Byte còn ghi được mà không phải giữ lại. Cổng đóng: ghi bị bỏ ngay → báo cả pending để report gửi dần
+// (host_diag_report) chạy hết thay vì chờ rồi bị huỷ
+static int cdc_write_space(void) {
+    if (!SerialUSB) {
+        return CDC_PENDING_SIZE;
+    }
+    int space = SerialUSB.availableForWrite() - cdc_pending_len;
+    return space > 0 ? space : 0;
+}
+
+// write_capacity = 0: queue đứng yên khi host không đọc là bình thường, restart USB không giúp gì
+static const host_transport_t host_cdc = {
+    "usb-cdc",
+    cdc_begin, cdc_end, cdc_available, cdc_read, cdc_write, cdc_write_space,
+    0,
+    HOST_CDC_PACKET_SIZE,
+    nullptr,
+    cdc_service,
+};
+#endif
+
+const host_transport_t *const host_transports[HAL_HOST_TRANSPORT_COUNT] = {
+    &host_usart,
+#if defined(USBCON) && defined(USBD_USE_CDC)
+    &host_cdc,
+#else
+    nullptr,
+#endif
+};
+
+#endif // !KNX_NATIVE
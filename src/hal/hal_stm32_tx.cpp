@@ -0,0 +1,237 @@
+#include "hal/hal.h"
+#include "config.h" // For DEBUG_SERIAL
+#include "profiler.h"
+#include "metrics.h"
+#include "recovery.h"
+
+#if KNX_TX_MODE && !KNX_NATIVE
+
+extern "C" {
+    #include "stm32f1xx_hal.h"
+    #include "stm32f1xx_hal_rcc.h" // Để kiểm tra clock
+}
+
+// Forward declaration for custom error handler
+void my_Error_Handler(void);
+
+// Define handles here (single definition)
+TIM_HandleTypeDef htim3;
+DMA_HandleTypeDef hdma_tim3_ch3;
+#if KNX_COUPLER_ENABLE
+DMA_HandleTypeDef hdma_tim3_ch4;
+#endif
+
+// Phần cứng TX của từng line: 2 line dùng chung TIM3 (chu kỳ bit 104µs), khác channel / chân / DMA.
+// TIM1 (chân PA8..PA11 trùng USART1 / USB) và TIM4 (tick 1ms) không dùng được cho line 1.
+typedef struct {
+    uint32_t channel;                 // TIM_CHANNEL_x
+    HAL_TIM_ActiveChannel active;     // htim->Channel trong PulseFinishedCallback
+    uint16_t dma_id;                  // TIM_DMA_ID_CCx
+    uint16_t pin;                     // Chân GPIOB
+    DMA_HandleTypeDef *hdma;
+    DMA_Channel_TypeDef *dma_channel; // Request TIM3_CHx cố định trên DMA1
+    IRQn_Type dma_irq;
+} tx_line_hw_t;
+
+static const tx_line_hw_t tx_hw[KNX_LINE_COUNT] = {
+    {TIM_CHANNEL_3, HAL_TIM_ACTIVE_CHANNEL_3, TIM_DMA_ID_CC3, GPIO_PIN_0, &hdma_tim3_ch3, DMA1_Channel2,
+     DMA1_Channel2_IRQn},
+#if KNX_COUPLER_ENABLE
+    {TIM_CHANNEL_4, HAL_TIM_ACTIVE_CHANNEL_4, TIM_DMA_ID_CC4, GPIO_PIN_1, &hdma_tim3_ch4, DMA1_Channel3,
+     DMA1_Channel3_IRQn},
+#endif
+};
+
+static void (*tx_done_isr[KNX_LINE_COUNT])(void);
+static bool tim3_ready = false;
+#if KNX_PROFILER_ENABLE
+// Giá trị compare kích DMA transfer cuối (pulses[count - 2]) của line 0, -1 = chuỗi quá ngắn để đo
+static int32_t tx_last_match = -1;
+#endif
+
+// Forward declarations
+extern "C" void DMA1_Channel2_IRQHandler(void);
+#if KNX_COUPLER_ENABLE
+extern "C" void DMA1_Channel3_IRQHandler(void);
+#endif
+
+// === TIM3 basic init (dùng chung mọi line) ===
+extern "C" void MX_TIM3_Init(void) {
+    // Enable clocks
+    __HAL_RCC_TIM3_CLK_ENABLE();
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    __HAL_RCC_GPIOA_CLK_ENABLE();
+
+    htim3.Instance = TIM3;
+    htim3.Init.Prescaler = (SystemCoreClock / 1000000) - 1;
+    htim3.Init.CounterMode = TIM_COUNTERMODE_UP;
+    //72MHz
+    //     htim3.Init.Period = 7499
+    //64MHz
+    htim3.Init.Period = 103; // 64MHz / (6666 + 1) = 9600Hz (104.166us)
+    htim3.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+    htim3.Init.RepetitionCounter = 0;
+    htim3.Init.AutoReloadPreload = TIM_AUTORELOAD_PRELOAD_ENABLE;
+    if (HAL_TIM_PWM_Init(&htim3) != HAL_OK) {
+        my_Error_Handler();
+    }
+    tim3_ready = true;
+}
+
+// === OC config cho channel của line (PWM2) ===
+static HAL_StatusTypeDef tx_config_channel(uint8_t line) {
+    TIM_OC_InitTypeDef sConfigOC = {0};
+    sConfigOC.OCMode = TIM_OCMODE_PWM2;
+    sConfigOC.Pulse = 0;
+    sConfigOC.OCPolarity = TIM_OCPOLARITY_LOW;
+    sConfigOC.OCNPolarity = TIM_OCNPOLARITY_HIGH;
+    sConfigOC.OCFastMode = TIM_OCFAST_DISABLE;
+    sConfigOC.OCIdleState = TIM_OCIDLESTATE_RESET;
+    sConfigOC.OCNIdleState = TIM_OCNIDLESTATE_RESET;
+    return HAL_TIM_PWM_ConfigChannel(&htim3, &sConfigOC, tx_hw[line].channel);
+}
+
+static void tx_line_init(uint8_t line) {
+    const tx_line_hw_t *hw = &tx_hw[line];
+
+    // === GPIO PB0 / PB1 as AF Push-Pull (TIM3_CH3 / CH4) ===
+    GPIO_InitTypeDef GPIO_InitStruct = {0};
+    GPIO_InitStruct.Pin = hw->pin;
+    GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+    GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+    HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+    if (tx_config_channel(line) != HAL_OK) {
+        my_Error_Handler();
+    }
+
+    // === DMA init for TIM3_CHx ===
+    hw->hdma->Instance = hw->dma_channel;
+    hw->hdma->Init.Direction = DMA_MEMORY_TO_PERIPH;
+    hw->hdma->Init.PeriphInc = DMA_PINC_DISABLE;
+    hw->hdma->Init.MemInc = DMA_MINC_ENABLE;
+    hw->hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+    hw->hdma->Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
+    hw->hdma->Init.Mode = DMA_NORMAL;
+    hw->hdma->Init.Priority = DMA_PRIORITY_HIGH;
+    if (HAL_DMA_Init(hw->hdma) != HAL_OK) {
+        my_Error_Handler();
+    }
+
+    // Link DMA handle to TIM handle (CCx)
+    __HAL_LINKDMA(&htim3, hdma[hw->dma_id], *hw->hdma);
+
+    // NVIC for DMA channel
+    HAL_NVIC_SetPriority(hw->dma_irq, KNX_NVIC_PRIO_BASE + KNX_NVIC_PRIO_DMA_TX, 0);
+    HAL_NVIC_EnableIRQ(hw->dma_irq);
+}
+
+void hal_tx_init(uint8_t line, void (*done_isr)(void)) {
+    tx_done_isr[line] = done_isr;
+    if (!tim3_ready) {
+        MX_TIM3_Init();
+    }
+    tx_line_init(line);
+}
+
+bool hal_tx_start(uint8_t line, const uint16_t *pulses, uint16_t count) {
+#if KNX_PROFILER_ENABLE
+    if (line == KNX_LINE_MAIN) {
+        tx_last_match = count >= 2 ? pulses[count - 2] : -1;
+    }
+#endif
+    return HAL_TIM_PWM_Start_DMA(&htim3, tx_hw[line].channel, (uint32_t *)pulses, count) == HAL_OK;
+}
+
+bool hal_tx_busy(uint8_t line) {
+    return tx_hw[line].hdma->State != HAL_DMA_STATE_READY;
+}
+
+// ===== Callback khi DMA hoàn tất =====
+// Stop_DMA chỉ tắt channel của line; counter TIM3 chỉ dừng khi không còn channel nào bật
+extern "C" void HAL_TIM_PWM_PulseFinishedCallback(TIM_HandleTypeDef *htim) {
+    if (htim->Instance != TIM3) {
+        return;
+    }
+    for (uint8_t line = 0; line < KNX_LINE_COUNT; line++) {
+        if (htim->Channel == tx_hw[line].active) {
+            HAL_TIM_PWM_Stop_DMA(&htim3, tx_hw[line].channel);
+            if (tx_done_isr[line]) {
+                tx_done_isr[line]();
+            }
+        }
+    }
+}
+
+// DMA IRQ handler (must be C linkage)
+extern "C" void DMA1_Channel2_IRQHandler(void) {
+    PROF_SCOPE(PROF_ISR_DMA_TX);
+#if KNX_PROFILER_ENABLE
+    // CCR3 có preload: transfer cuối được kích khi CNT khớp giá trị pulses[count - 2] đang active
+    if ((DMA1->ISR & DMA_ISR_TCIF2) && tx_last_match >= 0) {
+        uint32_t period = htim3.Init.Period + 1;
+        profiler_record_latency_us(PROF_LAT_DMA_TX, (TIM3->CNT + period - tx_last_match) % period);
+    }
+#endif
+    HAL_DMA_IRQHandler(&hdma_tim3_ch3);
+}
+
+#if KNX_COUPLER_ENABLE
+extern "C" void DMA1_Channel3_IRQHandler(void) {
+    HAL_DMA_IRQHandler(&hdma_tim3_ch4);
+}
+#endif
+
+// Khởi tạo lại DMA + channel TIM3 của line (dùng chung cho error handler và supervisor)
+static void knx_tx_reinit(uint8_t line) {
+    // Reset DMA
+    HAL_DMA_DeInit(tx_hw[line].hdma);
+    HAL_DMA_Init(tx_hw[line].hdma);
+
+    // Reset Timer: TIM3 dùng chung → chỉ khi không line nào khác đang phát
+    bool shared_busy = false;
+    for (uint8_t other = 0; other < KNX_LINE_COUNT; other++) {
+        if (other != line && hal_tx_busy(other)) {
+            shared_busy = true;
+        }
+    }
+    if (!shared_busy) {
+        HAL_TIM_PWM_DeInit(&htim3);
+        HAL_TIM_PWM_Init(&htim3);
+    }
+
+    // Reconfigure channel
+    tx_config_channel(line);
+}
+
+void hal_tx_recover(uint8_t line) {
+    HAL_TIM_PWM_Stop_DMA(&htim3, tx_hw[line].channel);
+    knx_tx_reinit(line);
+}
+
+// Custom error handler với recovery mechanism
+static uint32_t error_count = 0;
+static uint32_t last_error_time = 0;
+
+void my_Error_Handler(void) {
+    error_count++;
+    metric_inc(METRIC_SYS_ERRORS);
+    last_error_time = millis();
+    
+    // Log error
+    DEBUG_SERIAL.printf("Error #%lu at %lu ms\n", error_count, last_error_time);
+    
+    // Recovery mechanism - reset peripherals
+    if (error_count < MAX_ERROR_RETRY_COUNT) { // Giới hạn số lần retry
+        DEBUG_SERIAL.println("Attempting recovery...");
+        for (uint8_t line = 0; line < KNX_LINE_COUNT; line++) {
+            knx_tx_reinit(line);
+        }
+        DEBUG_SERIAL.println("Recovery completed");
+    } else {
+        // Quá nhiều lỗi → warm restart (queue + cấu hình giữ lại trong .noinit)
+        DEBUG_SERIAL.println("Too many errors - warm restart");
+        recovery_warm_restart(RECOVERY_REASON_ERROR_HANDLER, (uint8_t)error_count);
+    }
+}
+#endif // KNX_TX_MODE && !KNX_NATIVE
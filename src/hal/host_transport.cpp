@@ -0,0 +1,134 @@
+#include "hal/hal.h"
+#include "hal/host_transport.h"
+#include <string.h>
+#include "config.h"
+
+static uint8_t host_id = KNX_HOST_TRANSPORT;
+static bool host_started = false;
+
+// Packet đang gom của transport theo packet
+static uint8_t packet_buf[HOST_CDC_PACKET_SIZE];
+static uint16_t packet_len = 0;
+static bool packet_service = false;     // Packet đang gom có byte dịch vụ
+
+static const host_transport_t *host_tp(void) {
+    return host_transports[host_id];
+}
+
+static uint16_t packet_size(const host_transport_t *tp) {
+    return tp->packet_size < sizeof(packet_buf) ? tp->packet_size : sizeof(packet_buf);
+}
+
+bool hal_host_select(uint8_t transport) {
+    if (transport >= HAL_HOST_TRANSPORT_COUNT || !host_transports[transport]) {
+        return false;
+    }
+    if (transport == host_id) {
+        return true;
+    }
+    if (host_started) {
+        hal_host_flush();
+        host_tp()->end();
+        host_id = transport;
+        host_tp()->begin();
+    } else {
+        host_id = transport;
+    }
+    return true;
+}
+
+uint8_t hal_host_transport(void) {
+    return host_id;
+}
+
+const char *hal_host_transport_name(void) {
+    return host_tp()->name;
+}
+
+void hal_host_begin(void) {
+    // Transport mặc định không có trong bản build → về USART
+    if (!host_transports[host_id]) {
+        host_id = HAL_HOST_USART;
+    }
+    packet_len = 0;
+    packet_service = false;
+    host_tp()->begin();
+    host_started = true;
+}
+
+void hal_host_restart(void) {
+    packet_len = 0;
+    packet_service = false;
+    host_tp()->end();
+    host_tp()->begin();
+    host_started = true;
+}
+
+int hal_host_available(void) {
+    return host_tp()->available();
+}
+
+int hal_host_read(void) {
+    return host_tp()->read();
+}
+
+static void host_write(const uint8_t *data, uint16_t len, bool service) {
+    const host_transport_t *tp = host_tp();
+    uint16_t size = packet_size(tp);
+    if (size == 0) {
+        tp->write(data, len, service);
+        return;
+    }
+    packet_service |= service;
+    while (len) {
+        uint16_t n = size - packet_len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(packet_buf + packet_len, data, n);
+        packet_len += n;
+        data += n;
+        len -= n;
+        if (packet_len == size) {
+            tp->write(packet_buf, packet_len, packet_service);
+            packet_len = 0;
+            packet_service = service && len;
+        }
+    }
+}
+
+void hal_host_write(const uint8_t *data, uint16_t len) {
+    host_write(data, len, false);
+}
+
+void hal_host_write_service(const uint8_t *data, uint16_t len) {
+    host_write(data, len, true);
+}
+
+int hal_host_write_space(void) {
+    return host_tp()->write_space() - packet_len;
+}
+
+void hal_host_flush(void) {
+    if (packet_len) {
+        host_tp()->write(packet_buf, packet_len, packet_service);
+        packet_len = 0;
+        packet_service = false;
+    }
+}
+
+void hal_host_service(void) {
+    const host_transport_t *tp = host_tp();
+    if (tp->service) {
+        tp->service();
+    }
+}
+
+int hal_host_write_capacity(void) {
+    return host_tp()->write_capacity;
+}
+
+bool hal_host_rx_enabled(void) {
+    const host_transport_t *tp = host_tp();
+    return !tp->rx_enabled || tp->rx_enabled();
+}
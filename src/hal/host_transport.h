@@ -0,0 +1,40 @@
+#ifndef HOST_TRANSPORT_H
+#define HOST_TRANSPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Backend của host link (hal_host_* trong hal.h dispatch tới transport đang chọn)
+ *
+ * - HAL_HOST_USART: byte stream, ghi thẳng xuống driver (USART1 19200 8E1 trên target)
+ * - HAL_HOST_CDC:   transport theo packet (USB CDC trên target, stand-in RAM trên native).
+ *   hal_host_write() gom byte vào 1 packet packet_size byte; packet được gửi khi đầy hoặc khi
+ *   hal_host_flush() (host_link gọi ở cuối mỗi frame / byte dịch vụ) → 1 frame đi trong 1 packet
+ *   thay vì rải ra nhiều USB transaction.
+ *
+ * Mỗi nền tảng (hal_stm32_host.cpp / native/hal_native.cpp) định nghĩa host_transports[]; transport
+ * không có trong bản build (CDC khi không có USBCON) là nullptr → hal_host_select() trả false.
+ * Tất cả chạy trong main loop (RTOS: chỉ trong task host_link, xem rtos_tasks.h) nên buffer packet không cần khoá.
+ *
+ * write(service = true): dữ liệu có byte dịch vụ (L_DATA_CON, U_DIAG_IND...) - transport giữ lại dữ liệu chưa gửi
+ * được (USB CDC) chỉ bỏ loại này khi host đóng cổng. service() được gọi mỗi tick để gửi tiếp phần đang giữ.
+ */
+
+typedef struct {
+    const char *name;
+    void (*begin)(void);
+    void (*end)(void);
+    int (*available)(void);
+    int (*read)(void);
+    void (*write)(const uint8_t *data, uint16_t len, bool service);
+    int (*write_space)(void);
+    int write_capacity;      // write_space() khi TX rảnh (recovery: TX không tiến)
+    uint16_t packet_size;    // 0 = stream, > 0 = gom thành packet tối đa packet_size byte
+    bool (*rx_enabled)(void);  // RX interrupt còn bật (nullptr = luôn bật)
+    void (*service)(void);     // Gửi tiếp dữ liệu đang giữ (nullptr = transport không giữ lại gì)
+} host_transport_t;
+
+extern const host_transport_t *const host_transports[];
+
+#endif // HOST_TRANSPORT_H
@@ -0,0 +1,88 @@
+#ifndef KNX_FRAME_H
+#define KNX_FRAME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * View không sở hữu lên 1 telegram KNX TP1 nằm sẵn trong buffer (queue, tx_buffer, frame từ host...)
+ *
+ * Standard: [ctrl] [src hi lo] [dest hi lo] [AT|hop|LG] [TPCI|APCI] [APCI|data] ... [checksum]   = 8 + LG byte
+ * Extended: [ctrl] [AT|hop|EFF] [src hi lo] [dest hi lo] [LG] [TPCI|APCI] [APCI|data] ... [checksum] = 9 + LG byte
+ *   ctrl bit 7 = 1 standard / 0 extended, bit 5 = 1 lần gửi đầu / 0 lặp lại, bit 3-2 = priority
+ *   AT (bit 7) = 1 địa chỉ nhóm, hop = bit 6-4; LG = số byte sau byte TPCI (standard: 4 bit thấp)
+ *
+ * Loại frame đọc từ control byte 1 lần khi tạo view; accessor chỉ đọc đúng byte cần, không copy.
+ * Accessor không kiểm tra độ dài buffer: header (tới byte LG) cần has_header(), phần sau cần well_formed().
+ * Parser nhận từng byte dùng knx_frame_*_offset() / knx_frame_total_len() trước khi có đủ frame.
+ */
+
+#define KNX_CTRL_STANDARD    0x80  // Control field: 1 = standard, 0 = extended
+#define KNX_CTRL_REPEAT_FLAG 0x20  // Control field: 1 = lần gửi đầu, 0 = lặp lại
+#define KNX_ADDR_GROUP       0x80  // Byte AT|hop: 1 = địa chỉ đích là địa chỉ nhóm
+#define KNX_FRAME_MIN_LEN    8     // Standard, LG = 0
+
+constexpr bool knx_frame_is_extended(uint8_t ctrl) { return !(ctrl & KNX_CTRL_STANDARD); }
+constexpr uint8_t knx_frame_route_offset(bool ext) { return ext ? 1 : 5; }  // Byte AT|hop
+constexpr uint8_t knx_frame_src_offset(bool ext) { return ext ? 2 : 1; }
+constexpr uint8_t knx_frame_dest_offset(bool ext) { return ext ? 4 : 3; }
+constexpr uint8_t knx_frame_len_offset(bool ext) { return ext ? 6 : 5; }
+constexpr uint8_t knx_frame_tpci_offset(bool ext) { return ext ? 7 : 6; }
+// Số byte đầu frame chứa đủ địa chỉ đích và bit AT (standard: AT nằm ở byte 5, sau địa chỉ đích)
+constexpr uint8_t knx_frame_addr_len(bool ext) {
+    return knx_frame_route_offset(ext) + 1 > knx_frame_dest_offset(ext) + 2 ? knx_frame_route_offset(ext) + 1
+                                                                              : knx_frame_dest_offset(ext) + 2;
+}
+// Độ dài cả frame (gồm checksum) theo byte LG; extended tới 9 + 255 nên trả về uint16_t
+constexpr uint16_t knx_frame_total_len(bool ext, uint8_t len_byte) {
+    return knx_frame_tpci_offset(ext) + 2 + (ext ? len_byte : (len_byte & 0x0F));
+}
+
+struct knx_frame_view_t {
+    const uint8_t *data;
+    uint8_t len;   // Số byte có trong buffer
+    bool ext;
+
+    constexpr knx_frame_view_t(const uint8_t *d, uint8_t n)
+        : data(d), len(n), ext(n > 0 && knx_frame_is_extended(d[0])) {}
+
+    constexpr bool has_header() const { return len > knx_frame_len_offset(ext); }
+    // Byte LG khớp với độ dài buffer (chưa kiểm tra checksum)
+    constexpr bool well_formed() const { return has_header() && frame_len() == len; }
+
+    constexpr bool is_extended() const { return ext; }
+    constexpr uint8_t control() const { return data[0]; }
+    constexpr bool is_repeated() const { return !(data[0] & KNX_CTRL_REPEAT_FLAG); }
+    constexpr uint8_t priority() const { return (data[0] >> 2) & 0x03; }
+    constexpr uint16_t source() const { return u16(knx_frame_src_offset(ext)); }
+    constexpr uint16_t destination() const { return u16(knx_frame_dest_offset(ext)); }
+    constexpr bool is_group() const { return (data[knx_frame_route_offset(ext)] & KNX_ADDR_GROUP) != 0; }
+    constexpr uint8_t hop_count() const { return (data[knx_frame_route_offset(ext)] >> 4) & 0x07; }
+    // LG: số byte sau TPCI
+    constexpr uint8_t payload_len() const {
+        return ext ? data[knx_frame_len_offset(ext)] : (data[knx_frame_len_offset(ext)] & 0x0F);
+    }
+    constexpr uint16_t frame_len() const { return knx_frame_total_len(ext, data[knx_frame_len_offset(ext)]); }
+    constexpr uint8_t tpci() const { return data[knx_frame_tpci_offset(ext)] & 0xFC; }
+    // APCI 10 bit (cần payload_len() >= 1); dịch vụ nhóm GroupValue_* dùng 4 bit cao (apci() & 0x3C0)
+    constexpr uint16_t apci() const {
+        return ((data[knx_frame_tpci_offset(ext)] & 0x03) << 8) | data[knx_frame_tpci_offset(ext) + 1];
+    }
+    // payload_len() byte sau TPCI (byte đầu chứa phần thấp của APCI)
+    constexpr const uint8_t *payload() const { return &data[knx_frame_tpci_offset(ext) + 1]; }
+    constexpr uint8_t checksum() const { return data[len - 1]; }
+
+    constexpr uint16_t u16(uint8_t off) const { return (uint16_t)((data[off] << 8) | data[off + 1]); }
+};
+
+// Đánh dấu frame là lần lặp (repeat flag = 0), sửa checksum theo; false nếu đã là lần lặp
+inline bool knx_frame_mark_repeated(uint8_t *data, uint8_t len) {
+    if (len == 0 || !(data[0] & KNX_CTRL_REPEAT_FLAG)) {
+        return false;
+    }
+    data[0] &= ~KNX_CTRL_REPEAT_FLAG;
+    data[len - 1] ^= KNX_CTRL_REPEAT_FLAG;
+    return true;
+}
+
+#endif // KNX_FRAME_H
@@ -1,145 +1,284 @@
 #include "config.h"
 
 #include "knx_rx.h"
-#include <Arduino.h>
+#include "profiler.h"
+#include "hal/hal.h"
+#include <string.h>
 
 
 #define BIT0_MIN_US 25
 #define BIT0_MAX_US 55
-#define KNX_MAX_FRAME_LEN 23
 
 
-HardwareTimer timer(TIM2);
+// Trạng thái decoder của 1 line
+typedef struct {
+  uint8_t bit_idx, byte_idx, cur_byte;
+  volatile bool bit0;
+  knx_frame_callback_t callback_fn;
+  knx_idle_callback_t idle_fn;
+  volatile uint8_t parity_bit;
+  uint8_t last;                       // Mức chân RX ở sườn trước
 
-static uint8_t bit_idx = 0, byte_idx = 0, cur_byte = 0;
-static volatile bool bit0 = false;
-static uint8_t pulse_start = 0;
-static knx_frame_callback_t callback_fn = nullptr;
-static volatile uint8_t parity_bit = 0;
-static volatile uint8_t received_frame[KNX_MAX_FRAME_LEN];
-static volatile uint32_t last_rx_time = 0;
+  // Timestamp theo bus timebase (hal_timebase_now, µs)
+  uint32_t pulse_start;               // Sườn lên (đầu xung) gần nhất
+  uint32_t next_sample;               // Điểm lấy mẫu bit kế tiếp
+  volatile uint32_t last_edge_time;
+  volatile uint32_t last_byte_time;   // Điểm lấy mẫu stop bit của byte cuối
+  volatile bool bus_idle;
 
+  volatile bool RX_flag;
+  volatile bool parity_error;         // Byte vừa nhận sai parity
+} knx_rx_line_t;
 
-static volatile bool RX_flag=false;
-static uint8_t total = 0;
+// Compare channel của từng line; line 1 không có channel bus rảnh (HAL_TB_CHANNEL_COUNT = không có)
+typedef struct {
+  hal_tb_channel_t sample;
+  hal_tb_channel_t idle;
+} knx_rx_channels_t;
 
-bool get_knx_rx_flag(){
+static const knx_rx_channels_t rx_ch[KNX_LINE_COUNT] = {
+  {HAL_TB_SAMPLE, HAL_TB_IDLE},
+#if KNX_COUPLER_ENABLE
+  {HAL_TB_SAMPLE_LINE1, HAL_TB_CHANNEL_COUNT},
+#endif
+};
+
+static knx_rx_line_t rx_lines[KNX_LINE_COUNT];
+#if KNX_PROFILER_ENABLE
+// Chỉ đo line 0
+static uint32_t prof_pulse_edge = 0;        // Sườn đầu xung thật (đã trừ độ trễ EXTI)
+static bool prof_pulse_edge_valid = false;
+#endif
+
+// ISR không nhận tham số → 1 trampoline cho mỗi line
+static void knx_exti_irq_line0(void) {
+  knx_exti_irq(KNX_LINE_MAIN);
+}
+
+static void knx_timer_tick_line0(void) {
+  knx_timer_tick(KNX_LINE_MAIN);
+}
+
+static void knx_rx_idle_isr_line0(void);
+
+#if KNX_COUPLER_ENABLE
+static void knx_exti_irq_line1(void) {
+  knx_exti_irq(KNX_LINE_SUB);
+}
+
+static void knx_timer_tick_line1(void) {
+  knx_timer_tick(KNX_LINE_SUB);
+}
+#endif
+
+static void (*const exti_isr[KNX_LINE_COUNT])(void) = {
+  knx_exti_irq_line0,
+#if KNX_COUPLER_ENABLE
+  knx_exti_irq_line1,
+#endif
+};
+
+static void (*const tick_isr[KNX_LINE_COUNT])(void) = {
+  knx_timer_tick_line0,
+#if KNX_COUPLER_ENABLE
+  knx_timer_tick_line1,
+#endif
+};
+
+bool get_knx_rx_flag(uint8_t line){
+  knx_rx_line_t *l = &rx_lines[line];
   // Kiểm tra multiple conditions để đảm bảo bus thực sự rảnh
-  uint32_t now = millis();
-  
+  uint32_t now = hal_timebase_now();
+
   // 1. Kiểm tra thời gian từ lần cuối có activity
-  if ((now - last_rx_time) < KNX_BUS_BUSY_TIMEOUT_MS) {
+  if ((now - l->last_edge_time) < KNX_BUS_BUSY_TIMEOUT_MS * 1000) {
     return true; // Bus bận
   }
-  
+
   // 2. Kiểm tra RX_flag (đang trong quá trình nhận)
-  if (RX_flag) {
+  if (l->RX_flag) {
     return true; // Bus bận
   }
-  
-  // 3. Kiểm tra timer có đang chạy không
-  if (timer.isRunning()) {
+
+  // 3. Kiểm tra còn điểm lấy mẫu bit đang chờ không
+  if (hal_timebase_armed(rx_ch[line].sample)) {
     return true; // Bus bận
   }
-  
+
   return false; // Bus rảnh
 }
-bool send_ack_ok(){
 
-  if (RX_flag) {
+uint32_t knx_rx_idle_us(uint8_t line) {
+  knx_rx_line_t *l = &rx_lines[line];
+  if (l->RX_flag || hal_timebase_armed(rx_ch[line].sample)) {
+    return 0;
+  }
+  return hal_timebase_now() - l->last_edge_time;
+}
+// Lấy và xoá cờ lỗi parity (gọi từ main loop khi xử lý byte)
+bool knx_rx_take_parity_error(uint8_t line){
+  bool err = rx_lines[line].parity_error;
+  rx_lines[line].parity_error = false;
+  return err;
+}
+
+bool send_ack_ok(uint8_t line){
+
+  if (rx_lines[line].RX_flag) {
     return false; // Bus bận
   }
-  //Kiểm tra timer có đang chạy không
-  if (timer.isRunning()) {
+  //Kiểm tra còn điểm lấy mẫu bit đang chờ không
+  if (hal_timebase_armed(rx_ch[line].sample)) {
     return false; // Bus bận
   }
-  
+
   return true; // Bus rảnh
 }
 
 
-// Sử dụng cùng hàm checksum với main.cpp để đảm bảo consistency
-extern uint8_t knx_calc_checksum(const uint8_t *data, uint8_t len);
-void knx_rx_init(knx_frame_callback_t cb) {
-  timer.setPrescaleFactor((SystemCoreClock/1000000) -1);   // CK_CNT = 8MHz / (8+1) = 1MHz
-  timer.setOverflow(104);       
-  timer.attachInterrupt(knx_timer_tick);
- // timer2.setPrescaleFactor(63);   
-  //timer2.attachInterrupt(knx_send_tick);
- // timer2.setOverflow(1); 
-  attachInterrupt(digitalPinToInterrupt(KNX_TX_PIN), knx_exti_irq, CHANGE);
-  pinMode(KNX_TX_PIN, INPUT);
-  callback_fn = cb;
-  bit_idx = byte_idx = cur_byte = 0;
-  bit0 = false;
-  pulse_start = 0;
-}
-
-
-void knx_exti_irq(void) {
-  // Cập nhật last_rx_time ngay khi có bất kỳ thay đổi nào trên bus
-  last_rx_time = millis();
-  
-  if(!RX_flag){
-      RX_flag = true;
-      timer.refresh();
-      timer.resume(); // Bật lại timer để bắt đầu nhận dữ liệu
+void knx_rx_init(uint8_t line, knx_frame_callback_t cb, knx_idle_callback_t idle_cb) {
+  knx_rx_line_t *l = &rx_lines[line];
+  hal_bus_rx_init(line, exti_isr[line]);   // EXTI PB6 / PB7, timing theo bus timebase (TIM2 chạy tự do)
+  l->callback_fn = cb;
+  l->idle_fn = idle_cb;
+  l->bit_idx = l->byte_idx = l->cur_byte = 0;
+  l->bit0 = false;
+  l->pulse_start = 0;
+  l->bus_idle = false;
+  l->last_edge_time = l->last_byte_time = hal_timebase_now();
+}
+
+uint32_t knx_rx_last_byte_time(uint8_t line) {
+  return rx_lines[line].last_byte_time;
+}
+
+bool knx_rx_take_idle(uint8_t line) {
+  uint32_t irq = hal_irq_save();
+  bool idle = rx_lines[line].bus_idle;
+  rx_lines[line].bus_idle = false;
+  hal_irq_restore(irq);
+  return idle;
+}
+
+static void knx_rx_idle_isr_line0(void) {
+  knx_rx_line_t *l = &rx_lines[KNX_LINE_MAIN];
+  l->bus_idle = true;
+  if (l->idle_fn) l->idle_fn();
+}
+
+
+void knx_exti_irq(uint8_t line) {
+  PROF_SCOPE(PROF_ISR_EXTI);
+  knx_rx_line_t *l = &rx_lines[line];
+#if KNX_PROFILER_ENABLE
+  int32_t edge_latency = line == KNX_LINE_MAIN ? profiler_exti_latency() : -1;
+#endif
+  uint32_t now = hal_timebase_now();
+  // Cập nhật last_edge_time ngay khi có bất kỳ thay đổi nào trên bus
+  l->last_edge_time = now;
+
+  if(!l->RX_flag){
+      // Sườn start bit: các điểm lấy mẫu tính từ đây, mỗi KNX_BIT_PERIOD_US
+      l->RX_flag = true;
+      l->next_sample = now + KNX_BIT_PERIOD_US;
+      hal_timebase_arm(rx_ch[line].sample, l->next_sample, tick_isr[line]);
+      if (rx_ch[line].idle != HAL_TB_CHANNEL_COUNT) {
+        hal_timebase_cancel(rx_ch[line].idle);
+      }
   }
-  static uint8_t last = 0;
 
-// Đọc mức logic tại PB6
-  uint8_t lvl = (GPIOB->IDR & (1 << 6)) ? 1 : 0;
+// Đọc mức logic tại PB6 / PB7
+  uint8_t lvl = hal_bus_pin_level(line) ? 1 : 0;
    //bước 1: Nếu là sườn lên -> lưu lại time điểm này bằng bộ đếm timer
   //Bước 2: sườn xuống -> tính khoảng thời gian từ lúc sườn lên đến sườn xuống và kiểm tra khoảng time thỏa mãn ko? Nếu có thì bit 0/1
-  //bước 3: 
-  uint8_t now = timer.getCount();
-  if (lvl && !last) pulse_start = now;
-  else if (!lvl && last) {
-    uint8_t w = now >= pulse_start ? now - pulse_start :104-pulse_start + now;
+  //bước 3:
+  if (lvl && !l->last) {
+    l->pulse_start = now;
+#if KNX_PROFILER_ENABLE
+    if (line == KNX_LINE_MAIN) {
+      prof_pulse_edge = now - edge_latency;
+      prof_pulse_edge_valid = edge_latency >= 0;
+    }
+#endif
+  }
+  else if (!lvl && l->last) {
+    uint32_t w = now - l->pulse_start;
     if (w >= BIT0_MIN_US && w <= BIT0_MAX_US){
-         bit0 = true;
-         // last_rx_time đã được cập nhật ở đầu hàm
-    }   
+         l->bit0 = true;
+         // last_edge_time đã được cập nhật ở đầu hàm
+    }
   }
-  last = lvl;
+  l->last = lvl;
 }
 
 
-void reset_knx_receiver() {
-  memset((void*)received_frame, 0, sizeof(received_frame));
-  bit_idx = 0;
+static void reset_knx_receiver(knx_rx_line_t *l) {
+  l->bit_idx = 0;
   //byte_idx = 0;
-  total = 0;
-  cur_byte = 0;
-  bit0 = false;
-  RX_flag= false;
-}
-void knx_timer_tick(void) {
-  uint8_t bit = bit0 ? 0 : 1;
-  bit0 = false;
-  bit_idx++;
-  if (bit_idx == 1) {
-    cur_byte = 0;
-    parity_bit = 0;
-  } 
-  else if (bit_idx >= 2 && bit_idx <= 9) {
-    cur_byte >>= 1;
+  l->cur_byte = 0;
+  l->bit0 = false;
+  l->RX_flag= false;
+}
+// RX_flag chỉ được xoá ở stop bit: stop bit sai → lấy mẫu mãi, bus bị coi là bận
+bool knx_rx_stalled(uint8_t line) {
+  knx_rx_line_t *l = &rx_lines[line];
+  return l->RX_flag && (hal_timebase_now() - l->last_edge_time) > RECOVERY_RX_STALL_MS * 1000;
+}
+
+void knx_rx_recover(uint8_t line) {
+  uint32_t irq = hal_irq_save();
+  hal_timebase_cancel(rx_ch[line].sample);
+  reset_knx_receiver(&rx_lines[line]);
+  rx_lines[line].parity_error = false;
+  hal_irq_restore(irq);
+}
+
+void knx_timer_tick(uint8_t line) {
+  PROF_SCOPE(PROF_ISR_BIT_TIMER);
+  knx_rx_line_t *l = &rx_lines[line];
+  uint32_t sample = l->next_sample;
+  // Điểm kế tiếp tính từ điểm trước (không từ lúc ISR chạy) → không trôi trong 1 byte
+  l->next_sample += KNX_BIT_PERIOD_US;
+  hal_timebase_arm(rx_ch[line].sample, l->next_sample, tick_isr[line]);
+#if KNX_PROFILER_ENABLE
+  // Bit 0: cell bắt đầu ở sườn đầu xung → điểm lấy mẫu lý tưởng = sườn + 1 bit
+  if (line == KNX_LINE_MAIN) {
+    if (l->bit0 && prof_pulse_edge_valid) {
+      profiler_sample_phase((int32_t)(hal_timebase_now() - (prof_pulse_edge + KNX_BIT_PERIOD_US)));
+    }
+    prof_pulse_edge_valid = false;
+  }
+#endif
+  uint8_t bit = l->bit0 ? 0 : 1;
+  l->bit0 = false;
+  l->bit_idx++;
+  if (l->bit_idx == 1) {
+    l->cur_byte = 0;
+    l->parity_bit = 0;
+  }
+  else if (l->bit_idx >= 2 && l->bit_idx <= 9) {
+    l->cur_byte >>= 1;
     if (bit) {
-      cur_byte |= 0x80;
-      parity_bit++;
+      l->cur_byte |= 0x80;
+      l->parity_bit++;
     }
-  } 
-    else if (bit_idx == 10) {
-    if ((parity_bit & 1) == bit) {
+  }
+    else if (l->bit_idx == 10) {
+    if ((l->parity_bit & 1) == bit) {
       return;
     }
-  } 
-  if (bit_idx == 11 && bit == 1) {
-    if (callback_fn) callback_fn(cur_byte);
-    cur_byte = 0;
-    bit_idx = 0;
-    byte_idx++;
-    RX_flag = false;
-    timer.pause();
+    l->parity_error = true;
+  }
+  if (l->bit_idx == 11 && bit == 1) {
+    hal_timebase_cancel(rx_ch[line].sample);
+    l->last_byte_time = sample;
+    if (rx_ch[line].idle != HAL_TB_CHANNEL_COUNT) {
+      hal_timebase_arm(rx_ch[line].idle, sample + KNX_RX_IDLE_US, knx_rx_idle_isr_line0);
+    }
+    if (l->callback_fn) l->callback_fn(l->cur_byte);
+    l->cur_byte = 0;
+    l->bit_idx = 0;
+    l->byte_idx++;
+    l->RX_flag = false;
   }
 }
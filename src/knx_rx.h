@@ -4,21 +4,31 @@
 
 #include <stdint.h>
 #include <stdbool.h>
-#include <HardwareTimer.h>
-#include <HardwareSerial.h>
-
-#define KNX_TX_PIN PB6
 
 typedef void (*knx_frame_callback_t)(const uint8_t byte);
+typedef void (*knx_idle_callback_t)(void);
 
+// Mỗi line (KNX_LINE_MAIN, KNX_LINE_SUB khi bật coupler) có 1 decoder riêng: chân RX, điểm lấy mẫu, trạng thái bit
      
-// Khởi tạo: truyền vào callback xử lý telegram
-void knx_rx_init(knx_frame_callback_t cb);
+// Khởi tạo: callback xử lý từng byte và callback khi bus rảnh KNX_RX_IDLE_US sau byte cuối (đều gọi trong ISR)
+// Line 1 không có compare channel bus rảnh: idle_cb không được gọi, hết frame xác định theo độ dài
+void knx_rx_init(uint8_t line, knx_frame_callback_t cb, knx_idle_callback_t idle_cb);
+
+void knx_exti_irq(uint8_t line);
+// Compare HAL_TB_SAMPLE / HAL_TB_SAMPLE_LINE1: điểm lấy mẫu bit, mỗi 104µs tính từ sườn start bit
+void knx_timer_tick(uint8_t line);
 
-void knx_exti_irq(void);
-// Hàm gọi trong Timer IRQ 104µs (bit sampling)
-void knx_timer_tick(void);
+// Bus timebase (hal_timebase_now) lúc lấy mẫu stop bit của byte vừa giải mã - mốc của ACK window
+uint32_t knx_rx_last_byte_time(uint8_t line);
+// Bus đã rảnh KNX_RX_IDLE_US sau byte cuối (hết frame): lấy và xoá cờ
+bool knx_rx_take_idle(uint8_t line);
 
-bool get_knx_rx_flag();
-bool send_ack_ok();
+bool get_knx_rx_flag(uint8_t line);
+// Bus rảnh bao lâu tính từ sườn cuối (µs, bus timebase); 0 khi đang nhận byte
+uint32_t knx_rx_idle_us(uint8_t line);
+bool send_ack_ok(uint8_t line);
+bool knx_rx_take_parity_error(uint8_t line);
+// Decoder kẹt giữa byte (stop bit sai, mất sườn...) → reset bit state, huỷ điểm lấy mẫu
+bool knx_rx_stalled(uint8_t line);
+void knx_rx_recover(uint8_t line);
 #endif // STKNX_DRIVER_H
@@ -4,16 +4,22 @@
 #include <string.h> // For memset
 #include "logger.h"
 #include <tpuart/tpuart.h>
-extern "C" {
-  #include "stm32f1xx_hal.h"
-}
-// handles được init trong knx_hal_conf.cpp
-extern TIM_HandleTypeDef htim3;
-extern DMA_HandleTypeDef hdma_tim3_ch3;
+#include "event_loop.h"
+#include "trace.h"
+#include "metrics.h"
+#include "hal/hal.h"
+
+#define ACK_IDLE_BITS_MAX 15
 
-// buffer DMA (halfword)
-static uint16_t dma_buf[269];
-static int dma_len = 0;
+// buffer DMA (halfword) của từng line - TIM3 / DMA nằm trong hal/hal_stm32_tx.cpp
+typedef struct {
+    uint16_t dma_buf[KNX_TX_LEAD_BITS_MAX + KNX_TX_BITS_PER_BYTE * KNX_BUFFER_MAX_SIZE]; // Bit im lặng trước frame + frame đã encode
+    int dma_len;
+    uint16_t ack_buf[ACK_IDLE_BITS_MAX + KNX_TX_BITS_PER_BYTE]; // Bit im lặng trước ACK + 1 byte ACK đã encode (13 bit)
+    volatile uint32_t dma_start_ms;           // hal_millis() lúc bắt đầu DMA (frame hoặc ACK)
+} knx_tx_line_t;
+
+static knx_tx_line_t tx_lines[KNX_LINE_COUNT];
 
 // ===== Thông số timing (72 MHz) =====
 #define BIT_PERIOD   104   // ~104µs
@@ -21,47 +27,59 @@ static int dma_len = 0;
 #define T0_TOL       700    // ~10µs dung sai (không dùng)
 
 // ===== Encode bit =====
-static void encode_bit(uint8_t bit) {
-    if (dma_len >= (int)(sizeof(dma_buf) / sizeof(dma_buf[0]))) return;
+static void encode_bit(uint16_t *buf, int *n, int max, uint8_t bit) {
+    if (*n >= max) return;
     if (bit) {
-        dma_buf[dma_len++] = 0;  // bit 1 => luôn Low (~104µs, đảo ngược)
+        buf[(*n)++] = 0;  // bit 1 => luôn Low (~104µs, đảo ngược)
     } else {
-        dma_buf[dma_len++] = T0_HIGH;  // bit 0 => xung High ~69µs
+        buf[(*n)++] = T0_HIGH;  // bit 0 => xung High ~69µs
     }
 }
 
 // ===== Encode byte (Start + 8 data + parity + Stop) =====
-static void encode_byte(uint8_t b) {
+static void encode_byte(uint16_t *buf, int *n, int max, uint8_t b) {
     uint8_t parity_count = 0;
 
-    encode_bit(0); // start = 0
+    encode_bit(buf, n, max, 0); // start = 0
 
     for (int i = 0; i < 8; i++) {
         uint8_t bit = (b >> i) & 0x01;
-        encode_bit(bit);
+        encode_bit(buf, n, max, bit);
         if (bit) parity_count++;
     } 
 
     // parity even
-    encode_bit(parity_count & 1);
+    encode_bit(buf, n, max, parity_count & 1);
   //  encode_bit(1);    // stop = 1
-    encode_bit(1);
-    encode_bit(1);
-    encode_bit(1);
+    encode_bit(buf, n, max, 1);
+    encode_bit(buf, n, max, 1);
+    encode_bit(buf, n, max, 1);
 }
-// ===== Prepare frame =====
-static void prepare_frame(uint8_t *data, int len) {
-    memset(dma_buf, 0, sizeof(dma_buf));
-    dma_len = 0;
+int knx_tx_encode(uint16_t *buf, int max, const uint8_t *data, int len) {
+    int n = 0;
     for (int i = 0; i < len; i++) {
-        encode_byte(data[i]);
+        encode_byte(buf, &n, max, data[i]);
     }
+    return n;
+}
+
+// ===== Prepare frame =====
+// false = buffer DMA không chứa hết frame (không gửi frame bị cắt với checksum sai)
+static bool prepare_frame(knx_tx_line_t *l, uint8_t *data, int len, uint8_t lead_bits) {
+    memset(l->dma_buf, 0, sizeof(l->dma_buf));
+    int encoded = knx_tx_encode(&l->dma_buf[lead_bits], sizeof(l->dma_buf) / sizeof(l->dma_buf[0]) - lead_bits, data, len);
+    l->dma_len = lead_bits + encoded;
  //    DEBUG_SERIAL.printf("Prepared frame, dma_len: %d\r\n", dma_len);
+    return encoded == len * KNX_TX_BITS_PER_BYTE;
 }
 
 // ===== Public send function với error handling =====
-knx_error_t knx_send_frame(uint8_t *data, int len) {
-    DEBUG_SERIAL.print("Sending frame: ");
+knx_error_t knx_send_frame(uint8_t line, uint8_t *data, int len) {
+    return knx_send_frame_lead(line, data, len, 0);
+}
+
+knx_error_t knx_send_frame_lead(uint8_t line, uint8_t *data, int len, uint8_t lead_bits) {
+    knx_tx_line_t *l = &tx_lines[line];
     // Input validation
     if (data == nullptr) {
         LOG_DEBUG(LOG_CAT_SYSTEM, "KNX TX: Invalid data pointer");
@@ -75,38 +93,50 @@ knx_error_t knx_send_frame(uint8_t *data, int len) {
         //DEBUG_SERIAL.println(2);
         return KNX_ERROR_INVALID_LENGTH;
     }
+
+    if (lead_bits > KNX_TX_LEAD_BITS_MAX) {
+        return KNX_ERROR_INVALID_PARAM;
+    }
     
     // Kiểm tra DMA state
-    if (hdma_tim3_ch3.State != HAL_DMA_STATE_READY) {
+    if (hal_tx_busy(line)) {
         LOG_DEBUG(LOG_CAT_SYSTEM, "KNX TX: DMA busy");
+        metric_inc(METRIC_TX_DMA_BUSY);
         //DEBUG_SERIAL.println(3);
         return KNX_ERROR_BUS_BUSY;
     }
     
     // Final bus collision check - đọc trực tiếp GPIO
-    prepare_frame(data, len);
+    if (!prepare_frame(l, data, len, lead_bits)) {
+        LOG_DEBUG(LOG_CAT_SYSTEM, "KNX TX: Frame does not fit DMA buffer (%d bytes)", len);
+        return KNX_ERROR_INVALID_LENGTH;
+    }
 
-    uint8_t bus_level = get_knx_rx_flag();
+    uint8_t bus_level = get_knx_rx_flag(line);
     if (!bus_level) {
         // Kiểm tra tín hiệu trên chân RX
-        uint8_t rx_pin_level = (GPIOB->IDR & (1 << 6)) ? 1 : 0; // Giả sử chân RX là PA9
-        if(rx_pin_level && send_ack_ok()){ // Nếu chân RX vẫn cao thì bus vẫn bận
+        uint8_t rx_pin_level = hal_bus_pin_level(line) ? 1 : 0;
+        if(rx_pin_level && send_ack_ok(line)){ // Nếu chân RX vẫn cao thì bus vẫn bận
             //enqueue_frame(data, len);
             LOG_DEBUG(LOG_CAT_SYSTEM, "KNX TX: Bus collision detected - aborting");
+            metric_inc(METRIC_TX_COLLISIONS);
             //DEBUG_SERIAL.println(4);
             return KNX_ERROR_BUS_BUSY;
         }
-        set_echo_frame(); // Đánh dấu frame này là echo
-        HAL_StatusTypeDef status = HAL_TIM_PWM_Start_DMA(&htim3, TIM_CHANNEL_3, (uint32_t*)dma_buf, dma_len);
-        if (status != HAL_OK) {
-            LOG_DEBUG(LOG_CAT_SYSTEM, "KNX TX: DMA start failed %d\n", status);
+        if (!hal_tx_start(line, l->dma_buf, l->dma_len)) {
+            LOG_DEBUG(LOG_CAT_SYSTEM, "KNX TX: DMA start failed");
+            metric_inc(METRIC_TX_DMA_ERRORS);
             //DEBUG_SERIAL.println(5);
             return KNX_ERROR_BUS_BUSY;
         }
+        l->dma_start_ms = hal_millis();
+        TRACE(TRACE_DMA_START, len, l->dma_len);
+        metric_inc(METRIC_TX_FRAMES);
         return KNX_OK;
     }
     else {
-        enqueue_frame(data, len);
+        // Frame vẫn nằm ở đầu queue, sẽ được gửi lại ở lượt sau
+        metric_inc(METRIC_TX_BUS_BUSY);
         //DEBUG_SERIAL.println(6);
         return KNX_ERROR_BUS_BUSY;
     }
@@ -116,36 +146,76 @@ knx_error_t knx_send_ack_byte(uint8_t ack_value) {
     static uint8_t ack_byte = 0;
     switch(ack_value){
         case U_ACK_REQ_ADRESSED:
-            ack_byte = 0xCC;
+            ack_byte = KNX_BUS_ACK;
+            break;
         case U_ACK_REQ_NACK:
-            ack_byte = 0x0C;
+            ack_byte = KNX_BUS_NACK;
             break;
         case U_ACK_REQ_BUSY:
-            ack_byte = 0xC0;
+            ack_byte = KNX_BUS_BUSY;
             break;
     }
-    uint8_t rx_pin_level = (GPIOB->IDR & (1 << 6)) ? 1 : 0;
+    knx_tx_line_t *l = &tx_lines[KNX_LINE_MAIN];
+    uint8_t rx_pin_level = hal_bus_pin_level(KNX_LINE_MAIN) ? 1 : 0;
     if(rx_pin_level){ // Nếu chân RX vẫn cao thì bus vẫn bận
         LOG_DEBUG(LOG_CAT_SYSTEM, "KNX TX: Bus busy, cannot send ACK");
         return KNX_ERROR_BUS_BUSY;
     }
-    if(!send_ack_ok()){
+    if(!send_ack_ok(KNX_LINE_MAIN)){
         LOG_DEBUG(LOG_CAT_SYSTEM, "KNX TX: Timer running, bus busy, cannot send ACK");
         return KNX_ERROR_BUS_BUSY;
     }
     if(is_pending_ack()){
-    HAL_TIM_PWM_Start_DMA(&htim3, TIM_CHANNEL_3, (uint32_t*)&ack_byte, 1);
+    int ack_len = 0;
+    encode_byte(l->ack_buf, &ack_len, sizeof(l->ack_buf) / sizeof(l->ack_buf[0]), ack_byte);
+    if (!hal_tx_start(KNX_LINE_MAIN, l->ack_buf, ack_len)) {
+        metric_inc(METRIC_TX_DMA_ERRORS);
+        return KNX_ERROR_BUS_BUSY;
+    }
+    l->dma_start_ms = hal_millis();
+    TRACE(TRACE_DMA_START, 0, ack_byte);
     return KNX_OK;
     }
     return KNX_ERROR_BUS_BUSY;
 }
 
-// ===== Callback khi DMA hoàn tất =====
-extern "C" void HAL_TIM_PWM_PulseFinishedCallback(TIM_HandleTypeDef *htim) {
-    if (htim->Instance == TIM3 && htim->Channel == HAL_TIM_ACTIVE_CHANNEL_3) {
-        HAL_TIM_PWM_Stop_DMA(&htim3, TIM_CHANNEL_3);
-        //DEBUG_SERIAL.printf("PWM Finished, DMA State: %d\r\n", hdma_tim3_ch3.State);
+knx_error_t knx_send_ack_char(uint8_t line, uint8_t ack_char, uint8_t idle_bits) {
+    knx_tx_line_t *l = &tx_lines[line];
+    if (idle_bits > ACK_IDLE_BITS_MAX) {
+        return KNX_ERROR_INVALID_PARAM;
+    }
+    if (hal_tx_busy(line) || hal_bus_pin_level(line) || !send_ack_ok(line)) {
+        return KNX_ERROR_BUS_BUSY;
+    }
+    int ack_len = 0;
+    while (ack_len < idle_bits) {
+        encode_bit(l->ack_buf, &ack_len, sizeof(l->ack_buf) / sizeof(l->ack_buf[0]), 1);
+    }
+    encode_byte(l->ack_buf, &ack_len, sizeof(l->ack_buf) / sizeof(l->ack_buf[0]), ack_char);
+    if (!hal_tx_start(line, l->ack_buf, ack_len)) {
+        metric_inc(METRIC_TX_DMA_ERRORS);
+        return KNX_ERROR_BUS_BUSY;
     }
+    l->dma_start_ms = hal_millis();
+    TRACE(TRACE_DMA_START, 0, ack_char);
+    return KNX_OK;
+}
+
+// DMA không về READY sau thời gian gửi frame dài nhất → TIM3/DMA bị treo
+bool knx_tx_stalled(uint8_t line, uint32_t now_ms) {
+    return hal_tx_busy(line) && (now_ms - tx_lines[line].dma_start_ms) > RECOVERY_TX_STALL_MS;
 }
 
+void knx_tx_recover(uint8_t line) {
+    hal_tx_recover(line);
+}
 
+// ===== Callback khi DMA hoàn tất (PWM đã dừng) =====
+static void knx_tx_dma_done(void) {
+    TRACE(TRACE_DMA_DONE, 0, 0);
+    event_post(EVT_TX_DONE);
+}
+
+void knx_tx_init(uint8_t line) {
+    hal_tx_init(line, knx_tx_dma_done);
+}
@@ -11,9 +11,25 @@
 extern "C" {
 #endif
 
-void knx_tx_init(void);                 // init TIM1 CH3 + DMA
-knx_error_t knx_send_frame(uint8_t *data, int len);
+// Line 0: TIM3 CH3 + DMA1_Channel2, line 1 (coupler): TIM3 CH4 + DMA1_Channel3
+void knx_tx_init(uint8_t line);
+knx_error_t knx_send_frame(uint8_t line, uint8_t *data, int len);
+// Như knx_send_frame, nhưng phát lead_bits bit im lặng (bit 1) trước frame: frame bắt đầu đúng lúc bus đủ rảnh
+// mà loop không phải chờ (tối đa KNX_TX_LEAD_BITS_MAX, ~1 tick); độ chính xác 1 bit như mọi DMA của TIM3
+#define KNX_TX_LEAD_BITS_MAX 10
+knx_error_t knx_send_frame_lead(uint8_t line, uint8_t *data, int len, uint8_t lead_bits);
+// ACK theo U_ACK_REQ của host (line 0, chỉ khi tpuart còn pending ACK)
 knx_error_t knx_send_ack_byte(uint8_t ack_value);
+// Ký tự ACK / NACK / BUSY do gateway tự quyết định (coupler), phát sau idle_bits bit time im lặng
+// (bit 1 = không xung) - đặt được ACK vào cửa sổ 13-15 bit time mà không cần compare channel riêng
+knx_error_t knx_send_ack_char(uint8_t line, uint8_t ack_char, uint8_t idle_bits);
+// Mã hoá frame thành độ rộng xung PWM (13 halfword / byte: start, 8 data, parity chẵn, 3 stop),
+// trả về số halfword đã ghi (tối đa max)
+#define KNX_TX_BITS_PER_BYTE 13
+int knx_tx_encode(uint16_t *buf, int max, const uint8_t *data, int len);
+// Supervisor: DMA/TIM3 treo → dừng và khởi tạo lại tại chỗ (frame đang chờ echo sẽ timeout)
+bool knx_tx_stalled(uint8_t line, uint32_t now_ms);
+void knx_tx_recover(uint8_t line);
 #ifdef __cplusplus
 }
 #endif
@@ -24,8 +40,8 @@ knx_error_t knx_send_ack_byte(uint8_t ack_value);
 extern "C" {
 #endif
 
-void knx_tx_init(void);
-knx_error_t knx_send_frame(uint8_t *data, int len);
+void knx_tx_init(uint8_t line);
+knx_error_t knx_send_frame(uint8_t line, uint8_t *data, int len);
 void debug_dma_status(void);
 
 #ifdef __cplusplus
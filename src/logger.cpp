@@ -1,5 +1,7 @@
 #include "logger.h"
 #include "config.h"
+#include "rtos_tasks.h"
+#include "hal/hal.h"
 #include <stdarg.h>
 #include <string.h>
 
@@ -19,6 +21,7 @@ static uint32_t category_counters[LOG_CAT_MAX] = {0};
 static uint32_t total_logs = 0;
 static uint32_t last_log_time = 0;
 static uint32_t logs_this_second = 0;
+static bool logger_muted = false;
 
 // ANSI color codes
 #define ANSI_RESET   "\033[0m"
@@ -59,6 +62,24 @@ static const char* category_names[LOG_CAT_MAX] = {
     "ERROR"
 };
 
+static void logger_println(const char* line) {
+    hal_debug_write((const uint8_t*)line, strlen(line));
+    hal_debug_write((const uint8_t*)"\r\n", 2);
+}
+
+// Xuất 1 dòng log: FreeRTOS build đưa vào log_queue để task log ghi ra, không block caller
+static void logger_output(const char* line) {
+    if (logger_muted) {
+        return;
+    }
+#if KNX_USE_FREERTOS
+    if (rtos_log_write(line)) {
+        return;
+    }
+#endif
+    logger_println(line);
+}
+
 void logger_init(void) {
     // Initialize all categories as enabled
     for (int i = 0; i < LOG_CAT_MAX; i++) {
@@ -72,7 +93,7 @@ void logger_init(void) {
     last_log_time = 0;
     logs_this_second = 0;
     
-    DEBUG_SERIAL.println("\n=== KNX Gateway Logger Initialized ===");
+    logger_println("\n=== KNX Gateway Logger Initialized ===");
     LOG_INFO(LOG_CAT_SYSTEM, "Logger initialized - Level: %s", level_names[logger_config.level]);
 }
 
@@ -90,6 +111,16 @@ void logger_set_config(const logger_config_t* config) {
     }
 }
 
+void logger_get_config(logger_config_t* config) {
+    if (config) {
+        *config = logger_config;
+    }
+}
+
+void logger_set_muted(bool muted) {
+    logger_muted = muted;
+}
+
 void logger_enable_category(log_category_t category, bool enable) {
     if (category < LOG_CAT_MAX) {
         category_enabled[category] = enable;
@@ -98,6 +129,16 @@ void logger_enable_category(log_category_t category, bool enable) {
     }
 }
 
+bool logger_enabled(uint8_t level, uint8_t category) {
+    if (level > logger_config.level || category >= LOG_CAT_MAX || !category_enabled[category]) {
+        return false;
+    }
+    log_counters[level]++;
+    category_counters[category]++;
+    total_logs++;
+    return true;
+}
+
 void logger_log(log_level_t level, log_category_t category, const char* format, ...) {
     // Check if logging is enabled
     if (level > logger_config.level || !category_enabled[category]) {
@@ -105,7 +146,7 @@ void logger_log(log_level_t level, log_category_t category, const char* format,
     }
     
     // Rate limiting
-    uint32_t now = millis();
+    uint32_t now = hal_millis();
     if (now - last_log_time >= 1000) {
         logs_this_second = 0;
         last_log_time = now;
@@ -155,7 +196,7 @@ void logger_log(log_level_t level, log_category_t category, const char* format,
     buffer[sizeof(buffer) - 1] = '\0';
     
     // Output to serial
-    DEBUG_SERIAL.println(buffer);
+    logger_output(buffer);
 }
 
 void logger_log_hex(log_level_t level, log_category_t category, const char* prefix, const uint8_t* data, uint8_t len) {
@@ -164,7 +205,7 @@ void logger_log_hex(log_level_t level, log_category_t category, const char* pref
     }
     
     // Rate limiting
-    uint32_t now = millis();
+    uint32_t now = hal_millis();
     if (now - last_log_time >= 1000) {
         logs_this_second = 0;
         last_log_time = now;
@@ -218,7 +259,7 @@ void logger_log_hex(log_level_t level, log_category_t category, const char* pref
     buffer[sizeof(buffer) - 1] = '\0';
     
     // Output to serial
-    DEBUG_SERIAL.println(buffer);
+    logger_output(buffer);
 }
 
 const char* logger_level_to_string(log_level_t level) {
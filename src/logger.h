@@ -4,6 +4,7 @@
 #include <Arduino.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include "config.h"
 
 // Log levels
 typedef enum {
@@ -43,23 +44,36 @@ void logger_init(void);
 void logger_set_level(log_level_t level);
 void logger_set_config(const logger_config_t* config);
 void logger_enable_category(log_category_t category, bool enable);
+void logger_get_config(logger_config_t* config);
+// Bench: vẫn đếm / format đầy đủ nhưng không ghi dòng log ra serial
+void logger_set_muted(bool muted);
 
 // Main logging functions
 void logger_log(log_level_t level, log_category_t category, const char* format, ...);
 void logger_log_hex(log_level_t level, log_category_t category, const char* prefix, const uint8_t* data, uint8_t len);
 
+#if LOGGER_DEFERRED
+// Deferred mode: ghi record nhị phân vào ring, không format tại call site (xem logger_deferred.h)
+#include "logger_deferred.h"
+#define LOGGER_LOG_FN     logger_log_deferred
+#define LOGGER_LOG_HEX_FN logger_log_hex_deferred
+#else
+#define LOGGER_LOG_FN     logger_log
+#define LOGGER_LOG_HEX_FN logger_log_hex
+#endif
+
 // Convenience macros
-#define LOG_ERROR(cat, ...)   logger_log(LOG_LEVEL_ERROR, cat, __VA_ARGS__)
-#define LOG_WARN(cat, ...)    logger_log(LOG_LEVEL_WARN, cat, __VA_ARGS__)
-#define LOG_INFO(cat, ...)    logger_log(LOG_LEVEL_INFO, cat, __VA_ARGS__)
-#define LOG_DEBUG(cat, ...)   logger_log(LOG_LEVEL_DEBUG, cat, __VA_ARGS__)
-#define LOG_TRACE(cat, ...)   logger_log(LOG_LEVEL_TRACE, cat, __VA_ARGS__)
+#define LOG_ERROR(cat, ...)   LOGGER_LOG_FN(LOG_LEVEL_ERROR, cat, __VA_ARGS__)
+#define LOG_WARN(cat, ...)    LOGGER_LOG_FN(LOG_LEVEL_WARN, cat, __VA_ARGS__)
+#define LOG_INFO(cat, ...)    LOGGER_LOG_FN(LOG_LEVEL_INFO, cat, __VA_ARGS__)
+#define LOG_DEBUG(cat, ...)   LOGGER_LOG_FN(LOG_LEVEL_DEBUG, cat, __VA_ARGS__)
+#define LOG_TRACE(cat, ...)   LOGGER_LOG_FN(LOG_LEVEL_TRACE, cat, __VA_ARGS__)
 
-#define LOG_HEX_ERROR(cat, prefix, data, len) logger_log_hex(LOG_LEVEL_ERROR, cat, prefix, data, len)
-#define LOG_HEX_WARN(cat, prefix, data, len)  logger_log_hex(LOG_LEVEL_WARN, cat, prefix, data, len)
-#define LOG_HEX_INFO(cat, prefix, data, len)  logger_log_hex(LOG_LEVEL_INFO, cat, prefix, data, len)
-#define LOG_HEX_DEBUG(cat, prefix, data, len) logger_log_hex(LOG_LEVEL_DEBUG, cat, prefix, data, len)
-#define LOG_HEX_TRACE(cat, prefix, data, len) logger_log_hex(LOG_LEVEL_TRACE, cat, prefix, data, len)
+#define LOG_HEX_ERROR(cat, prefix, data, len) LOGGER_LOG_HEX_FN(LOG_LEVEL_ERROR, cat, prefix, data, len)
+#define LOG_HEX_WARN(cat, prefix, data, len)  LOGGER_LOG_HEX_FN(LOG_LEVEL_WARN, cat, prefix, data, len)
+#define LOG_HEX_INFO(cat, prefix, data, len)  LOGGER_LOG_HEX_FN(LOG_LEVEL_INFO, cat, prefix, data, len)
+#define LOG_HEX_DEBUG(cat, prefix, data, len) LOGGER_LOG_HEX_FN(LOG_LEVEL_DEBUG, cat, prefix, data, len)
+#define LOG_HEX_TRACE(cat, prefix, data, len) LOGGER_LOG_HEX_FN(LOG_LEVEL_TRACE, cat, prefix, data, len)
 
 // Utility functions
 const char* logger_level_to_string(log_level_t level);
@@ -0,0 +1,125 @@
+#include "logger.h"
+#include "config.h"
+#include "hal/hal.h"
+
+#if LOGGER_DEFERRED
+
+#define LOG_RING_MASK (LOGGER_RING_SIZE - 1)
+
+// Byte chưa dùng trong ring luôn = 0 → byte len = 0 nghĩa là record đang được ghi dở
+static uint8_t log_ring[LOGGER_RING_SIZE];
+static volatile uint32_t ring_head = 0;   // Đã giữ chỗ (producer)
+static volatile uint32_t ring_tail = 0;   // Đã xuất (consumer: logger_drain)
+static volatile uint32_t ring_dropped = 0;
+static uint32_t dropped_reported = 0;
+
+void logger_rec_begin(log_rec_t *rec, uint8_t level, uint8_t category, const void *fmt) {
+    rec->buf[0] = 0;
+    rec->buf[1] = (uint8_t)((level & 0x07) << 4) | (category & 0x0F);
+    rec->len = 2;
+    log_arg_put_u32(rec, (uint32_t)(uintptr_t)fmt);
+    log_arg_put_u32(rec, hal_millis());
+}
+
+void logger_rec_commit(log_rec_t *rec) {
+    uint32_t need = rec->len;
+    uint32_t head;
+    uint32_t next;
+    do {
+        head = __atomic_load_n(&ring_head, __ATOMIC_RELAXED);
+        if (head - __atomic_load_n(&ring_tail, __ATOMIC_ACQUIRE) + need > LOGGER_RING_SIZE) {
+            __atomic_fetch_add(&ring_dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        next = head + need;
+    } while (!__atomic_compare_exchange_n(&ring_head, &head, next, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+
+    for (uint32_t i = 1; i < need; i++) {
+        log_ring[(head + i) & LOG_RING_MASK] = rec->buf[i];
+    }
+    // Ghi byte len sau cùng = commit
+    __atomic_store_n(&log_ring[head & LOG_RING_MASK], (uint8_t)(need - 1), __ATOMIC_RELEASE);
+}
+
+void logger_log_hex_deferred(uint8_t level, uint8_t category, const char *prefix, const uint8_t *data, uint8_t len) {
+    if (!logger_enabled(level, category) || !data || len == 0) {
+        return;
+    }
+    log_rec_t rec;
+    logger_rec_begin(&rec, level, category, prefix);
+    rec.buf[1] |= LOG_REC_HEX_FLAG;
+    uint8_t room = LOG_REC_MAX - rec.len - 1;
+    if (len > room) {
+        len = room;
+    }
+    log_rec_put(&rec, &len, 1);
+    log_rec_put(&rec, data, len);
+    logger_rec_commit(&rec);
+}
+
+// Record báo số log bị mất (fmt = 0, arg = số record mất từ lần báo trước)
+static bool logger_report_dropped(void) {
+    uint32_t dropped = ring_dropped;
+    if (dropped == dropped_reported) {
+        return true;
+    }
+    log_rec_t rec;
+    logger_rec_begin(&rec, LOG_LEVEL_WARN, LOG_CAT_SYSTEM, nullptr);
+    log_arg_put_u32(&rec, dropped - dropped_reported);
+    if (hal_debug_write_space() < rec.len + 1) {
+        return false;
+    }
+    rec.buf[0] = rec.len - 1;
+    uint8_t sync = LOG_REC_SYNC;
+    hal_debug_write(&sync, 1);
+    hal_debug_write(rec.buf, rec.len);
+    dropped_reported = dropped;
+    return true;
+}
+
+/*
+ * USART3_TX chỉ nối được DMA1_Channel2 - kênh này đã dùng cho TIM3_CH3 (PWM TX bus KNX),
+ * nên ring được đẩy qua TX buffer của HardwareSerial (USART3 ISR gửi nền).
+ * Chỉ ghi record nguyên vẹn khi TX buffer còn đủ chỗ → không bao giờ block.
+ */
+void logger_drain(void) {
+    if (!logger_report_dropped()) {
+        return;
+    }
+    uint32_t tail = ring_tail;
+    for (;;) {
+        uint8_t len = __atomic_load_n(&log_ring[tail & LOG_RING_MASK], __ATOMIC_ACQUIRE);
+        if (len == 0) {
+            break; // Ring rỗng hoặc record đang ghi dở
+        }
+        if (hal_debug_write_space() < len + 2) {
+            break;
+        }
+        uint8_t out[LOG_REC_MAX + 1];
+        out[0] = LOG_REC_SYNC;
+        for (uint8_t i = 0; i <= len; i++) {
+            uint32_t idx = (tail + i) & LOG_RING_MASK;
+            out[i + 1] = log_ring[idx];
+            log_ring[idx] = 0;
+        }
+        hal_debug_write(out, len + 2);
+        tail += len + 1;
+        __atomic_store_n(&ring_tail, tail, __ATOMIC_RELEASE);
+    }
+}
+
+void logger_drain_blocking(void) {
+    for (;;) {
+        logger_drain();
+        hal_debug_flush();
+        if (__atomic_load_n(&log_ring[ring_tail & LOG_RING_MASK], __ATOMIC_ACQUIRE) == 0) {
+            break;
+        }
+    }
+}
+
+uint32_t logger_dropped_count(void) {
+    return ring_dropped;
+}
+
+#endif // LOGGER_DEFERRED
@@ -0,0 +1,110 @@
+#ifndef LOGGER_DEFERRED_H
+#define LOGGER_DEFERRED_H
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/*
+ * Deferred binary logging (LOGGER_DEFERRED = 1)
+ *
+ * Call site không format chuỗi: LOG_* chỉ ghi 1 record nhị phân vào ring
+ * (vài trăm cycle), logger_drain() đẩy ring ra DEBUG_SERIAL khi loop() rảnh.
+ * Host giải mã lại thành text bằng tools/log_decode.py (đọc format string từ file .elf).
+ *
+ * Record trên dây (little-endian):
+ *   [0xA5] [len] [hdr] [fmt u32] [timestamp ms u32] [args...]
+ *   len: số byte sau nó, hdr: bit7 = hex dump, bit6-4 = level, bit3-0 = category
+ *   fmt: địa chỉ format string (hoặc prefix của hex dump) trong flash, 0 = record báo mất log
+ *
+ * Tham số được ghi theo kiểu C++ lúc gọi:
+ *   số nguyên <= 32 bit, enum, bool, char → 4 byte
+ *   long long                            → 8 byte
+ *   float/double                         → double 8 byte
+ *   const char*                          → [n] [n byte] (cắt ở LOG_REC_STR_MAX)
+ *   pointer khác                         → 4 byte
+ *   hex dump                             → [n] [n byte]
+ *
+ * Ring nhiều producer (loop, ISR, task): giữ chỗ bằng CAS (LDREX/STREX), không tắt interrupt.
+ * Ring đầy → record bị bỏ, số record mất được báo bằng 1 record fmt = 0.
+ */
+
+#define LOG_REC_SYNC      0xA5
+#define LOG_REC_MAX       64     // Kích thước tối đa 1 record trong ring (gồm byte len)
+#define LOG_REC_STR_MAX   24
+#define LOG_REC_HEX_FLAG  0x80
+
+typedef struct {
+    uint8_t buf[LOG_REC_MAX];  // [len] [hdr] [fmt] [ts] [args]
+    uint8_t len;
+} log_rec_t;
+
+// logger.cpp: kiểm tra level/category trước khi encode
+bool logger_enabled(uint8_t level, uint8_t category);
+
+// logger_deferred.cpp
+void logger_rec_begin(log_rec_t *rec, uint8_t level, uint8_t category, const void *fmt);
+void logger_rec_commit(log_rec_t *rec);
+void logger_log_hex_deferred(uint8_t level, uint8_t category, const char *prefix, const uint8_t *data, uint8_t len);
+// Đẩy record đã commit ra DEBUG_SERIAL, không block (dừng khi TX buffer đầy)
+void logger_drain(void);
+// Trước reset: đẩy hết ring, chờ DEBUG_SERIAL gửi xong
+void logger_drain_blocking(void);
+uint32_t logger_dropped_count(void);
+
+// =================== Encode tham số ===================
+static inline void log_rec_put(log_rec_t *rec, const void *src, uint8_t n) {
+    if (rec->len + n <= LOG_REC_MAX) {
+        memcpy(&rec->buf[rec->len], src, n);
+        rec->len += n;
+    }
+}
+
+static inline void log_arg_put_u32(log_rec_t *rec, uint32_t v) { log_rec_put(rec, &v, 4); }
+
+static inline void log_arg_put(log_rec_t *rec, int v) { log_arg_put_u32(rec, (uint32_t)v); }
+static inline void log_arg_put(log_rec_t *rec, unsigned int v) { log_arg_put_u32(rec, (uint32_t)v); }
+static inline void log_arg_put(log_rec_t *rec, long v) { log_arg_put_u32(rec, (uint32_t)v); }
+static inline void log_arg_put(log_rec_t *rec, unsigned long v) { log_arg_put_u32(rec, (uint32_t)v); }
+static inline void log_arg_put(log_rec_t *rec, long long v) { log_rec_put(rec, &v, 8); }
+static inline void log_arg_put(log_rec_t *rec, unsigned long long v) { log_rec_put(rec, &v, 8); }
+static inline void log_arg_put(log_rec_t *rec, double v) { log_rec_put(rec, &v, 8); }
+static inline void log_arg_put(log_rec_t *rec, const void *v) { log_arg_put_u32(rec, (uint32_t)(uintptr_t)v); }
+
+static inline void log_arg_put(log_rec_t *rec, const char *s) {
+    uint8_t n = 0;
+    if (s) {
+        while (n < LOG_REC_STR_MAX && s[n]) {
+            n++;
+        }
+    }
+    if (rec->len + 1 + n > LOG_REC_MAX) {
+        n = rec->len + 1 < LOG_REC_MAX ? LOG_REC_MAX - rec->len - 1 : 0;
+    }
+    log_rec_put(rec, &n, 1);
+    if (n) {
+        log_rec_put(rec, s, n);
+    }
+}
+
+static inline void log_args_put(log_rec_t *rec) { (void)rec; }
+
+template <typename T, typename... Rest>
+static inline void log_args_put(log_rec_t *rec, T v, Rest... rest) {
+    log_arg_put(rec, v);
+    log_args_put(rec, rest...);
+}
+
+template <typename... Args>
+static inline void logger_log_deferred(uint8_t level, uint8_t category, const char *fmt, Args... args) {
+    if (!logger_enabled(level, category)) {
+        return;
+    }
+    log_rec_t rec;
+    logger_rec_begin(&rec, level, category, fmt);
+    log_args_put(&rec, args...);
+    logger_rec_commit(&rec);
+}
+
+#endif // LOGGER_DEFERRED_H
@@ -0,0 +1,86 @@
+#include "metrics.h"
+#include "config.h"
+#include "hal/hal.h"
+#include "event_loop.h"
+#include "tpuart/tpuart.h"
+#include "tpuart/host_diag.h"
+
+#define METRICS_PER_MSG 14  // 2 + 14 x 4 byte / U_DIAG_IND
+static_assert(2 + METRICS_PER_MSG * 4 <= DIAG_PAYLOAD_MAX, "METRICS_PER_MSG quá lớn cho 1 U_DIAG_IND");
+
+volatile uint32_t metrics_values[METRIC_COUNT];
+
+void metric_max(metric_id_t id, uint32_t v) {
+    uint32_t cur = metric_get(id);
+    while (v > cur && !__atomic_compare_exchange_n(&metrics_values[id], &cur, v, true,
+                                                   __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+void metric_min(metric_id_t id, uint32_t v) {
+    uint32_t cur = metric_get(id);
+    while (v < cur && !__atomic_compare_exchange_n(&metrics_values[id], &cur, v, true,
+                                                   __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+void metrics_init(void) {
+    metrics_reset();
+    metric_set(METRIC_SYS_RESET_FLAGS, hal_reset_flags() >> 24);
+}
+
+// Counter về 0, gauge về trạng thái "chưa có mẫu" (gauge của lần khởi động giữ nguyên)
+void metrics_reset(void) {
+    uint32_t reset_flags = metric_get(METRIC_SYS_RESET_FLAGS);
+    uint32_t warm_restarts = metric_get(METRIC_WARM_RESTARTS);
+    uint32_t warm_frames = metric_get(METRIC_WARM_FRAMES_KEPT);
+    for (uint8_t i = 0; i < METRIC_COUNT; i++) {
+        metric_set((metric_id_t)i, 0);
+    }
+    metric_set(METRIC_ACK_LATENCY_MIN_US, 0xFFFFFFFF);
+    metric_set(METRIC_Q_HIGH_WATER, q_count);
+    metric_set(METRIC_Q_HIGH_WATER_BYTES, queue_bytes_used());
+    metric_set(METRIC_Q_CAPACITY_BYTES, KNX_TX_QUEUE_BYTES);
+    metric_set(METRIC_Q_CAPACITY_FRAMES, KNX_TX_QUEUE_BYTES / (sizeof(Frame) + KNX_BUFFER_MAX_SIZE));
+    metric_set(METRIC_SYS_RESET_FLAGS, reset_flags);
+    metric_set(METRIC_WARM_RESTARTS, warm_restarts);
+    metric_set(METRIC_WARM_FRAMES_KEPT, warm_frames);
+    event_reset_latency(); // Gauge METRIC_EVT_LATENCY_* lấy lại từ đầu
+}
+
+/*
+ * Message đầu: [schema version] [số metric]
+ * Tiếp theo:   [index đầu] [n] [n x u32 little-endian], theo thứ tự metric_id_t
+ * Giá trị được đọc lúc tạo từng message.
+ */
+static bool metrics_next(uint16_t idx, uint8_t *payload, uint8_t *len) {
+    if (idx == 0) {
+        payload[0] = METRICS_SCHEMA_VERSION;
+        payload[1] = METRIC_COUNT;
+        *len = 2;
+        return true;
+    }
+    uint16_t i = (idx - 1) * METRICS_PER_MSG;
+    if (i >= METRIC_COUNT) {
+        return false;
+    }
+    uint8_t n = METRIC_COUNT - i < METRICS_PER_MSG ? METRIC_COUNT - i : METRICS_PER_MSG;
+    payload[0] = (uint8_t)i;
+    payload[1] = n;
+    for (uint8_t k = 0; k < n; k++) {
+        uint32_t v = metric_get((metric_id_t)(i + k));
+        payload[2 + k * 4] = (uint8_t)v;
+        payload[3 + k * 4] = (uint8_t)(v >> 8);
+        payload[4 + k * 4] = (uint8_t)(v >> 16);
+        payload[5 + k * 4] = (uint8_t)(v >> 24);
+    }
+    *len = 2 + n * 4;
+    return true;
+}
+
+static const host_diag_report_t metrics_report = {DIAG_METRICS_READ, metrics_next, nullptr};
+
+void metrics_send(void) {
+    metric_set(METRIC_SYS_UPTIME_S, hal_millis() / 1000);
+    host_diag_report(&metrics_report);
+}
@@ -0,0 +1,134 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Metrics registry: counter / gauge 32 bit, ISR-safe (LDREX/STREX, không tắt interrupt)
+ *
+ * ID cố định - chỉ được thêm vào cuối (host đọc theo index, METRICS_SCHEMA_VERSION
+ * tăng khi ý nghĩa một ID thay đổi).
+ * Gauge min chưa có mẫu = 0xFFFFFFFF.
+ *
+ * Host: [U_DIAG_REQ] [DIAG_METRICS_READ / DIAG_METRICS_RESET] (xem tpuart/host_diag.h)
+ */
+
+#define METRICS_SCHEMA_VERSION 1
+
+typedef enum {
+    // RX bus
+    METRIC_RX_BYTES = 0,
+    METRIC_RX_FRAMES,
+    METRIC_RX_PARITY_ERRORS,
+    METRIC_RX_CHECKSUM_ERRORS,   // Sai checksum / độ dài
+    METRIC_RX_GAP_ABORTS,        // Frame bị cắt (bus im lặng giữa frame)
+    METRIC_RX_FILTERED,          // Bị rx_filter chặn
+    // TX bus
+    METRIC_TX_FRAMES,            // DMA đã bắt đầu gửi frame
+    METRIC_TX_DMA_BUSY,          // knx_send_frame: DMA chưa READY
+    METRIC_TX_COLLISIONS,        // knx_send_frame: bus có tín hiệu ngay trước khi gửi
+    METRIC_TX_BUS_BUSY,          // knx_send_frame: đang nhận frame khác
+    METRIC_TX_DMA_ERRORS,        // HAL_TIM_PWM_Start_DMA lỗi
+    METRIC_TX_INVALID,           // Frame sai tham số / độ dài
+    // Echo / L_DATA_CON
+    METRIC_ECHO_CONFIRMED,       // L_DATA_CON dương
+    METRIC_ECHO_NEGATIVE,        // L_DATA_CON âm (mọi nguyên nhân)
+    METRIC_ECHO_BUS_NACK,        // Echo khớp nhưng bus trả NACK/BUSY
+    METRIC_ECHO_MISMATCH,
+    METRIC_ECHO_TIMEOUTS,
+    METRIC_ECHO_LOST,            // Echo không có ký tự ACK / bị cắt
+    // ACK gửi xuống bus (U_ACK_REQ)
+    METRIC_ACK_SENT,
+    METRIC_ACK_LATE,             // Gửi được nhưng trễ hơn 1 bit time so với đầu window
+    METRIC_ACK_MISSED,           // Quá window hoặc bus bận
+    METRIC_ACK_LATENCY_MIN_US,   // gauge: µs từ checksum tới lúc gửi ACK
+    METRIC_ACK_LATENCY_MAX_US,   // gauge
+    // Queue
+    METRIC_Q_PUSH,
+    METRIC_Q_DROPPED,            // Queue đầy / frame không hợp lệ
+    METRIC_Q_HIGH_WATER,         // gauge
+    // Host link
+    METRIC_HOST_BYTES,
+    METRIC_HOST_FRAMES,
+    METRIC_HOST_REJECTED,        // Frame từ host trả L_DATA_CON âm ngay
+    METRIC_HOST_PARSER_RESETS,   // Byte sai giữa frame → resync
+    METRIC_HOST_GAP_RESETS,      // Khoảng nghỉ giữa frame dở → reset
+    METRIC_HOST_CRC_ERRORS,
+    METRIC_HOST_MARKER_ERRORS,
+    // System
+    METRIC_SYS_ERRORS,           // my_Error_Handler
+    METRIC_SYS_UPTIME_S,         // gauge, cập nhật lúc đọc
+    METRIC_SYS_RESET_FLAGS,      // gauge: RCC_CSR >> 24 của lần khởi động này
+    // Supervisor / warm restart (recovery.h)
+    METRIC_RECOVER_RX,           // Decoder RX khởi động lại (huỷ điểm lấy mẫu bit)
+    METRIC_RECOVER_TX,           // DMA / TIM3 khởi động lại
+    METRIC_RECOVER_HOST_UART,    // MCU_SERIAL khởi động lại
+    METRIC_RECOVER_HOST_PARSER,  // Frame host dở dang bị bỏ
+    METRIC_WARM_RESTARTS,        // gauge: số warm restart kể từ lần mất nguồn
+    METRIC_WARM_FRAMES_KEPT,     // gauge: số frame queue giữ lại ở lần khởi động này
+    // Queue TX (byte-packed)
+    METRIC_Q_HIGH_WATER_BYTES,   // gauge
+    METRIC_Q_CAPACITY_BYTES,     // gauge: KNX_TX_QUEUE_BYTES
+    METRIC_Q_CAPACITY_FRAMES,    // gauge: số frame độ dài tối đa chắc chắn chứa được
+    // RX bus (tiếp)
+    METRIC_RX_STRAY_BYTES,       // Byte trên bus ngoài frame, không phải ký tự ACK (không forward)
+    METRIC_RX_ACK_SUPPRESSED,    // U_ACK_REQ bị bỏ vì frame sai checksum / độ dài / parity
+    METRIC_RX_REPEATS,           // Frame hợp lệ có repeat flag = 0 (bên gửi lặp lại)
+    METRIC_RX_REPEATS_DROPPED,   // Bản lặp của telegram đã forward, không gửi lên MCU (rx_dedup)
+    METRIC_RX_REPEAT_ACKS,       // Bản lặp bị bỏ nhưng vẫn được ACK như bản đầu
+    // Host link (tiếp)
+    METRIC_HOST_TX_PACKETS,      // Packet gửi qua transport theo packet (USB CDC)
+    METRIC_HOST_TX_DROPPED,      // Byte bỏ vì USB CDC chưa mở / host không đọc (hết chỗ giữ) / stream RTOS đầy
+    // Coupler (KNX_COUPLER_ENABLE, xem coupler.h)
+    METRIC_COUPLER_ROUTED_0_1,   // Telegram line 0 → line 1 đã gửi được (có ACK)
+    METRIC_COUPLER_ROUTED_1_0,   // Telegram line 1 → line 0 đã gửi được (có ACK)
+    METRIC_COUPLER_FILTERED,     // Telegram hợp lệ không route (bảng lọc / địa chỉ cá nhân cùng line)
+    METRIC_COUPLER_HOP_LIMIT,    // Hop count = 0, không route
+    METRIC_COUPLER_TX_RETRIES,   // Gửi lại (NACK / BUSY / không ACK / echo sai)
+    METRIC_COUPLER_TX_FAILED,    // Bỏ sau KNX_COUPLER_RETRIES lần gửi lại
+    METRIC_COUPLER_QUEUE_FULL,   // Queue line đích đầy → trả BUSY cho bên gửi
+    // RX bus (tiếp)
+    METRIC_RX_FORWARDED,         // Telegram forward lên host (rx_filter cho qua / bộ lọc tắt)
+    METRIC_RX_RING_OVERRUNS,     // Byte bus bị bỏ vì main loop chưa lấy kịp (bus_rx_ring.h / queue bus_rx)
+    // Latency lớn nhất từ ISR post event tới lúc loop xử lý (µs, gauge), theo thứ tự bit EVT_* (event_loop.h)
+    // FreeRTOS: tới lúc tx_sched nhận notification; RX / HOST tính từ lúc task bus_rx / host_link xử lý xong byte
+    METRIC_EVT_LATENCY_RX_US,
+    METRIC_EVT_LATENCY_HOST_US,
+    METRIC_EVT_LATENCY_ACK_US,
+    METRIC_EVT_LATENCY_TX_DONE_US,
+    METRIC_EVT_LATENCY_TICK_US,
+    METRIC_EVT_LATENCY_IDLE_US,
+    METRIC_EVT_LATENCY_LINE1_US,
+    METRIC_COUNT
+} metric_id_t;
+
+extern volatile uint32_t metrics_values[METRIC_COUNT];
+
+static inline void metric_add(metric_id_t id, uint32_t n) {
+    __atomic_fetch_add(&metrics_values[id], n, __ATOMIC_RELAXED);
+}
+
+static inline void metric_inc(metric_id_t id) {
+    metric_add(id, 1);
+}
+
+static inline void metric_set(metric_id_t id, uint32_t v) {
+    __atomic_store_n(&metrics_values[id], v, __ATOMIC_RELAXED);
+}
+
+static inline uint32_t metric_get(metric_id_t id) {
+    return __atomic_load_n(&metrics_values[id], __ATOMIC_RELAXED);
+}
+
+// Gauge: chỉ cập nhật khi v lớn hơn / nhỏ hơn giá trị hiện tại
+void metric_max(metric_id_t id, uint32_t v);
+void metric_min(metric_id_t id, uint32_t v);
+
+void metrics_init(void);
+void metrics_reset(void);
+// Gửi toàn bộ registry lên host (U_DIAG_IND, gửi dần qua host_diag_report)
+void metrics_send(void);
+
+#endif // METRICS_H
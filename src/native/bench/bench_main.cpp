@@ -0,0 +1,23 @@
+#include "bench.h"
+#include "native/hal_native.h"
+#include "config.h"
+#include "logger.h"
+#include "metrics.h"
+#include "trace.h"
+
+/*
+ * env:native_bench - microbenchmark trên Linux (ns / op), cùng danh sách case với bench build của target
+ *
+ *   pio run -e native_bench && .pio/build/native_bench/program > bench.txt
+ *   python3 tools/bench_compare.py tools/bench_baseline_native.txt bench.txt
+ */
+
+int main(void) {
+    hal_native_reset();
+    metrics_init();
+    logger_init();
+    trace_init();
+    hal_native_debug_echo(true); // Debug serial → stdout
+    bench_run_all();
+    return 0;
+}
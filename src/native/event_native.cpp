@@ -0,0 +1,59 @@
+#include "event_loop.h"
+#include "native/hal_native.h"
+
+/*
+ * event_loop.h trên env:native: tick 1ms là alarm của HAL giả lập, ACK deadline là compare HAL_TB_ACK như target,
+ * event_wait() chạy thời gian ảo từng µs thay cho WFI.
+ */
+
+static volatile uint32_t event_mask = 0;
+
+static void tick_alarm(void) {
+    event_post(EVT_TICK);
+    hal_native_alarm_set(HAL_NATIVE_ALARM_TICK, 1000, tick_alarm);
+}
+
+static void deadline_alarm(void) {
+    event_post(EVT_ACK_DEADLINE);
+}
+
+void event_loop_init(void) {
+    event_mask = 0;
+    hal_native_alarm_set(HAL_NATIVE_ALARM_TICK, 1000, tick_alarm);
+}
+
+void event_post(uint32_t events) {
+    event_mask |= events;
+}
+
+uint32_t event_wait(void) {
+    for (;;) {
+        // Giống target: USART1 ISR thuộc Arduino core → kiểm tra RX buffer khi thức dậy
+        if (hal_host_available()) {
+            event_mask |= EVT_HOST_RX;
+        }
+        if (event_mask) {
+            uint32_t events = event_mask;
+            event_mask = 0;
+            return events;
+        }
+        hal_native_advance_us(1);
+    }
+}
+
+void event_arm_ack_deadline(uint32_t at_us) {
+    hal_timebase_arm(HAL_TB_ACK, at_us, deadline_alarm);
+}
+
+void event_cancel_ack_deadline(void) {
+    hal_timebase_cancel(HAL_TB_ACK);
+}
+
+// ISR và loop() cùng chạy trong thời gian ảo → không có latency để đo
+uint32_t event_get_max_latency_us(uint8_t event_idx) {
+    (void)event_idx;
+    return 0;
+}
+
+void event_reset_latency(void) {
+}
@@ -0,0 +1,39 @@
+#ifndef FUZZ_H
+#define FUZZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Fuzz harness cho parser / queue (env:native_fuzz_*, Linux)
+ *
+ * Mỗi target định nghĩa LLVMFuzzerTestOneInput():
+ * - clang: link với libFuzzer (-fsanitize=fuzzer,address,undefined, KNX_LIBFUZZER=1)
+ * - không có clang: fuzz_driver.cpp cung cấp main() - sinh input ngẫu nhiên từ dictionary token
+ *   (không có coverage), replay file crash, báo exec/s và ns/byte
+ *
+ * Vi phạm invariant → FUZZ_CHECK in lỗi rồi abort() (driver ghi input ra file crash-*).
+ */
+
+#define FUZZ_CHECK(cond, what)                        \
+    do {                                              \
+        if (!(cond)) {                                \
+            fuzz_fail(what, __FILE__, __LINE__);      \
+        }                                             \
+    } while (0)
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+// Đưa firmware về trạng thái sau khi khởi động (queue rỗng, parser IDLE, host link không framing)
+void fuzz_reset(void);
+// Bỏ toàn bộ byte gateway đã ghi cho host
+void fuzz_drain_host(void);
+// Lấy byte gateway ghi cho host từ lần gọi trước, trả về số byte
+uint16_t fuzz_take_host(uint8_t *out, uint16_t max);
+
+[[noreturn]] void fuzz_fail(const char *what, const char *file, int line);
+
+// Input đang chạy (driver dùng để ghi file crash)
+void fuzz_set_current_input(const uint8_t *data, size_t size);
+
+#endif // FUZZ_H
@@ -0,0 +1,85 @@
+#include "native/fuzz/fuzz.h"
+#include "config.h"
+#include "metrics.h"
+#include "tpuart/tpuart.h"
+#include "tpuart/host_link.h"
+#include "tpuart/rx_filter.h"
+#include "tpuart/rx_dedup.h"
+
+/*
+ * knx_parse_BUS_byte(): byte decode từ bus → forward lên host, echo / L_DATA_CON
+ *
+ * Input: [cấu hình] [độ dài frame chờ echo] [frame chờ echo] [byte trên bus...]
+ *   cấu hình: FRAME_END_WITH_MARKER | CRC_CCITT, bit 0 = có frame đang chờ echo, bit 1 = bật RX filter,
+ *             bit 2 = bật bỏ bản lặp (rx_dedup)
+ * Sau byte cuối: bus im lặng (knx_BUS_gap_timeout)
+ * Invariant:
+ * - rx_buf_idx <= KNX_MAX_FRAME_LEN, parser về IDLE trong KNX_MAX_FRAME_LEN + 1 byte (frame + ACK)
+ * - số L_DATA_CON <= số frame chờ echo (không có frame → không có xác nhận)
+ * - byte ghi cho host khi parser ở IDLE (ngoài frame, không có xác nhận) chỉ là L_ACKN_IND
+ */
+#define FUZZ_CFG_ECHO 0x01
+#define FUZZ_CFG_FILTER 0x02
+#define FUZZ_CFG_DEDUP 0x04
+#define FUZZ_RX_IDLE_WITHIN (KNX_MAX_FRAME_LEN + 1)
+
+static uint32_t confirms(void) {
+    return metric_get(METRIC_ECHO_CONFIRMED) + metric_get(METRIC_ECHO_NEGATIVE);
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size < 2) {
+        return 0;
+    }
+    fuzz_reset();
+    uint8_t cfg = data[0];
+    host_link_configure(cfg & (FRAME_END_WITH_MARKER | CRC_CCITT));
+    size_t pos = 2;
+
+    uint32_t queued = 0;
+    if (cfg & FUZZ_CFG_ECHO) {
+        uint8_t len = data[1] % KNX_BUFFER_MAX_SIZE + 1;
+        if (size - pos < len) {
+            return 0;
+        }
+        if (enqueue_frame(&data[pos], len)) {
+            set_echo_frame();
+            queued = 1;
+        }
+        pos += len;
+    }
+    if (cfg & FUZZ_CFG_FILTER) {
+        rx_filter_add(0x1101);
+        rx_filter_enable(true);
+    }
+    if (cfg & FUZZ_CFG_DEDUP) {
+        rx_dedup_enable(true);
+    }
+
+    uint32_t busy_run = 0;
+    uint8_t out[256];
+    for (; pos < size; pos++) {
+        tpuart_rx_state_t before = tpuart_rx_state();
+        uint32_t confirms_before = confirms();
+        knx_parse_BUS_byte(data[pos]);
+
+        FUZZ_CHECK(tpuart_rx_index() <= KNX_MAX_FRAME_LEN, "rx_buf_idx out of bounds");
+        busy_run = tpuart_rx_state() == TPUART_RX_IDLE ? 0 : busy_run + 1;
+        FUZZ_CHECK(busy_run <= FUZZ_RX_IDLE_WITHIN, "bus parser stuck outside IDLE");
+        FUZZ_CHECK(confirms() <= queued, "confirmation without frame");
+
+        uint16_t n = fuzz_take_host(out, sizeof(out));
+        if (before == TPUART_RX_IDLE && tpuart_rx_state() == TPUART_RX_IDLE && confirms() == confirms_before) {
+            for (uint16_t i = 0; i < n; i++) {
+                FUZZ_CHECK((out[i] & L_ACKN_MASK) == L_ACKN_IND, "non-ACK service byte outside frame");
+            }
+        }
+    }
+
+    knx_BUS_gap_timeout();
+    FUZZ_CHECK(tpuart_rx_state() == TPUART_RX_IDLE, "bus parser not IDLE after gap");
+    FUZZ_CHECK(confirms() <= queued, "confirmation without frame");
+    FUZZ_CHECK(queue_validate(), "queue corrupted");
+    fuzz_drain_host();
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include "native/fuzz/fuzz.h"
+#include "native/hal_native.h"
+#include "config.h"
+#include "logger.h"
+#include "metrics.h"
+#include "trace.h"
+#include "tpuart/tpuart.h"
+#include "tpuart/host_link.h"
+#include "tpuart/rx_filter.h"
+#include "tpuart/rx_dedup.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static const uint8_t *current_data = nullptr;
+static size_t current_size = 0;
+static bool initialized = false;
+
+void fuzz_set_current_input(const uint8_t *data, size_t size) {
+    current_data = data;
+    current_size = size;
+}
+
+void fuzz_reset(void) {
+    if (!initialized) {
+        // Logger / trace chỉ cần init 1 lần, debug serial của HAL native không in ra
+        logger_init();
+        trace_init();
+        initialized = true;
+    }
+    hal_native_reset();
+    metrics_init();
+    queue_clear();
+    host_link_configure(0);
+    rx_filter_enable(false);
+    rx_filter_clear();
+    rx_dedup_enable(false);
+    reset_tx_state();
+    reset_rx_state();
+    reset_pending_ack();
+    fuzz_drain_host();
+}
+
+void fuzz_drain_host(void) {
+    uint8_t buf[256];
+    while (hal_native_host_take(buf, sizeof(buf)) > 0) {
+    }
+}
+
+uint16_t fuzz_take_host(uint8_t *out, uint16_t max) {
+    return hal_native_host_take(out, max);
+}
+
+void fuzz_fail(const char *what, const char *file, int line) {
+    fprintf(stderr, "FUZZ_CHECK failed: %s (%s:%d)\n", what, file, line);
+#if !KNX_LIBFUZZER
+    // libFuzzer tự lưu input gây crash, driver thì ghi ra crash-<hash>
+    if (current_data != nullptr) {
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < current_size; i++) {
+            h = (h ^ current_data[i]) * 16777619u;
+        }
+        char name[32];
+        snprintf(name, sizeof(name), "crash-%08x", h);
+        FILE *f = fopen(name, "wb");
+        if (f != nullptr) {
+            fwrite(current_data, 1, current_size, f);
+            fclose(f);
+            fprintf(stderr, "input (%zu byte) saved to %s\n", current_size, name);
+        }
+    }
+#endif
+    abort();
+}
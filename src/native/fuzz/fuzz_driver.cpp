@@ -0,0 +1,184 @@
+#include "native/fuzz/fuzz.h"
+#include "config.h"
+#include "tpuart/tpuart.h"
+
+#if !KNX_LIBFUZZER
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__SANITIZE_ADDRESS__)
+#include <sanitizer/common_interface_defs.h>
+#endif
+
+/*
+ * main() khi không có libFuzzer (g++): cùng cú pháp tham số chính của libFuzzer
+ *
+ *   program [-runs=N] [-max_total_time=S] [-seed=N] [-max_len=N] [file...]
+ *
+ * - Có file: chạy lại từng file (tái hiện crash-*)
+ * - Không có file: input ngẫu nhiên, trộn token của protocol (START/CONT/END, marker, ACK...)
+ *   vì không có coverage để tự tìm ra chúng; in exec/s và ns/byte
+ */
+#define DRIVER_MAX_LEN 512
+#define DRIVER_REPORT_RUNS 100000
+
+static const uint8_t tokens[] = {
+    0x80, 0x81, 0x82, 0x85, 0x89, 0x8F, 0x90, 0x95, 0x96, 0xBF,  // U_L_DATA_START / CONT_REQ | i
+    0x40, 0x47, 0x48, 0x4B, 0x56, 0x57, 0x7F,                    // U_L_DATA_END_REQ | i
+    0x18, 0x19, 0x1A, 0x1B,                                      // U_CONFIGURE_REQ
+    0x10, 0x11, 0x12, 0x14,                                      // U_ACK_REQ
+    0xCB, 0xF8, 0x06, 0x07,                                      // marker, U_DIAG_REQ
+    0xBC, 0xB0, 0x90, 0x10, 0x11, 0x01, 0x00, 0x60, 0x61, 0xE1,  // control / địa chỉ / byte 5
+    0xCC, 0x0C, 0xC0, 0x0B, 0x8B,                                // ACK / NACK / BUSY, L_DATA_CON
+};
+
+static uint64_t rng = 0x9E3779B97F4A7C15ULL;
+
+static uint32_t rnd(void) {
+    rng ^= rng >> 12;
+    rng ^= rng << 25;
+    rng ^= rng >> 27;
+    return (uint32_t)((rng * 2685821657736338717ULL) >> 32);
+}
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Frame đúng checksum, độ dài 8..KNX_MAX_FRAME_LEN + 8 (cả frame quá dài)
+static uint8_t gen_frame(uint8_t *frame) {
+    uint8_t n = 8 + rnd() % (KNX_MAX_FRAME_LEN + 1);
+    uint8_t x = 0;
+    for (uint8_t k = 0; k + 1 < n; k++) {
+        frame[k] = k == 5 ? (uint8_t)(0x60 | ((n - 8) & 0x0F)) : (uint8_t)rnd();
+        x ^= frame[k];
+    }
+    frame[n - 1] = (uint8_t)~x;
+    return n;
+}
+
+// Đôi khi chèn frame nguyên vẹn (dạng bus) hoặc đã mã hoá theo U_L_DATA_*_REQ (dạng host)
+// để đi được vào nhánh sâu (echo, ACK, queue đầy, frame quá dài)
+static size_t gen_input(uint8_t *buf, size_t max_len) {
+    size_t len = 1 + rnd() % max_len;
+    size_t i = 0;
+    while (i < len) {
+        uint32_t r = rnd() % 10;
+        if (r < 3) {
+            buf[i++] = (uint8_t)rnd();
+        } else if (r < 8) {
+            buf[i++] = tokens[rnd() % sizeof(tokens)];
+        } else {
+            uint8_t frame[KNX_MAX_FRAME_LEN + 8];
+            uint8_t n = gen_frame(frame);
+            for (uint8_t k = 0; k < n && i < len; k++) {
+                if (r == 9) {
+                    buf[i++] = k == 0 ? U_L_DATA_START_REQ
+                               : k == n - 1 ? (uint8_t)(U_L_DATA_END_REQ | (k & 0x3F))
+                               : (uint8_t)(U_L_DATA_CONT_REQ | (k & 0x3F));
+                    if (i >= len) {
+                        break;
+                    }
+                }
+                buf[i++] = frame[k];
+            }
+        }
+    }
+    return len;
+}
+
+static int run_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == nullptr) {
+        perror(path);
+        return 1;
+    }
+    static uint8_t buf[1 << 16];
+    size_t n = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+    fuzz_set_current_input(buf, n);
+    LLVMFuzzerTestOneInput(buf, n);
+    printf("%s: %zu byte OK\n", path, n);
+    return 0;
+}
+
+#if defined(__SANITIZE_ADDRESS__)
+// ASan / UBSan dừng chương trình trước FUZZ_CHECK → vẫn ghi input ra crash-*
+static void on_sanitizer_death(void) {
+    fuzz_fail("sanitizer error", __FILE__, __LINE__);
+}
+#endif
+
+static const char *flag_value(const char *arg, const char *name) {
+    size_t n = strlen(name);
+    return strncmp(arg, name, n) == 0 && arg[n] == '=' ? arg + n + 1 : nullptr;
+}
+
+int main(int argc, char **argv) {
+    uint64_t runs = 0;
+    double max_time = 10;
+    size_t max_len = 256;
+    int files = 0;
+#if defined(__SANITIZE_ADDRESS__)
+    __sanitizer_set_death_callback(on_sanitizer_death);
+#endif
+
+    for (int i = 1; i < argc; i++) {
+        const char *v;
+        if ((v = flag_value(argv[i], "-runs")) != nullptr) {
+            runs = strtoull(v, nullptr, 0);
+            max_time = 0;
+        } else if ((v = flag_value(argv[i], "-max_total_time")) != nullptr) {
+            max_time = atof(v);
+        } else if ((v = flag_value(argv[i], "-seed")) != nullptr) {
+            rng = strtoull(v, nullptr, 0) * 0x9E3779B97F4A7C15ULL + 1;
+        } else if ((v = flag_value(argv[i], "-max_len")) != nullptr) {
+            max_len = strtoul(v, nullptr, 0);
+            max_len = max_len < 1 ? 1 : max_len > DRIVER_MAX_LEN ? DRIVER_MAX_LEN : max_len;
+        } else if (argv[i][0] == '-') {
+            fprintf(stderr, "ignored flag %s (libFuzzer only)\n", argv[i]);
+        } else {
+            if (run_file(argv[i]) != 0) {
+                return 1;
+            }
+            files++;
+        }
+    }
+    if (files > 0) {
+        return 0;
+    }
+
+    static uint8_t buf[DRIVER_MAX_LEN];
+    uint64_t n = 0, bytes = 0;
+    double start = now_s(), last = start;
+    for (;;) {
+        size_t len = gen_input(buf, max_len);
+        fuzz_set_current_input(buf, len);
+        LLVMFuzzerTestOneInput(buf, len);
+        n++;
+        bytes += len;
+        if (runs && n >= runs) {
+            break;
+        }
+        if (n % DRIVER_REPORT_RUNS == 0) {
+            double t = now_s();
+            if (max_time > 0 && t - start >= max_time) {
+                break;
+            }
+            if (t - last >= 5) {
+                printf("#%llu exec/s: %.0f\n", (unsigned long long)n, n / (t - start));
+                fflush(stdout);
+                last = t;
+            }
+        }
+    }
+    double secs = now_s() - start;
+    printf("Done %llu runs in %.1f s: %.0f exec/s, %.1f ns/byte (%llu byte, random + dictionary, no coverage)\n",
+           (unsigned long long)n, secs, n / secs, secs * 1e9 / (bytes ? bytes : 1), (unsigned long long)bytes);
+    return 0;
+}
+
+#endif // !KNX_LIBFUZZER
@@ -0,0 +1,43 @@
+#include "native/fuzz/fuzz.h"
+#include "config.h"
+#include "metrics.h"
+#include "tpuart/tpuart.h"
+#include "tpuart/host_link.h"
+
+/*
+ * knx_parse_MCU_byte(): byte từ host (UART) → tx_buffer → queue TX
+ *
+ * Input: [cấu hình host link (FRAME_END_WITH_MARKER | CRC_CCITT)] [byte từ host...]
+ * Invariant sau mỗi byte:
+ * - tx_buf_idx <= KNX_MAX_FRAME_LEN
+ * - parser về IDLE trong FUZZ_TX_IDLE_WITHIN byte liên tiếp (frame dài nhất + chờ marker)
+ * - queue luôn hợp lệ (queue_validate)
+ * - mỗi frame host gửi xong có đúng 1 kết quả: vào queue hoặc 1 L_DATA_CON âm
+ */
+#define FUZZ_TX_IDLE_WITHIN (2 * TPUART_TX_MAX_FRAME_BYTES)
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    fuzz_reset();
+    host_link_configure(data[0] & (FRAME_END_WITH_MARKER | CRC_CCITT));
+
+    for (size_t i = 1; i < size; i++) {
+        knx_parse_MCU_byte(data[i]);
+
+        FUZZ_CHECK(tpuart_tx_index() <= KNX_MAX_FRAME_LEN, "tx_buf_idx out of bounds");
+        FUZZ_CHECK(tpuart_tx_busy_bytes() <= FUZZ_TX_IDLE_WITHIN, "host parser stuck outside IDLE");
+        FUZZ_CHECK(queue_validate(), "queue corrupted");
+
+        // Không có echo trên bus → frame vào queue ở lại queue, frame bị từ chối nhận L_DATA_CON âm
+        uint32_t finished = metric_get(METRIC_HOST_FRAMES) + metric_get(METRIC_HOST_CRC_ERRORS) +
+                            metric_get(METRIC_HOST_MARKER_ERRORS);
+        FUZZ_CHECK(q_count + metric_get(METRIC_HOST_REJECTED) == finished,
+                   "host frame without exactly one outcome");
+        FUZZ_CHECK(metric_get(METRIC_ECHO_CONFIRMED) + metric_get(METRIC_ECHO_NEGATIVE) == 0,
+                   "confirmation without bus echo");
+    }
+    fuzz_drain_host();
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "native/fuzz/fuzz.h"
+#include "config.h"
+#include "frame_validator.h"
+#include "tpuart/tpuart.h"
+#include <string.h>
+
+/*
+ * Queue TX (enqueue_frame / dequeue_frame / peek_frame) so với model FIFO đơn giản,
+ * và validate_knx_frame() so với định nghĩa frame chuẩn.
+ *
+ * Input: chuỗi lệnh [op] [tham số...]
+ *   op % 4 = 0: enqueue [len] [data]  (len 0..KNX_BUFFER_MAX_SIZE + 1, gồm cả độ dài sai)
+ *            1: dequeue
+ *            2: peek
+ *            3: validate_knx_frame [len] [data]
+ * Invariant sau mỗi lệnh: queue_validate(), q_count và nội dung khớp model,
+ * enqueue độ dài hợp lệ chỉ thất bại khi queue_frames_free(len) == 0
+ */
+#define MODEL_MAX 256
+
+typedef struct {
+    uint8_t data[KNX_BUFFER_MAX_SIZE];
+    uint8_t len;
+} model_frame_t;
+
+static model_frame_t model[MODEL_MAX];
+static uint16_t model_head = 0, model_count = 0;
+
+static bool expect_valid(const uint8_t *d, uint8_t len) {
+    // Standard: LG = 4 bit thấp byte 5, 8 + LG byte; extended (bit 7 control = 0): LG = byte 6, 9 + LG byte
+    bool ext = len > 0 && !(d[0] & 0x80);
+    if (len < 8 || len > KNX_BUFFER_MAX_SIZE || len != (ext ? 9 + d[6] : 8 + (d[5] & 0x0F))) {
+        return false;
+    }
+    uint8_t x = 0;
+    for (uint8_t i = 0; i < len; i++) {
+        x ^= d[i];
+    }
+    return x == 0xFF;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    fuzz_reset();
+    model_head = model_count = 0;
+
+    size_t pos = 0;
+    while (pos < size) {
+        uint8_t op = data[pos++] % 4;
+        if (op == 0 || op == 3) {
+            if (pos >= size) {
+                break;
+            }
+            uint8_t len = data[pos++] % (KNX_BUFFER_MAX_SIZE + 2);
+            uint8_t buf[KNX_BUFFER_MAX_SIZE + 1] = {0};
+            size_t avail = size - pos < len ? size - pos : len;
+            memcpy(buf, &data[pos], avail);
+            pos += avail;
+
+            if (op == 3) {
+                bool valid = validate_knx_frame(buf, len) == FRAME_VALID;
+                FUZZ_CHECK(valid == expect_valid(buf, len), "validate_knx_frame disagrees with frame definition");
+                continue;
+            }
+            bool valid_len = len > 0 && len <= KNX_BUFFER_MAX_SIZE;
+            uint16_t free_before = valid_len ? queue_frames_free(len) : 0;
+            bool ok = enqueue_frame(buf, len);
+            FUZZ_CHECK(!ok || valid_len, "enqueue accepted invalid length");
+            FUZZ_CHECK(ok || !valid_len || free_before == 0, "enqueue failed with space left");
+            if (ok) {
+                FUZZ_CHECK(model_count < MODEL_MAX, "queue holds more frames than q_count allows");
+                model_frame_t *m = &model[(model_head + model_count) % MODEL_MAX];
+                memcpy(m->data, buf, len);
+                m->len = len;
+                model_count++;
+            }
+        } else if (op == 1) {
+            uint8_t out[KNX_BUFFER_MAX_SIZE];
+            uint8_t len = 0;
+            bool ok = dequeue_frame(out, &len);
+            FUZZ_CHECK(ok == (model_count > 0), "dequeue result differs from model");
+            if (ok) {
+                const model_frame_t *m = &model[model_head];
+                FUZZ_CHECK(len == m->len && memcmp(out, m->data, len) == 0, "dequeued frame differs from model");
+                model_head = (model_head + 1) % MODEL_MAX;
+                model_count--;
+            }
+        } else {
+            Frame *f = peek_frame();
+            FUZZ_CHECK((f != nullptr) == (model_count > 0), "peek result differs from model");
+            if (f != nullptr) {
+                const model_frame_t *m = &model[model_head];
+                FUZZ_CHECK(f->len == m->len && memcmp(f->data, m->data, f->len) == 0, "peeked frame differs from model");
+            }
+        }
+
+        FUZZ_CHECK(q_count == model_count, "q_count differs from model");
+        FUZZ_CHECK(queue_bytes_used() <= KNX_TX_QUEUE_BYTES, "queue_bytes_used out of range");
+        FUZZ_CHECK(queue_validate(), "queue corrupted");
+    }
+    return 0;
+}
@@ -0,0 +1,432 @@
+#include "native/hal_native.h"
+#include "config.h"
+#include "metrics.h"
+#include "hal/host_transport.h"
+#include <stdio.h>
+#include <string.h>
+
+#define NATIVE_CYCLES_PER_US 72        // Giả lập SYSCLK 72MHz cho hal_cycles()
+#define NATIVE_HOST_BUF 4096
+#define NATIVE_DEBUG_SPACE 1024        // Debug serial không bao giờ đầy
+#define NATIVE_PEER_T0_HIGH 35         // Cùng độ rộng xung bit 0 với knx_tx
+#define NATIVE_PEER_MAX_PULSES (KNX_BUFFER_MAX_SIZE * 13)
+
+// Phát lại 1 buffer độ rộng xung: mỗi phần tử = 1 bit, mức 1 trong pulses[i] µs đầu bit
+typedef struct {
+    const uint16_t *pulses;
+    uint16_t count;
+    uint32_t pos_us;
+    bool active;
+    bool level;
+} pulse_player_t;
+
+static uint64_t now_us = 0;
+
+// ===== Bus: mỗi line 1 đường TP1 riêng (line 1 chỉ có khi KNX_COUPLER_ENABLE) =====
+// Line hook, tx_loopback chỉ áp dụng cho line 0 (sim / replay mô hình 1 line)
+typedef struct {
+    void (*edge_isr)(void);
+    bool level;
+    void (*tx_done_isr)(void);
+    pulse_player_t tx_player;
+    pulse_player_t peer_player;
+    uint16_t peer_pulses[NATIVE_PEER_MAX_PULSES];
+} native_line_t;
+
+static native_line_t lines[KNX_LINE_COUNT];
+
+// ===== Bus timebase: (uint32_t)now_us, compare channel kiểm tra mỗi µs =====
+static struct {
+    uint32_t at_us;
+    void (*cb)(void);
+    bool armed;
+} tb_ch[HAL_TB_CHANNEL_COUNT];
+
+// ===== Bus TX =====
+static hal_native_line_hook_t line_hook = nullptr;
+static bool tx_loopback = true;
+
+// ===== Alarm =====
+static struct {
+    uint64_t at_us;
+    hal_native_alarm_cb_t cb;
+    bool armed;
+} alarms[HAL_NATIVE_ALARM_COUNT];
+
+// ===== Serial =====
+static uint8_t host_rx[NATIVE_HOST_BUF];
+static uint16_t host_rx_head = 0, host_rx_tail = 0;
+static uint8_t host_tx[NATIVE_HOST_BUF];
+static uint16_t host_tx_len = 0;
+static uint32_t host_writes = 0;   // Số lần transport ghi xuống "driver" (CDC: số packet)
+static bool debug_echo = false;
+static void (*debug_sink)(const uint8_t *data, uint16_t len) = nullptr;
+static uint32_t reset_flags = HAL_RESET_FLAG_POR;
+
+// Bus đổi mức → "EXTI"
+static void bus_update(uint8_t line) {
+    if (line >= KNX_LINE_COUNT) {
+        return; // Build 1 line: -O2 không suy ra được line luôn = 0
+    }
+    native_line_t *l = &lines[line];
+    bool level = ((tx_loopback || line != KNX_LINE_MAIN) && l->tx_player.level) || l->peer_player.level;
+    if (line == KNX_LINE_MAIN && line_hook && line_hook(level)) {
+        level = true;
+    }
+    if (level != l->level) {
+        l->level = level;
+        if (l->edge_isr) {
+            l->edge_isr();
+        }
+    }
+}
+
+// Trả về true khi vừa phát xong bit cuối
+static bool player_step(pulse_player_t *p) {
+    if (!p->active) {
+        return false;
+    }
+    if (p->pos_us >= (uint32_t)p->count * KNX_BIT_PERIOD_US) {
+        p->active = false;
+        p->level = false;
+        return true;
+    }
+    p->level = (p->pos_us % KNX_BIT_PERIOD_US) < p->pulses[p->pos_us / KNX_BIT_PERIOD_US];
+    p->pos_us++;
+    return false;
+}
+
+static void player_start(pulse_player_t *p, const uint16_t *pulses, uint16_t count) {
+    p->pulses = pulses;
+    p->count = count;
+    p->pos_us = 0;
+    p->level = false;
+    p->active = count > 0;
+}
+
+void hal_native_reset(void) {
+    now_us = 0;
+    memset(tb_ch, 0, sizeof(tb_ch));
+    for (uint8_t line = 0; line < KNX_LINE_COUNT; line++) {
+        lines[line].level = false;
+        memset(&lines[line].tx_player, 0, sizeof(lines[line].tx_player));
+        memset(&lines[line].peer_player, 0, sizeof(lines[line].peer_player));
+    }
+    memset(alarms, 0, sizeof(alarms));
+    host_rx_head = host_rx_tail = 0;
+    host_tx_len = 0;
+    host_writes = 0;
+    hal_host_begin();  // Bỏ packet đang gom, transport đã chọn giữ nguyên
+}
+
+void hal_native_advance_us(uint32_t us) {
+    while (us--) {
+        now_us++;
+
+        // Compare của timebase (TIM2) trước: điểm lấy mẫu và sườn cùng µs → sườn thuộc bit mới
+        for (uint8_t ch = 0; ch < HAL_TB_CHANNEL_COUNT; ch++) {
+            if (tb_ch[ch].armed && (int32_t)((uint32_t)now_us - tb_ch[ch].at_us) >= 0) {
+                tb_ch[ch].armed = false;
+                tb_ch[ch].cb();
+            }
+        }
+
+        for (uint8_t line = 0; line < KNX_LINE_COUNT; line++) {
+            native_line_t *l = &lines[line];
+            bool tx_done = player_step(&l->tx_player);
+            player_step(&l->peer_player);
+            bus_update(line);
+            if (tx_done && l->tx_done_isr) {
+                l->tx_done_isr();
+            }
+        }
+
+        for (uint8_t i = 0; i < HAL_NATIVE_ALARM_COUNT; i++) {
+            if (alarms[i].armed && now_us >= alarms[i].at_us) {
+                alarms[i].armed = false;
+                alarms[i].cb();
+            }
+        }
+    }
+}
+
+uint64_t hal_native_now_us(void) {
+    return now_us;
+}
+
+void hal_native_alarm_set(hal_native_alarm_t id, uint32_t delay_us, hal_native_alarm_cb_t cb) {
+    alarms[id].at_us = now_us + delay_us;
+    alarms[id].cb = cb;
+    alarms[id].armed = cb != nullptr;
+}
+
+void hal_native_alarm_cancel(hal_native_alarm_t id) {
+    alarms[id].armed = false;
+}
+
+// Start + 8 data (LSB trước) + parity chẵn + 3 stop, bit 0 = xung
+bool hal_native_line_send(uint8_t line, const uint8_t *data, uint8_t len) {
+    pulse_player_t *peer_player = &lines[line].peer_player;
+    uint16_t *peer_pulses = lines[line].peer_pulses;
+    if (peer_player->active || len == 0 || len > KNX_BUFFER_MAX_SIZE) {
+        return false;
+    }
+    uint16_t n = 0;
+    for (uint8_t i = 0; i < len; i++) {
+        uint8_t ones = 0;
+        peer_pulses[n++] = NATIVE_PEER_T0_HIGH;
+        for (uint8_t b = 0; b < 8; b++) {
+            uint8_t bit = (data[i] >> b) & 1;
+            ones += bit;
+            peer_pulses[n++] = bit ? 0 : NATIVE_PEER_T0_HIGH;
+        }
+        peer_pulses[n++] = (ones & 1) ? 0 : NATIVE_PEER_T0_HIGH;
+        peer_pulses[n++] = 0;
+        peer_pulses[n++] = 0;
+        peer_pulses[n++] = 0;
+    }
+    player_start(peer_player, peer_pulses, n);
+    return true;
+}
+
+bool hal_native_line_busy(uint8_t line) {
+    return lines[line].peer_player.active;
+}
+
+bool hal_native_bus_send(const uint8_t *data, uint8_t len) {
+    return hal_native_line_send(KNX_LINE_MAIN, data, len);
+}
+
+bool hal_native_bus_busy(void) {
+    return hal_native_line_busy(KNX_LINE_MAIN);
+}
+
+void hal_native_set_line_hook(hal_native_line_hook_t hook) {
+    line_hook = hook;
+}
+
+bool hal_native_tx_sending_one(void) {
+    const pulse_player_t *tx_player = &lines[KNX_LINE_MAIN].tx_player;
+    if (!tx_player->active || tx_player->pos_us == 0) {
+        return false;
+    }
+    return tx_player->pulses[(tx_player->pos_us - 1) / KNX_BIT_PERIOD_US] == 0;
+}
+
+uint16_t hal_native_tx_bits(void) {
+    const pulse_player_t *tx_player = &lines[KNX_LINE_MAIN].tx_player;
+    return tx_player->active ? tx_player->count : 0;
+}
+
+void hal_native_tx_loopback(bool enable) {
+    tx_loopback = enable;
+}
+
+void hal_native_host_inject(const uint8_t *data, uint16_t len) {
+    for (uint16_t i = 0; i < len; i++) {
+        uint16_t next = (host_rx_head + 1) % NATIVE_HOST_BUF;
+        if (next == host_rx_tail) {
+            return; // Đầy: giống RX buffer của HardwareSerial, byte mới bị bỏ
+        }
+        host_rx[host_rx_head] = data[i];
+        host_rx_head = next;
+    }
+}
+
+uint16_t hal_native_host_take(uint8_t *out, uint16_t max) {
+    uint16_t n = host_tx_len < max ? host_tx_len : max;
+    memcpy(out, host_tx, n);
+    memmove(host_tx, host_tx + n, host_tx_len - n);
+    host_tx_len -= n;
+    return n;
+}
+
+uint32_t hal_native_host_writes(void) {
+    return host_writes;
+}
+
+void hal_native_debug_echo(bool enable) {
+    debug_echo = enable;
+}
+
+void hal_native_set_debug_sink(void (*sink)(const uint8_t *data, uint16_t len)) {
+    debug_sink = sink;
+}
+
+void hal_native_set_reset_flags(uint32_t flags) {
+    reset_flags = flags;
+}
+
+// ===== hal.h =====
+uint32_t hal_millis(void) {
+    return (uint32_t)(now_us / 1000);
+}
+
+uint32_t hal_micros(void) {
+    return (uint32_t)now_us;
+}
+
+void hal_cycles_init(void) {
+}
+
+uint32_t hal_cycles(void) {
+    return (uint32_t)(now_us * NATIVE_CYCLES_PER_US);
+}
+
+uint32_t hal_cycles_per_us(void) {
+    return NATIVE_CYCLES_PER_US;
+}
+
+uint32_t hal_irq_save(void) {
+    return 0;
+}
+
+void hal_irq_restore(uint32_t state) {
+    (void)state;
+}
+
+uint32_t hal_reset_flags(void) {
+    return reset_flags;
+}
+
+void hal_watchdog_start(uint32_t timeout_us) {
+    (void)timeout_us;
+}
+
+void hal_watchdog_reload(void) {
+}
+
+void hal_timebase_init(void) {
+}
+
+uint32_t hal_timebase_now(void) {
+    return (uint32_t)now_us;
+}
+
+// Đích đã qua: gọi ở µs kế tiếp (target: sự kiện compare tạo bằng phần mềm, ngắt ngay sau khi arm)
+void hal_timebase_arm(hal_tb_channel_t ch, uint32_t at_us, void (*cb)(void)) {
+    tb_ch[ch].at_us = at_us;
+    tb_ch[ch].cb = cb;
+    tb_ch[ch].armed = cb != nullptr;
+}
+
+void hal_timebase_cancel(hal_tb_channel_t ch) {
+    tb_ch[ch].armed = false;
+}
+
+bool hal_timebase_armed(hal_tb_channel_t ch) {
+    return tb_ch[ch].armed;
+}
+
+void hal_bus_rx_init(uint8_t line, void (*edge)(void)) {
+    lines[line].edge_isr = edge;
+}
+
+bool hal_bus_pin_level(uint8_t line) {
+    return lines[line].level;
+}
+
+void hal_tx_init(uint8_t line, void (*done_isr)(void)) {
+    lines[line].tx_done_isr = done_isr;
+}
+
+bool hal_tx_start(uint8_t line, const uint16_t *pulses, uint16_t count) {
+    if (lines[line].tx_player.active) {
+        return false;
+    }
+    player_start(&lines[line].tx_player, pulses, count);
+    return true;
+}
+
+bool hal_tx_busy(uint8_t line) {
+    return lines[line].tx_player.active;
+}
+
+void hal_tx_recover(uint8_t line) {
+    lines[line].tx_player.active = false;
+    lines[line].tx_player.level = false;
+    bus_update(line);
+}
+
+// ===== Host transport: cả 2 dùng chung buffer RAM, CDC chỉ khác ở chỗ dispatcher gom packet =====
+static void host_native_begin(void) {
+}
+
+static void host_native_end(void) {
+}
+
+static int host_native_available(void) {
+    return (host_rx_head - host_rx_tail + NATIVE_HOST_BUF) % NATIVE_HOST_BUF;
+}
+
+static int host_native_read(void) {
+    if (host_rx_head == host_rx_tail) {
+        return -1;
+    }
+    uint8_t b = host_rx[host_rx_tail];
+    host_rx_tail = (host_rx_tail + 1) % NATIVE_HOST_BUF;
+    return b;
+}
+
+static void host_native_write(const uint8_t *data, uint16_t len, bool service) {
+    (void)service; // Buffer RAM: không có lúc "tạm đầy"
+    if (len > NATIVE_HOST_BUF - host_tx_len) {
+        len = NATIVE_HOST_BUF - host_tx_len;
+    }
+    memcpy(host_tx + host_tx_len, data, len);
+    host_tx_len += len;
+    host_writes++;
+}
+
+static void host_native_cdc_write(const uint8_t *data, uint16_t len, bool service) {
+    host_native_write(data, len, service);
+    metric_inc(METRIC_HOST_TX_PACKETS);
+}
+
+static int host_native_write_space(void) {
+    return NATIVE_HOST_BUF - host_tx_len;
+}
+
+static const host_transport_t host_native_usart = {
+    "usart",
+    host_native_begin, host_native_end, host_native_available, host_native_read, host_native_write,
+    host_native_write_space,
+    NATIVE_HOST_BUF,
+    0,
+    nullptr,
+    nullptr,
+};
+
+static const host_transport_t host_native_cdc = {
+    "usb-cdc",
+    host_native_begin, host_native_end, host_native_available, host_native_read, host_native_cdc_write,
+    host_native_write_space,
+    NATIVE_HOST_BUF,
+    HOST_CDC_PACKET_SIZE,
+    nullptr,
+    nullptr,
+};
+
+const host_transport_t *const host_transports[HAL_HOST_TRANSPORT_COUNT] = {
+    &host_native_usart,
+    &host_native_cdc,
+};
+
+void hal_debug_write(const uint8_t *data, uint16_t len) {
+    if (debug_echo) {
+        fwrite(data, 1, len, stdout);
+    }
+    if (debug_sink) {
+        debug_sink(data, len);
+    }
+}
+
+int hal_debug_write_space(void) {
+    return NATIVE_DEBUG_SPACE;
+}
+
+void hal_debug_flush(void) {
+    if (debug_echo) {
+        fflush(stdout);
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef HAL_NATIVE_H
+#define HAL_NATIVE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "hal/hal.h"
+
+/*
+ * Điều khiển HAL giả lập của env:native (chỉ dùng từ native/, không có trên target)
+ *
+ * - Thời gian ảo tính bằng µs, chỉ chạy khi gọi hal_native_advance_us() (event_wait() gọi khi rảnh)
+ * - Mỗi µs: compare channel của bus timebase tới hạn được gọi, 2 nguồn phát xung trên bus được phát lại,
+ *   alarm tới hạn được gọi
+ * - Bus = OR của xung gateway (hal_tx_start), xung của node khác (hal_native_bus_send) và line hook
+ *   (mô hình nhiều node, xem native/sim): sườn đổi mức → edge_isr, giống bộ thu thật thấy cả echo của chính mình
+ * - KNX_COUPLER_ENABLE: line 1 là đường bus thứ 2 độc lập (xung gateway + node khác, không có line hook)
+ * - Host / debug serial là buffer trong RAM, debug có thể in ra stdout. Host transport HAL_HOST_CDC
+ *   là stand-in của USB CDC: cùng buffer, nhưng byte tới buffer theo packet (hal_host_flush())
+ */
+
+typedef void (*hal_native_alarm_cb_t)(void);
+// Gọi mỗi µs với mức gateway + peer đang phát, trả về mức các node bên ngoài kéo bus (1 = xung)
+typedef bool (*hal_native_line_hook_t)(bool local_level);
+
+typedef enum {
+    HAL_NATIVE_ALARM_TICK = 0,      // event_native: tick 1ms
+    HAL_NATIVE_ALARM_USER,          // Tự do cho chương trình native (peer, kịch bản...)
+    HAL_NATIVE_ALARM_COUNT
+} hal_native_alarm_t;
+
+// Về thời điểm 0, xoá bus / serial / alarm (callback đã đăng ký giữ nguyên)
+void hal_native_reset(void);
+void hal_native_advance_us(uint32_t us);
+uint64_t hal_native_now_us(void);
+
+// One-shot sau delay_us (gọi lại trong callback để lặp)
+void hal_native_alarm_set(hal_native_alarm_t id, uint32_t delay_us, hal_native_alarm_cb_t cb);
+void hal_native_alarm_cancel(hal_native_alarm_t id);
+
+// Node khác phát các byte lên bus (cùng dạng 13 bit/byte với knx_tx), bắt đầu ở µs tiếp theo
+bool hal_native_bus_send(const uint8_t *data, uint8_t len);
+bool hal_native_bus_busy(void);
+// Như trên, trên line bất kỳ (KNX_LINE_SUB khi KNX_COUPLER_ENABLE)
+bool hal_native_line_send(uint8_t line, const uint8_t *data, uint8_t len);
+bool hal_native_line_busy(uint8_t line);
+void hal_native_set_line_hook(hal_native_line_hook_t hook);
+// Gateway đang phát bit 1 (không xung) - dùng để phát hiện thua arbitration mà firmware không biết
+bool hal_native_tx_sending_one(void);
+// Số bit của buffer DMA line 0 đang phát (0 = không phát): phân biệt frame với ký tự ACK
+uint16_t hal_native_tx_bits(void);
+// false = xung của gateway không lên bus (DMA vẫn chạy và báo xong) - replay phát lại bus đã ghi, gồm cả echo
+void hal_native_tx_loopback(bool enable);
+
+// Host serial: byte host gửi cho gateway / lấy byte gateway đã gửi lên host
+void hal_native_host_inject(const uint8_t *data, uint16_t len);
+uint16_t hal_native_host_take(uint8_t *out, uint16_t max);
+// Số lần host transport ghi xuống buffer (HAL_HOST_CDC: số packet)
+uint32_t hal_native_host_writes(void);
+
+// Debug serial: true = in ra stdout (mặc định false); sink nhận mọi byte ghi ra debug serial (nullptr = bỏ)
+void hal_native_debug_echo(bool enable);
+void hal_native_set_debug_sink(void (*sink)(const uint8_t *data, uint16_t len));
+// Cờ reset của "lần khởi động" giả lập (mặc định HAL_RESET_FLAG_POR)
+void hal_native_set_reset_flags(uint32_t flags);
+
+#endif // HAL_NATIVE_H
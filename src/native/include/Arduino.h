@@ -0,0 +1,25 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+/*
+ * Stand-in tối thiểu của <Arduino.h> cho env:native (Linux)
+ *
+ * Chỉ đủ cho protocol core: mọi truy cập phần cứng đi qua hal/hal.h (native/hal_native.cpp).
+ * Module còn gọi thẳng HardwareSerial / HardwareTimer / thanh ghi thì không thuộc env:native.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Chỉ dùng trong khai báo extern DEBUG_SERIAL / MCU_SERIAL của config.h
+class HardwareSerial;
+
+// Native chạy đơn luồng, "ISR" được gọi từ hal_native_advance_us() → không cần tắt interrupt
+static inline void __disable_irq(void) {}
+static inline void __enable_irq(void) {}
+
+#endif // NATIVE_ARDUINO_H
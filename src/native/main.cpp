@@ -0,0 +1,654 @@
+#include <stdio.h>
+#include <string.h>
+#include "config.h"
+#include "crc_ccitt.h"
+#include "coupler.h"
+#include "event_loop.h"
+#include "gateway.h"
+#include "knx_frame.h"
+#include "knx_rx.h"
+#include "knx_tx.h"
+#include "hal/hal.h"
+#include "logger.h"
+#include "metrics.h"
+#include "trace.h"
+#include "tpuart/tpuart.h"
+#include "tpuart/host_diag.h"
+#include "tpuart/rx_dedup.h"
+#include "native/hal_native.h"
+
+/*
+ * env:native - loopback smoke run trên Linux (pio run -e native && .pio/build/native/program [-v])
+ *
+ * Host gửi 1 L_DATA request → queue → knx_send_frame → waveform PWM được phát lại lên bus giả lập
+ * → decoder knx_rx nhận lại chính frame đó (echo) → 1 node khác trả ACK (0xCC) sau 15 bit time
+ * → host phải nhận được echo + L_DATA_CON | SUCCESS. Chạy bằng đúng gateway_dispatch() như loop().
+ *
+ * env:native_coupler (KNX_COUPLER_ENABLE = 1): thêm 1 node trên line 1 gửi frame nhóm → coupler phải
+ * route sang line 0, frame của host cũng được route sang line 1. Node trên mỗi line ACK frame mà gateway
+ * gửi lên line đó; host phải thấy frame line 1 với tag U_CHANNEL_IND | 1.
+ *
+ * Pipeline: host bật CRC_CCITT rồi gửi liền 4 frame, frame 3 sai CRC → mỗi frame đúng 1 L_DATA_CON theo thứ tự
+ * queue, L_DATA_CON âm của frame 3 nằm ngay sau confirm của frame 2.
+ *
+ * Confirm âm: node khác phát frame khác đúng lúc gateway gửi (echo sai), trả NACK / BUSY, im lặng sau echo,
+ * hoặc không có echo → mỗi trường hợp 1 L_DATA_CON không có SUCCESS và counter METRIC_ECHO_* tương ứng tăng 1.
+ *
+ * RX filter: host nạp bảng + bật bộ lọc bằng DIAG_FILTER_*, node trên line 0 gửi telegram nhóm 0/0/1 (không có
+ * trong bảng) → không lên host nhưng vẫn được ACK trên bus (node khác / coupler), rồi telegram tới địa chỉ cá nhân
+ * 0.0.1 (cùng số 0x0001) → phải lên host, host trả U_ACK_REQ → gateway ACK; DIAG_FILTER_READ trả số bị chặn.
+ * Coupler build: nạp thêm bảng 1 (DIAG_TABLE_COUPLER), DIAG_FILTER_READ bảng 1 trả số frame đã route.
+ *
+ * Repeat suppression: telegram A (không U_ACK_REQ) rồi B (U_ACK_REQ giữa frame) tới địa chỉ cá nhân, sau đó bản lặp
+ * của cả hai trong KNX_RX_DEDUP_WINDOW_MS → không lên host, bản lặp B được gateway ACK như bản đầu, bản lặp A thì không.
+ * Telegram C có U_ACK_REQ tới sau ACK window (ACK bị lỡ) → bản lặp C phải lên host.
+ *
+ * Metrics: DIAG_METRICS_READ được gửi dần (1 U_DIAG_IND mỗi lượt loop) → host phải nhận đủ registry, đúng thứ tự.
+ * Trace: DIAG_TRACE_DUMP cũng gửi dần → đủ số entry theo header, index liên tục, ring ghi tiếp sau khi dump xong.
+ */
+
+#define SMOKE_TIMEOUT_US 200000
+#define PEER_ACK_DELAY_US (KNX_BIT_PERIOD_US * 2)  // Sau 13 bit của checksum → ACK ở bit time 15
+
+static const uint8_t test_frame[] = {0xBC, 0x11, 0x01, 0x00, 0x01, 0xE1, 0x00, 0x81, 0x00};
+
+// Node 1.1.7 trên line 0: GroupValue_Write 0/0/1 và cùng telegram tới địa chỉ cá nhân 0.0.1
+static const uint8_t filter_group_frame[] = {0xBC, 0x11, 0x07, 0x00, 0x01, 0xE1, 0x00, 0x81, 0x00};
+static const uint8_t filter_individual_frame[] = {0xBC, 0x11, 0x07, 0x00, 0x01, 0x61, 0x00, 0x81, 0x00};
+#define FILTER_TABLE_ADDR 0x0A01  // 1/2/1 - bảng lọc chỉ có địa chỉ này
+#define FILTER_PHASE_US 30000     // Đủ cho 1 frame + ACK + khoảng nghỉ
+#define METRICS_PER_MSG 14        // Giống metrics.cpp
+#define TRACE_ENTRIES_PER_MSG 7   // Giống trace.cpp
+#define DEDUP_LATE_ACK_US (KNX_BIT_PERIOD_US * 20)  // Sau ACK window (bit 15), trước KNX_RX_IDLE_US
+
+#define PEER_FRAME_MIN_US (KNX_BIT_PERIOD_US * 13 * 3)  // DMA dài hơn 1 ký tự ACK (kể cả bit im lặng) → frame
+
+#if KNX_COUPLER_ENABLE
+#define HOST_TAG_LEN 1      // U_CHANNEL_IND | line trước mỗi frame bus
+// Node 1.2.5 trên line 1 gửi GroupValue_Write 0/0/2
+static const uint8_t line1_frame[] = {0xBC, 0x12, 0x05, 0x00, 0x02, 0xE1, 0x00, 0x81, 0x00};
+#else
+#define HOST_TAG_LEN 0
+#endif
+
+// Giống handle_knx_frame() của target (main.cpp)
+static void on_bus_byte(const uint8_t byte) {
+    gateway_bus_byte_isr(byte);
+}
+
+static void on_bus_idle(void) {
+    event_post(EVT_BUS_IDLE);
+}
+
+static uint8_t peer_ack_lines = 0;      // Line có node chờ ACK
+static uint8_t peer_ack_char = KNX_BUS_ACK;  // Ký tự node trả cho frame gateway gửi (0 = im lặng)
+static const uint8_t *peer_collide_frame = nullptr;  // Frame node gửi đúng lúc gateway bắt đầu phát trên line 0
+static uint8_t peer_collide_len = 0;
+static uint64_t tx_start_us[KNX_LINE_COUNT];
+static bool tx_was_busy[KNX_LINE_COUNT];
+
+static void peer_send_ack(void) {
+    uint8_t ack = peer_ack_char;
+    for (uint8_t line = 0; line < KNX_LINE_COUNT; line++) {
+        if ((peer_ack_lines & (1u << line)) && ack) {
+            hal_native_line_send(line, &ack, 1);
+        }
+    }
+    peer_ack_lines = 0;
+}
+
+// Chỉ ACK frame gateway gửi, không ACK ký tự ACK của chính gateway
+static void peer_watch_tx(void) {
+    for (uint8_t line = 0; line < KNX_LINE_COUNT; line++) {
+        bool busy = hal_tx_busy(line);
+        if (busy && !tx_was_busy[line]) {
+            tx_start_us[line] = hal_native_now_us();
+            if (line == KNX_LINE_MAIN && peer_collide_len) {
+                hal_native_bus_send(peer_collide_frame, peer_collide_len);
+                peer_collide_len = 0;
+            }
+        } else if (!busy && tx_was_busy[line] && hal_native_now_us() - tx_start_us[line] > PEER_FRAME_MIN_US) {
+            peer_ack_lines |= 1u << line;
+            hal_native_alarm_set(HAL_NATIVE_ALARM_USER, PEER_ACK_DELAY_US, peer_send_ack);
+        }
+        tx_was_busy[line] = busy;
+    }
+}
+
+// Frame theo giao thức TPUART: U_L_DATA_START, rồi U_L_DATA_CONT|i trước byte i, U_L_DATA_END|i trước checksum;
+// host link đang bật CRC_CCITT: thêm 2 byte CRC (byte cao trước) sau checksum
+static void host_send_frame_crc(const uint8_t *frame, uint8_t len, bool with_crc, uint16_t crc) {
+    uint8_t out[2 * KNX_BUFFER_MAX_SIZE + 2];
+    uint8_t n = 0;
+    for (uint8_t i = 0; i < len; i++) {
+        if (i == 0) {
+            out[n++] = U_L_DATA_START_REQ;
+        } else if (i == len - 1) {
+            out[n++] = U_L_DATA_END_REQ | i;
+        } else {
+            out[n++] = U_L_DATA_CONT_REQ | i;
+        }
+        out[n++] = frame[i];
+    }
+    if (with_crc) {
+        out[n++] = (uint8_t)(crc >> 8);
+        out[n++] = (uint8_t)crc;
+    }
+    hal_native_host_inject(out, n);
+}
+
+static void host_send_frame(const uint8_t *frame, uint8_t len) {
+    host_send_frame_crc(frame, len, false, 0);
+}
+
+static void set_checksum(uint8_t *frame, uint8_t len) {
+    uint8_t x = 0;
+    for (uint8_t i = 0; i < len - 1; i++) {
+        x ^= frame[i];
+    }
+    frame[len - 1] = (uint8_t)~x;
+}
+
+// 1 lượt loop(): peer trả ACK theo TX của gateway, rồi gateway_dispatch()
+static void smoke_step(void) {
+    uint32_t events = event_wait();
+    peer_watch_tx();
+    gateway_dispatch(events);
+    peer_watch_tx();
+}
+
+#if KNX_COUPLER_ENABLE
+// Frame line 1 → line 0, frame của host (line 0) → line 1; host thấy frame line 1 có tag kênh 1
+static bool coupler_smoke(void) {
+    uint8_t frame[sizeof(line1_frame)];
+    memcpy(frame, line1_frame, sizeof(frame));
+    set_checksum(frame, sizeof(frame));
+
+    uint8_t host_out[128];
+    uint16_t host_len = 0;
+    bool sent = false;
+    uint64_t deadline = hal_native_now_us() + SMOKE_TIMEOUT_US;
+    while (hal_native_now_us() < deadline && metric_get(METRIC_COUPLER_ROUTED_1_0) == 0) {
+        // Node line 1 chờ line rảnh (frame host đã route xong) rồi mới gửi
+        if (!sent && metric_get(METRIC_COUPLER_ROUTED_0_1) && !hal_tx_busy(KNX_LINE_SUB)) {
+            sent = hal_native_line_send(KNX_LINE_SUB, frame, sizeof(frame));
+        }
+        smoke_step();
+        host_len += hal_native_host_take(host_out + host_len, sizeof(host_out) - host_len);
+    }
+    // Flush nốt frame line 1 đang chờ host link
+    for (uint8_t i = 0; i < 10; i++) {
+        smoke_step();
+        host_len += hal_native_host_take(host_out + host_len, sizeof(host_out) - host_len);
+    }
+
+    bool tagged = false;
+    for (uint16_t i = 0; i + sizeof(frame) < host_len && !tagged; i++) {
+        tagged = host_out[i] == (U_CHANNEL_IND | KNX_LINE_SUB) && memcmp(&host_out[i + 1], frame, sizeof(frame)) == 0;
+    }
+    bool success = tagged && metric_get(METRIC_COUPLER_ROUTED_0_1) == 1 && metric_get(METRIC_COUPLER_ROUTED_1_0) == 1 &&
+                   metric_get(METRIC_COUPLER_TX_FAILED) == 0;
+    printf("native coupler: %s - routed 0->1=%lu 1->0=%lu, retries=%lu, line 1 frame to host %s at %llu us\n",
+           success ? "OK" : "FAIL", (unsigned long)metric_get(METRIC_COUPLER_ROUTED_0_1),
+           (unsigned long)metric_get(METRIC_COUPLER_ROUTED_1_0), (unsigned long)metric_get(METRIC_COUPLER_TX_RETRIES),
+           tagged ? "tagged" : "missing", (unsigned long long)hal_native_now_us());
+    if (!success) {
+        for (uint16_t i = 0; i < host_len; i++) {
+            printf("%02X ", host_out[i]);
+        }
+        printf("\n");
+    }
+    return success;
+}
+#endif
+
+// [U_DIAG_REQ] [sub] [len] [args]
+static void host_send_diag(uint8_t sub, const uint8_t *args, uint8_t len) {
+    uint8_t out[3 + DIAG_ARG_MAX];
+    out[0] = U_DIAG_REQ;
+    out[1] = sub;
+    out[2] = len;
+    memcpy(&out[3], args, len);
+    hal_native_host_inject(out, 3 + len);
+}
+
+static void host_send_diag_plain(uint8_t sub) {
+    uint8_t out[2] = {U_DIAG_REQ, sub};
+    hal_native_host_inject(out, sizeof(out));
+}
+
+#if !KNX_COUPLER_ENABLE
+// Node khác trên line 0 ACK telegram nhóm (không phải gateway)
+static void peer_line0_ack(void) {
+    uint8_t ack = KNX_BUS_ACK;
+    hal_native_bus_send(&ack, 1);
+}
+#endif
+
+// Chạy loop() duration_us, gom byte gửi lên host; ack_addressed: host trả U_ACK_REQ khi thấy telegram
+// tới địa chỉ cá nhân (byte AT|hop|LG ở vị trí 5 của frame)
+static uint16_t filter_run(uint32_t duration_us, uint8_t *out, uint16_t max, bool ack_addressed) {
+    uint16_t len = 0;
+    bool acked = false;
+#if !KNX_COUPLER_ENABLE
+    bool peer_acked = false;
+    bool peer_busy = hal_native_bus_busy();
+#endif
+    uint64_t end = hal_native_now_us() + duration_us;
+    while (hal_native_now_us() < end) {
+        smoke_step();
+        len += hal_native_host_take(out + len, max - len);
+        if (ack_addressed && !acked && len >= HOST_TAG_LEN + 6 && !(out[HOST_TAG_LEN + 5] & KNX_ADDR_GROUP)) {
+            uint8_t req = U_ACK_REQ | U_ACK_REQ_ADRESSED;
+            hal_native_host_inject(&req, 1);
+            acked = true;
+        }
+#if !KNX_COUPLER_ENABLE
+        // Coupler build: coupler route telegram nhóm sang line 1 và tự ACK trên line 0
+        if (!ack_addressed && !peer_acked && peer_busy && !hal_native_bus_busy()) {
+            hal_native_alarm_set(HAL_NATIVE_ALARM_USER, PEER_ACK_DELAY_US, peer_line0_ack);
+            peer_acked = true;
+        }
+        peer_busy = hal_native_bus_busy();
+#endif
+    }
+    return len;
+}
+
+static uint32_t head_confirms(void) {
+    return metric_get(METRIC_ECHO_CONFIRMED) + metric_get(METRIC_ECHO_NEGATIVE);
+}
+
+// Chạy loop() tới khi frame đầu queue đã được confirm thêm confirm_count lần (tối đa SMOKE_TIMEOUT_US) rồi thêm
+// FILTER_PHASE_US, gom byte gửi lên host. Không có node nào tự ACK telegram của người khác (khác filter_run)
+static uint16_t smoke_run(uint32_t confirm_count, uint8_t *out, uint16_t max) {
+    uint16_t len = 0;
+    uint32_t confirms_before = head_confirms();
+    uint64_t timeout = hal_native_now_us() + SMOKE_TIMEOUT_US;
+    uint64_t end = hal_native_now_us() + FILTER_PHASE_US;
+    while (hal_native_now_us() < end) {
+        smoke_step();
+        len += hal_native_host_take(out + len, max - len);
+        if (head_confirms() - confirms_before < confirm_count && hal_native_now_us() < timeout) {
+            end = hal_native_now_us() + FILTER_PHASE_US;
+        }
+    }
+    return len;
+}
+
+// Host link → chuỗi sự kiện: số thứ tự frame (byte 7 & 0x0F) khi thấy echo line 0, '+' / '-' cho mỗi L_DATA_CON.
+// Frame line 1 (coupler route) bỏ qua; with_crc: frame lên host có 2 byte CRC sau checksum
+static bool pipeline_events(const uint8_t *out, uint16_t len, bool with_crc, char *events, uint8_t max) {
+    uint8_t n = 0;
+    uint8_t line = KNX_LINE_MAIN;
+    for (uint16_t i = 0; i < len && n + 1 < max;) {
+        uint8_t b = out[i];
+        if (HOST_TAG_LEN && (b & ~1u) == U_CHANNEL_IND) {
+            line = b & 1;
+            i++;
+        } else if ((b & L_DATA_CON_MASK) == L_DATA_CON) {
+            events[n++] = (b & SUCCESS) ? '+' : '-';
+            i++;
+        } else if ((b & L_DATA_MASK) == L_DATA_STANDARD_IND && i + 7 < len) {
+            if (line == KNX_LINE_MAIN) {
+                events[n++] = (char)('0' + (out[i + 7] & 0x0F));
+            }
+            i += 8 + (out[i + 5] & 0x0F) + (with_crc ? 2 : 0);
+            line = KNX_LINE_MAIN;
+        } else {
+            events[n] = '\0';
+            return false;
+        }
+    }
+    events[n] = '\0';
+    return true;
+}
+
+// Host gửi liền 4 frame (frame 3 sai CRC → bị từ chối): mỗi frame đúng 1 L_DATA_CON theo thứ tự queue,
+// L_DATA_CON âm của frame 3 ra sau confirm của frame 2 chứ không ra ngay lúc bị từ chối
+static bool pipeline_smoke(void) {
+    const uint8_t crc_on = U_CONFIGURE_REQ | U_CONFIGURE_CRC_CCITT_REQ;
+    const uint8_t crc_off = U_CONFIGURE_REQ;
+    uint8_t out[256];
+    hal_native_host_inject(&crc_on, 1);
+    uint16_t n = smoke_run(0, out, sizeof(out));
+    bool configured = n == 1 && out[0] == (U_CONFIGURE_IND | CRC_CCITT);
+
+    uint32_t confirms_before = metric_get(METRIC_ECHO_CONFIRMED);
+    for (uint8_t i = 1; i <= 4; i++) {
+        uint8_t frame[sizeof(test_frame)];
+        memcpy(frame, test_frame, sizeof(frame));
+        frame[7] = 0x80 | i;
+        set_checksum(frame, sizeof(frame));
+        uint16_t crc = crc_ccitt(frame, sizeof(frame));
+        host_send_frame_crc(frame, sizeof(frame), true, i == 3 ? (uint16_t)~crc : crc);
+    }
+    // Chạy thêm FILTER_PHASE_US sau confirm cuối: không được có L_DATA_CON thừa
+    uint16_t len = smoke_run(3, out, sizeof(out));
+
+    char events[16];
+    bool parsed = pipeline_events(out, len, true, events, sizeof(events));
+    bool ordered = strcmp(events, "1+2+-4+") == 0;
+    hal_native_host_inject(&crc_off, 1);
+    n = smoke_run(0, out, sizeof(out));
+    configured = configured && n == 1 && out[0] == U_CONFIGURE_IND;
+
+    bool success = configured && parsed && ordered && metric_get(METRIC_HOST_CRC_ERRORS) == 1;
+    printf("native pipeline: %s - host link events \"%s\" (expected \"1+2+-4+\"), confirmed=%lu\n",
+           success ? "OK" : "FAIL", events, (unsigned long)(metric_get(METRIC_ECHO_CONFIRMED) - confirms_before));
+    return success;
+}
+
+// 1 frame từ host với 1 kiểu lỗi: chuỗi sự kiện host link phải đúng expected, counter tăng đúng 1
+static bool negative_case(const char *name, uint8_t value, const char *expected, metric_id_t counter) {
+    uint8_t frame[sizeof(test_frame)];
+    memcpy(frame, test_frame, sizeof(frame));
+    frame[7] = 0x80 | value;
+    set_checksum(frame, sizeof(frame));
+    uint32_t before = metric_get(counter);
+    uint32_t negative_before = metric_get(METRIC_ECHO_NEGATIVE);
+    host_send_frame(frame, sizeof(frame));
+    uint8_t out[64];
+    uint16_t len = smoke_run(1, out, sizeof(out));
+    char events[16];
+    bool ok = pipeline_events(out, len, false, events, sizeof(events)) && strcmp(events, expected) == 0 &&
+              metric_get(counter) == before + 1 && metric_get(METRIC_ECHO_NEGATIVE) == negative_before + 1;
+    if (!ok) {
+        printf("native confirm: %s - host link events \"%s\" (expected \"%s\"), counter %lu -> %lu\n", name, events,
+               expected, (unsigned long)before, (unsigned long)metric_get(counter));
+    }
+    return ok;
+}
+
+// L_DATA_CON âm: echo khác frame đã gửi, bus NACK / BUSY sau echo khớp, echo không có ACK, không có echo
+static bool confirm_smoke(void) {
+    uint8_t other[sizeof(test_frame)];
+    memcpy(other, test_frame, sizeof(other));
+    other[7] = 0x86;
+    set_checksum(other, sizeof(other));
+
+    // Xung của gateway không lên bus, node khác phát frame khác đúng lúc đó
+    hal_native_tx_loopback(false);
+    peer_collide_frame = other;
+    peer_collide_len = sizeof(other);
+    bool mismatch = negative_case("mismatch", 5, "6-", METRIC_ECHO_MISMATCH);
+    hal_native_tx_loopback(true);
+
+    peer_ack_char = KNX_BUS_NACK;
+    bool nack = negative_case("NACK", 5, "5-", METRIC_ECHO_BUS_NACK);
+    peer_ack_char = KNX_BUS_BUSY;
+    bool busy = negative_case("BUSY", 5, "5-", METRIC_ECHO_BUS_NACK);
+    peer_ack_char = 0;
+    bool lost = negative_case("no ACK", 5, "5-", METRIC_ECHO_LOST);
+    hal_native_tx_loopback(false);
+    bool timeout = negative_case("timeout", 5, "-", METRIC_ECHO_TIMEOUTS);
+    hal_native_tx_loopback(true);
+    peer_ack_char = KNX_BUS_ACK;
+#if KNX_TRACE_ENABLE
+    trace_arm(); // Echo timeout / mất ACK freeze trace
+#endif
+
+    bool success = mismatch && nack && busy && lost && timeout;
+    printf("native confirm: %s - mismatch=%lu bus NACK/BUSY=%lu no ACK=%lu timeout=%lu negative=%lu\n",
+           success ? "OK" : "FAIL", (unsigned long)metric_get(METRIC_ECHO_MISMATCH),
+           (unsigned long)metric_get(METRIC_ECHO_BUS_NACK), (unsigned long)metric_get(METRIC_ECHO_LOST),
+           (unsigned long)metric_get(METRIC_ECHO_TIMEOUTS), (unsigned long)metric_get(METRIC_ECHO_NEGATIVE));
+    return success;
+}
+
+static bool filter_smoke(void) {
+    uint8_t out[64];
+    const uint8_t add[] = {DIAG_TABLE_RX, FILTER_TABLE_ADDR >> 8, FILTER_TABLE_ADDR & 0xFF};
+    const uint8_t enable[] = {DIAG_TABLE_RX, 1};
+    host_send_diag(DIAG_FILTER_ADD, add, sizeof(add));
+    filter_run(FILTER_PHASE_US, out, sizeof(out), false);
+    host_send_diag(DIAG_FILTER_ENABLE, enable, sizeof(enable));
+    uint16_t n = filter_run(FILTER_PHASE_US, out, sizeof(out), false);
+    bool configured = n == 4 && out[0] == U_DIAG_IND && out[1] == DIAG_FILTER_ENABLE && out[3] == DIAG_STATUS_OK;
+
+    uint8_t frame[sizeof(filter_group_frame)];
+    memcpy(frame, filter_group_frame, sizeof(frame));
+    set_checksum(frame, sizeof(frame));
+    uint32_t acks_before = metric_get(METRIC_ACK_SENT);
+    hal_native_bus_send(frame, sizeof(frame));
+    uint16_t group_len = filter_run(FILTER_PHASE_US, out, sizeof(out), false);
+    // Coupler: bản route sang line 1 cũng qua bộ lọc trước khi lên host
+    uint32_t supp = metric_get(METRIC_RX_FILTERED);
+    bool suppressed = group_len == 0 && supp == KNX_LINE_COUNT;
+#if KNX_COUPLER_ENABLE
+    bool group_acked = metric_get(METRIC_ACK_SENT) == acks_before + 1;
+#else
+    bool group_acked = metric_get(METRIC_ACK_SENT) == acks_before && tpuart_rx_state() == TPUART_RX_IDLE;
+#endif
+
+    memcpy(frame, filter_individual_frame, sizeof(frame));
+    set_checksum(frame, sizeof(frame));
+    acks_before = metric_get(METRIC_ACK_SENT);
+    hal_native_bus_send(frame, sizeof(frame));
+    uint16_t ind_len = filter_run(FILTER_PHASE_US, out, sizeof(out), true);
+    bool forwarded = ind_len == HOST_TAG_LEN + sizeof(frame) && memcmp(out + HOST_TAG_LEN, frame, sizeof(frame)) == 0 &&
+                     metric_get(METRIC_ACK_SENT) == acks_before + 1;
+
+    const uint8_t table = DIAG_TABLE_RX;
+    host_send_diag(DIAG_FILTER_READ, &table, 1);
+    n = filter_run(FILTER_PHASE_US, out, sizeof(out), false);
+    uint32_t fwd = out[7] | (out[8] << 8) | (out[9] << 16) | ((uint32_t)out[10] << 24);
+    bool stats = n == 15 && out[1] == DIAG_FILTER_READ && out[4] == 1 && out[5] == 1 && fwd >= 2 &&
+                 (out[11] | (out[12] << 8) | (out[13] << 16) | ((uint32_t)out[14] << 24)) == supp;
+
+#if KNX_COUPLER_ENABLE
+    // Bảng 1 = bảng lọc coupler, forward = tổng 2 chiều route
+    const uint8_t coupler_add[] = {DIAG_TABLE_COUPLER, FILTER_TABLE_ADDR >> 8, FILTER_TABLE_ADDR & 0xFF};
+    const uint8_t coupler_table = DIAG_TABLE_COUPLER;
+    host_send_diag(DIAG_FILTER_ADD, coupler_add, sizeof(coupler_add));
+    filter_run(FILTER_PHASE_US, out, sizeof(out), false);
+    host_send_diag(DIAG_FILTER_READ, &coupler_table, 1);
+    n = filter_run(FILTER_PHASE_US, out, sizeof(out), false);
+    uint32_t routed = metric_get(METRIC_COUPLER_ROUTED_0_1) + metric_get(METRIC_COUPLER_ROUTED_1_0);
+    stats = stats && n == 15 && out[3] == DIAG_TABLE_COUPLER && out[4] == KNX_COUPLER_FILTER_ENABLE &&
+            out[5] == 1 && coupler_filter_count() == 1 &&
+            (out[7] | (out[8] << 8) | (out[9] << 16) | ((uint32_t)out[10] << 24)) == routed;
+    coupler_filter_clear();
+#endif
+
+    bool success = configured && suppressed && group_acked && forwarded && stats;
+    printf("native filter: %s - group 0/0/1 %s (%s), individual 0.0.1 %s, forwarded=%lu suppressed=%lu\n",
+           success ? "OK" : "FAIL", suppressed ? "suppressed" : "forwarded", group_acked ? "acked" : "ack wrong",
+           forwarded ? "forwarded + acked" : "missing", (unsigned long)fwd, (unsigned long)supp);
+    return success;
+}
+
+// Telegram của node 1.1.7 tới địa chỉ cá nhân 0.0.dest, repeat = bản lặp (repeat flag = 0)
+static void dedup_frame(uint8_t *frame, uint8_t dest, bool repeat) {
+    memcpy(frame, filter_individual_frame, sizeof(filter_individual_frame));
+    frame[4] = dest;
+    set_checksum(frame, sizeof(filter_individual_frame));
+    if (repeat) {
+        knx_frame_mark_repeated(frame, sizeof(filter_individual_frame));
+    }
+}
+
+static void host_late_ack(void) {
+    uint8_t req = U_ACK_REQ | U_ACK_REQ_ADRESSED;
+    hal_native_host_inject(&req, 1);
+}
+
+// Như filter_run nhưng host gửi U_ACK_REQ DEDUP_LATE_ACK_US sau checksum → gateway lỡ ACK window
+static uint16_t dedup_run_late_ack(uint8_t *out, uint16_t max) {
+    uint16_t len = 0;
+    uint32_t frames = metric_get(METRIC_RX_FRAMES);
+    bool requested = false;
+    uint64_t end = hal_native_now_us() + FILTER_PHASE_US;
+    while (hal_native_now_us() < end) {
+        smoke_step();
+        len += hal_native_host_take(out + len, max - len);
+        if (!requested && metric_get(METRIC_RX_FRAMES) != frames) {
+            hal_native_alarm_set(HAL_NATIVE_ALARM_USER, DEDUP_LATE_ACK_US, host_late_ack);
+            requested = true;
+        }
+    }
+    return len;
+}
+
+static bool dedup_smoke(void) {
+    uint8_t out[64];
+    uint8_t frame[sizeof(filter_individual_frame)];
+    rx_dedup_enable(true);
+
+    // Bản đầu: A không được host ACK, B có U_ACK_REQ giữa frame (trước khi B vào cache)
+    dedup_frame(frame, 0x02, false);
+    hal_native_bus_send(frame, sizeof(frame));
+    bool first_ok = filter_run(FILTER_PHASE_US, out, sizeof(out), false) == HOST_TAG_LEN + sizeof(frame);
+    uint32_t acks_before = metric_get(METRIC_ACK_SENT);
+    dedup_frame(frame, 0x01, false);
+    hal_native_bus_send(frame, sizeof(frame));
+    first_ok = filter_run(FILTER_PHASE_US, out, sizeof(out), true) == HOST_TAG_LEN + sizeof(frame) && first_ok &&
+               metric_get(METRIC_ACK_SENT) == acks_before + 1;
+
+    // Bản lặp: bị bỏ, ACK giống bản đầu
+    uint32_t dropped_before = metric_get(METRIC_RX_REPEATS_DROPPED);
+    uint32_t repeat_acks_before = metric_get(METRIC_RX_REPEAT_ACKS);
+    acks_before = metric_get(METRIC_ACK_SENT);
+    dedup_frame(frame, 0x02, true);
+    hal_native_bus_send(frame, sizeof(frame));
+    uint16_t repeat_a_len = filter_run(FILTER_PHASE_US, out, sizeof(out), false);
+    bool repeat_a_ok = repeat_a_len == 0 && metric_get(METRIC_ACK_SENT) == acks_before;
+    dedup_frame(frame, 0x01, true);
+    hal_native_bus_send(frame, sizeof(frame));
+    uint16_t repeat_b_len = filter_run(FILTER_PHASE_US, out, sizeof(out), true);
+    bool repeat_b_ok = repeat_b_len == 0 && metric_get(METRIC_ACK_SENT) == acks_before + 1 &&
+                       metric_get(METRIC_RX_REPEAT_ACKS) == repeat_acks_before + 1;
+    uint32_t dropped = metric_get(METRIC_RX_REPEATS_DROPPED) - dropped_before;
+
+    // C: host yêu cầu ACK nhưng gateway lỡ ACK window → bản lặp phải tới host để được ACK
+    uint32_t missed_before = metric_get(METRIC_ACK_MISSED);
+    dedup_frame(frame, 0x03, false);
+    hal_native_bus_send(frame, sizeof(frame));
+    dedup_run_late_ack(out, sizeof(out));
+    bool missed = metric_get(METRIC_ACK_MISSED) == missed_before + 1;
+#if KNX_TRACE_ENABLE
+    trace_arm(); // ACK bị lỡ freeze trace (TRACE_TRIG_ACK_MISS)
+#endif
+    dedup_frame(frame, 0x03, true);
+    hal_native_bus_send(frame, sizeof(frame));
+    uint16_t repeat_c_len = filter_run(FILTER_PHASE_US, out, sizeof(out), false);
+    bool repeat_c_ok = repeat_c_len == HOST_TAG_LEN + sizeof(frame) && memcmp(out + HOST_TAG_LEN, frame, sizeof(frame)) == 0;
+
+    rx_dedup_enable(false);
+    bool success = first_ok && repeat_a_ok && repeat_b_ok && dropped == 2 && missed && repeat_c_ok;
+    printf("native dedup: %s - repeat A %s, repeat B %s, dropped=%lu, ACK-missed repeat %s\n",
+           success ? "OK" : "FAIL", repeat_a_ok ? "dropped" : "wrong", repeat_b_ok ? "dropped + acked" : "wrong",
+           (unsigned long)dropped, repeat_c_ok && missed ? "forwarded" : "wrong");
+    return success;
+}
+
+static bool metrics_smoke(void) {
+    uint8_t out[512];
+    host_send_diag_plain(DIAG_METRICS_READ);
+    uint16_t n = filter_run(FILTER_PHASE_US, out, sizeof(out), false);
+    // [U_DIAG_IND] [sub] [len] [payload], message đầu [schema] [số metric], sau đó [index đầu] [n] [n x u32]
+    uint16_t msgs = 0;
+    uint16_t next_index = 0;
+    bool ok = true;
+    for (uint16_t i = 0; i + 3 <= n && ok; i += 3 + out[i + 2]) {
+        ok = out[i] == U_DIAG_IND && out[i + 1] == DIAG_METRICS_READ && i + 3 + out[i + 2] <= n;
+        if (ok && msgs == 0) {
+            ok = out[i + 2] == 2 && out[i + 3] == METRICS_SCHEMA_VERSION && out[i + 4] == METRIC_COUNT;
+        } else if (ok) {
+            ok = out[i + 3] == next_index && out[i + 2] == 2 + out[i + 4] * 4;
+            next_index += out[i + 4];
+        }
+        msgs++;
+    }
+    uint16_t expected = 1 + (METRIC_COUNT + METRICS_PER_MSG - 1) / METRICS_PER_MSG;
+    bool success = ok && msgs == expected && next_index == METRIC_COUNT;
+    printf("native metrics: %s - %u message(s), %u metric(s), %u byte(s)\n", success ? "OK" : "FAIL", msgs,
+           next_index, n);
+    return success;
+}
+
+#if KNX_TRACE_ENABLE
+static bool trace_smoke(void) {
+    uint8_t out[KNX_TRACE_DEPTH * sizeof(trace_entry_t) + 512];
+    host_send_diag_plain(DIAG_TRACE_DUMP);
+    uint16_t n = filter_run(FILTER_PHASE_US, out, sizeof(out), false);
+    // Message đầu [frozen] [reason] [số entry u16] [depth u16] [clock u32], sau đó [index đầu u16] [n x 8 byte]
+    uint16_t msgs = 0;
+    uint16_t count = 0;
+    uint16_t next_index = 0;
+    bool ok = true;
+    for (uint16_t i = 0; i + 3 <= n && ok; i += 3 + out[i + 2]) {
+        ok = out[i] == U_DIAG_IND && out[i + 1] == DIAG_TRACE_DUMP && i + 3 + out[i + 2] <= n;
+        if (ok && msgs == 0) {
+            ok = out[i + 2] == 10 && (out[i + 7] | (out[i + 8] << 8)) == KNX_TRACE_DEPTH;
+            count = out[i + 5] | (out[i + 6] << 8);
+        } else if (ok) {
+            uint8_t entries = (out[i + 2] - 2) / sizeof(trace_entry_t);
+            ok = (out[i + 3] | (out[i + 4] << 8)) == next_index && entries > 0 && entries <= TRACE_ENTRIES_PER_MSG;
+            next_index += entries;
+        }
+        msgs++;
+    }
+    bool success = ok && count > 0 && next_index == count && !trace_is_frozen();
+    printf("native trace: %s - %u message(s), %u/%u entries, %u byte(s)\n", success ? "OK" : "FAIL", msgs, next_index,
+           count, n);
+    return success;
+}
+#endif
+
+int main(int argc, char **argv) {
+    hal_native_reset();
+    hal_native_debug_echo(argc > 1 && strcmp(argv[1], "-v") == 0);
+
+    metrics_init();
+    logger_init();
+    trace_init();
+    knx_rx_init(KNX_LINE_MAIN, on_bus_byte, on_bus_idle);
+    knx_tx_init(KNX_LINE_MAIN);
+#if KNX_COUPLER_ENABLE
+    knx_rx_init(KNX_LINE_SUB, coupler_line1_byte_isr, nullptr);
+    knx_tx_init(KNX_LINE_SUB);
+    coupler_init();
+#endif
+    event_loop_init();
+
+    uint8_t frame[sizeof(test_frame)];
+    memcpy(frame, test_frame, sizeof(frame));
+    set_checksum(frame, sizeof(frame));
+    host_send_frame(frame, sizeof(frame));
+
+    uint8_t host_out[64];
+    uint16_t host_len = 0;
+    bool confirmed = false;
+    while (!confirmed && hal_native_now_us() < SMOKE_TIMEOUT_US) {
+        smoke_step();
+        host_len += hal_native_host_take(host_out + host_len, sizeof(host_out) - host_len);
+        confirmed = host_len > 0 && (host_out[host_len - 1] & L_DATA_CON_MASK) == L_DATA_CON;
+    }
+
+    bool echo_ok = host_len == HOST_TAG_LEN + sizeof(frame) + 1 && memcmp(host_out + HOST_TAG_LEN, frame, sizeof(frame)) == 0;
+    bool success = confirmed && echo_ok && host_out[host_len - 1] == (L_DATA_CON | SUCCESS);
+
+    printf("native loopback: %s - %u byte(s) to host, confirm %02X at %llu us, tx=%lu rx=%lu\n",
+           success ? "OK" : "FAIL", host_len, confirmed ? host_out[host_len - 1] : 0,
+           (unsigned long long)hal_native_now_us(), (unsigned long)metric_get(METRIC_TX_FRAMES),
+           (unsigned long)metric_get(METRIC_RX_FRAMES));
+    if (!success) {
+        for (uint16_t i = 0; i < host_len; i++) {
+            printf("%02X ", host_out[i]);
+        }
+        printf("\n");
+    }
+#if KNX_COUPLER_ENABLE
+    success = coupler_smoke() && success;
+#endif
+    success = pipeline_smoke() && success;
+    success = confirm_smoke() && success;
+    success = filter_smoke() && success;
+    success = dedup_smoke() && success;
+    success = metrics_smoke() && success;
+#if KNX_TRACE_ENABLE
+    success = trace_smoke() && success;
+#endif
+    return success ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+#include "native/replay/capture_reader.h"
+#include <string.h>
+#include "crc_ccitt.h"
+
+#define BLOCK_HDR 7
+
+void capture_reader_init(capture_reader_t *r, capture_record_cb_t cb, void *ctx) {
+    memset(r, 0, sizeof(*r));
+    r->cb = cb;
+    r->ctx = ctx;
+}
+
+const char *capture_rec_name(uint8_t type) {
+    static const char *names[CAP_REC_COUNT] = {"START", "BUS_RX", "HOST_RX", "HOST_TX", "BUS_TX", "DROP"};
+    return type < CAP_REC_COUNT ? names[type] : "?";
+}
+
+static bool read_varint(const uint8_t *p, uint8_t len, uint8_t *pos, uint32_t *out) {
+    uint32_t v = 0;
+    for (uint8_t shift = 0; shift < 35 && *pos < len; shift += 7) {
+        uint8_t b = p[(*pos)++];
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *out = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Record của 1 block đã qua CRC; false = nội dung sai (firmware khác version...)
+static bool parse_records(capture_reader_t *r, const uint8_t *p, uint8_t len, uint32_t t0) {
+    uint64_t t = r->have_time ? r->last_us + (uint32_t)(t0 - (uint32_t)r->last_us) : t0;
+    uint8_t pos = 0;
+    while (pos < len) {
+        capture_record_t rec;
+        memset(&rec, 0, sizeof(rec));
+        uint8_t hdr = p[pos++];
+        uint32_t delta = 0;
+        if (!read_varint(p, len, &pos, &delta)) {
+            return false;
+        }
+        t += delta;
+        rec.t_us = t;
+        rec.type = hdr >> 4;
+        rec.flags = hdr & 0x0F;
+
+        uint8_t n = 0;
+        switch (rec.type) {
+            case CAP_REC_START:  n = 5; break;
+            case CAP_REC_BUS_RX:
+            case CAP_REC_HOST_RX: n = 1; break;
+            case CAP_REC_DROP:   n = 2; break;
+            case CAP_REC_BUS_TX:
+                if (pos >= len) {
+                    return false;
+                }
+                rec.result = p[pos++];
+                // fallthrough
+            case CAP_REC_HOST_TX:
+                if (pos >= len) {
+                    return false;
+                }
+                n = p[pos++];
+                break;
+            default:
+                return false;
+        }
+        if (n > CAPTURE_DATA_MAX || pos + n > len) {
+            return false;
+        }
+        memcpy(rec.data, &p[pos], n);
+        rec.len = n;
+        pos += n;
+
+        if (rec.type == CAP_REC_DROP) {
+            r->dropped_records += rec.data[0] | (rec.data[1] << 8);
+        }
+        r->have_time = true;
+        r->last_us = t;
+        r->records++;
+        if (r->cb) {
+            r->cb(&rec, r->ctx);
+        }
+    }
+    return true;
+}
+
+static void drop_front(capture_reader_t *r, uint16_t n) {
+    memmove(r->buf, r->buf + n, r->fill - n);
+    r->fill -= n;
+}
+
+void capture_reader_feed(capture_reader_t *r, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        r->buf[r->fill++] = data[i];
+
+        for (;;) {
+            if (r->fill == 0) {
+                break;
+            }
+            if (r->buf[0] != CAPTURE_SYNC) {
+                r->skipped_bytes++;
+                drop_front(r, 1);
+                continue;
+            }
+            if (r->fill < 2) {
+                break;
+            }
+            uint8_t blen = r->buf[1];
+            if (blen == 0 || blen > CAPTURE_BLOCK_MAX) {
+                r->skipped_bytes++;
+                drop_front(r, 1);
+                continue;
+            }
+            uint16_t size = BLOCK_HDR + blen + 2;
+            if (r->fill < size) {
+                break;
+            }
+            uint16_t crc = crc_ccitt(&r->buf[1], BLOCK_HDR - 1 + blen);
+            if (r->buf[BLOCK_HDR + blen] != (uint8_t)(crc >> 8) || r->buf[BLOCK_HDR + blen + 1] != (uint8_t)crc) {
+                // 0xC5 trong dữ liệu hoặc block hỏng: thử đồng bộ lại từ byte kế tiếp
+                r->skipped_bytes++;
+                drop_front(r, 1);
+                continue;
+            }
+
+            uint8_t seq = r->buf[2];
+            if (r->have_seq && seq != (uint8_t)(r->seq + 1)) {
+                r->lost_blocks += (uint8_t)(seq - r->seq - 1);
+            }
+            r->have_seq = true;
+            r->seq = seq;
+            uint32_t t0 = (uint32_t)r->buf[3] | ((uint32_t)r->buf[4] << 8) | ((uint32_t)r->buf[5] << 16) |
+                          ((uint32_t)r->buf[6] << 24);
+            r->blocks++;
+            if (!parse_records(r, &r->buf[BLOCK_HDR], blen, t0)) {
+                r->bad_blocks++;
+            }
+            drop_front(r, size);
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef CAPTURE_READER_H
+#define CAPTURE_READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "capture.h"
+
+/*
+ * Giải mã stream capture (format trong capture.h) trên Linux
+ *
+ * Nhận byte theo từng đoạn bất kỳ (file, serial), tìm block theo 0xC5 + CRC, bỏ rác / block hỏng,
+ * mở rộng timestamp u32 thành 64 bit và gọi callback cho từng record theo thứ tự.
+ */
+
+typedef struct {
+    uint64_t t_us;
+    uint8_t type;      // capture_rec_t
+    uint8_t flags;
+    uint8_t result;    // BUS_TX: knx_error_t
+    uint8_t len;
+    uint8_t data[CAPTURE_DATA_MAX];  // START: [version] [reset flags u32]; DROP: [số record u16]
+} capture_record_t;
+
+typedef void (*capture_record_cb_t)(const capture_record_t *rec, void *ctx);
+
+typedef struct {
+    capture_record_cb_t cb;
+    void *ctx;
+    uint8_t buf[CAPTURE_BLOCK_MAX + 9];
+    uint16_t fill;
+    bool have_seq;
+    uint8_t seq;
+    bool have_time;
+    uint64_t last_us;
+    // Thống kê
+    uint32_t blocks;
+    uint32_t bad_blocks;       // CRC / record sai
+    uint32_t lost_blocks;      // Theo seq bị nhảy
+    uint32_t skipped_bytes;    // Rác ngoài block
+    uint32_t records;
+    uint32_t dropped_records;  // Tổng CAP_REC_DROP (ring đầy trên firmware)
+} capture_reader_t;
+
+void capture_reader_init(capture_reader_t *r, capture_record_cb_t cb, void *ctx);
+void capture_reader_feed(capture_reader_t *r, const uint8_t *data, size_t len);
+const char *capture_rec_name(uint8_t type);
+
+#endif // CAPTURE_READER_H
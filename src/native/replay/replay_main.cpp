@@ -0,0 +1,455 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "native/replay/capture_reader.h"
+#include "native/hal_native.h"
+#include "capture.h"
+#include "config.h"
+#include "event_loop.h"
+#include "gateway.h"
+#include "knx_rx.h"
+#include "knx_tx.h"
+#include "logger.h"
+#include "metrics.h"
+#include "trace.h"
+
+/*
+ * env:native_replay - chạy lại 1 capture (capture.h) qua firmware trên Linux và so sánh output
+ *
+ *   .pio/build/native_replay/program [--realtime] [-o replay.cap] [-v] incident.cap
+ *   .pio/build/native_replay/program --dump incident.cap
+ *
+ * - Byte bus đã ghi (gồm cả echo của chính gateway) được phát lại thành waveform lên bus giả lập qua line hook,
+ *   xung TX của gateway không lên bus (hal_native_tx_loopback(false)) → decoder, bus busy, ACK window chạy như thật
+ * - Byte host được đưa vào host serial giả lập đúng thời điểm gateway đã đọc
+ * - Firmware replay cũng chạy capture → so sánh byte gửi host và frame / ACK gửi bus với bản ghi
+ * - Mặc định chạy nhanh nhất có thể (thời gian ảo), --realtime giữ tốc độ 1x theo đồng hồ thật
+ *
+ * Chỉ replay phiên đầu tiên (từ CAP_REC_START tới START kế tiếp = firmware khởi động lại).
+ * Exit code: 0 = output khớp, 1 = khác, 2 = lỗi file.
+ */
+
+#define REPLAY_CHAR_US (13 * KNX_BIT_PERIOD_US)      // 1 ký tự trên bus
+#define REPLAY_DECODE_US (11 * KNX_BIT_PERIOD_US)     // Start bit → callback của decoder (stop bit đầu)
+#define REPLAY_BIT0_US 35                            // Cùng độ rộng xung bit 0 với knx_tx
+#define REPLAY_SHOW_BYTES 16
+
+typedef struct {
+    capture_record_t *items;
+    uint32_t count;
+    uint32_t cap;
+} rec_list_t;
+
+// Byte theo thứ tự kèm thời điểm (host TX được so sánh như 1 stream, không theo từng lần ghi)
+typedef struct {
+    uint64_t *t_us;
+    uint8_t *bytes;
+    uint32_t count;
+} byte_stream_t;
+
+static rec_list_t recorded;
+static rec_list_t replayed;
+static capture_reader_t out_reader;
+static FILE *out_file = nullptr;
+
+// Input của phiên đang replay (thời gian tính từ CAP_REC_START)
+static capture_record_t *session = nullptr;
+static uint32_t session_len = 0;
+static uint64_t session_t0 = 0;
+static uint32_t next_bus = 0;
+static uint32_t next_host = 0;
+static bool char_active = false;
+static uint64_t char_start = 0;
+static uint16_t char_pulses[13];
+
+static void list_add(const capture_record_t *rec, void *ctx) {
+    rec_list_t *l = (rec_list_t *)ctx;
+    if (l->count == l->cap) {
+        l->cap = l->cap ? l->cap * 2 : 4096;
+        l->items = (capture_record_t *)realloc(l->items, l->cap * sizeof(capture_record_t));
+        if (!l->items) {
+            fprintf(stderr, "out of memory\n");
+            exit(2);
+        }
+    }
+    l->items[l->count++] = *rec;
+}
+
+// Giống handle_knx_frame() của target (main.cpp)
+static void on_bus_byte(const uint8_t byte) {
+    gateway_bus_byte_isr(byte);
+}
+
+static void on_bus_idle(void) {
+    event_post(EVT_BUS_IDLE);
+}
+
+static void on_debug_out(const uint8_t *data, uint16_t len) {
+    capture_reader_feed(&out_reader, data, len);
+    if (out_file) {
+        fwrite(data, 1, len, out_file);
+    }
+}
+
+// Start + 8 data (LSB trước) + parity chẵn (đảo nếu bản ghi báo sai parity) + 3 stop, bit 0 = xung
+static void char_encode(uint8_t byte, bool parity_error) {
+    uint8_t n = 0;
+    uint8_t ones = 0;
+    char_pulses[n++] = REPLAY_BIT0_US;
+    for (uint8_t b = 0; b < 8; b++) {
+        uint8_t bit = (byte >> b) & 1;
+        ones += bit;
+        char_pulses[n++] = bit ? 0 : REPLAY_BIT0_US;
+    }
+    bool parity_one = (ones & 1) != parity_error;
+    char_pulses[n++] = parity_one ? 0 : REPLAY_BIT0_US;
+    char_pulses[n++] = 0;
+    char_pulses[n++] = 0;
+    char_pulses[n++] = 0;
+}
+
+static uint32_t next_of_type(uint32_t from, uint8_t type) {
+    while (from < session_len && session[from].type != type) {
+        from++;
+    }
+    return from;
+}
+
+// Gọi mỗi µs từ HAL giả lập: đưa byte host tới hạn vào serial, phát lại ký tự bus đã ghi
+static bool replay_line(bool local_level) {
+    (void)local_level;
+    uint64_t now = hal_native_now_us();
+
+    while (next_host < session_len && session[next_host].t_us - session_t0 <= now) {
+        hal_native_host_inject(session[next_host].data, 1);
+        next_host = next_of_type(next_host + 1, CAP_REC_HOST_RX);
+    }
+
+    if (char_active && now - char_start >= REPLAY_CHAR_US) {
+        char_active = false;
+    }
+    if (!char_active && next_bus < session_len) {
+        // Ký tự bắt đầu sao cho decoder trả byte đúng lúc đã ghi; ký tự liền nhau không chồng lên nhau
+        const capture_record_t *r = &session[next_bus];
+        uint64_t due = r->t_us - session_t0;
+        if (due < REPLAY_DECODE_US || due - REPLAY_DECODE_US <= now) {
+            char_encode(r->data[0], (r->flags & CAP_FLAG_PARITY) != 0);
+            char_active = true;
+            char_start = now;
+            next_bus = next_of_type(next_bus + 1, CAP_REC_BUS_RX);
+        }
+    }
+    if (!char_active) {
+        return false;
+    }
+    uint32_t pos = (uint32_t)(now - char_start);
+    return pos % KNX_BIT_PERIOD_US < char_pulses[pos / KNX_BIT_PERIOD_US];
+}
+
+static uint64_t wall_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static bool load_capture(const char *path, capture_reader_t *reader) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    capture_reader_init(reader, list_add, &recorded);
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        capture_reader_feed(reader, buf, n);
+    }
+    fclose(f);
+    return true;
+}
+
+static void print_record(const capture_record_t *r, uint64_t t0) {
+    uint64_t t = r->t_us - t0;
+    printf("%6llu.%06llu %-7s", (unsigned long long)(t / 1000000), (unsigned long long)(t % 1000000), capture_rec_name(r->type));
+    switch (r->type) {
+        case CAP_REC_START:
+            printf(" v%u reset=%08X", r->data[0],
+                   (unsigned)(r->data[1] | (r->data[2] << 8) | (r->data[3] << 16) | ((uint32_t)r->data[4] << 24)));
+            break;
+        case CAP_REC_DROP:
+            printf(" %u record(s) lost", r->data[0] | (r->data[1] << 8));
+            break;
+        case CAP_REC_BUS_TX:
+            printf(" %s result=%u", (r->flags & CAP_FLAG_ACK) ? "ack" : "frame", r->result);
+            // fallthrough
+        default:
+            printf(" ");
+            for (uint8_t i = 0; i < r->len; i++) {
+                printf(" %02X", r->data[i]);
+            }
+            if (r->type == CAP_REC_BUS_RX && (r->flags & CAP_FLAG_PARITY)) {
+                printf("  parity");
+            }
+            if (r->flags & CAP_FLAG_TRUNC) {
+                printf("  (truncated)");
+            }
+            break;
+    }
+    printf("\n");
+}
+
+static void print_stats(const char *name, const capture_reader_t *r) {
+    printf("%s: %u record(s) in %u block(s), %u bad, %u lost, %u byte(s) skipped, %u record(s) dropped by firmware\n",
+           name, r->records, r->blocks, r->bad_blocks, r->lost_blocks, r->skipped_bytes, r->dropped_records);
+}
+
+// Nối byte của mọi record cùng type, thời gian tính từ t0
+static void collect_bytes(const capture_record_t *recs, uint32_t count, uint8_t type, uint64_t t0, byte_stream_t *s) {
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (recs[i].type == type) {
+            total += recs[i].len;
+        }
+    }
+    s->t_us = (uint64_t *)malloc((total + 1) * sizeof(uint64_t));
+    s->bytes = (uint8_t *)malloc(total + 1);
+    s->count = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (recs[i].type != type) {
+            continue;
+        }
+        for (uint8_t k = 0; k < recs[i].len; k++) {
+            s->t_us[s->count] = recs[i].t_us - t0;
+            s->bytes[s->count++] = recs[i].data[k];
+        }
+    }
+}
+
+static void show_bytes(const char *label, const byte_stream_t *s, uint32_t at) {
+    printf("    %s @%llu us:", label, at < s->count ? (unsigned long long)s->t_us[at] : 0ULL);
+    for (uint32_t i = at; i < s->count && i < at + REPLAY_SHOW_BYTES; i++) {
+        printf(" %02X", s->bytes[i]);
+    }
+    printf(at < s->count ? "\n" : " (end)\n");
+}
+
+// So sánh 2 stream byte: số byte khớp liên tiếp từ đầu, độ lệch thời gian lớn nhất
+static bool compare_stream(const char *name, const byte_stream_t *exp, const byte_stream_t *got) {
+    uint32_t n = exp->count < got->count ? exp->count : got->count;
+    uint32_t i = 0;
+    int64_t skew_max = 0;
+    for (; i < n && exp->bytes[i] == got->bytes[i]; i++) {
+        int64_t skew = (int64_t)(got->t_us[i] - exp->t_us[i]);
+        if (skew < 0) {
+            skew = -skew;
+        }
+        if (skew > skew_max) {
+            skew_max = skew;
+        }
+    }
+    bool ok = i == exp->count && i == got->count;
+    printf("%-8s %7u / %7u byte(s) match, replay %7u, max skew %lld us%s\n", name, i, exp->count, got->count,
+           (long long)skew_max, ok ? "" : "  MISMATCH");
+    if (!ok) {
+        uint32_t from = i > 4 ? i - 4 : 0;
+        printf("  first difference at byte %u:\n", i);
+        show_bytes("recorded", exp, from);
+        show_bytes("replayed", got, from);
+    }
+    return ok;
+}
+
+// Frame / ACK gửi xuống bus: so sánh từng record (cờ, kết quả, dữ liệu)
+static bool compare_bus_tx(const capture_record_t *exp, uint32_t exp_n, uint64_t exp_t0,
+                           const capture_record_t *got, uint32_t got_n, uint64_t got_t0) {
+    uint32_t i = 0, j = 0, matched = 0, total = 0, replay_total = 0;
+    int64_t skew_max = 0;
+    bool ok = true;
+    for (;;) {
+        while (i < exp_n && exp[i].type != CAP_REC_BUS_TX) {
+            i++;
+        }
+        while (j < got_n && got[j].type != CAP_REC_BUS_TX) {
+            j++;
+        }
+        if (i >= exp_n || j >= got_n) {
+            break;
+        }
+        total++;
+        replay_total++;
+        bool same = exp[i].flags == got[j].flags && exp[i].result == got[j].result && exp[i].len == got[j].len &&
+                    memcmp(exp[i].data, got[j].data, exp[i].len) == 0;
+        if (!same) {
+            if (ok) {
+                printf("  first bus TX difference (#%u):\n    recorded ", total);
+                print_record(&exp[i], exp_t0);
+                printf("    replayed ");
+                print_record(&got[j], got_t0);
+            }
+            ok = false;
+            break;
+        }
+        int64_t skew = (int64_t)((got[j].t_us - got_t0) - (exp[i].t_us - exp_t0));
+        if (skew < 0) {
+            skew = -skew;
+        }
+        if (skew > skew_max) {
+            skew_max = skew;
+        }
+        matched++;
+        i++;
+        j++;
+    }
+    for (; i < exp_n; i++) {
+        total += exp[i].type == CAP_REC_BUS_TX;
+    }
+    for (; j < got_n; j++) {
+        replay_total += got[j].type == CAP_REC_BUS_TX;
+    }
+    ok = ok && matched == total && total == replay_total;
+    printf("%-8s %7u / %7u TX(s) match,  replay %7u, max skew %lld us%s\n", "bus TX", matched, total, replay_total,
+           (long long)skew_max, ok ? "" : "  MISMATCH");
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    const char *path = nullptr;
+    const char *out_path = nullptr;
+    bool dump = false;
+    bool realtime = false;
+    bool verbose = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--dump")) {
+            dump = true;
+        } else if (!strcmp(argv[i], "--realtime")) {
+            realtime = true;
+        } else if (!strcmp(argv[i], "-v")) {
+            verbose = true;
+        } else if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (argv[i][0] != '-' && !path) {
+            path = argv[i];
+        } else {
+            path = nullptr;
+            break;
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "usage: %s [--realtime] [-o replay.cap] [-v] <capture>\n"
+                        "       %s --dump <capture>\n", argv[0], argv[0]);
+        return 2;
+    }
+
+    capture_reader_t in_reader;
+    if (!load_capture(path, &in_reader)) {
+        return 2;
+    }
+    if (dump) {
+        uint64_t t0 = recorded.count ? recorded.items[0].t_us : 0;
+        for (uint32_t i = 0; i < recorded.count; i++) {
+            print_record(&recorded.items[i], t0);
+        }
+        print_stats(path, &in_reader);
+        return 0;
+    }
+
+    // Phiên đầu tiên: từ START tới START kế tiếp
+    uint32_t first = 0;
+    while (first < recorded.count && recorded.items[first].type != CAP_REC_START) {
+        first++;
+    }
+    if (first == recorded.count) {
+        fprintf(stderr, "%s: no CAP_REC_START - capture must start at firmware boot\n", path);
+        return 2;
+    }
+    session = &recorded.items[first];
+    session_len = 1;
+    while (first + session_len < recorded.count && session[session_len].type != CAP_REC_START) {
+        session_len++;
+    }
+    session_t0 = session[0].t_us;
+    uint64_t duration_us = session[session_len - 1].t_us - session_t0;
+    print_stats(path, &in_reader);
+    if (first + session_len < recorded.count) {
+        printf("firmware restarted at +%llu us - replaying the first session only\n", (unsigned long long)duration_us);
+    }
+    if (in_reader.lost_blocks || in_reader.bad_blocks || in_reader.dropped_records) {
+        printf("warning: capture has gaps, output will likely diverge after the first one\n");
+    }
+
+    if (out_path) {
+        out_file = fopen(out_path, "wb");
+        if (!out_file) {
+            perror(out_path);
+            return 2;
+        }
+    }
+    capture_reader_init(&out_reader, list_add, &replayed);
+    next_bus = next_of_type(0, CAP_REC_BUS_RX);
+    next_host = next_of_type(0, CAP_REC_HOST_RX);
+
+    hal_native_reset();
+    hal_native_debug_echo(false);
+    hal_native_set_debug_sink(on_debug_out);
+    hal_native_tx_loopback(false);
+    hal_native_set_line_hook(replay_line);
+    hal_native_set_reset_flags(session[0].data[1] | (session[0].data[2] << 8) | (session[0].data[3] << 16) |
+                               ((uint32_t)session[0].data[4] << 24));
+
+    metrics_init();
+    logger_init();
+    trace_init();
+    knx_rx_init(KNX_LINE_MAIN, on_bus_byte, on_bus_idle);
+    knx_tx_init(KNX_LINE_MAIN);
+    event_loop_init();
+    capture_init();
+
+    // Bản ghi dừng ở record cuối: output sau thời điểm đó không có gì để so sánh
+    uint64_t end_us = duration_us + 1;
+    uint64_t wall_start = wall_us();
+    while (hal_native_now_us() < end_us) {
+        gateway_dispatch(event_wait());
+        capture_drain();
+        if (realtime) {
+            uint64_t virt = hal_native_now_us();
+            uint64_t wall = wall_us() - wall_start;
+            if (virt > wall + 1000) {
+                struct timespec ts = {(time_t)((virt - wall) / 1000000), (long)((virt - wall) % 1000000) * 1000};
+                nanosleep(&ts, nullptr);
+            }
+        }
+    }
+    capture_flush();
+    uint64_t wall_total = wall_us() - wall_start;
+    if (out_file) {
+        fclose(out_file);
+    }
+
+    // Thời gian phiên replay tính từ START của chính nó
+    uint64_t replay_t0 = replayed.count ? replayed.items[0].t_us : 0;
+    while (replayed.count && replayed.items[replayed.count - 1].t_us - replay_t0 > duration_us) {
+        replayed.count--;
+    }
+    byte_stream_t exp_rx, got_rx, exp_host, got_host;
+    collect_bytes(session, session_len, CAP_REC_BUS_RX, session_t0, &exp_rx);
+    collect_bytes(replayed.items, replayed.count, CAP_REC_BUS_RX, replay_t0, &got_rx);
+    collect_bytes(session, session_len, CAP_REC_HOST_TX, session_t0, &exp_host);
+    collect_bytes(replayed.items, replayed.count, CAP_REC_HOST_TX, replay_t0, &got_host);
+
+    printf("replayed %.3f s of traffic in %.3f s (%.1fx real time)\n", duration_us / 1e6, wall_total / 1e6,
+           wall_total ? (double)duration_us / wall_total : 0.0);
+    bool ok = compare_stream("bus RX", &exp_rx, &got_rx);
+    ok = compare_stream("host TX", &exp_host, &got_host) && ok;
+    ok = compare_bus_tx(session, session_len, session_t0, replayed.items, replayed.count, replay_t0) && ok;
+    if (verbose) {
+        printf("firmware: rx_frames=%u tx_frames=%u echo_ok=%u echo_neg=%u echo_timeout=%u ack_sent=%u ack_missed=%u "
+               "host_bytes=%u parity=%u\n",
+               metric_get(METRIC_RX_FRAMES), metric_get(METRIC_TX_FRAMES), metric_get(METRIC_ECHO_CONFIRMED),
+               metric_get(METRIC_ECHO_NEGATIVE), metric_get(METRIC_ECHO_TIMEOUTS), metric_get(METRIC_ACK_SENT),
+               metric_get(METRIC_ACK_MISSED), metric_get(METRIC_HOST_BYTES), metric_get(METRIC_RX_PARITY_ERRORS));
+    }
+    printf("RESULT: %s\n", ok ? "MATCH" : "MISMATCH");
+    return ok ? 0 : 1;
+}
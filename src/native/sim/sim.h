@@ -0,0 +1,104 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Simulator nhiều node trên 1 đường TP1 (env:native_sim, Linux, thời gian ảo)
+ *
+ * Firmware gateway chạy nguyên vẹn trên HAL giả lập (native/hal_native.cpp), bên ngoài là:
+ * - Line: wired-AND - bit 0 (xung) thắng bit 1, là OR của mức xung mọi node (sim_bus.cpp)
+ * - Device: sinh frame theo Poisson, chờ bus rảnh 50 bit time rồi phát; đang phát bit 1 mà thấy xung
+ *   → thua arbitration, dừng và chờ lượt sau; không nhận được ACK → lặp lại (repeat flag = 0) tối đa 3 lần;
+ *   trả ACK cho frame gửi tới địa chỉ của mình (--ack-loss: bỏ ACK ngẫu nhiên, giả lập device bận)
+ * - Host: gửi L_DATA request qua UART giả lập theo Poisson, chờ L_DATA_CON, lặp lại frame bị xác nhận âm,
+ *   trả U_ACK_REQ cho frame gửi tới địa chỉ gateway (sim_host.cpp). --cdc: host link là USB CDC
+ *   (HAL_HOST_CDC), host gửi tối đa 1 packet 64 byte mỗi USB frame 1ms thay vì 1 byte / 573µs
+ * - Gateway: mặc định theo KNX_TX_IDLE_BITS của firmware; --idle-rule: bắt đầu frame sau SIM_IDLE_BITS như device
+ *   (gateway_set_tx_idle_bits) → tranh bus thật với device. Khoảng rảnh nhỏ nhất trước frame của gateway được báo
+ *   trong cột "gap" (bit time) để kiểm tra gateway không chen trước device
+ *
+ * Tải bus = tổng thời gian chiếm bus của traffic (frame + ACK) / thời gian, chia cho host và các device.
+ */
+
+#define SIM_MAX_DEVICES 32
+#define SIM_MAX_FRAME 23          // KNX_MAX_FRAME_LEN
+#define SIM_REPEAT_MAX 3
+#define SIM_IDLE_BITS 50           // Bus rảnh trước khi device được bắt đầu frame
+#define SIM_ACK_DELAY_BITS 13      // ACK bắt đầu sau khi nhận xong checksum (cùng quy ước ACK_WINDOW_START_US)
+#define SIM_ACK_TIMEOUT_BITS 30    // Không thấy ký tự ACK trong khoảng này → coi như không ACK
+#define SIM_GATEWAY_ADDR 0x11FF    // 1.1.255 - địa chỉ host dùng qua gateway
+#define SIM_DEVICE_ADDR_BASE 0x1101
+#define SIM_LATENCY_MAX_SAMPLES 65536
+
+typedef struct {
+    uint8_t load_pct;          // Tải bus mục tiêu
+    uint8_t devices;
+    uint8_t host_share_pct;    // Phần tải do host (qua gateway) sinh ra
+    uint8_t host_retries;      // Số lần host lặp lại frame bị L_DATA_CON âm
+    uint8_t ack_loss_pct;      // Xác suất device bận / không trả ACK cho frame gửi tới nó → bên gửi lặp lại
+    bool rx_dedup;             // Bật tpuart/rx_dedup trên gateway
+    bool host_cdc;             // Host link qua USB CDC thay cho USART
+    bool gw_idle_rule;         // Gateway chờ SIM_IDLE_BITS như device thay cho backoff của firmware
+    uint32_t duration_ms;
+    uint32_t seed;
+} sim_config_t;
+
+typedef struct {
+    // Gateway (nhìn từ host)
+    uint32_t host_requests;
+    uint32_t host_sent;            // Số lần ghi frame xuống gateway (gồm lặp lại)
+    uint32_t host_ok;
+    uint32_t host_failed;          // Hết số lần lặp mà vẫn âm
+    uint32_t host_pending;         // Chưa có kết quả khi hết giờ
+    uint32_t host_repeats;
+    uint32_t host_parse_errors;
+    uint32_t host_acks;            // U_ACK_REQ host gửi cho frame tới địa chỉ gateway
+    uint32_t host_rx_bytes;        // Byte gateway gửi lên host
+    uint32_t gw_arbitration_lost;  // Frame gateway phát bit 1 mà bus có xung (firmware không phát hiện)
+    uint32_t gw_min_gap_us;        // Bus rảnh ngắn nhất trước control byte của frame gateway (UINT32_MAX = chưa có)
+    // Device
+    uint32_t dev_frames;
+    uint32_t dev_ok;
+    uint32_t dev_failed;
+    uint32_t dev_arbitration_lost;
+    uint32_t dev_repeats;
+    uint32_t dev_acks_sent;
+    uint32_t dev_acks_to_gateway;  // ACK device trả cho frame của gateway
+    // Line
+    uint32_t line_chars;
+    uint32_t line_frames;
+    uint32_t line_frames_bad;      // Checksum / parity sai (va chạm lệch pha...)
+    uint64_t line_busy_us;
+    // Latency host: request → L_DATA_CON cuối cùng (µs)
+    uint32_t latency_count;
+    uint32_t latency_us[SIM_LATENCY_MAX_SAMPLES];
+} sim_stats_t;
+
+extern sim_config_t sim_cfg;
+extern sim_stats_t sim_stats;
+
+// Số ngẫu nhiên [0, 1) và khoảng thời gian Poisson (µs) cho tốc độ rate_per_s
+double sim_rand(void);
+uint32_t sim_rand_range(uint32_t n);
+uint64_t sim_exp_us(double rate_per_s);
+// Thời gian chiếm bus của 1 frame len byte + khoảng chờ + ACK
+uint32_t sim_frame_airtime_us(uint8_t len);
+// Ghép frame chuẩn: ctrl, src, dest (địa chỉ cá nhân), payload_len byte APDU, checksum
+uint8_t sim_build_frame(uint8_t *out, uint16_t src, uint16_t dest, uint8_t payload_len);
+void sim_frame_set_repeat(uint8_t *frame, uint8_t len);
+
+// ===== sim_bus.cpp =====
+void sim_bus_init(void);
+bool sim_bus_idle_for_bits(uint32_t bits);
+// Tốc độ request của host (frame/s) theo tải và host_share_pct
+double sim_host_rate(void);
+
+// ===== sim_host.cpp =====
+void sim_host_init(void);
+// Mỗi lượt loop(): đọc byte từ gateway, gửi request tới hạn
+void sim_host_service(void);
+void sim_host_finish(void);
+
+#endif // SIM_H
@@ -0,0 +1,429 @@
+#include "native/sim/sim.h"
+#include "native/hal_native.h"
+#include "config.h"
+#include "tpuart/tpuart.h"
+#include "knx_frame.h"
+#include <math.h>
+#include <string.h>
+
+#define SIM_T0_HIGH 35             // Độ rộng xung bit 0 (cùng knx_tx)
+#define SIM_SAMPLE_US 60           // Xung trong 60µs đầu bit → bit 0
+#define SIM_CHAR_BITS 13
+#define SIM_FRAME_GAP_BITS 4       // Khoảng nghỉ giữa 2 ký tự lớn hơn → frame mới
+#define BIT_US KNX_BIT_PERIOD_US
+
+sim_config_t sim_cfg;
+sim_stats_t sim_stats;
+
+static uint64_t rng_state = 1;
+
+double sim_rand(void) {
+    // xorshift64*
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return (double)((rng_state * 2685821657736338717ULL) >> 11) / 9007199254740992.0;
+}
+
+uint32_t sim_rand_range(uint32_t n) {
+    return (uint32_t)(sim_rand() * n);
+}
+
+uint64_t sim_exp_us(double rate_per_s) {
+    if (rate_per_s <= 0) {
+        return UINT64_MAX / 2;
+    }
+    return (uint64_t)(-log(1.0 - sim_rand()) / rate_per_s * 1e6) + 1;
+}
+
+uint32_t sim_frame_airtime_us(uint8_t len) {
+    return (len * SIM_CHAR_BITS + SIM_ACK_DELAY_BITS + SIM_CHAR_BITS + SIM_IDLE_BITS) * BIT_US;
+}
+
+uint8_t sim_build_frame(uint8_t *out, uint16_t src, uint16_t dest, uint8_t payload_len) {
+    uint8_t n = 0;
+    out[n++] = 0xBC;                      // Standard, lần gửi đầu, priority low
+    out[n++] = (uint8_t)(src >> 8);
+    out[n++] = (uint8_t)src;
+    out[n++] = (uint8_t)(dest >> 8);
+    out[n++] = (uint8_t)dest;
+    out[n++] = 0x60 | (payload_len & 0x0F); // Địa chỉ cá nhân, hop count 6
+    out[n++] = 0x00;                      // TPCI
+    for (uint8_t i = 0; i < payload_len; i++) {
+        out[n++] = (uint8_t)sim_rand_range(256);
+    }
+    uint8_t x = 0;
+    for (uint8_t i = 0; i < n; i++) {
+        x ^= out[i];
+    }
+    out[n] = (uint8_t)~x;
+    return n + 1;
+}
+
+// Lặp lại: xoá repeat flag, checksum đổi cùng bit
+void sim_frame_set_repeat(uint8_t *frame, uint8_t len) {
+    knx_frame_mark_repeated(frame, len);
+}
+
+// ===== Phát ký tự: mảng bit (0 = xung), bắt đầu ở start_us =====
+typedef struct {
+    uint8_t bits[SIM_MAX_FRAME * SIM_CHAR_BITS];
+    uint16_t count;
+    uint64_t start_us;
+    bool active;
+} sim_tx_t;
+
+static void tx_load(sim_tx_t *tx, const uint8_t *data, uint8_t len, uint64_t now) {
+    uint16_t n = 0;
+    for (uint8_t i = 0; i < len; i++) {
+        uint8_t ones = 0;
+        tx->bits[n++] = 0;
+        for (uint8_t b = 0; b < 8; b++) {
+            uint8_t bit = (data[i] >> b) & 1;
+            ones += bit;
+            tx->bits[n++] = bit;
+        }
+        tx->bits[n++] = ones & 1;
+        tx->bits[n++] = 1;
+        tx->bits[n++] = 1;
+        tx->bits[n++] = 1;
+    }
+    tx->count = n;
+    tx->start_us = now;
+    tx->active = true;
+}
+
+// -1 = đã phát xong, 0 / 1 = bit đang phát ở now
+static int tx_bit(const sim_tx_t *tx, uint64_t now, uint32_t *pos_us) {
+    uint64_t t = now - tx->start_us;
+    uint64_t slot = t / BIT_US;
+    if (slot >= tx->count) {
+        return -1;
+    }
+    *pos_us = (uint32_t)(t % BIT_US);
+    return tx->bits[slot];
+}
+
+// ===== Device =====
+typedef enum {
+    DEV_IDLE = 0,
+    DEV_WAIT_BUS,     // Có frame, chờ bus rảnh SIM_IDLE_BITS
+    DEV_SENDING,
+    DEV_WAIT_ACK,
+} dev_state_t;
+
+typedef struct {
+    uint16_t addr;
+    dev_state_t state;
+    uint8_t frame[SIM_MAX_FRAME];
+    uint8_t len;
+    uint8_t repeats;
+    uint32_t backlog;         // Frame đã sinh nhưng chưa tới lượt
+    uint64_t next_gen_us;
+    uint64_t ack_deadline_us;
+    sim_tx_t tx;
+    sim_tx_t ack_tx;
+    uint64_t ack_at_us;       // Thời điểm trả ACK cho frame gửi tới mình (0 = không)
+} sim_device_t;
+
+static sim_device_t devices[SIM_MAX_DEVICES];
+static double device_rate = 0;
+
+// ===== Line: giải mã ký tự + tách frame, dùng chung cho mọi device =====
+typedef enum {
+    LINE_IDLE = 0,
+    LINE_FRAME,
+    LINE_AFTER_FRAME,         // Frame xong, ký tự kế tiếp trong SIM_ACK_TIMEOUT_BITS là ACK
+} line_state_t;
+
+static bool line_level = false;
+static uint64_t line_last_pulse_us = 0;
+static bool char_active = false;
+static uint64_t char_start_us = 0;
+static uint16_t char_zero_mask = 0;    // bit k = thấy xung trong bit k
+static uint64_t prev_char_start_us = 0;
+
+static line_state_t line_state = LINE_IDLE;
+static uint8_t line_frame[SIM_MAX_FRAME];
+static uint8_t line_frame_idx = 0;
+static uint8_t line_frame_len = 0;
+static bool line_frame_bad = false;
+static uint64_t line_frame_end_us = 0;
+static bool gw_lost_this_frame = false;
+static bool gw_started = false;         // Gateway đã phát xung đầu của DMA (bỏ qua bit im lặng phía trước)
+static uint64_t char_gap_us = 0;        // Bus rảnh trước start bit của ký tự hiện tại
+
+bool sim_bus_idle_for_bits(uint32_t bits) {
+    uint64_t now = hal_native_now_us();
+    return !line_level && !char_active && now - line_last_pulse_us >= (uint64_t)bits * BIT_US;
+}
+
+// Tải mục tiêu / thời gian chiếm bus của frame trung bình (payload 1..4 byte → 9..12 byte)
+static double sim_total_rate(void) {
+    return sim_cfg.load_pct / 100.0 / (sim_frame_airtime_us(10) / 1e6);
+}
+
+static void device_new_frame(sim_device_t *d) {
+    uint16_t dest;
+    uint32_t pick = sim_rand_range(sim_cfg.devices);  // devices - 1 device khác + gateway
+    if (pick == (uint32_t)(d - devices)) {
+        dest = SIM_GATEWAY_ADDR;
+    } else {
+        dest = devices[pick].addr;
+    }
+    d->len = sim_build_frame(d->frame, d->addr, dest, 1 + sim_rand_range(4));
+    d->repeats = 0;
+    d->state = DEV_WAIT_BUS;
+    sim_stats.dev_frames++;
+}
+
+static void device_done(sim_device_t *d, bool ok) {
+    if (ok) {
+        sim_stats.dev_ok++;
+    } else if (d->repeats < SIM_REPEAT_MAX) {
+        d->repeats++;
+        sim_stats.dev_repeats++;
+        sim_frame_set_repeat(d->frame, d->len);
+        d->state = DEV_WAIT_BUS;
+        return;
+    } else {
+        sim_stats.dev_failed++;
+    }
+    d->state = DEV_IDLE;
+    if (d->backlog) {
+        d->backlog--;
+        device_new_frame(d);
+    }
+}
+
+static void line_on_frame(void) {
+    bool ok = !line_frame_bad;
+    uint8_t x = 0;
+    for (uint8_t i = 0; i < line_frame_len; i++) {
+        x ^= line_frame[i];
+    }
+    ok = ok && x == 0xFF;
+    if (!ok) {
+        sim_stats.line_frames_bad++;
+        return;
+    }
+    sim_stats.line_frames++;
+    knx_frame_view_t frame(line_frame, line_frame_len);
+    uint16_t src = frame.source();
+    uint16_t dest = frame.destination();
+    if (frame.is_group()) {
+        return; // Group address: không có responder trong mô hình
+    }
+    for (uint8_t i = 0; i < sim_cfg.devices; i++) {
+        if (devices[i].addr == dest) {
+            if (sim_cfg.ack_loss_pct && sim_rand_range(100) < sim_cfg.ack_loss_pct) {
+                continue;
+            }
+            devices[i].ack_at_us = hal_native_now_us() + SIM_ACK_DELAY_BITS * BIT_US;
+            if (src == SIM_GATEWAY_ADDR) {
+                sim_stats.dev_acks_to_gateway++;
+            }
+        }
+    }
+}
+
+static void line_on_ack(uint8_t c) {
+    for (uint8_t i = 0; i < sim_cfg.devices; i++) {
+        sim_device_t *d = &devices[i];
+        if (d->state == DEV_WAIT_ACK) {
+            device_done(d, c == KNX_BUS_ACK);
+        }
+    }
+}
+
+static void line_on_char(uint8_t c, bool parity_ok, uint64_t start_us) {
+    sim_stats.line_chars++;
+    sim_stats.line_busy_us += SIM_CHAR_BITS * BIT_US;
+
+    if (line_state == LINE_FRAME && start_us - prev_char_start_us > (SIM_CHAR_BITS + SIM_FRAME_GAP_BITS) * BIT_US) {
+        sim_stats.line_frames_bad++; // Frame bị cắt ngang
+        line_state = LINE_IDLE;
+    }
+    if (line_state == LINE_AFTER_FRAME && start_us - line_frame_end_us > SIM_ACK_TIMEOUT_BITS * BIT_US) {
+        line_state = LINE_IDLE;
+    }
+    prev_char_start_us = start_us;
+
+    switch (line_state) {
+        case LINE_AFTER_FRAME:
+            line_state = LINE_IDLE;
+            if ((c & L_DATA_MASK) != L_DATA_STANDARD_IND) {
+                line_on_ack(c);
+                break;
+            }
+            // Không có ACK, frame mới bắt đầu ngay
+            // fall through
+        case LINE_IDLE:
+            if ((c & L_DATA_MASK) == L_DATA_STANDARD_IND) {
+
+                line_state = LINE_FRAME;
+                line_frame_idx = 0;
+                line_frame_len = 0;
+                line_frame_bad = !parity_ok;
+                line_frame[line_frame_idx++] = c;
+            }
+            break;
+        case LINE_FRAME:
+            line_frame[line_frame_idx++] = c;
+            line_frame_bad |= !parity_ok;
+            if (line_frame_idx == knx_frame_len_offset(false) + 1) {
+                line_frame_len = (uint8_t)knx_frame_total_len(false, c);
+            }
+            if (line_frame_len && line_frame_idx >= line_frame_len) {
+                line_on_frame();
+                line_state = LINE_AFTER_FRAME;
+                line_frame_end_us = hal_native_now_us();
+            } else if (line_frame_idx >= SIM_MAX_FRAME) {
+                sim_stats.line_frames_bad++;
+                line_state = LINE_IDLE;
+            }
+            break;
+    }
+}
+
+// Bộ thu dùng chung: sườn lên khi rảnh = start bit, bit k = 0 nếu có xung trong SIM_SAMPLE_US đầu bit
+static void line_receive(uint64_t now, bool level) {
+    if (!char_active) {
+        if (level && !line_level) {
+            char_active = true;
+            char_start_us = now;
+            char_zero_mask = 0;
+            char_gap_us = now - line_last_pulse_us - 1;
+            line_last_pulse_us = now;
+        } else {
+            return;
+        }
+    }
+    if (level) {
+        line_last_pulse_us = now;
+    }
+    uint64_t t = now - char_start_us;
+    uint32_t slot = (uint32_t)(t / BIT_US);
+    if (level && t % BIT_US < SIM_SAMPLE_US && slot < 16) {
+        char_zero_mask |= 1u << slot;
+    }
+    if (t >= 11 * BIT_US) {
+        // Start + 8 data + parity + stop đầu tiên
+        uint8_t c = 0;
+        uint8_t ones = 0;
+        for (uint8_t b = 0; b < 8; b++) {
+            if (!(char_zero_mask & (1u << (b + 1)))) {
+                c |= 1 << b;
+                ones++;
+            }
+        }
+        bool parity_one = !(char_zero_mask & (1u << 9));
+        bool ok = (char_zero_mask & 1) && ((ones + parity_one) & 1) == 0 && !(char_zero_mask & (1u << 10));
+        char_active = false;
+        line_on_char(c, ok, char_start_us);
+    }
+}
+
+// ===== Line hook: gọi mỗi µs từ hal_native =====
+static bool line_hook(bool gateway_level) {
+    uint64_t now = hal_native_now_us();
+    bool ext = false;
+
+    for (uint8_t i = 0; i < sim_cfg.devices; i++) {
+        sim_device_t *d = &devices[i];
+
+        if (now >= d->next_gen_us) {
+            d->next_gen_us = now + sim_exp_us(device_rate);
+            if (d->state == DEV_IDLE) {
+                device_new_frame(d);
+            } else {
+                d->backlog++;
+            }
+        }
+        if (d->ack_at_us && now >= d->ack_at_us) {
+            uint8_t ack = KNX_BUS_ACK;
+            tx_load(&d->ack_tx, &ack, 1, now);
+            d->ack_at_us = 0;
+            sim_stats.dev_acks_sent++;
+        }
+        if (d->state == DEV_WAIT_BUS && sim_bus_idle_for_bits(SIM_IDLE_BITS)) {
+            tx_load(&d->tx, d->frame, d->len, now);
+            d->state = DEV_SENDING;
+        }
+        if (d->state == DEV_WAIT_ACK && now >= d->ack_deadline_us) {
+            device_done(d, false);
+        }
+
+        uint32_t pos;
+        if (d->state == DEV_SENDING) {
+            int bit = tx_bit(&d->tx, now, &pos);
+            if (bit < 0) {
+                d->state = DEV_WAIT_ACK;
+                d->ack_deadline_us = now + SIM_ACK_TIMEOUT_BITS * BIT_US;
+            } else if (bit == 0 && pos < SIM_T0_HIGH) {
+                ext = true;
+            }
+        }
+        if (d->ack_tx.active) {
+            int bit = tx_bit(&d->ack_tx, now, &pos);
+            if (bit < 0) {
+                d->ack_tx.active = false;
+            } else if (bit == 0 && pos < SIM_T0_HIGH) {
+                ext = true;
+            }
+        }
+    }
+
+    bool level = gateway_level || ext;
+
+    // Wired-AND: đang phát bit 1 mà bus có xung → thua arbitration
+    for (uint8_t i = 0; i < sim_cfg.devices; i++) {
+        sim_device_t *d = &devices[i];
+        uint32_t pos;
+        if (d->state == DEV_SENDING && level && tx_bit(&d->tx, now, &pos) == 1 && pos < SIM_SAMPLE_US) {
+            sim_stats.dev_arbitration_lost++;
+            d->state = DEV_WAIT_BUS;
+        }
+    }
+    if (!hal_tx_busy(KNX_LINE_MAIN)) {
+        gw_lost_this_frame = false;
+        gw_started = false;
+    } else if (gateway_level && !gw_started) {
+        gw_started = true;
+        if (hal_native_tx_bits() > 2 * SIM_CHAR_BITS) {
+            // Xung đầu của frame gateway: chung start bit với ký tự vừa bắt đầu → tính khoảng rảnh trước ký tự đó,
+            // giữa ký tự của node khác → 0 (gateway phát đè)
+            uint64_t gap = !char_active ? now - line_last_pulse_us - 1 : now - char_start_us < BIT_US ? char_gap_us : 0;
+            if (gap < sim_stats.gw_min_gap_us) {
+                sim_stats.gw_min_gap_us = (uint32_t)gap;
+            }
+        }
+    } else if (ext && gw_started && hal_native_tx_sending_one() && !gw_lost_this_frame) {
+        // Firmware không kiểm tra bus khi đang phát → vẫn phát tiếp, echo sẽ sai
+        gw_lost_this_frame = true;
+        sim_stats.gw_arbitration_lost++;
+    }
+
+    line_receive(now, level);
+    line_level = level;
+    return ext;
+}
+
+void sim_bus_init(void) {
+    rng_state = sim_cfg.seed ? sim_cfg.seed : 1;
+    memset(devices, 0, sizeof(devices));
+    sim_stats.gw_min_gap_us = UINT32_MAX;
+
+    double total_rate = sim_total_rate();
+    device_rate = sim_cfg.devices ? total_rate * (100 - sim_cfg.host_share_pct) / 100.0 / sim_cfg.devices : 0;
+
+    for (uint8_t i = 0; i < sim_cfg.devices; i++) {
+        devices[i].addr = SIM_DEVICE_ADDR_BASE + i;
+        devices[i].next_gen_us = sim_exp_us(device_rate);
+    }
+    hal_native_set_line_hook(line_hook);
+}
+
+double sim_host_rate(void) {
+    return sim_total_rate() * sim_cfg.host_share_pct / 100.0;
+}
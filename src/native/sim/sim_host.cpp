@@ -0,0 +1,196 @@
+#include "native/sim/sim.h"
+#include "native/hal_native.h"
+#include "config.h"
+#include "tpuart/tpuart.h"
+#include "knx_frame.h"
+#include <string.h>
+
+#define HOST_UART_BYTE_US (11 * 1000000 / UART_BAUD_RATE)  // 8E1 = 11 bit / byte
+#define HOST_USB_FRAME_US 1000                              // USB full-speed: 1 packet OUT mỗi frame
+#define HOST_OUTSTANDING_MAX 256
+#define HOST_TX_BUF 4096
+
+// Frame đã gửi xuống gateway, chờ L_DATA_CON theo thứ tự
+typedef struct {
+    uint8_t frame[SIM_MAX_FRAME];
+    uint8_t len;
+    uint8_t tries;
+    uint64_t request_us;
+} host_req_t;
+
+static host_req_t outstanding[HOST_OUTSTANDING_MAX];
+static uint16_t out_head = 0, out_count = 0;
+
+// Host → gateway: UART 19200 8E1 (1 byte mỗi HOST_UART_BYTE_US) hoặc USB CDC (1 packet mỗi HOST_USB_FRAME_US)
+static uint8_t tx_buf[HOST_TX_BUF];
+static uint16_t tx_head = 0, tx_count = 0;
+static uint64_t uart_free_us = 0;   // Đơn vị (byte / packet) đầu buffer bắt đầu truyền lúc này
+static uint32_t link_step_us = HOST_UART_BYTE_US;
+static uint16_t link_chunk = 1;
+
+static uint64_t next_req_us = 0;
+static double req_rate = 0;
+
+// Gateway → host (byte mode): byte của frame trên bus hoặc service (L_DATA_CON...)
+static uint8_t ind_frame[SIM_MAX_FRAME];
+static uint8_t ind_idx = 0;
+static uint8_t ind_len = 0;
+static bool ind_active = false;
+
+static void host_pump(void);
+
+// Hẹn alarm tới byte / packet kế tiếp hoặc request kế tiếp (cái nào sớm hơn)
+static void host_schedule(void) {
+    uint64_t now = hal_native_now_us();
+    uint64_t at = next_req_us;
+    if (tx_count && uart_free_us + link_step_us < at) {
+        at = uart_free_us + link_step_us;
+    }
+    uint64_t delay = at > now ? at - now : 0;
+    hal_native_alarm_set(HAL_NATIVE_ALARM_USER, delay > UINT32_MAX ? UINT32_MAX : (uint32_t)delay, host_pump);
+}
+
+static void host_put(uint8_t b) {
+    if (tx_count == 0 && uart_free_us < hal_native_now_us()) {
+        uart_free_us = hal_native_now_us();
+    }
+    if (tx_count < HOST_TX_BUF) {
+        tx_buf[(tx_head + tx_count) % HOST_TX_BUF] = b;
+        tx_count++;
+    }
+}
+
+// U_L_DATA_START, U_L_DATA_CONT|i trước byte i, U_L_DATA_END|i trước checksum
+static void host_write_frame(const uint8_t *frame, uint8_t len) {
+    for (uint8_t i = 0; i < len; i++) {
+        if (i == 0) {
+            host_put(U_L_DATA_START_REQ);
+        } else if (i == len - 1) {
+            host_put(U_L_DATA_END_REQ | i);
+        } else {
+            host_put(U_L_DATA_CONT_REQ | i);
+        }
+        host_put(frame[i]);
+    }
+    sim_stats.host_sent++;
+}
+
+static void host_submit(const host_req_t *r) {
+    if (out_count >= HOST_OUTSTANDING_MAX) {
+        sim_stats.host_failed++;
+        return;
+    }
+    outstanding[(out_head + out_count) % HOST_OUTSTANDING_MAX] = *r;
+    out_count++;
+    host_write_frame(r->frame, r->len);
+}
+
+static void host_on_confirm(bool success) {
+    if (out_count == 0) {
+        sim_stats.host_parse_errors++;
+        return;
+    }
+    host_req_t r = outstanding[out_head];
+    out_head = (out_head + 1) % HOST_OUTSTANDING_MAX;
+    out_count--;
+
+    if (success) {
+        sim_stats.host_ok++;
+        if (sim_stats.latency_count < SIM_LATENCY_MAX_SAMPLES) {
+            sim_stats.latency_us[sim_stats.latency_count++] = (uint32_t)(hal_native_now_us() - r.request_us);
+        }
+    } else if (r.tries < sim_cfg.host_retries) {
+        // Giống TP-UART tự lặp: gửi lại với repeat flag = 0
+        r.tries++;
+        sim_stats.host_repeats++;
+        sim_frame_set_repeat(r.frame, r.len);
+        host_submit(&r);
+    } else {
+        sim_stats.host_failed++;
+    }
+}
+
+static void host_on_byte(uint8_t b) {
+    sim_stats.host_rx_bytes++;
+    if (ind_active) {
+        ind_frame[ind_idx++] = b;
+        if (ind_idx == knx_frame_dest_offset(false) + 2) {
+            uint16_t dest = knx_frame_view_t(ind_frame, ind_idx).destination();
+            if (dest == SIM_GATEWAY_ADDR) {
+                // Frame gửi tới mình: yêu cầu gateway trả ACK trên bus
+                host_put(U_ACK_REQ | U_ACK_REQ_ADRESSED);
+                sim_stats.host_acks++;
+            }
+        }
+        if (ind_idx == knx_frame_len_offset(false) + 1) {
+            ind_len = (uint8_t)knx_frame_total_len(false, b);
+        }
+        if ((ind_len && ind_idx >= ind_len) || ind_idx >= SIM_MAX_FRAME) {
+            ind_active = false;
+        }
+        return;
+    }
+    if ((b & L_DATA_MASK) == L_DATA_STANDARD_IND) {
+        ind_active = true;
+        ind_idx = 0;
+        ind_len = 0;
+        ind_frame[ind_idx++] = b;
+    } else if ((b & L_DATA_CON_MASK) == L_DATA_CON) {
+        host_on_confirm((b & SUCCESS) != 0);
+    } else {
+        sim_stats.host_parse_errors++;
+    }
+}
+
+// Alarm (trong thời gian ảo): sinh request tới hạn, đẩy byte qua host link với tốc độ thật
+static void host_pump(void) {
+    uint64_t now = hal_native_now_us();
+
+    while (now >= next_req_us) {
+        host_req_t r;
+        uint16_t dest = SIM_DEVICE_ADDR_BASE + (sim_cfg.devices ? sim_rand_range(sim_cfg.devices) : 0);
+        r.len = sim_build_frame(r.frame, SIM_GATEWAY_ADDR, dest, 1 + sim_rand_range(4));
+        r.tries = 0;
+        r.request_us = next_req_us;
+        sim_stats.host_requests++;
+        host_submit(&r);
+        next_req_us += sim_exp_us(req_rate);
+    }
+
+    while (tx_count && uart_free_us + link_step_us <= now) {
+        uart_free_us += link_step_us;
+        for (uint16_t i = 0; i < link_chunk && tx_count; i++) {
+            hal_native_host_inject(&tx_buf[tx_head], 1);
+            tx_head = (tx_head + 1) % HOST_TX_BUF;
+            tx_count--;
+        }
+    }
+    host_schedule();
+}
+
+void sim_host_init(void) {
+    out_head = out_count = 0;
+    tx_head = tx_count = 0;
+    uart_free_us = 0;
+    link_step_us = sim_cfg.host_cdc ? HOST_USB_FRAME_US : HOST_UART_BYTE_US;
+    link_chunk = sim_cfg.host_cdc ? HOST_CDC_PACKET_SIZE : 1;
+    ind_active = false;
+    req_rate = sim_host_rate();
+    next_req_us = sim_exp_us(req_rate);
+    host_schedule();
+}
+
+void sim_host_service(void) {
+    uint8_t in[64];
+    uint16_t n;
+    while ((n = hal_native_host_take(in, sizeof(in))) > 0) {
+        for (uint16_t i = 0; i < n; i++) {
+            host_on_byte(in[i]);
+        }
+    }
+    host_schedule();
+}
+
+void sim_host_finish(void) {
+    sim_stats.host_pending = out_count;
+}
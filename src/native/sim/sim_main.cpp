@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "native/sim/sim.h"
+#include "native/hal_native.h"
+#include "config.h"
+#include "event_loop.h"
+#include "gateway.h"
+#include "knx_rx.h"
+#include "knx_tx.h"
+#include "logger.h"
+#include "metrics.h"
+#include "trace.h"
+#include "capture.h"
+#include "tpuart/rx_dedup.h"
+
+/*
+ * env:native_sim - chạy firmware gateway giữa nhiều device trên 1 đường TP1 giả lập
+ *
+ *   .pio/build/native_sim/program [--load 10,30,50,70,90] [--devices 8] [--duration 20000]
+ *                                 [--host-share 20] [--retries 3] [--seed 1] [--ack-loss 0] [--dedup] [--cdc]
+ *                                 [--idle-rule] [-v] [--capture file]
+ *
+ * --capture: ghi traffic của gateway (capture.h) ra file để replay bằng env:native_replay (chỉ 1 mức tải).
+ *
+ * Mỗi mức tải chạy trong 1 process con (firmware dùng biến static → bắt đầu lại từ trạng thái sạch).
+ */
+
+#define SIM_MAX_LOADS 16
+
+static const uint32_t latency_buckets_ms[] = {5, 10, 20, 50, 100, 200, 500};
+#define LATENCY_BUCKETS (sizeof(latency_buckets_ms) / sizeof(latency_buckets_ms[0]))
+
+// Giống handle_knx_frame() của target (main.cpp)
+static void on_bus_byte(const uint8_t byte) {
+    gateway_bus_byte_isr(byte);
+}
+
+static void on_bus_idle(void) {
+    event_post(EVT_BUS_IDLE);
+}
+
+static int cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static double pct_ms(uint32_t p) {
+    if (sim_stats.latency_count == 0) {
+        return 0;
+    }
+    uint32_t idx = (uint32_t)((uint64_t)(sim_stats.latency_count - 1) * p / 100);
+    return sim_stats.latency_us[idx] / 1000.0;
+}
+
+static void sim_report(void) {
+    double secs = sim_cfg.duration_ms / 1000.0;
+    uint32_t done = sim_stats.host_ok + sim_stats.host_failed;
+    qsort(sim_stats.latency_us, sim_stats.latency_count, sizeof(uint32_t), cmp_u32);
+    // Bus rảnh ngắn nhất trước frame gateway, theo bit time (-1: gateway chưa gửi frame nào)
+    double gap_bits = sim_stats.gw_min_gap_us == UINT32_MAX ? -1.0 : (double)sim_stats.gw_min_gap_us / KNX_BIT_PERIOD_US;
+
+    printf("%4u%% %5.1f%% | %5u %5u %4u %4u %6.1f%% %5u %5u %5.1f | %5u %6.1f%% %5u %5u | %6.1f %6.1f | %6.1f %6.1f %6.1f %7.1f\n",
+           sim_cfg.load_pct, 100.0 * sim_stats.line_busy_us / (sim_cfg.duration_ms * 1000.0),
+           sim_stats.host_requests, sim_stats.host_ok, sim_stats.host_failed, sim_stats.host_pending,
+           done ? 100.0 * sim_stats.host_ok / done : 0.0, sim_stats.gw_arbitration_lost, sim_stats.host_repeats, gap_bits,
+           sim_stats.dev_frames, sim_stats.dev_ok + sim_stats.dev_failed ? 100.0 * sim_stats.dev_ok / (sim_stats.dev_ok + sim_stats.dev_failed) : 0.0,
+           sim_stats.dev_arbitration_lost, sim_stats.dev_repeats,
+           sim_stats.line_frames / secs, sim_stats.host_ok / secs,
+           pct_ms(50), pct_ms(90), pct_ms(99), pct_ms(100));
+}
+
+static void sim_report_detail(void) {
+    printf("      latency (ms):");
+    uint32_t k = 0;
+    for (uint32_t b = 0; b <= LATENCY_BUCKETS; b++) {
+        uint32_t n = 0;
+        while (k < sim_stats.latency_count &&
+               (b == LATENCY_BUCKETS || sim_stats.latency_us[k] < latency_buckets_ms[b] * 1000)) {
+            n++;
+            k++;
+        }
+        if (b < LATENCY_BUCKETS) {
+            printf(" <%u:%u", latency_buckets_ms[b], n);
+        } else {
+            printf(" >=%u:%u", latency_buckets_ms[b - 1], n);
+        }
+    }
+    printf("\n      firmware: echo_ok=%u echo_neg=%u echo_timeout=%u echo_mismatch=%u echo_lost=%u "
+           "tx_bus_busy=%u tx_collisions=%u ack_sent=%u ack_missed=%u | line bad=%u host_acks=%u parse_err=%u\n"
+           "      host link: %s, %u byte(s) to host in %u write(s), rx repeats=%u dropped=%u re-acked=%u\n",
+           metric_get(METRIC_ECHO_CONFIRMED), metric_get(METRIC_ECHO_NEGATIVE), metric_get(METRIC_ECHO_TIMEOUTS),
+           metric_get(METRIC_ECHO_MISMATCH), metric_get(METRIC_ECHO_LOST), metric_get(METRIC_TX_BUS_BUSY),
+           metric_get(METRIC_TX_COLLISIONS), metric_get(METRIC_ACK_SENT), metric_get(METRIC_ACK_MISSED),
+           sim_stats.line_frames_bad, sim_stats.host_acks, sim_stats.host_parse_errors,
+           hal_host_transport_name(), sim_stats.host_rx_bytes, hal_native_host_writes(), metric_get(METRIC_RX_REPEATS), metric_get(METRIC_RX_REPEATS_DROPPED),
+           metric_get(METRIC_RX_REPEAT_ACKS));
+}
+
+static FILE *capture_file = nullptr;
+
+static void capture_write(const uint8_t *data, uint16_t len) {
+    fwrite(data, 1, len, capture_file);
+}
+
+static void sim_run(bool verbose) {
+    hal_host_select(sim_cfg.host_cdc ? HAL_HOST_CDC : HAL_HOST_USART);
+    hal_native_reset();
+    memset(&sim_stats, 0, sizeof(sim_stats));
+
+    metrics_init();
+    logger_init();
+    trace_init();
+    knx_rx_init(KNX_LINE_MAIN, on_bus_byte, on_bus_idle);
+    knx_tx_init(KNX_LINE_MAIN);
+    event_loop_init();
+    rx_dedup_enable(sim_cfg.rx_dedup);
+    if (sim_cfg.gw_idle_rule) {
+        gateway_set_tx_idle_bits(SIM_IDLE_BITS);
+    }
+    sim_bus_init();
+    sim_host_init();
+    if (capture_file) {
+        hal_native_set_debug_sink(capture_write);
+        capture_init();
+    }
+
+    uint64_t end_us = (uint64_t)sim_cfg.duration_ms * 1000;
+    while (hal_native_now_us() < end_us) {
+        gateway_dispatch(event_wait());
+        sim_host_service();
+        capture_drain();
+    }
+    sim_host_finish();
+    if (capture_file) {
+        capture_flush();
+        fclose(capture_file);
+    }
+
+    sim_report();
+    if (verbose) {
+        sim_report_detail();
+    }
+}
+
+static uint8_t parse_loads(const char *arg, uint8_t *loads) {
+    uint8_t n = 0;
+    char buf[128];
+    strncpy(buf, arg, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = 0;
+    for (char *tok = strtok(buf, ","); tok && n < SIM_MAX_LOADS; tok = strtok(nullptr, ",")) {
+        int v = atoi(tok);
+        if (v > 0 && v < 100) {
+            loads[n++] = (uint8_t)v;
+        }
+    }
+    return n;
+}
+
+int main(int argc, char **argv) {
+    uint8_t loads[SIM_MAX_LOADS] = {10, 30, 50, 70, 90};
+    uint8_t load_count = 5;
+    bool verbose = false;
+
+    sim_cfg.devices = 8;
+    sim_cfg.host_share_pct = 20;
+    sim_cfg.host_retries = SIM_REPEAT_MAX;
+    sim_cfg.duration_ms = 20000;
+    sim_cfg.seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        const char *v = i + 1 < argc ? argv[i + 1] : "";
+        if (!strcmp(a, "--load")) {
+            load_count = parse_loads(v, loads);
+            i++;
+        } else if (!strcmp(a, "--devices")) {
+            int d = atoi(v);
+            sim_cfg.devices = d < 1 ? 1 : d > SIM_MAX_DEVICES ? SIM_MAX_DEVICES : d;
+            i++;
+        } else if (!strcmp(a, "--duration")) {
+            sim_cfg.duration_ms = (uint32_t)atoi(v);
+            i++;
+        } else if (!strcmp(a, "--host-share")) {
+            int h = atoi(v);
+            sim_cfg.host_share_pct = h < 0 ? 0 : h > 100 ? 100 : h;
+            i++;
+        } else if (!strcmp(a, "--retries")) {
+            sim_cfg.host_retries = (uint8_t)atoi(v);
+            i++;
+        } else if (!strcmp(a, "--seed")) {
+            sim_cfg.seed = (uint32_t)strtoul(v, nullptr, 0);
+            i++;
+        } else if (!strcmp(a, "--ack-loss")) {
+            int p = atoi(v);
+            sim_cfg.ack_loss_pct = p < 0 ? 0 : p > 100 ? 100 : p;
+            i++;
+        } else if (!strcmp(a, "--dedup")) {
+            sim_cfg.rx_dedup = true;
+        } else if (!strcmp(a, "--cdc")) {
+            sim_cfg.host_cdc = true;
+        } else if (!strcmp(a, "--idle-rule")) {
+            sim_cfg.gw_idle_rule = true;
+        } else if (!strcmp(a, "-v")) {
+            verbose = true;
+        } else if (!strcmp(a, "--capture")) {
+            capture_file = fopen(v, "wb");
+            if (!capture_file) {
+                perror(v);
+                return 2;
+            }
+            i++;
+        } else {
+            fprintf(stderr, "usage: %s [--load 10,30,50,70,90] [--devices N] [--duration ms] "
+                            "[--host-share %%] [--retries N] [--seed N] [--ack-loss %%] [--dedup] [--cdc] [--idle-rule] [-v] "
+                            "[--capture file]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (capture_file && load_count != 1) {
+        fprintf(stderr, "--capture needs exactly one --load point\n");
+        return 2;
+    }
+
+    printf("KNX TP1 sim: %u device(s), host %u%% of load, %u host retries, %.1f s/point, seed %u, ack loss %u%%%s%s%s\n",
+           sim_cfg.devices, sim_cfg.host_share_pct, sim_cfg.host_retries, sim_cfg.duration_ms / 1000.0, sim_cfg.seed,
+           sim_cfg.ack_loss_pct, sim_cfg.rx_dedup ? ", rx repeat suppression" : "", sim_cfg.host_cdc ? ", host link USB CDC" : "",
+           sim_cfg.gw_idle_rule ? ", gateway idle rule" : "");
+    printf("load  busy  | ------------------- gateway (host) ------------------- | ------ devices ------- | -- frame/s -- | ----- latency ms ------------\n");
+    printf("            |   req    ok fail pend  succ%%  arbL   rep   gap |  sent  succ%%  arbL   rep |    bus     gw |    p50    p90    p99     max\n");
+    fflush(stdout);
+
+    for (uint8_t i = 0; i < load_count; i++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            return 1;
+        }
+        if (pid == 0) {
+            sim_cfg.load_pct = loads[i];
+            sim_run(verbose);
+            fflush(stdout);
+            _exit(0);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            fprintf(stderr, "load %u%%: simulation failed\n", loads[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
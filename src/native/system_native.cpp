@@ -0,0 +1,22 @@
+#include "system_utils.h"
+#include "recovery.h"
+#include "config.h"
+#include "logger.h"
+#include "tpuart/tpuart.h"
+
+/*
+ * Phần của system_utils / recovery mà gateway.cpp gọi tới, bản env:native:
+ * không có watchdog, NVIC, UART để khởi động lại → supervisor không làm gì.
+ */
+
+bool system_health_check(void) {
+    if (queue_bytes_used() > KNX_TX_QUEUE_BYTES * 0.8) {
+        LOG_WARN(LOG_CAT_SYSTEM, "Queue nearly full");
+        return false;
+    }
+    return true;
+}
+
+void recovery_service(uint32_t now_ms) {
+    (void)now_ms;
+}
@@ -0,0 +1,287 @@
+#include "profiler.h"
+
+#if KNX_PROFILER_ENABLE
+
+#include "logger.h"
+#include "hal/hal.h"
+#include "tpuart/host_diag.h"
+
+static prof_stats_t prof_stats[PROF_SLOT_COUNT];
+static prof_phase_t prof_phase;
+static uint32_t cycles_per_us = 72;
+
+static const char *const prof_slot_names[PROF_SLOT_COUNT] = {
+    "rx_parse", "ack", "host_uart", "tx", "health",
+    "isr_exti", "isr_bit_tmr", "isr_dma_tx", "isr_usart1", "isr_usart3",
+    "lat_tim2", "lat_exti", "lat_dma_tx",
+};
+
+// =================== USART ISR wrapper ===================
+// USART1/USART3_IRQHandler nằm trong Arduino core → copy vector table ra RAM
+// và thay 2 entry bằng wrapper có đo thời gian.
+#define PROF_VECTOR_COUNT (16 + 68)  // Đủ cho dòng F1 nhiều IRQ nhất
+typedef void (*prof_isr_fn_t)(void);
+
+static uint32_t prof_vectors[PROF_VECTOR_COUNT] __attribute__((aligned(512)));
+static prof_isr_fn_t usart_host_isr = nullptr;
+static prof_isr_fn_t usart_debug_isr = nullptr;
+
+static void usart_host_isr_profiled(void) {
+    PROF_SCOPE(PROF_ISR_USART_HOST);
+    usart_host_isr();
+}
+
+static void usart_debug_isr_profiled(void) {
+    PROF_SCOPE(PROF_ISR_USART_DEBUG);
+    usart_debug_isr();
+}
+
+static void profiler_hook_vectors(void) {
+    const uint32_t *flash_vectors = (const uint32_t *)(uintptr_t)SCB->VTOR;
+    for (uint16_t i = 0; i < PROF_VECTOR_COUNT; i++) {
+        prof_vectors[i] = flash_vectors[i];
+    }
+    usart_host_isr = (prof_isr_fn_t)(uintptr_t)prof_vectors[16 + USART1_IRQn];
+    usart_debug_isr = (prof_isr_fn_t)(uintptr_t)prof_vectors[16 + USART3_IRQn];
+    prof_vectors[16 + USART1_IRQn] = (uint32_t)(uintptr_t)usart_host_isr_profiled;
+    prof_vectors[16 + USART3_IRQn] = (uint32_t)(uintptr_t)usart_debug_isr_profiled;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    SCB->VTOR = (uint32_t)(uintptr_t)prof_vectors;
+    __DSB();
+    __set_PRIMASK(primask);
+}
+
+// =================== Timestamp sườn EXTI ===================
+// EXTI không có timestamp phần cứng → TIM4 CH1 (TI1 = PB6) capture cùng sườn. TIM4 là tick 1ms của
+// event_loop: chỉ dùng CH1, giữ nguyên PSC / ARR của tick và quy đổi theo chúng khi đọc.
+// F1 không capture được cả 2 sườn: mỗi lần vào EXTI đổi cực theo mức hiện tại cho sườn kế tiếp.
+static void profiler_edge_capture_init(void) {
+    __HAL_RCC_TIM4_CLK_ENABLE();
+    TIM4->CCER &= ~(TIM_CCER_CC1E | TIM_CCER_CC1P);
+    TIM4->CCMR1 = (TIM4->CCMR1 & ~0xFFu) | TIM_CCMR1_CC1S_0;  // IC1 trên TI1, không lọc, không chia
+    TIM4->CCER |= TIM_CCER_CC1E;                              // Sườn lên trước, sửa lại ở lần EXTI đầu
+    TIM4->SR = ~(TIM_SR_CC1IF | TIM_SR_CC1OF);
+}
+
+int32_t profiler_exti_latency(void) {
+    uint16_t cnt = TIM4->CNT;
+    uint32_t sr = TIM4->SR;
+    uint16_t captured = TIM4->CCR1;  // Đọc CCR1 xoá CC1IF
+    int32_t us = -1;
+    if ((sr & TIM_SR_CC1IF) && !(sr & TIM_SR_CC1OF)) {
+        // APB1 timer clock = SystemCoreClock (APB1 chia 2 → x2): 1 count = PSC + 1 cycle
+        uint32_t period = TIM4->ARR + 1;
+        uint32_t ticks = (cnt + period - captured) % period;
+        uint32_t cycles = ticks * (TIM4->PSC + 1);
+        profiler_record(PROF_LAT_EXTI, cycles);
+        us = cycles / cycles_per_us;
+    }
+    TIM4->SR = ~TIM_SR_CC1OF;
+    // Mức cao → sườn kế tiếp là sườn xuống (CC1P = 1)
+    if (hal_bus_pin_level(KNX_LINE_MAIN)) {
+        TIM4->CCER |= TIM_CCER_CC1P;
+    } else {
+        TIM4->CCER &= ~TIM_CCER_CC1P;
+    }
+    return us;
+}
+
+// =================== Core ===================
+void profiler_init(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    cycles_per_us = SystemCoreClock / 1000000;
+    if (cycles_per_us == 0) {
+        cycles_per_us = 1;
+    }
+    profiler_reset();
+    profiler_hook_vectors();
+    profiler_edge_capture_init();
+}
+
+void profiler_record(uint8_t slot, uint32_t cycles) {
+    if (slot >= PROF_SLOT_COUNT) {
+        return;
+    }
+    prof_stats_t *s = &prof_stats[slot];
+    s->count++;
+    s->total_cycles += cycles;
+    if (cycles < s->min_cycles) {
+        s->min_cycles = cycles;
+    }
+    if (cycles > s->max_cycles) {
+        s->max_cycles = cycles;
+    }
+
+    uint32_t us = cycles / cycles_per_us;
+    uint8_t bucket = 0;
+    if (us > 0) {
+        bucket = 32 - __builtin_clz(us);
+        if (bucket >= PROF_HIST_BUCKETS) {
+            bucket = PROF_HIST_BUCKETS - 1;
+        }
+    }
+    if (s->hist[bucket] != 0xFFFF) {
+        s->hist[bucket]++;
+    }
+}
+
+void profiler_record_latency_us(uint8_t slot, uint32_t us) {
+    profiler_record(slot, us * cycles_per_us);
+}
+
+void profiler_sample_phase(int32_t err_us) {
+    prof_phase_t *p = &prof_phase;
+    p->count++;
+    p->total_us += err_us;
+    if (err_us < p->min_us) {
+        p->min_us = err_us;
+    }
+    if (err_us > p->max_us) {
+        p->max_us = err_us;
+    }
+
+    // floor(err / step), bucket PROF_HIST_BUCKETS / 2 bắt đầu từ 0
+    int32_t bucket = err_us >= 0 ? err_us / PROF_PHASE_STEP_US
+                                 : -((-err_us + PROF_PHASE_STEP_US - 1) / PROF_PHASE_STEP_US);
+    bucket += PROF_HIST_BUCKETS / 2;
+    if (bucket < 0) {
+        bucket = 0;
+    } else if (bucket >= PROF_HIST_BUCKETS) {
+        bucket = PROF_HIST_BUCKETS - 1;
+    }
+    if (p->hist[bucket] != 0xFFFF) {
+        p->hist[bucket]++;
+    }
+}
+
+// Copy atomic (slot của ISR có thể bị cập nhật giữa chừng)
+bool profiler_get_stats(uint8_t slot, prof_stats_t *stats) {
+    if (slot >= PROF_SLOT_COUNT || stats == nullptr) {
+        return false;
+    }
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *stats = prof_stats[slot];
+    __set_PRIMASK(primask);
+    return true;
+}
+
+bool profiler_get_phase(prof_phase_t *phase) {
+    if (phase == nullptr) {
+        return false;
+    }
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    *phase = prof_phase;
+    __set_PRIMASK(primask);
+    return true;
+}
+
+const char *profiler_slot_name(uint8_t slot) {
+    return slot < PROF_SLOT_COUNT ? prof_slot_names[slot] : "?";
+}
+
+void profiler_reset(void) {
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    for (uint8_t i = 0; i < PROF_SLOT_COUNT; i++) {
+        memset(&prof_stats[i], 0, sizeof(prof_stats[i]));
+        prof_stats[i].min_cycles = 0xFFFFFFFF;
+    }
+    memset(&prof_phase, 0, sizeof(prof_phase));
+    prof_phase.min_us = INT32_MAX;
+    prof_phase.max_us = INT32_MIN;
+    __set_PRIMASK(primask);
+}
+
+// =================== Báo cáo ===================
+static uint32_t prof_avg_cycles(const prof_stats_t *s) {
+    return s->count ? (uint32_t)(s->total_cycles / s->count) : 0;
+}
+
+void profiler_log_report(void) {
+    for (uint8_t i = 0; i < PROF_SLOT_COUNT; i++) {
+        prof_stats_t s;
+        profiler_get_stats(i, &s);
+        if (s.count == 0) {
+            continue;
+        }
+        LOG_INFO(LOG_CAT_SYSTEM, "PROF %-11s n=%lu min=%lu avg=%lu max=%lu us hist=%u/%u/%u/%u/%u/%u/%u/%u",
+                 prof_slot_names[i], s.count, s.min_cycles / cycles_per_us,
+                 prof_avg_cycles(&s) / cycles_per_us, s.max_cycles / cycles_per_us,
+                 s.hist[0], s.hist[1], s.hist[2], s.hist[3],
+                 s.hist[4], s.hist[5], s.hist[6], s.hist[7]);
+    }
+
+    prof_phase_t ph;
+    profiler_get_phase(&ph);
+    if (ph.count) {
+        LOG_INFO(LOG_CAT_SYSTEM, "PROF phase       n=%lu min=%ld avg=%ld max=%ld us hist=%u/%u/%u/%u/%u/%u/%u/%u",
+                 ph.count, ph.min_us, (int32_t)(ph.total_us / (int32_t)ph.count), ph.max_us,
+                 ph.hist[0], ph.hist[1], ph.hist[2], ph.hist[3],
+                 ph.hist[4], ph.hist[5], ph.hist[6], ph.hist[7]);
+    }
+}
+
+static uint8_t *put_u32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+    return p + 4;
+}
+
+/*
+ * Message đầu: [0xFF] [số slot] [SystemCoreClock u32]
+ * Mỗi slot:    [slot] [count] [min] [avg] [max] (u32, cycle) [hist 8 x u16]
+ * Message cuối: [0xFE] [count u32] [min] [avg] [max] (i32, µs) [hist 8 x u16]  - lệch pha lấy mẫu
+ * Tất cả little-endian. Gửi dần qua host_diag_report, mỗi slot được đọc lúc tạo message của nó.
+ */
+static bool profiler_report_next(uint16_t idx, uint8_t *payload, uint8_t *len) {
+    uint8_t *p = payload;
+    if (idx == 0) {
+        *p++ = 0xFF;
+        *p++ = PROF_SLOT_COUNT;
+        p = put_u32(p, SystemCoreClock);
+    } else if (idx <= PROF_SLOT_COUNT) {
+        uint8_t i = idx - 1;
+        prof_stats_t s;
+        profiler_get_stats(i, &s);
+        *p++ = i;
+        p = put_u32(p, s.count);
+        p = put_u32(p, s.count ? s.min_cycles : 0);
+        p = put_u32(p, prof_avg_cycles(&s));
+        p = put_u32(p, s.max_cycles);
+        for (uint8_t b = 0; b < PROF_HIST_BUCKETS; b++) {
+            *p++ = (uint8_t)s.hist[b];
+            *p++ = (uint8_t)(s.hist[b] >> 8);
+        }
+    } else if (idx == PROF_SLOT_COUNT + 1) {
+        prof_phase_t ph;
+        profiler_get_phase(&ph);
+        *p++ = 0xFE;
+        p = put_u32(p, ph.count);
+        p = put_u32(p, ph.count ? (uint32_t)ph.min_us : 0);
+        p = put_u32(p, ph.count ? (uint32_t)(int32_t)(ph.total_us / (int32_t)ph.count) : 0);
+        p = put_u32(p, ph.count ? (uint32_t)ph.max_us : 0);
+        for (uint8_t b = 0; b < PROF_HIST_BUCKETS; b++) {
+            *p++ = (uint8_t)ph.hist[b];
+            *p++ = (uint8_t)(ph.hist[b] >> 8);
+        }
+    } else {
+        return false;
+    }
+    *len = (uint8_t)(p - payload);
+    return true;
+}
+
+static const host_diag_report_t profiler_report = {DIAG_PROFILE_REPORT, profiler_report_next, nullptr};
+
+void profiler_send_report(void) {
+    host_diag_report(&profiler_report);
+}
+
+#endif // KNX_PROFILER_ENABLE
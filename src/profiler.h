@@ -0,0 +1,123 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+
+/*
+ * Profiler theo DWT cycle counter cho từng stage của loop() và các ISR
+ *
+ * Mỗi slot giữ count, min/avg/max (cycle) và histogram thô theo µs:
+ *   bucket 0: <1µs, 1: 1µs, 2: 2-3µs, 3: 4-7µs ... 7: >=64µs
+ *
+ * Thời gian của ISR bao gồm cả thời gian bị ISR priority cao hơn chen vào.
+ * USART ISR thuộc Arduino core → được bọc bằng vector table copy trong RAM.
+ *
+ * Độ trễ ngắt (slot PROF_LAT_*): từ sự kiện phần cứng tới lúc vào handler của gateway
+ * (gồm cả dispatch của core và thời gian chờ ISR khác cùng / cao priority):
+ *   - TIM2:  hal_timebase_now() - thời điểm compare đã arm (độ phân giải 1µs; bỏ qua lần arm đã quá hạn)
+ *   - EXTI:  TIM4 CH1 input capture trên chính PB6 (TIM4 = tick 1ms, counter chạy 36MHz) → CNT - CCR1
+ *   - DMA TX: TIM3 CNT lúc vào ISR so với giá trị compare đã kích DMA transfer cuối (chỉ ngắt TC, 1µs)
+ *
+ * Lệch pha lấy mẫu (profiler_sample_phase): decoder lấy mẫu ở cuối mỗi bit cell (xung bit 0 chỉ chiếm
+ * 35µs đầu cell) → với mỗi bit 0, điểm lý tưởng = sườn đầu xung (đã trừ độ trễ EXTI) + 1 bit.
+ * Lệch = lúc knx_timer_tick chạy - điểm lý tưởng; vùng an toàn khoảng -69µs (trước khi xung kết thúc)
+ * tới +35µs (xung của cell sau đã kết thúc). Histogram có dấu, mỗi bucket PROF_PHASE_STEP_US:
+ *   bucket 0: < -3 step, 1: [-3,-2) step ... 3: [-1,0), 4: [0,1) ... 7: >= 3 step
+ *
+ * Báo cáo: log định kỳ từ system_health_check() và lệnh DIAG_PROFILE_REPORT
+ * trên host link (xem tpuart/host_diag.h).
+ *
+ * KNX_PROFILER_ENABLE = 0: toàn bộ macro PROF_* rỗng, không có code/RAM nào.
+ */
+
+typedef enum {
+    // loop() stages
+    PROF_STAGE_RX_PARSE = 0,
+    PROF_STAGE_ACK,
+    PROF_STAGE_HOST_UART,
+    PROF_STAGE_TX,
+    PROF_STAGE_HEALTH,
+    // ISR
+    PROF_ISR_EXTI,          // knx_exti_irq
+    PROF_ISR_BIT_TIMER,     // knx_timer_tick
+    PROF_ISR_DMA_TX,        // DMA1_Channel2_IRQHandler
+    PROF_ISR_USART_HOST,    // USART1 (MCU_SERIAL)
+    PROF_ISR_USART_DEBUG,   // USART3 (DEBUG_SERIAL)
+    // Độ trễ từ sự kiện phần cứng tới lúc vào ISR
+    PROF_LAT_TIM2,
+    PROF_LAT_EXTI,
+    PROF_LAT_DMA_TX,
+    PROF_SLOT_COUNT
+} prof_slot_t;
+
+#define PROF_HIST_BUCKETS 8
+
+typedef struct {
+    uint32_t count;
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+    uint64_t total_cycles;
+    uint16_t hist[PROF_HIST_BUCKETS];  // Bão hoà ở 0xFFFF
+} prof_stats_t;
+
+#define PROF_PHASE_STEP_US 4
+
+typedef struct {
+    uint32_t count;
+    int32_t min_us;
+    int32_t max_us;
+    int64_t total_us;
+    uint16_t hist[PROF_HIST_BUCKETS];  // Bão hoà ở 0xFFFF
+} prof_phase_t;
+
+#if KNX_PROFILER_ENABLE
+
+void profiler_init(void);
+void profiler_record(uint8_t slot, uint32_t cycles);
+bool profiler_get_stats(uint8_t slot, prof_stats_t *stats);
+const char *profiler_slot_name(uint8_t slot);
+void profiler_reset(void);
+
+// Độ trễ ngắt theo µs (TIM2, DMA TX)
+void profiler_record_latency_us(uint8_t slot, uint32_t us);
+// Gọi đầu EXTI handler: đọc TIM4 capture của sườn vừa xảy ra, ghi PROF_LAT_EXTI
+// Trả về độ trễ (µs), hoặc -1 nếu không có capture hợp lệ (sườn bị gộp / bỏ lỡ)
+int32_t profiler_exti_latency(void);
+// Lệch pha điểm lấy mẫu của 1 bit 0 (µs, âm = sớm)
+void profiler_sample_phase(int32_t err_us);
+bool profiler_get_phase(prof_phase_t *phase);
+
+// Log toàn bộ slot (gọi từ system_health_check)
+void profiler_log_report(void);
+// Gửi toàn bộ slot + lệch pha lên host bằng U_DIAG_IND (~550 byte, gửi dần qua host_diag_report)
+void profiler_send_report(void);
+
+// Đo 1 đoạn code trong cùng scope
+#define PROF_BEGIN(slot) uint32_t _prof_start_##slot = DWT->CYCCNT
+#define PROF_END(slot)   profiler_record(slot, DWT->CYCCNT - _prof_start_##slot)
+
+// Đo tới cuối scope (dùng cho hàm có nhiều điểm return, ví dụ ISR)
+struct prof_scope {
+    uint8_t slot;
+    uint32_t start;
+    explicit prof_scope(uint8_t s) : slot(s), start(DWT->CYCCNT) {}
+    ~prof_scope() { profiler_record(slot, DWT->CYCCNT - start); }
+};
+#define PROF_SCOPE(slot) prof_scope _prof_scope(slot)
+
+#else
+
+static inline void profiler_init(void) {}
+static inline void profiler_reset(void) {}
+static inline void profiler_log_report(void) {}
+
+#define PROF_BEGIN(slot)
+#define PROF_END(slot)
+#define PROF_SCOPE(slot)
+
+#endif // KNX_PROFILER_ENABLE
+
+#endif // PROFILER_H
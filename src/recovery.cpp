@@ -0,0 +1,251 @@
+#include "recovery.h"
+#include "config.h"
+#include "knx_rx.h"
+#include "knx_tx.h"
+#include "logger.h"
+#include "system_utils.h"
+#include "crc_ccitt.h"
+#include "knx_frame.h"
+#include "trace.h"
+#include "metrics.h"
+#include "tpuart/tpuart.h"
+#include "tpuart/host_link.h"
+#include "tpuart/rx_filter.h"
+#include "hal/hal.h"
+#include "rtos_tasks.h"
+
+#define WARM_MAGIC 0x57524D31u       // "WRM1"
+
+typedef struct {
+    uint32_t magic;
+    uint8_t reason;          // recovery_reason_t ghi ngay trước khi reset
+    uint8_t detail;
+    uint8_t streak;          // Warm boot liên tiếp chưa chạy ổn định
+    uint8_t reserved;
+    uint32_t restarts;       // Tổng warm restart kể từ lần mất nguồn
+    // Snapshot cấu hình - CRC tính từ link_config tới hết filter_table[filter_count]
+    uint16_t cfg_crc;
+    uint8_t link_config;
+    uint8_t filter_enabled;
+    uint16_t filter_count;
+    uint16_t filter_table[KNX_RX_FILTER_MAX_ADDR];
+} warm_state_t;
+
+static warm_state_t warm __attribute__((section(".noinit")));
+
+static bool warm_boot = false;
+static bool queue_dropped = false;
+static recovery_reason_t boot_reason = RECOVERY_REASON_NONE;
+static uint8_t boot_detail = 0;
+static uint8_t frames_kept = 0;
+static uint32_t cfg_generation = 0;
+
+typedef struct {
+    uint32_t window_start;
+    uint8_t count;
+} recovery_window_t;
+
+static recovery_window_t windows[RECOVERY_SUB_COUNT];
+static const char *const sub_names[RECOVERY_SUB_COUNT] = {"RX decoder", "TX DMA", "host UART", "host parser"};
+static const metric_id_t sub_metrics[RECOVERY_SUB_COUNT] = {
+    METRIC_RECOVER_RX, METRIC_RECOVER_TX, METRIC_RECOVER_HOST_UART, METRIC_RECOVER_HOST_PARSER};
+// RX decoder / parser được reset hoàn toàn bằng phần mềm, lỗi lặp lại do bus / host → không warm restart
+static const bool sub_escalate[RECOVERY_SUB_COUNT] = {false, true, true, false};
+
+static uint16_t config_crc(void) {
+    return crc_ccitt(&warm.link_config, 4 + warm.filter_count * sizeof(warm.filter_table[0]));
+}
+
+static bool config_valid(void) {
+    return warm.filter_count <= KNX_RX_FILTER_MAX_ADDR && warm.cfg_crc == config_crc();
+}
+
+// Chụp cấu hình hiện tại vào .noinit (reset giữa chừng → CRC sai → dùng mặc định)
+static void config_snapshot(void) {
+    warm.cfg_crc = ~warm.cfg_crc;
+    warm.link_config = host_link_get_config();
+    warm.filter_enabled = rx_filter_is_enabled();
+    warm.filter_count = rx_filter_export(warm.filter_table, KNX_RX_FILTER_MAX_ADDR);
+    warm.cfg_crc = config_crc();
+    cfg_generation = rx_filter_generation();
+}
+
+static bool config_changed(void) {
+    return warm.link_config != host_link_get_config() ||
+           warm.filter_enabled != rx_filter_is_enabled() ||
+           cfg_generation != rx_filter_generation();
+}
+
+void recovery_early_init(void) {
+    uint32_t reset_flags = hal_reset_flags();
+    warm_boot = warm.magic == WARM_MAGIC && !(reset_flags & HAL_RESET_FLAG_POR);
+
+    if (!warm_boot) {
+        // Mất nguồn: RAM không còn ý nghĩa
+        memset(&warm, 0, sizeof(warm));
+        warm.cfg_crc = ~config_crc();
+        warm.magic = WARM_MAGIC;
+        queue_clear();
+        return;
+    }
+
+    if (warm.reason != RECOVERY_REASON_NONE) {
+        boot_reason = (recovery_reason_t)warm.reason;
+    } else if (reset_flags & HAL_RESET_FLAG_IWDG) {
+        boot_reason = RECOVERY_REASON_WATCHDOG;
+    } else {
+        boot_reason = RECOVERY_REASON_EXTERNAL;
+    }
+    boot_detail = warm.detail;
+    warm.reason = RECOVERY_REASON_NONE;
+    warm.detail = 0;
+    warm.restarts++;
+    if (warm.streak < 0xFF) {
+        warm.streak++;
+    }
+
+    if (warm.streak > RECOVERY_MAX_WARM_STREAK || !queue_validate()) {
+        queue_dropped = true;
+        queue_clear();
+    }
+    frames_kept = q_count;
+}
+
+void recovery_start(void) {
+    metric_set(METRIC_WARM_RESTARTS, warm.restarts);
+    metric_set(METRIC_WARM_FRAMES_KEPT, frames_kept);
+
+    if (warm_boot) {
+        bool cfg_ok = config_valid();
+        if (cfg_ok) {
+            host_link_configure(warm.link_config);
+            rx_filter_load(warm.filter_table, warm.filter_count);
+            rx_filter_enable(warm.filter_enabled);
+        }
+
+        // Không biết frame đang chờ echo đã lên bus chưa → gửi lại dưới dạng lặp,
+        // thiết bị đã nhận lần đầu sẽ bỏ qua (checksum đổi cùng bit với control field)
+        Frame *f = peek_frame();
+        if (f != nullptr && f->state == FRAME_SENT) {
+            if (knx_frame_mark_repeated(f->data, f->len)) {
+                frame_update_check(f);
+            }
+            f->state = FRAME_QUEUED;
+        }
+
+        TRACE(TRACE_WARM_START, boot_reason, frames_kept);
+        LOG_WARN(LOG_CAT_SYSTEM, "Warm restart #%lu (reason %d/%d, streak %d): %d frame(s) kept%s, config %s",
+                 warm.restarts, boot_reason, boot_detail, warm.streak, frames_kept,
+                 queue_dropped ? " (queue dropped)" : "", cfg_ok ? "restored" : "default");
+    }
+    config_snapshot();
+
+    hal_watchdog_start(WATCHDOG_TIMEOUT_US);
+}
+
+void recovery_feed_watchdog(void) {
+    hal_watchdog_reload();
+}
+
+void recovery_warm_restart(recovery_reason_t reason, uint8_t detail) {
+    warm.reason = reason;
+    warm.detail = detail;
+    LOG_ERROR(LOG_CAT_SYSTEM, "Warm restart (reason %d/%d) - %d frame(s) in queue", reason, detail, q_count);
+#if LOGGER_DEFERRED
+    logger_drain_blocking(); // LOG_ERROR chỉ mới vào ring
+#endif
+    hal_debug_flush();
+    NVIC_SystemReset();
+}
+
+// line: RX decoder / TX DMA của line nào (subsystem khác bỏ qua)
+static void recover(recovery_subsystem_t sub, uint8_t line, uint32_t now_ms) {
+    recovery_window_t *w = &windows[sub];
+    if (now_ms - w->window_start > RECOVERY_ESCALATE_WINDOW_MS) {
+        w->window_start = now_ms;
+        w->count = 0;
+    }
+    w->count++;
+    metric_inc(sub_metrics[sub]);
+    TRACE(TRACE_RECOVERY, sub, w->count);
+    LOG_WARN(LOG_CAT_SYSTEM, "Recovering %s line %d (%d in %d ms)", sub_names[sub], line, w->count,
+             RECOVERY_ESCALATE_WINDOW_MS);
+
+    switch (sub) {
+        case RECOVERY_SUB_RX:
+            knx_rx_recover(line);
+            break;
+        case RECOVERY_SUB_TX:
+            knx_tx_recover(line);
+            break;
+        case RECOVERY_SUB_HOST_UART:
+#if KNX_USE_FREERTOS
+            rtos_host_restart(); // Chỉ task host_link chạm transport
+#else
+            // begin() đặt lại priority mặc định của core → cấu hình lại NVIC
+            hal_host_restart();
+            MX_NVIC_Init();
+#endif
+            reset_tx_state();
+            break;
+        case RECOVERY_SUB_HOST_PARSER:
+            reset_tx_state();
+            break;
+        default:
+            break;
+    }
+
+    if (sub_escalate[sub] && w->count >= RECOVERY_ESCALATE_COUNT) {
+        recovery_warm_restart(RECOVERY_REASON_ESCALATED, sub);
+    }
+}
+
+// TX buffer không giảm trong RECOVERY_HOST_TX_STALL_MS, hoặc RX interrupt bị tắt sau lỗi UART
+static bool host_uart_stalled(uint32_t now_ms) {
+    static int last_free = -1;
+    static uint32_t tx_progress_ms = 0;
+    static uint32_t rx_ok_ms = 0;
+
+    int free_space = hal_host_write_space();
+    if (free_space != last_free || free_space >= hal_host_write_capacity()) {
+        last_free = free_space;
+        tx_progress_ms = now_ms;
+    }
+    if (hal_host_rx_enabled()) {
+        rx_ok_ms = now_ms;
+    }
+
+    if (now_ms - tx_progress_ms > RECOVERY_HOST_TX_STALL_MS || now_ms - rx_ok_ms > 2) {
+        last_free = -1;
+        tx_progress_ms = now_ms;
+        rx_ok_ms = now_ms;
+        return true;
+    }
+    return false;
+}
+
+void recovery_service(uint32_t now_ms) {
+    recovery_feed_watchdog();
+
+    for (uint8_t line = 0; line < KNX_LINE_COUNT; line++) {
+        if (knx_rx_stalled(line)) {
+            recover(RECOVERY_SUB_RX, line, now_ms);
+        }
+        if (knx_tx_stalled(line, now_ms)) {
+            recover(RECOVERY_SUB_TX, line, now_ms);
+        }
+    }
+    if (host_uart_stalled(now_ms)) {
+        recover(RECOVERY_SUB_HOST_UART, KNX_LINE_MAIN, now_ms);
+    }
+    if (is_tx_frame_stalled(now_ms)) {
+        recover(RECOVERY_SUB_HOST_PARSER, KNX_LINE_MAIN, now_ms);
+    }
+
+    if (config_changed()) {
+        config_snapshot();
+    }
+    if (warm.streak && now_ms >= RECOVERY_STABLE_MS) {
+        warm.streak = 0;
+    }
+}
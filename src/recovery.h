@@ -0,0 +1,56 @@
+#ifndef RECOVERY_H
+#define RECOVERY_H
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Supervisor + warm restart
+ *
+ * recovery_service() chạy mỗi tick (1ms), kiểm tra rẻ từng subsystem và khởi động lại tại chỗ:
+ * - RX:          decoder kẹt giữa byte (RX_flag bật, không có sườn > RECOVERY_RX_STALL_MS) → reset bit state, huỷ compare lấy mẫu
+ * - TX:          DMA/TIM3 không về READY sau RECOVERY_TX_STALL_MS → stop + init lại (frame chờ echo sẽ timeout)
+ * - Host UART:   TX buffer không giảm / RX interrupt bị tắt sau lỗi → hal_host_restart() (end() + begin() transport)
+ * - Host parser: frame dở dang không có byte mới > RECOVERY_PARSER_STALL_MS → reset_tx_state()
+ * RX / TX được kiểm tra cho từng line (coupler: line 1 có decoder / DMA riêng).
+ * TX / host UART bị recover RECOVERY_ESCALATE_COUNT lần trong RECOVERY_ESCALATE_WINDOW_MS → warm restart.
+ * IWatchdog (WATCHDOG_TIMEOUT_US) được reload từ recovery_service → treo main loop cũng thành warm restart.
+ *
+ * Warm restart: queue TX (tpuart.cpp) và snapshot cấu hình (host link framing, RX filter)
+ * nằm trong .noinit. Lúc khởi động (mọi reset trừ mất nguồn):
+ * - Queue được giữ nếu index / độ dài / trạng thái / CRC từng frame hợp lệ, ngược lại xoá
+ * - Frame đang chờ echo lúc reset được gửi lại dưới dạng lặp (repeat flag = 0)
+ * - Cấu hình được nạp lại nếu CRC snapshot đúng
+ * - Quá RECOVERY_MAX_WARM_STREAK warm restart liên tiếp mà chưa chạy ổn định RECOVERY_STABLE_MS
+ *   → bỏ queue (có thể chính frame trong queue gây treo)
+ */
+
+typedef enum {
+    RECOVERY_SUB_RX = 0,
+    RECOVERY_SUB_TX,
+    RECOVERY_SUB_HOST_UART,
+    RECOVERY_SUB_HOST_PARSER,
+    RECOVERY_SUB_COUNT
+} recovery_subsystem_t;
+
+typedef enum {
+    RECOVERY_REASON_NONE = 0,       // Cold boot
+    RECOVERY_REASON_ESCALATED,      // detail = recovery_subsystem_t
+    RECOVERY_REASON_ERROR_HANDLER,  // detail = error_count
+    RECOVERY_REASON_WATCHDOG,
+    RECOVERY_REASON_EXTERNAL,       // NRST / software reset không qua recovery_warm_restart
+} recovery_reason_t;
+
+// Gọi đầu tiên trong setup(): quyết định cold / warm, kiểm tra hoặc xoá queue (chưa log được)
+void recovery_early_init(void);
+// Sau system_init + logger + trace: nạp lại cấu hình, báo cáo, bật watchdog
+void recovery_start(void);
+// Mỗi tick từ main loop / task tx_sched
+void recovery_service(uint32_t now_ms);
+
+void recovery_feed_watchdog(void);
+// Lưu nguyên nhân rồi reset (queue + cấu hình giữ lại)
+void recovery_warm_restart(recovery_reason_t reason, uint8_t detail);
+
+#endif // RECOVERY_H
@@ -0,0 +1,295 @@
+#include "rtos_tasks.h"
+
+#if KNX_USE_FREERTOS
+
+#include <STM32FreeRTOS.h>
+#include "event_loop.h"
+#include "gateway.h"
+#include "knx_rx.h"
+#include "metrics.h"
+#include "logger.h"
+#include "capture.h"
+#include "system_utils.h"
+#include "hal/hal.h"
+
+// Stack (word) - logger dùng buffer 256/512 byte trên stack
+#define RX_TASK_STACK      384
+#define TX_TASK_STACK      384
+#define HOST_TASK_STACK    384
+#define LOG_TASK_STACK     256
+
+#define RX_QUEUE_LEN       32
+#define LOG_QUEUE_LEN      8
+#define LOG_LINE_MAX       128
+#define HOST_TX_STREAM     512   // Byte chờ ghi lên host (frame / dịch vụ / U_DIAG_IND)
+#define HOST_TX_CHUNK      64    // Byte mỗi lần task host_link lấy ra ghi xuống transport
+
+#define STATS_PERIOD_MS    10000
+
+static QueueHandle_t rx_byte_queue = nullptr;
+static QueueHandle_t log_queue = nullptr;
+static StreamBufferHandle_t host_tx_stream = nullptr;
+static SemaphoreHandle_t gateway_mutex = nullptr;
+static TaskHandle_t task_handles[RTOS_TASK_COUNT];
+static const char *const task_names[RTOS_TASK_COUNT] = {"bus_rx", "tx_sched", "host_link", "log"};
+
+// CPU time theo run-time stats của kernel (chỉ tính lúc task thực sự chạy, không tính lúc bị preempt)
+static uint32_t task_cpu_permille[RTOS_TASK_COUNT];
+static uint32_t log_dropped = 0;
+
+// Host TX: mọi task ghi vào host_tx_stream (dưới gateway_lock), chỉ task host_link chạm transport
+static volatile uint32_t host_tx_flush_seq = 0;  // Tăng mỗi lần host_link yêu cầu flush
+static uint32_t host_tx_flushed_seq = 0;
+static volatile bool host_restart_pending = false;
+
+// portGET_RUN_TIME_COUNTER_VALUE() (include/STM32FreeRTOSConfig_extra.h): bus timebase 1MHz
+extern "C" uint32_t rtos_run_time_counter(void) {
+    return hal_timebase_now();
+}
+
+static void gateway_lock(void) {
+    xSemaphoreTake(gateway_mutex, portMAX_DELAY);
+}
+
+static void gateway_unlock(void) {
+    xSemaphoreGive(gateway_mutex);
+}
+
+// ========== bus_rx: xử lý byte từ bus ==========
+static void bus_rx_task(void *arg) {
+    (void)arg;
+    for (;;) {
+        uint16_t item;
+        xQueueReceive(rx_byte_queue, &item, portMAX_DELAY);
+        gateway_lock();
+        gateway_on_bus_byte((uint8_t)item, (item & 0x100) != 0);
+        gateway_unlock();
+        // Checksum vừa nhận có thể mở ACK window
+        event_post(EVT_RX_BYTE);
+    }
+}
+
+// ========== tx_sched: ACK timing, gửi frame, timeout ==========
+static void tx_sched_task(void *arg) {
+    (void)arg;
+    event_reset_latency(); // Bỏ event post trước khi scheduler chạy (không có ai nhận notification)
+    for (;;) {
+        uint32_t events = 0;
+        xTaskNotifyWait(0, 0xFFFFFFFF, &events, pdMS_TO_TICKS(1));
+        event_taken(events);
+        gateway_lock();
+        gateway_service_bus_gap();
+        gateway_service_recovery();
+        gateway_service_ack(events & EVT_ACK_DEADLINE);
+        gateway_service_tx();
+        gateway_service_coupler();
+        gateway_service_diag();
+        gateway_unlock();
+    }
+}
+
+// ========== host_link: ghi byte chờ lên host, đọc frame từ MCU ==========
+// Ghi transport (MCU_SERIAL.write có thể chờ UART) chỉ xảy ra ở đây, không giữ gateway_lock
+static void host_link_task(void *arg) {
+    (void)arg;
+    static uint8_t chunk[HOST_TX_CHUNK];
+    for (;;) {
+        hal_host_service();
+        // Chỉ lấy từ stream phần transport nhận ngay được: byte chờ nằm lại trong stream buffer thay vì bị
+        // transport bỏ (USB CDC queue đầy). Thức dậy khi có byte cần gửi, tối đa 1 tick để poll MCU_SERIAL
+        int space = hal_host_write_space();
+        size_t n = 0;
+        if (space > 0) {
+            n = xStreamBufferReceive(host_tx_stream, chunk, space < (int)sizeof(chunk) ? space : sizeof(chunk), 1);
+        } else {
+            vTaskDelay(1);
+        }
+        if (n) {
+            hal_host_write(chunk, n);
+        }
+        // Flush (USB CDC gửi packet đang gom) khi đã ghi hết byte trước yêu cầu flush
+        uint32_t seq = host_tx_flush_seq;
+        if (seq != host_tx_flushed_seq && xStreamBufferIsEmpty(host_tx_stream)) {
+            hal_host_flush();
+            host_tx_flushed_seq = seq;
+        }
+        if (host_restart_pending) {
+            host_restart_pending = false;
+            // begin() đặt lại priority mặc định của core → cấu hình lại NVIC
+            hal_host_restart();
+            MX_NVIC_Init();
+        }
+        if (hal_host_available()) {
+            gateway_lock();
+            gateway_on_host_bytes();
+            gateway_unlock();
+            event_post(EVT_HOST_RX);
+        }
+    }
+}
+
+// Tính CPU time (‰) của từng task trong chu kỳ vừa qua (run-time counter của kernel, µs)
+static void update_task_stats(void) {
+    static uint32_t last_total = 0;
+    static uint32_t last_run[RTOS_TASK_COUNT];
+    uint32_t now = rtos_run_time_counter();
+    uint32_t total = now - last_total;
+    last_total = now;
+    if (total == 0) {
+        return;
+    }
+    for (uint8_t i = 0; i < RTOS_TASK_COUNT; i++) {
+        TaskStatus_t status;
+        vTaskGetInfo(task_handles[i], &status, pdFALSE, eRunning);
+        task_cpu_permille[i] = (uint32_t)(((uint64_t)(status.ulRunTimeCounter - last_run[i]) * 1000) / total);
+        last_run[i] = status.ulRunTimeCounter;
+    }
+}
+
+// ========== log: xuất log, health check, thống kê task ==========
+static void log_task(void *arg) {
+    (void)arg;
+    static char line[LOG_LINE_MAX];
+    TickType_t last_stats = xTaskGetTickCount();
+    for (;;) {
+#if LOGGER_DEFERRED || KNX_CAPTURE
+        // Deferred logging / capture: record nhị phân nằm trong ring, drain mỗi tick
+        TickType_t log_wait = 1;
+#else
+        TickType_t log_wait = pdMS_TO_TICKS(200);
+#endif
+        if (xQueueReceive(log_queue, line, log_wait) == pdTRUE) {
+            DEBUG_SERIAL.println(line);
+        }
+#if LOGGER_DEFERRED
+        logger_drain();
+#endif
+#if KNX_CAPTURE
+        capture_drain();
+#endif
+        gateway_service_health();
+
+        if (xTaskGetTickCount() - last_stats >= pdMS_TO_TICKS(STATS_PERIOD_MS)) {
+            last_stats = xTaskGetTickCount();
+            update_task_stats();
+            for (uint8_t i = 0; i < RTOS_TASK_COUNT; i++) {
+                rtos_task_stats_t stats;
+                rtos_get_task_stats((rtos_task_id_t)i, &stats);
+                LOG_DEBUG(LOG_CAT_SYSTEM, "Task %s: stack free %lu words, cpu %lu.%lu%%",
+                          stats.name, stats.stack_free_words,
+                          stats.cpu_permille / 10, stats.cpu_permille % 10);
+            }
+            if (log_dropped) {
+                LOG_WARN(LOG_CAT_SYSTEM, "Log dropped %lu", log_dropped);
+            }
+        }
+    }
+}
+
+void rtos_start(void) {
+    rx_byte_queue = xQueueCreate(RX_QUEUE_LEN, sizeof(uint16_t));
+    log_queue = xQueueCreate(LOG_QUEUE_LEN, LOG_LINE_MAX);
+    host_tx_stream = xStreamBufferCreate(HOST_TX_STREAM, 1);
+    gateway_mutex = xSemaphoreCreateMutex();
+
+    xTaskCreate(bus_rx_task, task_names[RTOS_TASK_BUS_RX], RX_TASK_STACK, nullptr, tskIDLE_PRIORITY + 4, &task_handles[RTOS_TASK_BUS_RX]);
+    xTaskCreate(tx_sched_task, task_names[RTOS_TASK_TX_SCHED], TX_TASK_STACK, nullptr, tskIDLE_PRIORITY + 3, &task_handles[RTOS_TASK_TX_SCHED]);
+    xTaskCreate(host_link_task, task_names[RTOS_TASK_HOST_LINK], HOST_TASK_STACK, nullptr, tskIDLE_PRIORITY + 2, &task_handles[RTOS_TASK_HOST_LINK]);
+    xTaskCreate(log_task, task_names[RTOS_TASK_LOG], LOG_TASK_STACK, nullptr, tskIDLE_PRIORITY + 1, &task_handles[RTOS_TASK_LOG]);
+
+    LOG_INFO(LOG_CAT_SYSTEM, "Starting FreeRTOS scheduler");
+    vTaskStartScheduler();
+
+    // Chỉ tới đây khi không đủ heap cho idle task
+    DEBUG_SERIAL.println("FreeRTOS scheduler failed to start");
+    for (;;) {
+    }
+}
+
+// Giống bus_rx_ring.h: bit 8 = sai parity, lấy ngay trong ISR
+void rtos_on_bus_byte_isr(uint8_t byte) {
+    BaseType_t woken = pdFALSE;
+    uint16_t item = byte | (knx_rx_take_parity_error(KNX_LINE_MAIN) ? 0x100 : 0);
+    if (xQueueSendFromISR(rx_byte_queue, &item, &woken) != pdTRUE) {
+        metric_inc(METRIC_RX_RING_OVERRUNS);
+    }
+    portYIELD_FROM_ISR(woken);
+}
+
+// Event từ ISR (ACK deadline, TX done, tick) hoặc task bus_rx / host_link → notify tx_sched
+void rtos_post_events(uint32_t events) {
+    TaskHandle_t task = task_handles[RTOS_TASK_TX_SCHED];
+    if (task == nullptr) {
+        return; // Scheduler chưa chạy
+    }
+    if (__get_IPSR() != 0) {
+        BaseType_t woken = pdFALSE;
+        xTaskNotifyFromISR(task, events, eSetBits, &woken);
+        portYIELD_FROM_ISR(woken);
+    } else {
+        xTaskNotify(task, events, eSetBits);
+    }
+}
+
+bool rtos_log_write(const char *line) {
+    if (log_queue == nullptr || xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) {
+        return false; // Trước khi chạy scheduler → caller ghi thẳng ra DEBUG_SERIAL
+    }
+    static char item[LOG_LINE_MAX];
+    // item dùng chung giữa các task → copy trong vùng scheduler bị suspend
+    vTaskSuspendAll();
+    strncpy(item, line, LOG_LINE_MAX - 1);
+    item[LOG_LINE_MAX - 1] = '\0';
+    if (xQueueSend(log_queue, item, 0) != pdTRUE) {
+        log_dropped++;
+    }
+    xTaskResumeAll();
+    return true;
+}
+
+bool rtos_host_write(const uint8_t *data, uint16_t len) {
+    if (host_tx_stream == nullptr || xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) {
+        return false; // Trước khi chạy scheduler → caller ghi thẳng ra transport
+    }
+    size_t n = xStreamBufferSend(host_tx_stream, data, len, 0);
+    if (n < len) {
+        metric_add(METRIC_HOST_TX_DROPPED, len - n);
+    }
+    return true;
+}
+
+bool rtos_host_flush(void) {
+    if (host_tx_stream == nullptr || xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) {
+        return false;
+    }
+    host_tx_flush_seq++;
+    return true;
+}
+
+int rtos_host_write_space(void) {
+    if (host_tx_stream == nullptr || xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) {
+        return hal_host_write_space();
+    }
+    return (int)xStreamBufferSpacesAvailable(host_tx_stream);
+}
+
+void rtos_host_restart(void) {
+    host_restart_pending = true;
+}
+
+void rtos_get_task_stats(rtos_task_id_t id, rtos_task_stats_t *stats) {
+    if (id >= RTOS_TASK_COUNT || stats == nullptr) {
+        return;
+    }
+    stats->name = task_names[id];
+    stats->stack_free_words = task_handles[id] ? uxTaskGetStackHighWaterMark(task_handles[id]) : 0;
+    stats->cpu_permille = task_cpu_permille[id];
+    stats->run_time_us = 0;
+    if (task_handles[id]) {
+        TaskStatus_t status;
+        vTaskGetInfo(task_handles[id], &status, pdFALSE, eRunning);
+        stats->run_time_us = status.ulRunTimeCounter;
+    }
+}
+
+#endif // KNX_USE_FREERTOS
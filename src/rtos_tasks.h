@@ -0,0 +1,64 @@
+#ifndef RTOS_TASKS_H
+#define RTOS_TASKS_H
+
+#include "config.h"
+
+#if KNX_USE_FREERTOS
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * FreeRTOS build (KNX_USE_FREERTOS = 1): mỗi khối việc chạy trong 1 task riêng
+ *
+ *   Task        Priority   Nhận dữ liệu từ
+ *   bus_rx      4 (cao)    rx_byte_queue   ← knx_rx ISR (byte đã giải mã)
+ *   tx_sched    3          task notify     ← ACK deadline / TX done / tick ISR, bus_rx, host_link
+ *   host_link   2          host_tx_stream  ← host_link.cpp (byte lên host), MCU_SERIAL (poll mỗi 1 tick)
+ *   log         1 (thấp)   log_queue       ← logger_log / logger_log_hex
+ *
+ * Trạng thái TPUART (parser, queue, ACK) dùng chung được bảo vệ bằng 1 mutex.
+ * Byte gửi lên host được đưa vào stream buffer, chỉ task host_link ghi ra transport (ngoài mutex):
+ * log chậm hoặc host I/O chậm không làm trễ việc xử lý bus.
+ * CPU time từng task lấy từ run-time stats của kernel (configGENERATE_RUN_TIME_STATS,
+ * include/STM32FreeRTOSConfig_extra.h), đếm bằng bus timebase 1MHz.
+ */
+
+typedef enum {
+    RTOS_TASK_BUS_RX = 0,
+    RTOS_TASK_TX_SCHED,
+    RTOS_TASK_HOST_LINK,
+    RTOS_TASK_LOG,
+    RTOS_TASK_COUNT
+} rtos_task_id_t;
+
+typedef struct {
+    const char *name;
+    uint32_t stack_free_words;  // Stack high-water mark (còn trống ít nhất)
+    uint32_t cpu_permille;      // CPU time trong chu kỳ đo gần nhất (‰)
+    uint32_t run_time_us;       // Tổng thời gian task đã chạy (run-time counter, wrap sau ~71 phút)
+} rtos_task_stats_t;
+
+// Tạo queue, task và chạy scheduler (không return)
+void rtos_start(void);
+
+// Gọi từ ISR / task
+void rtos_on_bus_byte_isr(uint8_t byte);
+void rtos_post_events(uint32_t events);
+
+// Logger: đưa 1 dòng log vào log_queue (không block)
+bool rtos_log_write(const char *line);
+
+// Host link: byte lên host vào host_tx_stream (không block, đầy → bỏ, đếm METRIC_HOST_TX_DROPPED);
+// false = scheduler chưa chạy → caller ghi thẳng transport
+bool rtos_host_write(const uint8_t *data, uint16_t len);
+bool rtos_host_flush(void);
+int rtos_host_write_space(void);  // Chỗ trống của host_tx_stream (trước scheduler: của transport)
+// Recovery: task host_link restart transport (không chen vào lúc đang ghi)
+void rtos_host_restart(void);
+
+void rtos_get_task_stats(rtos_task_id_t id, rtos_task_stats_t *stats);
+
+#endif // KNX_USE_FREERTOS
+
+#endif // RTOS_TASKS_H
@@ -2,48 +2,73 @@
 #include "atomic_utils.h"
 #include "knx_rx.h"
 #include "knx_tx.h"
-#include <IWatchdog.h>
 #include "logger.h"
+#include "profiler.h"
+#include "coupler.h"
+#include "tpuart/tpuart.h"
+#include "hal/hal.h"
 
 // Forward declarations
 void handle_knx_frame(const uint8_t byte);
+void handle_knx_bus_idle(void);
 
-// NVIC Priority Configuration
-void MX_NVIC_Init(void) {
-    // Ưu tiên cao hơn cho Timer (để KNX đọc không bị block)
-    HAL_NVIC_SetPriority(TIM2_IRQn, 0, 0);
-    HAL_NVIC_EnableIRQ(TIM2_IRQn);
-    // Ưu tiên cao nhất cho EXTI (để KNX đọc không bị block)
-    HAL_NVIC_SetPriority(EXTI9_5_IRQn, 0, 0);
-    HAL_NVIC_EnableIRQ(EXTI9_5_IRQn);
+// NVIC Priority Configuration (priority map trong config.h)
+typedef struct {
+    IRQn_Type irq;
+    uint8_t prio;
+} nvic_prio_entry_t;
+
+static const nvic_prio_entry_t nvic_prio_map[] = {
+    {TIM2_IRQn, KNX_NVIC_PRIO_BASE + KNX_NVIC_PRIO_TIM2},
+    {EXTI9_5_IRQn, KNX_NVIC_PRIO_BASE + KNX_NVIC_PRIO_EXTI},
+    {DMA1_Channel2_IRQn, KNX_NVIC_PRIO_BASE + KNX_NVIC_PRIO_DMA_TX},
+#if KNX_COUPLER_ENABLE
+    {DMA1_Channel3_IRQn, KNX_NVIC_PRIO_BASE + KNX_NVIC_PRIO_DMA_TX},
+#endif
+    {USART1_IRQn, KNX_NVIC_PRIO_BASE + KNX_NVIC_PRIO_USART_HOST},
+    {USART3_IRQn, KNX_NVIC_PRIO_BASE + KNX_NVIC_PRIO_USART_DEBUG},
+};
 
-    // Ưu tiên trung bình cho USART1
-    HAL_NVIC_SetPriority(USART1_IRQn, 1, 0);
-    HAL_NVIC_EnableIRQ(USART1_IRQn);
+// F103 có 4 bit priority (NVIC_PRIORITYGROUP_4: 0..15 đều là preempt)
+static_assert(KNX_NVIC_PRIO_BASE + KNX_NVIC_PRIO_TIM2 <= 15 && KNX_NVIC_PRIO_BASE + KNX_NVIC_PRIO_EXTI <= 15 &&
+              KNX_NVIC_PRIO_BASE + KNX_NVIC_PRIO_DMA_TX <= 15 && KNX_NVIC_PRIO_BASE + KNX_NVIC_PRIO_USART_HOST <= 15 &&
+              KNX_NVIC_PRIO_BASE + KNX_NVIC_PRIO_USART_DEBUG <= 15, "NVIC priority vượt quá 15");
 
-    // Ưu tiên thấp nhất cho USART2
-    HAL_NVIC_SetPriority(USART3_IRQn, 2, 0);
-    HAL_NVIC_EnableIRQ(USART3_IRQn);
+void MX_NVIC_Init(void) {
+    for (uint8_t i = 0; i < sizeof(nvic_prio_map) / sizeof(nvic_prio_map[0]); i++) {
+        HAL_NVIC_SetPriority(nvic_prio_map[i].irq, nvic_prio_map[i].prio, 0);
+        HAL_NVIC_EnableIRQ(nvic_prio_map[i].irq);
+    }
 }
 
 // System initialization function
 void system_init(void) {
     // Initialize serial ports
+#if KNX_CAPTURE
+    DEBUG_SERIAL.begin(CAPTURE_SERIAL_BAUD, SERIAL_8N1); // Chỉ chở block capture (capture.h)
+#else
     DEBUG_SERIAL.begin(19200, SERIAL_8E1);
-    MCU_SERIAL.begin(UART_BAUD_RATE, SERIAL_8E1);
+#endif
+    hal_host_begin();  // USART1 hoặc USB CDC (KNX_HOST_TRANSPORT)
     
-    // Initialize watchdog
-    //  IWatchdog.begin(WATCHDOG_TIMEOUT_US);
+    // Watchdog: bật trong recovery_start(), reload từ recovery_service()
     
     // Initialize KNX modules
-    knx_rx_init(handle_knx_frame);
-    knx_tx_init();
+    hal_timebase_init(); // TIM2 chạy tự do: lấy mẫu bit RX, ACK deadline, bus rảnh
+    knx_rx_init(KNX_LINE_MAIN, handle_knx_frame, handle_knx_bus_idle);
+    knx_tx_init(KNX_LINE_MAIN);
+#if KNX_COUPLER_ENABLE
+    // Line 1: byte đi thẳng vào coupler (ring + EVT_LINE1_RX), hết frame xác định theo độ dài
+    knx_rx_init(KNX_LINE_SUB, coupler_line1_byte_isr, nullptr);
+    knx_tx_init(KNX_LINE_SUB);
+    coupler_init();
+#endif
     
     // Initialize NVIC priorities
     MX_NVIC_Init();
     
     // System ready message
-    LOG_INFO(LOG_CAT_SYSTEM, "System initialized - KNX Gateway Ready");
+    LOG_INFO(LOG_CAT_SYSTEM, "System initialized - KNX Gateway Ready (host link: %s)", hal_host_transport_name());
 }
 
 // Error handler with logging
@@ -67,17 +92,22 @@ bool system_health_check(void) {
     if (now - last_check > 200) {
         last_check = now;
         
-        // Check if watchdog is working
-        IWatchdog.reload();
-        
         // Check memory usage (basic check)
-        if (ATOMIC_QUEUE_READ_COUNT() > KNX_MAX_QUEUE_SIZE * 0.8) {
+        if (queue_bytes_used() > KNX_TX_QUEUE_BYTES * 0.8) {
             LOG_WARN(LOG_CAT_SYSTEM, "Queue nearly full");
             return false;
         }
         
        // LOG_INFO(LOG_CAT_SYSTEM, "System health OK");
     }
+
+#if KNX_PROFILER_ENABLE
+    static uint32_t last_profile_report = 0;
+    if (now - last_profile_report >= KNX_PROFILER_REPORT_MS) {
+        last_profile_report = now;
+        profiler_log_report();
+    }
+#endif
     
     return true;
 }
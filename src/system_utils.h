@@ -7,6 +7,8 @@
 
 // Function prototypes
 void system_init(void);
+// Áp dụng priority map NVIC (TIM2 / EXTI / DMA TX / USART, xem config.h); gọi lại sau khi MCU_SERIAL.begin()
+void MX_NVIC_Init(void);
 void error_handler(const char* error_msg);
 void debug_print(const char* msg);
 bool system_health_check(void);
@@ -0,0 +1,66 @@
+#include "addr_table.h"
+#include <string.h>
+
+// Vị trí của addr trong bảng (hoặc vị trí cần chèn nếu chưa có)
+static uint16_t addr_table_lower_bound(const addr_table_t *t, uint16_t addr) {
+    uint16_t lo = 0;
+    uint16_t hi = t->count;
+    while (lo < hi) {
+        uint16_t mid = (lo + hi) >> 1;
+        if (t->addrs[mid] < addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+void addr_table_clear(addr_table_t *t) {
+    t->count = 0;
+}
+
+bool addr_table_add(addr_table_t *t, uint16_t addr) {
+    uint16_t pos = addr_table_lower_bound(t, addr);
+    if (pos < t->count && t->addrs[pos] == addr) {
+        return true;
+    }
+    if (t->count >= t->capacity) {
+        return false;
+    }
+    memmove(&t->addrs[pos + 1], &t->addrs[pos], (t->count - pos) * sizeof(t->addrs[0]));
+    t->addrs[pos] = addr;
+    t->count++;
+    return true;
+}
+
+bool addr_table_remove(addr_table_t *t, uint16_t addr) {
+    uint16_t pos = addr_table_lower_bound(t, addr);
+    if (pos >= t->count || t->addrs[pos] != addr) {
+        return false;
+    }
+    memmove(&t->addrs[pos], &t->addrs[pos + 1], (t->count - pos - 1) * sizeof(t->addrs[0]));
+    t->count--;
+    return true;
+}
+
+bool addr_table_contains(const addr_table_t *t, uint16_t addr) {
+    uint16_t pos = addr_table_lower_bound(t, addr);
+    return pos < t->count && t->addrs[pos] == addr;
+}
+
+uint16_t addr_table_load(addr_table_t *t, const uint16_t *addrs, uint16_t count) {
+    addr_table_clear(t);
+    for (uint16_t i = 0; addrs != nullptr && i < count; i++) {
+        if (!addr_table_add(t, addrs[i])) {
+            break;
+        }
+    }
+    return t->count;
+}
+
+uint16_t addr_table_export(const addr_table_t *t, uint16_t *addrs, uint16_t max) {
+    uint16_t n = t->count < max ? t->count : max;
+    memcpy(addrs, t->addrs, n * sizeof(t->addrs[0]));
+    return n;
+}
@@ -0,0 +1,32 @@
+#ifndef ADDR_TABLE_H
+#define ADDR_TABLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Bảng địa chỉ KNX (u16) luôn giữ sắp xếp tăng dần → tra cứu bằng binary search
+ *
+ * Dùng chung cho bộ lọc forward lên host (rx_filter) và bảng lọc route của coupler.
+ * Bộ nhớ do module dùng bảng cấp (mảng static), bảng không tự khoá: chỉ sửa / tra trong main loop.
+ */
+
+typedef struct {
+    uint16_t *addrs;
+    uint16_t count;
+    uint16_t capacity;
+} addr_table_t;
+
+#define ADDR_TABLE_INIT(storage) {(storage), 0, (uint16_t)(sizeof(storage) / sizeof((storage)[0]))}
+
+void addr_table_clear(addr_table_t *t);
+// false = bảng đầy (địa chỉ đã có → true)
+bool addr_table_add(addr_table_t *t, uint16_t addr);
+bool addr_table_remove(addr_table_t *t, uint16_t addr);
+bool addr_table_contains(const addr_table_t *t, uint16_t addr);
+// Xoá rồi nạp lại, dừng ở địa chỉ đầu tiên không thêm được; trả về số địa chỉ trong bảng
+uint16_t addr_table_load(addr_table_t *t, const uint16_t *addrs, uint16_t count);
+// Copy bảng (đã sắp xếp), trả về số địa chỉ đã copy
+uint16_t addr_table_export(const addr_table_t *t, uint16_t *addrs, uint16_t max);
+
+#endif // ADDR_TABLE_H
@@ -0,0 +1,264 @@
+#include "host_diag.h"
+#include "config.h"
+#include "logger.h"
+#include "profiler.h"
+#include "trace.h"
+#include "metrics.h"
+#include "tpuart/host_link.h"
+#include "tpuart/rx_filter.h"
+#include "coupler.h"
+#include "hal/hal.h"
+#include <string.h>
+
+#define DIAG_MSG_MAX (DIAG_PAYLOAD_MAX + 3)
+#define DIAG_REPORT_STALL_MS 1000  // Transport không nhận thêm byte nào → huỷ report (cổng đóng, host ngừng đọc)
+
+static bool diag_pending = false;
+static uint8_t diag_sub = 0;
+static uint8_t diag_args[DIAG_ARG_MAX];
+static uint8_t diag_arg_len = 0;
+
+// Report đang gửi dần
+static const host_diag_report_t *report = nullptr;
+static uint16_t report_idx = 0;
+static uint8_t report_msg[DIAG_MSG_MAX];
+static uint8_t report_msg_len = 0;     // Message đã tạo, chờ transport đủ chỗ
+static uint32_t report_progress_ms = 0;
+
+void host_diag_request(uint8_t sub, const uint8_t *args, uint8_t len) {
+    if (diag_pending) {
+        LOG_WARN(LOG_CAT_UART, "Diag request %02X dropped - %02X still pending", sub, diag_sub);
+        return;
+    }
+    if (len > DIAG_ARG_MAX) {
+        len = DIAG_ARG_MAX;
+    }
+    diag_sub = sub;
+    diag_arg_len = len;
+    if (len) {
+        memcpy(diag_args, args, len);
+    }
+    diag_pending = true;
+}
+
+void host_diag_send(uint8_t sub, const uint8_t *payload, uint8_t len) {
+    uint8_t msg[DIAG_MSG_MAX];
+    if (len > DIAG_MSG_MAX - 3) {
+        len = DIAG_MSG_MAX - 3;
+    }
+    msg[0] = U_DIAG_IND;
+    msg[1] = sub;
+    msg[2] = len;
+    if (len) {
+        memcpy(&msg[3], payload, len);
+    }
+    host_link_write_services(msg, len + 3);
+}
+
+void host_diag_report(const host_diag_report_t *r) {
+    report = r;
+    report_idx = 0;
+    report_msg_len = 0;
+    report_progress_ms = hal_millis();
+}
+
+static void host_diag_report_end(void) {
+    if (report->end) {
+        report->end();
+    }
+    report = nullptr;
+}
+
+// 1 message của report đang gửi; true = report chưa xong
+static bool host_diag_report_step(void) {
+    if (report == nullptr) {
+        return false;
+    }
+    if (report_msg_len == 0) {
+        uint8_t len = 0;
+        if (!report->next(report_idx, &report_msg[3], &len)) {
+            host_diag_report_end();
+            return false;
+        }
+        report_idx++;
+        report_msg[0] = U_DIAG_IND;
+        report_msg[1] = report->sub;
+        report_msg[2] = len;
+        report_msg_len = len + 3;
+    }
+    if (host_link_write_space() < report_msg_len) {
+        if (hal_millis() - report_progress_ms > DIAG_REPORT_STALL_MS) {
+            LOG_WARN(LOG_CAT_UART, "Diag report %02X aborted after %u messages - host not reading",
+                     report->sub, report_idx - 1);
+            host_diag_report_end();
+            return false;
+        }
+        return true;
+    }
+    host_link_write_services(report_msg, report_msg_len);
+    report_msg_len = 0;
+    report_progress_ms = hal_millis();
+    return true;
+}
+
+// Lệnh không có dữ liệu trả về: xác nhận bằng 1 byte trạng thái
+static void host_diag_status(uint8_t sub, uint8_t status) {
+    host_diag_send(sub, &status, 1);
+}
+
+static void host_diag_ack(uint8_t sub) {
+    host_diag_status(sub, DIAG_STATUS_OK);
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+// DIAG_FILTER_*: args[0] = bảng, phần còn lại tuỳ lệnh
+// Các bảng lọc điều khiển được qua DIAG_FILTER_*, chọn theo args[0]
+typedef struct {
+    void (*clear)(void);
+    bool (*add)(uint16_t addr);
+    void (*enable)(bool enable);
+    bool (*is_enabled)(void);
+    uint16_t (*count)(void);
+    uint32_t (*forwarded)(void);
+    uint32_t (*blocked)(void);
+} diag_filter_table_t;
+
+static uint32_t rx_forwarded(void) {
+    return metric_get(METRIC_RX_FORWARDED);
+}
+
+static uint32_t rx_blocked(void) {
+    return metric_get(METRIC_RX_FILTERED);
+}
+
+static const diag_filter_table_t rx_table = {
+    rx_filter_clear, rx_filter_add, rx_filter_enable, rx_filter_is_enabled, rx_filter_count,
+    rx_forwarded, rx_blocked,
+};
+
+#if KNX_COUPLER_ENABLE
+static uint32_t coupler_forwarded(void) {
+    return metric_get(METRIC_COUPLER_ROUTED_0_1) + metric_get(METRIC_COUPLER_ROUTED_1_0);
+}
+
+static uint32_t coupler_blocked(void) {
+    return metric_get(METRIC_COUPLER_FILTERED);
+}
+
+static const diag_filter_table_t coupler_table = {
+    coupler_filter_clear, coupler_filter_add, coupler_filter_enable, coupler_filter_is_enabled, coupler_filter_count,
+    coupler_forwarded, coupler_blocked,
+};
+#endif
+
+static const diag_filter_table_t *host_diag_filter_table(uint8_t table) {
+    switch (table) {
+        case DIAG_TABLE_RX:
+            return &rx_table;
+#if KNX_COUPLER_ENABLE
+        case DIAG_TABLE_COUPLER:
+            return &coupler_table;
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+static void host_diag_filter(uint8_t sub, const uint8_t *args, uint8_t len) {
+    const diag_filter_table_t *table = len >= 1 ? host_diag_filter_table(args[0]) : nullptr;
+    if (table == nullptr) {
+        host_diag_status(sub, DIAG_STATUS_ERROR);
+        return;
+    }
+    switch (sub) {
+        case DIAG_FILTER_CLEAR:
+            table->clear();
+            host_diag_ack(sub);
+            break;
+        case DIAG_FILTER_ADD: {
+            uint8_t status = (len & 1) ? DIAG_STATUS_OK : DIAG_STATUS_ERROR;
+            for (uint8_t i = 1; i + 1 < len; i += 2) {
+                if (!table->add((uint16_t)((args[i] << 8) | args[i + 1]))) {
+                    status = DIAG_STATUS_ERROR;
+                    break;
+                }
+            }
+            host_diag_status(sub, status);
+            break;
+        }
+        case DIAG_FILTER_ENABLE:
+            if (len != 2) {
+                host_diag_status(sub, DIAG_STATUS_ERROR);
+                break;
+            }
+            table->enable(args[1] != 0);
+            host_diag_ack(sub);
+            break;
+        case DIAG_FILTER_READ: {
+            uint8_t payload[12];
+            uint16_t count = table->count();
+            payload[0] = args[0];
+            payload[1] = table->is_enabled();
+            payload[2] = (uint8_t)count;
+            payload[3] = (uint8_t)(count >> 8);
+            put_u32(&payload[4], table->forwarded());
+            put_u32(&payload[8], table->blocked());
+            host_diag_send(sub, payload, sizeof(payload));
+            break;
+        }
+    }
+}
+
+void host_diag_service(void) {
+    if (host_link_frame_active() || host_diag_report_step() || !diag_pending) {
+        return;
+    }
+    diag_pending = false;
+
+    switch (diag_sub) {
+#if KNX_PROFILER_ENABLE
+        case DIAG_PROFILE_REPORT:
+            profiler_send_report();
+            break;
+        case DIAG_PROFILE_RESET:
+            profiler_reset();
+            host_diag_ack(diag_sub);
+            break;
+#endif
+#if KNX_TRACE_ENABLE
+        case DIAG_TRACE_DUMP:
+            trace_send_dump();
+            break;
+        case DIAG_TRACE_ARM:
+            trace_arm();
+            host_diag_ack(diag_sub);
+            break;
+        case DIAG_TRACE_FREEZE:
+            trace_trigger(TRACE_TRIG_HOST);
+            host_diag_ack(diag_sub);
+            break;
+#endif
+        case DIAG_METRICS_READ:
+            metrics_send();
+            break;
+        case DIAG_METRICS_RESET:
+            metrics_reset();
+            host_diag_ack(diag_sub);
+            break;
+        case DIAG_FILTER_CLEAR:
+        case DIAG_FILTER_ADD:
+        case DIAG_FILTER_ENABLE:
+        case DIAG_FILTER_READ:
+            host_diag_filter(diag_sub, diag_args, diag_arg_len);
+            break;
+        default:
+            host_diag_send(diag_sub, nullptr, 0);
+            break;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef HOST_DIAG_H
+#define HOST_DIAG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Lệnh chẩn đoán riêng của gateway trên host link (không có trên TPUART/NCN5120 thật)
+ *
+ * Host gửi:    [U_DIAG_REQ] [sub-command]
+ *              [U_DIAG_REQ] [sub-command 0x80-0xFF] [len] [args (len byte, tối đa DIAG_ARG_MAX)]
+ * Gateway trả: [U_DIAG_IND] [sub-command] [len] [payload (len byte)]  - 1 hoặc nhiều message
+ *
+ * Phản hồi được hoãn tới khi không còn frame bus nào đang forward lên host,
+ * để không chen vào giữa frame. Sub-command không hỗ trợ → 1 message len = 0.
+ * Lệnh không có dữ liệu trả về (reset...) → payload 1 byte trạng thái 0x00.
+ *
+ * Report nhiều message (profiler, trace, metrics) được gửi dần: mỗi lượt host_diag_service() tối đa
+ * 1 message, chỉ khi host transport còn chỗ cho cả message → không block loop trên UART.
+ * Request tới trong lúc report đang gửi được xử lý sau message cuối.
+ */
+#define U_DIAG_REQ 0xF8
+#define U_DIAG_IND 0xF9
+
+// Sub-commands
+#define DIAG_PROFILE_REPORT 0x01   // profiler.h: thống kê cycle từng stage / ISR
+#define DIAG_PROFILE_RESET  0x02
+#define DIAG_TRACE_DUMP     0x03   // trace.h: toàn bộ trace ring
+#define DIAG_TRACE_ARM      0x04   // Xoá ring, bỏ freeze, ghi lại từ đầu
+#define DIAG_TRACE_FREEZE   0x05   // Trigger thủ công
+#define DIAG_METRICS_READ   0x06   // metrics.h: toàn bộ counter / gauge
+#define DIAG_METRICS_RESET  0x07
+
+// Sub-command có tham số
+#define DIAG_SUB_ARGS       0x80
+#define DIAG_ARG_MAX        48
+// Bảng lọc địa chỉ nhóm - args[0] = bảng (DIAG_TABLE_*), trả 1 byte trạng thái trừ DIAG_FILTER_READ
+#define DIAG_FILTER_CLEAR   0x81   // [bảng]
+#define DIAG_FILTER_ADD     0x82   // [bảng] [addr hi] [addr lo] ... - thêm nhiều địa chỉ, lỗi nếu bảng đầy
+#define DIAG_FILTER_ENABLE  0x83   // [bảng] [0 / 1]
+#define DIAG_FILTER_READ    0x84   // [bảng] → [bảng] [bật] [số địa chỉ u16] [forward u32] [bị chặn u32] (little-endian)
+
+#define DIAG_TABLE_RX       0x00   // tpuart/rx_filter.h: forward bus → host
+#define DIAG_TABLE_COUPLER  0x01   // coupler.h: route giữa 2 line (KNX_COUPLER_ENABLE), forward = 2 chiều cộng lại
+
+#define DIAG_PAYLOAD_MAX    61     // Payload tối đa của 1 U_DIAG_IND (message 64 byte)
+
+#define DIAG_STATUS_OK      0x00
+#define DIAG_STATUS_ERROR   0x01   // Tham số sai / bảng đầy / bảng không có
+
+// Gọi từ TX parser khi nhận đủ [U_DIAG_REQ] [sub] ([len] [args])
+void host_diag_request(uint8_t sub, const uint8_t *args, uint8_t len);
+// Xử lý request đang chờ (gọi từ loop / task đang giữ gateway)
+void host_diag_service(void);
+// Ghi 1 message U_DIAG_IND
+void host_diag_send(uint8_t sub, const uint8_t *payload, uint8_t len);
+
+// Report gửi dần, 1 message mỗi lượt service
+typedef struct {
+    uint8_t sub;
+    // Tạo message thứ idx (payload tối đa DIAG_PAYLOAD_MAX byte), false = hết report
+    bool (*next)(uint16_t idx, uint8_t *payload, uint8_t *len);
+    // Sau message cuối hoặc khi report bị huỷ (nullptr = không cần)
+    void (*end)(void);
+} host_diag_report_t;
+
+// Bắt đầu gửi report (gọi từ case của host_diag_service)
+void host_diag_report(const host_diag_report_t *report);
+
+#endif // HOST_DIAG_H
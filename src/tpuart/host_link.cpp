@@ -0,0 +1,179 @@
+#include "host_link.h"
+#include "config.h"
+#include "crc_ccitt.h"
+#include "tpuart/tpuart.h"
+#include "hal/hal.h"
+#include "capture.h"
+#include "knx_frame.h"
+#include "rtos_tasks.h"
+
+static uint8_t link_config = 0;     // FRAME_END_WITH_MARKER | CRC_CCITT
+static bool frame_open = false;
+static uint16_t frame_crc = CRC_CCITT_INIT;
+
+#if KNX_RX_MODE
+// Frame mode: [kênh] + frame (đã escape) + CRC + marker + trạng thái, ghi ra 1 lần
+#define HOST_LINK_OUT_MAX (2 * (KNX_MAX_FRAME_LEN + 2) + 2 + KNX_COUPLER_ENABLE)
+static uint8_t out_buf[HOST_LINK_OUT_MAX];
+static uint8_t out_len = 0;
+#else
+// Byte mode: vị trí byte trong frame, packet đầu (USB CDC) kết thúc sau địa chỉ đích
+static uint8_t frame_pos = 0;
+static bool frame_ext = false;
+#endif
+
+void host_link_configure(uint8_t config_flags) {
+    link_config = config_flags & (FRAME_END_WITH_MARKER | CRC_CCITT);
+}
+
+uint8_t host_link_get_config(void) {
+    return link_config;
+}
+
+bool host_link_marker_enabled(void) {
+    return (link_config & FRAME_END_WITH_MARKER) != 0;
+}
+
+bool host_link_crc_enabled(void) {
+    return (link_config & CRC_CCITT) != 0;
+}
+
+// Mọi byte gửi lên host đi qua đây (capture thấy đúng từng lần ghi ra host transport)
+// service: byte dịch vụ, transport không bỏ khi tạm đầy
+static void host_link_out(const uint8_t *data, uint16_t len, bool service = false) {
+    CAPTURE_HOST_TX(data, len);
+#if KNX_USE_FREERTOS
+    if (rtos_host_write(data, len)) {
+        return; // Task host_link ghi ra transport, task gọi (bus_rx / tx_sched) không chờ UART
+    }
+#endif
+    if (service) {
+        hal_host_write_service(data, len);
+    } else {
+        hal_host_write(data, len);
+    }
+}
+
+// Hết 1 đơn vị cho host: USB CDC gửi packet đang gom (USART: không làm gì)
+static void host_link_flush(void) {
+#if KNX_USE_FREERTOS
+    if (rtos_host_flush()) {
+        return;
+    }
+#endif
+    hal_host_flush();
+}
+
+// Ghi 1 byte của frame: frame mode → vào buffer, byte mode → ghi thẳng ra MCU
+static void host_link_put(uint8_t byte) {
+#if KNX_RX_MODE
+    if (out_len < HOST_LINK_OUT_MAX) {
+        out_buf[out_len++] = byte;
+    }
+#else
+    host_link_out(&byte, 1);
+#endif
+}
+
+// Ghi 1 byte, nhân đôi nếu trùng marker
+static void host_link_write_escaped(uint8_t byte) {
+    host_link_put(byte);
+    if (byte == U_FRAME_END_IND && host_link_marker_enabled()) {
+        host_link_put(byte);
+    }
+}
+
+static void host_link_frame_close(uint16_t crc, uint8_t frame_state) {
+    if (host_link_crc_enabled()) {
+        host_link_write_escaped((uint8_t)(crc >> 8));
+        host_link_write_escaped((uint8_t)crc);
+    }
+    if (host_link_marker_enabled()) {
+        host_link_put(U_FRAME_END_IND);
+    }
+#if KNX_RX_MODE
+    host_link_put(U_FRAME_STATE_IND | frame_state);
+    host_link_out(out_buf, out_len);
+    out_len = 0;
+#else
+    (void)frame_state; // Byte mode: host tự kiểm tra frame
+#endif
+    host_link_flush();
+    frame_open = false;
+}
+
+void host_link_write_service(uint8_t byte) {
+    host_link_out(&byte, 1, true);
+    host_link_flush();
+}
+
+void host_link_write_services(const uint8_t *data, uint8_t len) {
+    host_link_out(data, len, true);
+    host_link_flush();
+}
+
+int host_link_write_space(void) {
+#if KNX_USE_FREERTOS
+    return rtos_host_write_space();
+#else
+    return hal_host_write_space();
+#endif
+}
+
+void host_link_frame_begin(uint8_t line) {
+    frame_open = true;
+    frame_crc = CRC_CCITT_INIT;
+#if KNX_RX_MODE
+    out_len = 0;
+#else
+    frame_pos = 0;
+#endif
+#if KNX_COUPLER_ENABLE
+    // Byte kênh không thuộc frame: không tính CRC, không trùng marker → không escape
+    host_link_put(U_CHANNEL_IND | line);
+#else
+    (void)line;
+#endif
+}
+
+void host_link_frame_byte(uint8_t byte) {
+    if (host_link_crc_enabled()) {
+        frame_crc = crc_ccitt_update(frame_crc, byte);
+    }
+    host_link_write_escaped(byte);
+#if !KNX_RX_MODE
+    // Byte mode: host cần địa chỉ đích sớm để kịp U_ACK_REQ → packet đầu kết thúc ở đây, phần còn lại lúc đóng frame
+    if (frame_pos == 0) {
+        frame_ext = knx_frame_is_extended(byte);
+    }
+    if (frame_pos == knx_frame_dest_offset(frame_ext) + 1) {
+        host_link_flush();
+    }
+    if (frame_pos < 0xFF) {
+        frame_pos++;
+    }
+#endif
+}
+
+void host_link_frame_bytes(const uint8_t *data, uint8_t len) {
+    for (uint8_t i = 0; i < len; i++) {
+        host_link_frame_byte(data[i]);
+    }
+}
+
+void host_link_frame_end(uint8_t frame_state) {
+    if (frame_open) {
+        host_link_frame_close(frame_crc, frame_state);
+    }
+}
+
+// Frame bị cắt ngang (khoảng nghỉ quá lâu giữa 2 byte)
+void host_link_frame_abort(void) {
+    if (frame_open) {
+        host_link_frame_close((uint16_t)~frame_crc, TIMING_ERROR | CHECKSUM_LENGTH_ERROR);
+    }
+}
+
+bool host_link_frame_active(void) {
+    return frame_open;
+}
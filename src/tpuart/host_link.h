@@ -0,0 +1,51 @@
+#ifndef HOST_LINK_H
+#define HOST_LINK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Framing cho dữ liệu gửi lên MCU (host) - cấu hình bằng U_CONFIGURE_REQ
+ *
+ * Mặc định (không cấu hình): byte được ghi thẳng ra host transport (USART1 / USB CDC) như trước.
+ * USB CDC: mỗi frame / byte dịch vụ kết thúc bằng hal_host_flush() → đi trong 1 packet
+ * (byte mode: 2 packet, packet đầu tới hết địa chỉ đích để host kịp gửi U_ACK_REQ).
+ *
+ * FRAME_END_WITH_MARKER: sau mỗi frame gửi U_FRAME_END_IND (0xCB).
+ *   Byte 0xCB nằm trong frame/CRC được gửi 2 lần để host phân biệt với marker.
+ * CRC_CCITT: sau mỗi frame gửi 2 byte CRC-CCITT (byte cao trước), tính trên các byte của frame.
+ *
+ * Format: [frame (0xCB nhân đôi)] [CRC hi] [CRC lo] [0xCB]
+ * Frame bị cắt ngang (reset giữa chừng) được kết thúc bằng CRC đảo → host sẽ loại bỏ.
+ *
+ * KNX_COUPLER_ENABLE: mỗi frame bus bắt đầu bằng U_CHANNEL_IND | line (0xFC / 0xFD) - line nhận được frame.
+ *   Byte dịch vụ (L_ACKN_IND, L_DATA_CON...) không gắn kênh, luôn thuộc line 0.
+ *
+ * KNX_RX_MODE = 1 (frame mode): cả frame được giữ trong buffer và ghi ra host
+ * bằng 1 lần write, kèm U_FRAME_STATE_IND | trạng thái lỗi ở cuối:
+ * [frame] [CRC] [0xCB] [U_FRAME_STATE_IND | PARITY_BIT_ERROR | CHECKSUM_LENGTH_ERROR | TIMING_ERROR]
+ */
+
+// Cấu hình framing (dùng chung các bit của U_CONFIGURE_IND)
+void host_link_configure(uint8_t config_flags);
+uint8_t host_link_get_config(void);
+bool host_link_marker_enabled(void);
+bool host_link_crc_enabled(void);
+
+// Byte dịch vụ đơn lẻ (L_DATA_CON, U_CONFIGURE_IND, L_ACKN_IND...)
+void host_link_write_service(uint8_t byte);
+// Chuỗi byte dịch vụ ghi liền 1 lần (U_DIAG_IND...)
+void host_link_write_services(const uint8_t *data, uint8_t len);
+// Số byte ghi được ngay mà không phải chờ (RTOS: chỗ trống của stream buffer tới task host_link)
+int host_link_write_space(void);
+
+// Frame nhận từ bus line (KNX_LINE_MAIN / KNX_LINE_SUB)
+void host_link_frame_begin(uint8_t line);
+void host_link_frame_byte(uint8_t byte);
+void host_link_frame_bytes(const uint8_t *data, uint8_t len);
+void host_link_frame_end(uint8_t frame_state);
+void host_link_frame_abort(void);
+// Đang có frame bus forward dở lên host (không được chen byte dịch vụ dài)
+bool host_link_frame_active(void);
+
+#endif // HOST_LINK_H
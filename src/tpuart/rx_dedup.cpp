@@ -0,0 +1,102 @@
+#include "rx_dedup.h"
+#include <string.h>
+#include "config.h"
+#include "logger.h"
+#include "metrics.h"
+#include "crc_ccitt.h"
+
+typedef struct {
+    uint32_t t_ms;   // hal_millis() lúc forward
+    uint16_t src;
+    uint16_t dest;
+    uint16_t hash;
+    uint8_t ack;     // Ký tự ACK gateway đã gửi cho telegram này (0 = không)
+    bool ack_req;    // Host đã yêu cầu ACK (U_ACK_REQ)
+    bool used;
+} rx_dedup_entry_t;
+
+// Ghi theo vòng: slot bị thay luôn là telegram cũ nhất
+static rx_dedup_entry_t dedup_cache[KNX_RX_DEDUP_SLOTS];
+static uint8_t dedup_next = 0;
+static int8_t dedup_last = -1;   // Slot insert gần nhất
+static bool dedup_enabled = KNX_RX_DEDUP_ENABLE;
+
+// Bản đầu và bản lặp chỉ khác repeat flag (và checksum theo nó)
+static uint16_t dedup_hash(knx_frame_view_t frame) {
+    uint16_t crc = crc_ccitt_update(CRC_CCITT_INIT, frame.control() | KNX_CTRL_REPEAT_FLAG);
+    for (uint8_t i = 1; i + 1 < frame.len; i++) {
+        crc = crc_ccitt_update(crc, frame.data[i]);
+    }
+    return crc;
+}
+
+// Host yêu cầu ACK mà gateway không gửi được (lỡ cửa sổ ACK): bản lặp phải tới host để được ACK
+static bool dedup_live(const rx_dedup_entry_t *e, uint32_t now_ms) {
+    return e->used && (!e->ack_req || e->ack) && now_ms - e->t_ms < KNX_RX_DEDUP_WINDOW_MS;
+}
+
+void rx_dedup_enable(bool enable) {
+    dedup_enabled = enable;
+    rx_dedup_clear();
+    LOG_INFO(LOG_CAT_KNX_RX, "RX repeat suppression %s", enable ? "enabled" : "disabled");
+}
+
+bool rx_dedup_is_enabled(void) {
+    return dedup_enabled;
+}
+
+void rx_dedup_clear(void) {
+    memset(dedup_cache, 0, sizeof(dedup_cache));
+    dedup_next = 0;
+    dedup_last = -1;
+}
+
+bool rx_dedup_candidate(uint16_t src, uint16_t dest, uint32_t now_ms) {
+    for (uint8_t i = 0; i < KNX_RX_DEDUP_SLOTS; i++) {
+        const rx_dedup_entry_t *e = &dedup_cache[i];
+        if (dedup_live(e, now_ms) && e->src == src && e->dest == dest) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool rx_dedup_match(knx_frame_view_t frame, uint32_t now_ms, uint8_t *ack) {
+    uint16_t src = frame.source();
+    uint16_t dest = frame.destination();
+    uint16_t hash = dedup_hash(frame);
+    for (uint8_t i = 0; i < KNX_RX_DEDUP_SLOTS; i++) {
+        const rx_dedup_entry_t *e = &dedup_cache[i];
+        if (dedup_live(e, now_ms) && e->src == src && e->dest == dest && e->hash == hash) {
+            *ack = e->ack;
+            metric_inc(METRIC_RX_REPEATS_DROPPED);
+            return true;
+        }
+    }
+    return false;
+}
+
+void rx_dedup_insert(knx_frame_view_t frame, uint32_t now_ms, bool ack_requested) {
+    rx_dedup_entry_t *e = &dedup_cache[dedup_next];
+    e->t_ms = now_ms;
+    e->src = frame.source();
+    e->dest = frame.destination();
+    e->hash = dedup_hash(frame);
+    e->ack = 0;
+    e->ack_req = ack_requested;
+    e->used = true;
+    dedup_last = dedup_next;
+    dedup_next = (dedup_next + 1) % KNX_RX_DEDUP_SLOTS;
+}
+
+void rx_dedup_note_ack_request(void) {
+    if (dedup_last >= 0) {
+        dedup_cache[dedup_last].ack_req = true;
+    }
+}
+
+void rx_dedup_note_ack(uint8_t ack) {
+    if (dedup_last >= 0) {
+        dedup_cache[dedup_last].ack = ack;
+    }
+}
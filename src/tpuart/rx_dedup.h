@@ -0,0 +1,41 @@
+#ifndef RX_DEDUP_H
+#define RX_DEDUP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "knx_frame.h"
+
+/*
+ * Bỏ bản lặp lại của telegram vừa forward lên MCU
+ *
+ * Bên gửi không thấy ACK sẽ phát lại telegram tối đa 3 lần với repeat flag = 0; nếu bản đầu
+ * đã tới host thì các bản sau chỉ làm nặng host link đúng lúc bus bận nhất.
+ *
+ * - Cache KNX_RX_DEDUP_SLOTS telegram hợp lệ đã forward gần nhất: source, dest, hash, thời điểm
+ *   (hash CRC-CCITT của mọi byte trừ repeat flag và checksum)
+ * - Frame có repeat flag = 0: nếu cache có telegram cùng source + dest trong KNX_RX_DEDUP_WINDOW_MS,
+ *   knx_parse_BUS_byte giữ frame lại tới checksum rồi mới quyết định; khác nội dung → forward như thường
+ * - Bản sao bị bỏ vẫn được ACK trên bus giống bản đầu (ký tự ACK gateway đã gửi theo U_ACK_REQ),
+ *   nếu không bên gửi sẽ lặp tiếp vì ACK lần trước bị mất. Host yêu cầu ACK nhưng gateway lỡ cửa sổ ACK
+ *   → không bỏ bản lặp, để host ACK được lần này
+ * - Frame lặp lần đầu không có trong cache (bản đầu bị hỏng / bị lọc...) forward không chậm trễ
+ * - Echo frame của chính gateway không qua cache
+ */
+
+void rx_dedup_enable(bool enable);
+bool rx_dedup_is_enabled(void);
+void rx_dedup_clear(void);
+
+// Frame lặp lại, đã có địa chỉ: true = có thể là bản sao, cần giữ tới checksum
+bool rx_dedup_candidate(uint16_t src, uint16_t dest, uint32_t now_ms);
+// Frame lặp lại hợp lệ đã nhận đủ: true = bản sao của telegram đã forward, *ack = ACK gateway đã gửi cho bản đầu (0 = không)
+bool rx_dedup_match(knx_frame_view_t frame, uint32_t now_ms, uint8_t *ack);
+// Telegram hợp lệ đã forward lên MCU; ack_requested = host đã gửi U_ACK_REQ cho nó
+void rx_dedup_insert(knx_frame_view_t frame, uint32_t now_ms, bool ack_requested);
+// U_ACK_REQ tới sau khi insert (áp dụng cho telegram insert gần nhất) - chỉ gọi khi telegram đang nhận
+// đã được insert; U_ACK_REQ giữa frame đi theo ack_requested của rx_dedup_insert
+void rx_dedup_note_ack_request(void);
+// Gateway đã gửi ký tự ACK cho telegram insert gần nhất
+void rx_dedup_note_ack(uint8_t ack);
+
+#endif // RX_DEDUP_H
@@ -0,0 +1,77 @@
+#include "rx_filter.h"
+#include "config.h"
+#include "logger.h"
+#include "metrics.h"
+#include "addr_table.h"
+
+#define KNX_BROADCAST_ADDR 0x0000
+
+// Bảng địa chỉ đích, luôn giữ sắp xếp tăng dần
+static uint16_t filter_storage[KNX_RX_FILTER_MAX_ADDR];
+static addr_table_t filter_table = ADDR_TABLE_INIT(filter_storage);
+static bool filter_enabled = KNX_RX_FILTER_ENABLE;
+static uint32_t filter_generation = 0; // Tăng mỗi khi bảng / trạng thái thay đổi
+
+void rx_filter_enable(bool enable) {
+    filter_enabled = enable;
+    filter_generation++;
+    LOG_INFO(LOG_CAT_KNX_RX, "RX filter %s (%d addresses)", enable ? "enabled" : "disabled", filter_table.count);
+}
+
+bool rx_filter_is_enabled(void) {
+    return filter_enabled;
+}
+
+void rx_filter_clear(void) {
+    addr_table_clear(&filter_table);
+    filter_generation++;
+}
+
+bool rx_filter_add(uint16_t dest_addr) {
+    if (!addr_table_add(&filter_table, dest_addr)) {
+        LOG_WARN(LOG_CAT_KNX_RX, "RX filter full - address %04X not added", dest_addr);
+        return false;
+    }
+    filter_generation++;
+    return true;
+}
+
+bool rx_filter_remove(uint16_t dest_addr) {
+    if (!addr_table_remove(&filter_table, dest_addr)) {
+        return false;
+    }
+    filter_generation++;
+    return true;
+}
+
+// Nạp lại toàn bộ bảng, trả về số địa chỉ đã nạp
+uint16_t rx_filter_load(const uint16_t *addrs, uint16_t count) {
+    uint16_t n = addr_table_load(&filter_table, addrs, count);
+    filter_generation++;
+    LOG_INFO(LOG_CAT_KNX_RX, "RX filter loaded %d addresses", n);
+    return n;
+}
+
+uint16_t rx_filter_count(void) {
+    return filter_table.count;
+}
+
+// Copy bảng địa chỉ (đã sắp xếp), trả về số địa chỉ đã copy
+uint16_t rx_filter_export(uint16_t *addrs, uint16_t max) {
+    return addr_table_export(&filter_table, addrs, max);
+}
+
+uint32_t rx_filter_generation(void) {
+    return filter_generation;
+}
+
+bool rx_filter_match(uint16_t dest_addr, bool group_addr) {
+    if (!filter_enabled || !group_addr || dest_addr == KNX_BROADCAST_ADDR) {
+        return true;
+    }
+    return addr_table_contains(&filter_table, dest_addr);
+}
+
+void rx_filter_record(bool forwarded) {
+    metric_inc(forwarded ? METRIC_RX_FORWARDED : METRIC_RX_FILTERED);
+}
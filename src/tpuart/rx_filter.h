@@ -0,0 +1,42 @@
+#ifndef RX_FILTER_H
+#define RX_FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Bộ lọc forward theo địa chỉ đích (destination address)
+ *
+ * knx_parse_BUS_byte hỏi bộ lọc ngay khi nhận xong địa chỉ đích và bit AT
+ * (standard: byte 5, ngay sau địa chỉ đích; extended: byte 1 - knx_frame_addr_len()).
+ * Telegram không có trong bảng sẽ không được forward lên MCU, nhưng state
+ * machine RX vẫn chạy hết frame (ACK, echo, bus busy không bị ảnh hưởng).
+ *
+ * - Bảng chỉ chứa địa chỉ nhóm; telegram tới địa chỉ cá nhân luôn được forward
+ *   (0x1105 vừa là 1.1.5 vừa là 2/1/5 - host phải thấy telegram gửi tới nó để trả U_ACK_REQ)
+ * - Bảng địa chỉ được giữ sắp xếp tăng dần → tra cứu bằng binary search
+ * - Địa chỉ broadcast 0x0000 luôn được forward
+ * - Khi bộ lọc tắt, mọi telegram đều được forward (như trước đây)
+ * - Số telegram forward / bị chặn: METRIC_RX_FORWARDED / METRIC_RX_FILTERED
+ *
+ * Host nạp bảng và bật bộ lọc bằng DIAG_FILTER_* (tpuart/host_diag.h), bảng giữ qua warm restart (recovery.h).
+ */
+
+void rx_filter_enable(bool enable);
+bool rx_filter_is_enabled(void);
+
+// Quản lý bảng địa chỉ
+void rx_filter_clear(void);
+bool rx_filter_add(uint16_t dest_addr);
+bool rx_filter_remove(uint16_t dest_addr);
+uint16_t rx_filter_load(const uint16_t *addrs, uint16_t count);
+uint16_t rx_filter_count(void);
+uint16_t rx_filter_export(uint16_t *addrs, uint16_t max);
+// Tăng mỗi lần bảng / trạng thái bật-tắt thay đổi (recovery snapshot cấu hình theo số này)
+uint32_t rx_filter_generation(void);
+
+// Gọi từ RX parser
+bool rx_filter_match(uint16_t dest_addr, bool group_addr);
+void rx_filter_record(bool forwarded);
+
+#endif // RX_FILTER_H
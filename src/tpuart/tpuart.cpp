@@ -4,18 +4,53 @@
 //#include "knx_rx.h"
 #include "logger.h"
 #include "tpuart/tpuart.h"
+#include "tpuart/rx_filter.h"
+#include "tpuart/rx_dedup.h"
+#include "tpuart/host_link.h"
+#include "tpuart/host_diag.h"
+#include "crc_ccitt.h"
+#include "knx_frame.h"
+#include "trace.h"
+#include "metrics.h"
+#include "hal/hal.h"
 
 //Biến, buffer dùng chung TX
 static uint8_t tx_buffer[KNX_MAX_FRAME_LEN];
 static uint8_t tx_buf_idx = 0;
 static bool tx_frame_complete=false;
-static bool is_echo_frame = false;
+static uint16_t tx_crc_rx = 0; // CRC-CCITT host gửi kèm frame (khi bật CRC_CCITT)
+static uint32_t tx_last_byte_ms = 0; // hal_millis() lúc nhận byte cuối từ host
+static uint8_t tx_skip_count = 0;    // Số byte đã bỏ qua ở TPUART_TX_END khi chờ marker
+static bool tx_marker_pending = false; // Chế độ marker: vừa nhận 0xCB trong vùng data, chờ byte sau để phân biệt
+static uint16_t tx_busy_bytes = 0;     // Số byte từ lần cuối parser xử lý byte ở IDLE
+static uint8_t diag_sub = 0;         // U_DIAG_REQ có tham số: sub-command, tham số đang nhận
+static uint8_t diag_args[DIAG_ARG_MAX];
+static uint8_t diag_arg_len = 0;
+static uint8_t diag_arg_idx = 0;
 
 //Biến, buffer dùng chung RX
 static uint8_t rx_buf_idx = 0;
 static uint8_t rx_buf_len = 0;
 static bool rx_checksum_byte=false;
 static bool is_extended_frame = false; // Lưu loại frame (standard/extended)
+static uint8_t rx_xor = 0;         // XOR các byte đã nhận (frame đúng: XOR cả checksum = 0xFF)
+static uint8_t rx_frame_state = 0; // Cờ lỗi cho U_FRAME_STATE_IND (frame mode)
+static bool rx_frame_ok = false;   // Frame vừa nhận xong checksum không có lỗi → được ACK / confirm
+
+// Echo: frame đầu tiên trên bus sau khi gửi được so sánh từng byte với frame đầu queue
+static bool rx_is_echo = false;    // Frame đang nhận là echo của frame đầu queue
+static bool rx_echo_match = false; // Các byte đã nhận khớp hoàn toàn với frame đã gửi
+static void rx_echo_cancel();
+
+// Giữ lại các byte đầu frame cho đến khi quyết định forward: RX filter → tới địa chỉ đích,
+// bản lặp có thể trùng (rx_dedup) → tới checksum. Khi bật rx_dedup, mọi frame được ghi lại ở đây
+static uint8_t rx_held[KNX_MAX_FRAME_LEN];
+static uint8_t rx_held_len = 0;
+static bool rx_hold = false;         // Đang giữ byte, chưa quyết định forward
+static bool rx_forward = true;       // Frame hiện tại có được forward lên MCU không
+static bool rx_is_repeat = false;    // Control byte có repeat flag = 0
+static bool rx_repeat_hold = false;  // Giữ bản lặp tới checksum để so với cache rx_dedup
+static bool rx_dedup_noted = false;  // Frame vừa nhận đã vào cache rx_dedup, chờ ack_sent()
 
 // ACK handling: Lưu trạng thái cần gửi ACK và giá trị ACK từ MCU
 static bool pending_ack = false; // Có cần gửi ACK xuống bus không, set true khi nhận được U_ACK_REQ từ MCU
@@ -32,71 +67,235 @@ bool is_rx_checksum_done() {
 }
 
 
-Frame queue[MAX_QUEUE];
-volatile uint8_t q_head = 0;
-volatile uint8_t q_tail = 0;
-volatile uint8_t q_count = 0;
+/*
+ * Queue TX: ring byte chứa record [Frame header 4 byte][data len byte], không padding.
+ * Record không bao giờ bị cắt ở cuối buffer: không đủ chỗ → byte len = 0 (wrap marker) rồi ghi từ đầu.
+ * Frame luôn liền mạch trong RAM → peek_frame() trả con trỏ thẳng vào ring, enqueue / dequeue O(1).
+ * q_head / q_tail / q_last là offset byte; q_count == 0 thì head = tail = 0.
+ *
+ * .noinit: queue còn nguyên qua warm restart (recovery.cpp kiểm tra / xoá lúc khởi động)
+ */
+#define FRAME_HDR_SIZE offsetof(Frame, data)
+#define FRAME_RECORD_SIZE(len) (FRAME_HDR_SIZE + (len))
 
-bool enqueue_frame(const uint8_t *data, uint8_t len) {
-  // Validation đầu vào với flow control
-  if (q_count >= MAX_QUEUE) {
-    LOG_ERROR(LOG_CAT_QUEUE, "Queue full - frame dropped");
+static_assert(KNX_TX_QUEUE_BYTES / FRAME_RECORD_SIZE(1) <= 0xFF, "q_count là uint8_t");
+
+static uint8_t q_buf[KNX_TX_QUEUE_BYTES] __attribute__((section(".noinit"), aligned(4)));
+static volatile uint16_t q_head __attribute__((section(".noinit")));
+static volatile uint16_t q_tail __attribute__((section(".noinit")));
+static volatile uint16_t q_last __attribute__((section(".noinit")));  // Record cuối (nhận nack_after)
+volatile uint8_t q_count __attribute__((section(".noinit")));
+static uint32_t q_sent_time = 0; // hal_millis() lúc frame đầu queue được gửi (chỉ frame đầu ở FRAME_SENT)
+
+static inline Frame *frame_at(uint16_t offset) {
+  return (Frame *)&q_buf[offset];
+}
+
+// CRC-CCITT gập còn 1 byte - đủ để phát hiện record hỏng sau warm restart
+static uint8_t frame_check(const uint8_t *data, uint8_t len) {
+  uint16_t crc = crc_ccitt(data, len);
+  return (uint8_t)(crc ^ (crc >> 8));
+}
+
+void frame_update_check(Frame *f) {
+  f->check = frame_check(f->data, f->len);
+}
+
+void queue_clear() {
+  q_head = 0;
+  q_tail = 0;
+  q_last = 0;
+  q_count = 0;
+  memset(q_buf, 0, sizeof(q_buf));
+}
+
+// Đầu record tiếp theo kể từ offset (bỏ qua wrap marker)
+static uint16_t queue_skip_marker(uint16_t offset) {
+  if (offset >= KNX_TX_QUEUE_BYTES || q_buf[offset] == 0) {
+    return 0;
+  }
+  return offset;
+}
+
+// Queue sau warm restart: chỉ giữ lại khi offset, độ dài, trạng thái và check từng record đều hợp lệ
+bool queue_validate() {
+  if (q_count == 0) {
+    return q_head == 0 && q_tail == 0;
+  }
+  if (q_head >= KNX_TX_QUEUE_BYTES || q_tail > KNX_TX_QUEUE_BYTES || q_last >= KNX_TX_QUEUE_BYTES ||
+      q_buf[q_head] == 0) {
     return false;
   }
-  
-  // Send flow control signal: GO (if queue was nearly full)
-  if (q_count >= MAX_QUEUE * 0.8) {
-    LOG_WARN(LOG_CAT_QUEUE, "Queue nearly full - sending flow control signal");
+  uint16_t pos = q_head;
+  uint16_t last = pos;
+  bool wrapped = false;
+  for (uint8_t i = 0; i < q_count; i++) {
+    uint16_t next = queue_skip_marker(pos);
+    if (next != pos) {
+      if (wrapped) {
+        return false;
+      }
+      wrapped = true;
+      pos = next;
+    }
+    const Frame *f = frame_at(pos);
+    if (pos + FRAME_HDR_SIZE > KNX_TX_QUEUE_BYTES || f->len == 0 || f->len > KNX_BUFFER_MAX_SIZE ||
+        pos + FRAME_RECORD_SIZE(f->len) > KNX_TX_QUEUE_BYTES ||
+        f->state > (i == 0 ? FRAME_SENT : FRAME_QUEUED) || f->check != frame_check(f->data, f->len)) {
+      return false;
+    }
+    last = pos;
+    pos += FRAME_RECORD_SIZE(f->len);
+    if (wrapped && pos > q_head) {
+      return false;
+    }
   }
-  
+  return pos == q_tail && last == q_last;
+}
+
+// Offset để ghi record size byte, -1 nếu không đủ chỗ
+static int32_t queue_reserve(uint16_t size) {
+  if (q_count == 0) {
+    return size <= KNX_TX_QUEUE_BYTES ? 0 : -1;
+  }
+  if (q_tail > q_head) {
+    if (q_tail + size <= KNX_TX_QUEUE_BYTES) {
+      return q_tail;
+    }
+    if (size <= q_head) {
+      if (q_tail < KNX_TX_QUEUE_BYTES) {
+        q_buf[q_tail] = 0; // Wrap marker
+      }
+      return 0;
+    }
+    return -1;
+  }
+  // Đã wrap: chỗ trống nằm giữa tail và head
+  return q_tail + size <= q_head ? q_tail : -1;
+}
+
+uint16_t queue_bytes_used() {
+  if (q_count == 0) return 0;
+  if (q_tail > q_head) return q_tail - q_head;
+  return KNX_TX_QUEUE_BYTES - q_head + q_tail; // Gồm cả phần bỏ trống trước wrap marker
+}
+
+// Số frame dài len byte còn thêm được vào queue
+uint16_t queue_frames_free(uint8_t len) {
+  uint16_t size = FRAME_RECORD_SIZE(len);
+  if (q_count == 0) return KNX_TX_QUEUE_BYTES / size;
+  if (q_tail > q_head) return (KNX_TX_QUEUE_BYTES - q_tail) / size + q_head / size;
+  return (q_head - q_tail) / size;
+}
+
+bool enqueue_frame(const uint8_t *data, uint8_t len) {
+  // Validation đầu vào với flow control
   if (data == nullptr) {
     LOG_ERROR(LOG_CAT_QUEUE, "Invalid data pointer");
+    metric_inc(METRIC_Q_DROPPED);
     return false;
   }
   
   if (len == 0 || len > KNX_BUFFER_MAX_SIZE) {
     LOG_ERROR(LOG_CAT_QUEUE, "Invalid frame length: %d", len);
+    metric_inc(METRIC_Q_DROPPED);
     return false;
   }
-  
-  // Copy an toàn với bounds checking
-  memcpy(queue[q_tail].data, data, len);
-  queue[q_tail].len = len;
-  
-  // Clear phần còn lại của buffer để tránh data leakage
-  if (len < KNX_BUFFER_MAX_SIZE) {
-    memset(queue[q_tail].data + len, 0, KNX_BUFFER_MAX_SIZE - len);
+
+  int32_t pos = queue_reserve(FRAME_RECORD_SIZE(len));
+  if (pos < 0) {
+    LOG_ERROR(LOG_CAT_QUEUE, "Queue full (%d frames, %d bytes) - frame dropped", q_count, queue_bytes_used());
+    metric_inc(METRIC_Q_DROPPED);
+    return false;
   }
   
-  q_tail = (q_tail + 1) % MAX_QUEUE;
+  Frame *f = frame_at(pos);
+  memcpy(f->data, data, len);
+  f->len = len;
+  f->state = FRAME_QUEUED;
+  f->nack_after = 0;
+  f->check = frame_check(data, len);
+
+  // Record chỉ thuộc queue sau khi q_count tăng (reset giữa chừng → record bị bỏ qua)
+  q_last = pos;
+  q_tail = pos + FRAME_RECORD_SIZE(len);
+  if (q_count == 0) {
+    q_head = pos;
+  }
   q_count++;
+
+  uint16_t used = queue_bytes_used();
+  // Send flow control signal: GO (if queue was nearly full)
+  if (used >= KNX_TX_QUEUE_BYTES * 0.8) {
+    LOG_WARN(LOG_CAT_QUEUE, "Queue nearly full - sending flow control signal");
+  }
+  TRACE(TRACE_Q_PUSH, len, q_count);
+  metric_inc(METRIC_Q_PUSH);
+  metric_max(METRIC_Q_HIGH_WATER, q_count);
+  metric_max(METRIC_Q_HIGH_WATER_BYTES, used);
   return true;
 }
 
-// Hàm lấy frame ra khỏi queue
-bool dequeue_frame(Frame *f) {
+// Hàm lấy frame ra khỏi queue (data / len có thể nullptr nếu chỉ cần bỏ frame)
+bool dequeue_frame(uint8_t *data, uint8_t *len) {
   if (q_count == 0) return false;
-  memcpy(f->data, queue[q_head].data, queue[q_head].len);
-  f->len = queue[q_head].len;
-  q_head = (q_head + 1) % MAX_QUEUE;
+  Frame *f = frame_at(q_head);
+  if (data != nullptr) {
+    memcpy(data, f->data, f->len);
+  }
+  if (len != nullptr) {
+    *len = f->len;
+  }
   q_count--;
+  if (q_count == 0) {
+    q_head = q_tail = q_last = 0;
+  } else {
+    q_head = queue_skip_marker(q_head + FRAME_RECORD_SIZE(f->len));
+  }
   return true;
 }
 
+Frame *peek_frame() {
+  if (q_count == 0) return nullptr;
+  return frame_at(q_head);
+}
+
+uint32_t frame_sent_time() {
+  return q_sent_time;
+}
+
+/*
+ * Xác nhận frame đầu queue: mỗi frame host gửi xuống nhận đúng 1 L_DATA_CON, theo thứ tự.
+ * Các frame bị từ chối ngay sau frame này (queue đầy, sai CRC...) được trả L_DATA_CON âm ngay sau nó.
+ */
+void confirm_frame(bool success) {
+  if (q_count == 0) return;
+  Frame *f = frame_at(q_head);
+  TRACE(TRACE_Q_CONFIRM, success, q_count);
+  metric_inc(success ? METRIC_ECHO_CONFIRMED : METRIC_ECHO_NEGATIVE);
+  rx_echo_cancel(); // Echo (nếu đang nhận dở) không còn thuộc frame nào
+  host_link_write_service(success ? (L_DATA_CON | SUCCESS) : L_DATA_CON);
+  for (uint8_t i = 0; i < f->nack_after; i++) {
+    host_link_write_service(L_DATA_CON);
+  }
+  dequeue_frame(nullptr, nullptr);
+}
+
 
 // TX STATE
 
 
 tpuart_tx_state_t parse_tx_state = TPUART_TX_IDLE;
 
+// Frame đầu queue đã được đưa xuống bus → chờ echo
 void set_echo_frame() {
-    is_echo_frame = true;
-}
-void reset_echo_frame() {
-    is_echo_frame = false;
+    if (q_count == 0) return;
+    frame_at(q_head)->state = FRAME_SENT;
+    q_sent_time = hal_millis();
+    TRACE(TRACE_ECHO_SENT, 0, q_count);
 }
 bool is_get_echo_frame() {
-    return is_echo_frame; 
+    return q_count > 0 && frame_at(q_head)->state == FRAME_SENT;
 }
 
 
@@ -113,13 +312,126 @@ bool is_get_echo_frame() {
  * 3. Nhận U_L_DATA_START_REQ | pos+1 → chờ data byte tiếp theo
  * 4. Nhận U_L_DATA_END_REQ | pos → chờ checksum byte
  * 5. Nhận checksum byte → hoàn thành frame
+ *
+ * U_CONFIGURE_REQ (NCN5120): bật marker / CRC-CCITT cho cả 2 chiều
+ * - CRC_CCITT: sau checksum, host gửi thêm 2 byte CRC (hi, lo) tính trên các byte của frame
+ * - FRAME_END_WITH_MARKER: frame chỉ được nhận khi có U_FRAME_END_IND (0xCB) ở cuối.
+ *   Giống chiều gateway → host, byte 0xCB trong data / checksum / CRC / tham số U_DIAG_REQ được host gửi 2 lần.
+ *   0xCB đơn ở bất kỳ đâu là ranh giới: frame dở bị bỏ, byte sau đó được xử lý từ IDLE.
+ *   Khi lỗi, parser bỏ qua mọi byte (kể cả U_ACK_REQ / U_CONFIGURE_REQ nằm trong data) đến marker tiếp theo
+ * Format: ... [U_L_DATA_END_REQ|pos] [checksum] [CRC hi] [CRC lo] [0xCB]
 
  * Note: bản tin request_state F1 FF FF 02 gửi sang định kì để kiểm tra trạng thái connected
  Chip tpuart sẽ phản hồi lại 1 byte để trả lời, mcu sẽ ghi nhận là connected 
  Nếu sau ghép vào 1 module thì không cần làm phần này, tại vì code cùng chạy trong 1 chip
  Tạm thời bỏ qua, không cần đến
  */
+/*
+ * Mọi trạng thái đều quay về IDLE trong giới hạn số byte:
+ * - tx_buf_idx không vượt KNX_MAX_FRAME_LEN (U_L_DATA_CONT/END_REQ với vị trí lớn hơn → resync)
+ * - TPUART_TX_END bỏ qua tối đa TPUART_TX_MAX_FRAME_BYTES byte (đủ cho 1 frame dài nhất kèm marker),
+ *   sau đó về IDLE: host đã reset / tắt marker sẽ không làm parser kẹt mãi
+ * - 0xCB chờ byte sau tối đa 1 byte
+ */
+// Lỗi giữa frame: chế độ marker → bỏ qua đến marker tiếp theo, ngược lại về IDLE
+static void tx_resync() {
+    reset_tx_state();
+    if (host_link_marker_enabled()) {
+        parse_tx_state = TPUART_TX_END;
+    }
+}
+
+// Chế độ marker: trạng thái nhận byte tự do, host gửi 0xCB 2 lần (TPUART_TX_END: chỉ khi đang bỏ qua để resync)
+static bool tx_state_escaped() {
+    switch (parse_tx_state) {
+        case TPUART_TX_CTRL:
+        case TPUART_TX_DATA:
+        case TPUART_TX_CHECKSUM:
+        case TPUART_TX_CRC_HI:
+        case TPUART_TX_CRC_LO:
+        case TPUART_TX_DIAG_ARG:
+            return true;
+        case TPUART_TX_END:
+            return !tx_frame_complete;
+        default:
+            return false;
+    }
+}
+
+// 0xCB đơn giữa frame / lúc resync: ranh giới sạch, byte tiếp theo xử lý từ IDLE
+static void tx_marker_boundary() {
+    if (parse_tx_state != TPUART_TX_END) {
+        LOG_WARN(LOG_CAT_UART, "Host frame cut by end marker - dropped");
+        metric_inc(METRIC_HOST_PARSER_RESETS);
+    }
+    reset_tx_state();
+}
+
+// Từ chối frame từ host, giữ đúng thứ tự L_DATA_CON:
+// nếu còn frame trong queue thì L_DATA_CON âm được trả sau frame cuối queue
+static void tx_frame_reject() {
+    TRACE(TRACE_Q_REJECT, 0, q_count);
+    metric_inc(METRIC_HOST_REJECTED);
+    if (q_count == 0) {
+        host_link_write_service(L_DATA_CON);
+        return;
+    }
+    Frame *last = frame_at(q_last);
+    if (last->nack_after < 0xFF) {
+        last->nack_after++;
+    }
+}
+
+// Đưa frame đã nhận đủ vào queue
+static void tx_frame_commit() {
+    metric_inc(METRIC_HOST_FRAMES);
+    if (!enqueue_frame(tx_buffer, tx_buf_idx)) {
+        tx_frame_reject();
+    }
+}
+
+// Đã nhận checksum (và CRC nếu có): kiểm tra CRC, chờ marker hoặc đưa vào queue ngay
+static void tx_frame_done() {
+    if (host_link_crc_enabled() && crc_ccitt(tx_buffer, tx_buf_idx) != tx_crc_rx) {
+        LOG_WARN(LOG_CAT_UART, "Host frame CRC mismatch - dropped");
+        metric_inc(METRIC_HOST_CRC_ERRORS);
+        tx_frame_reject(); // L_DATA_CON không có SUCCESS
+        tx_resync();
+        return;
+    }
+    if (host_link_marker_enabled()) {
+        tx_frame_complete = true;
+        parse_tx_state = TPUART_TX_END;
+        return;
+    }
+    tx_frame_commit();
+    reset_tx_state();
+}
+
 void knx_parse_MCU_byte(uint8_t byte) {
+    TRACE(TRACE_HOST_BYTE, byte, parse_tx_state);
+    tx_last_byte_ms = hal_millis();
+    bool literal = false; // 0xCB 0xCB trong vùng data = 1 byte 0xCB
+    if (tx_marker_pending) {
+        tx_marker_pending = false;
+        if (byte == U_FRAME_END_IND) {
+            literal = true;
+        } else {
+            tx_marker_boundary();
+        }
+    } else if (byte == U_FRAME_END_IND && host_link_marker_enabled() && parse_tx_state != TPUART_TX_IDLE) {
+        if (tx_state_escaped()) {
+            tx_marker_pending = true;
+            tx_busy_bytes++;
+            return;
+        }
+        if (parse_tx_state != TPUART_TX_END) {
+            // CONT / DIAG / DIAG_LEN không nhận 0xCB: marker, frame / lệnh bị cắt
+            tx_marker_boundary();
+            return;
+        }
+    }
+    tx_busy_bytes = parse_tx_state == TPUART_TX_IDLE ? 0 : tx_busy_bytes + 1;
     switch (parse_tx_state) {
         case TPUART_TX_IDLE:
             if (byte == U_L_DATA_START_REQ) { // example: start of frame (high bit set)
@@ -129,16 +441,33 @@ void knx_parse_MCU_byte(uint8_t byte) {
                // DEBUG_SERIAL.print(1);
                 break;
             }
-            else if ((byte &0xF0) == U_ACK_REQ) {
+            else if ((byte & 0xF8) == U_CONFIGURE_REQ) {
+                // Cấu hình framing cho cả 2 chiều, phản hồi U_CONFIGURE_IND
+                uint8_t config = 0;
+                if (byte & U_CONFIGURE_MARKER_REQ) config |= FRAME_END_WITH_MARKER;
+                if (byte & U_CONFIGURE_CRC_CCITT_REQ) config |= CRC_CCITT;
+                host_link_configure(config);
+                host_link_write_service(U_CONFIGURE_IND | config);
+                LOG_INFO(LOG_CAT_UART, "Host link configured: marker=%d crc=%d",
+                         host_link_marker_enabled(), host_link_crc_enabled());
+            }
+            else if (byte == U_DIAG_REQ) {
+                // Lệnh chẩn đoán riêng: byte tiếp theo là sub-command
+                parse_tx_state = TPUART_TX_DIAG;
+            }
+            else if ((byte & 0xF8) == U_ACK_REQ) {
                 ack_value = byte&0x0F;
                 if(ack_value) {
                 pending_ack = true;
+                if (rx_dedup_noted) {
+                    rx_dedup_note_ack_request(); // U_ACK_REQ tới sau checksum, telegram đã vào cache
+                }
                 }
             }
            // DEBUG_SERIAL.print(3);
             break;
         case TPUART_TX_CTRL:
-            tx_buffer[tx_buf_idx++] = byte;
+            tx_buffer[tx_buf_idx++] = byte; // tx_buf_idx = 0
             parse_tx_state = TPUART_TX_CONT;
             //DEBUG_SERIAL.print(4);
             break;
@@ -148,31 +477,90 @@ void knx_parse_MCU_byte(uint8_t byte) {
             parse_tx_state = TPUART_TX_CONT;
             break;  
         case TPUART_TX_CONT:
-            if((byte & 0xF0) == U_L_DATA_CONT_REQ && ((byte & 0x3F)==tx_buf_idx)){ // example: continue of frame (high bit set)    
+            // CONT: 0x80-0xBF, END: 0x40-0x7F, 6 bit thấp = vị trí byte tiếp theo
+            // Còn chỗ cho byte data + checksum (CONT) / checksum (END) trong tx_buffer
+            if((byte & 0xC0) == U_L_DATA_CONT_REQ && ((byte & 0x3F)==tx_buf_idx) &&
+               tx_buf_idx + 2 <= KNX_MAX_FRAME_LEN){
                 parse_tx_state = TPUART_TX_DATA;
-            } else if(((byte & 0xF0) == U_L_DATA_END_REQ) && ((byte & 0x3F)==tx_buf_idx)){ // example: end of frame (bit7)
+            } else if(((byte & 0xC0) == U_L_DATA_END_REQ) && ((byte & 0x3F)==tx_buf_idx) &&
+                      tx_buf_idx + 1 <= KNX_MAX_FRAME_LEN){
                 parse_tx_state = TPUART_TX_CHECKSUM;
             }
             else {
                 // Invalid byte in CONT state, reset
-                reset_tx_state();
-                parse_tx_state = TPUART_TX_IDLE;
+                metric_inc(METRIC_HOST_PARSER_RESETS);
+                tx_resync();
             }
             break;
         case TPUART_TX_CHECKSUM:
             tx_buffer[tx_buf_idx++] = byte;
-            enqueue_frame(tx_buffer, tx_buf_idx);
-           // DEBUG_SERIAL.print("Enqueued frame: ");
-            for(int i=0; i<tx_buf_idx; i++) {
-              //DEBUG_SERIAL.print(tx_buffer[i], HEX);
+            if (host_link_crc_enabled()) {
+                parse_tx_state = TPUART_TX_CRC_HI;
+            } else {
+                tx_frame_done();
+            }
+            break;
+        case TPUART_TX_CRC_HI:
+            tx_crc_rx = (uint16_t)byte << 8;
+            parse_tx_state = TPUART_TX_CRC_LO;
+            break;
+        case TPUART_TX_CRC_LO:
+            tx_crc_rx |= byte;
+            tx_frame_done();
+            break;
+        case TPUART_TX_END:
+            // Chờ U_FRAME_END_IND: chỉ nhận frame khi đúng marker, ngược lại bỏ frame.
+            // Đang resync: marker đơn đã được xử lý ở trên, ở đây chỉ còn byte bị bỏ qua
+            if (byte != U_FRAME_END_IND || literal) {
+                if (tx_frame_complete) {
+                    LOG_WARN(LOG_CAT_UART, "Host frame without end marker - dropped");
+                    metric_inc(METRIC_HOST_MARKER_ERRORS);
+                    tx_frame_complete = false;
+                    tx_frame_reject();
+                }
+                tx_skip_count += literal ? 2 : 1;
+                if (tx_skip_count >= TPUART_TX_MAX_FRAME_BYTES) {
+                    // Không thấy marker sau cả 1 frame dài nhất: host không còn ở chế độ marker
+                    metric_inc(METRIC_HOST_PARSER_RESETS);
+                    reset_tx_state();
+                }
+                break;
+            }
+            if (tx_frame_complete) {
+                tx_frame_commit();
             }
-            //DEBUG_SERIAL.println();
-
-            set_echo_frame();
             reset_tx_state();
+            break;
+        case TPUART_TX_DIAG:
+            if (byte & DIAG_SUB_ARGS) {
+                diag_sub = byte;
+                parse_tx_state = TPUART_TX_DIAG_LEN;
+                break;
+            }
+            host_diag_request(byte, nullptr, 0);
             parse_tx_state = TPUART_TX_IDLE;
             break;
-        case TPUART_TX_END:
+        case TPUART_TX_DIAG_LEN:
+            if (byte > DIAG_ARG_MAX) {
+                metric_inc(METRIC_HOST_PARSER_RESETS);
+                tx_resync();
+                break;
+            }
+            diag_arg_len = byte;
+            diag_arg_idx = 0;
+            if (diag_arg_len == 0) {
+                host_diag_request(diag_sub, diag_args, 0);
+                parse_tx_state = TPUART_TX_IDLE;
+                break;
+            }
+            parse_tx_state = TPUART_TX_DIAG_ARG;
+            break;
+        case TPUART_TX_DIAG_ARG:
+            diag_args[diag_arg_idx++] = byte;
+            if (diag_arg_idx >= diag_arg_len) {
+                host_diag_request(diag_sub, diag_args, diag_arg_len);
+                parse_tx_state = TPUART_TX_IDLE;
+            }
             break;
     }
 }
@@ -187,6 +575,24 @@ uint8_t get_ack_value() {
     return ack_value;
 }
 
+// Như U_ACK_REQ từ host, cho frame đang nhận (coupler ACK telegram nó route)
+void set_pending_ack(uint8_t value) {
+    ack_value = value & 0x0F;
+    if (ack_value) {
+        pending_ack = true;
+        if (rx_dedup_noted) {
+            rx_dedup_note_ack_request();
+        }
+    }
+}
+
+void ack_sent(uint8_t ack) {
+    if (rx_dedup_noted) {
+        rx_dedup_note_ack(ack); // Bản lặp (nếu có) được ACK giống bản này
+        rx_dedup_noted = false;
+    }
+}
+
 void reset_pending_ack() {
     pending_ack = false;
     ack_value = 0;
@@ -196,8 +602,15 @@ void reset_pending_ack() {
 
 // TX STATE functions
 void reset_tx_state() {
+    TRACE(TRACE_TX_RESET, parse_tx_state, tx_buf_idx);
     parse_tx_state = TPUART_TX_IDLE;
     tx_buf_idx = 0;
+    tx_frame_complete = false;
+    tx_crc_rx = 0;
+    tx_skip_count = 0;
+    tx_marker_pending = false;
+    diag_arg_len = 0;
+    diag_arg_idx = 0;
     memset(tx_buffer, 0, sizeof(tx_buffer));
 }
 
@@ -214,13 +627,127 @@ void reset_tx_state() {
  * 
  * QUY TRÌNH:
  * 1. Phát hiện L_DATA_STANDARD_IND/L_DATA_EXTENDED_IND → bắt đầu frame
- * 2. Forward tất cả byte lên MCU
- * 3. Tính toán độ dài frame từ byte thứ 5 (standard) hoặc byte thứ 6 (extended)
- * 4. Khi nhận đủ frame → set checksum done
- * 5. Nếu là echo frame → gửi L_DATA_CON | SUCCESS
+ * 2. Forward tất cả byte lên MCU (nếu bật RX filter: giữ header đến khi nhận đủ
+ *    địa chỉ đích rồi mới quyết định forward hay bỏ phần còn lại của frame)
+ * 3. Tính toán độ dài frame từ byte LG (index 5 standard / 6 extended, xem knx_frame.h)
+ * 4. Khi nhận đủ frame → set checksum done; checksum (XOR tích luỹ từng byte) và độ dài được kiểm tra
+ *    ngay ở byte checksum - frame sai checksum / độ dài / parity không được ACK, không được confirm
+ * 5. Nếu là echo frame (so khớp từng byte với frame đã gửi):
+ *    - khớp hoàn toàn + bus ACK (0xCC) → L_DATA_CON | SUCCESS
+ *    - sai byte / sai độ dài / NACK / BUSY / không có ACK → L_DATA_CON (âm)
  */
 tpuart_rx_state_t parse_rx_state = TPUART_RX_IDLE;
+
+// Forward 1 byte của frame đang nhận: giữ lại nếu chưa quyết định, bỏ qua nếu bị lọc
+static void rx_forward_byte(uint8_t byte) {
+    if ((rx_hold || rx_dedup_is_enabled()) && rx_held_len < KNX_MAX_FRAME_LEN) {
+        rx_held[rx_held_len++] = byte;
+    }
+    if (!rx_hold && rx_forward) {
+        host_link_frame_byte(byte);
+    }
+}
+
+// Bắt đầu frame mới: nếu bộ lọc bật (hoặc có thể là bản lặp bị bỏ) thì giữ header lại để quyết định sau
+static void rx_forward_begin(uint8_t ctrl_byte) {
+    rx_xor = ctrl_byte;
+    rx_held_len = 0;
+    rx_forward = true;
+    rx_is_repeat = !(ctrl_byte & KNX_CTRL_REPEAT_FLAG);
+    rx_hold = rx_filter_is_enabled() || (rx_is_repeat && rx_dedup_is_enabled() && !is_get_echo_frame());
+    if (!rx_hold) {
+        rx_filter_record(true);
+        host_link_frame_begin(KNX_LINE_MAIN);
+    }
+    rx_forward_byte(ctrl_byte);
+}
+
+// Đã nhận đủ địa chỉ đích và bit AT: quyết định forward hay bỏ phần còn lại của frame
+static void rx_forward_decide() {
+    if (!rx_hold || rx_buf_idx != knx_frame_addr_len(is_extended_frame)) {
+        return;
+    }
+    knx_frame_view_t hdr(rx_held, rx_held_len);
+    // Echo frame của chính mình luôn được forward
+    bool echo = is_get_echo_frame();
+    rx_forward = echo || rx_filter_match(hdr.destination(), hdr.is_group());
+    rx_filter_record(rx_forward);
+    // Bản lặp của telegram cùng địa chỉ vừa forward: giữ tới checksum để so nội dung
+    rx_repeat_hold = rx_forward && rx_is_repeat && !echo && rx_dedup_is_enabled() &&
+                     rx_dedup_candidate(hdr.source(), hdr.destination(), hal_millis());
+    rx_hold = rx_repeat_hold;
+    if (rx_forward && !rx_hold) {
+        host_link_frame_begin(KNX_LINE_MAIN);
+        host_link_frame_bytes(rx_held, rx_held_len);
+    }
+}
+
+// Bản lặp đã nhận đủ: bỏ nếu trùng telegram đã forward (ACK lại như bản đầu), ngược lại forward cả frame
+static void rx_repeat_decide() {
+    rx_hold = false;
+    rx_repeat_hold = false;
+    uint8_t ack = 0;
+    if (rx_frame_ok && rx_dedup_match(knx_frame_view_t(rx_held, rx_held_len), hal_millis(), &ack)) {
+        rx_forward = false;
+        if (ack) {
+            pending_ack = true;
+            ack_value = ack;
+            metric_inc(METRIC_RX_REPEAT_ACKS);
+        }
+        return;
+    }
+    host_link_frame_begin(KNX_LINE_MAIN);
+    host_link_frame_bytes(rx_held, rx_held_len);
+}
+
+// So khớp byte thứ idx của frame đang nhận với frame đã gửi
+static void rx_echo_check(uint8_t idx, uint8_t byte) {
+    if (!rx_echo_match) {
+        return;
+    }
+    Frame *f = peek_frame();
+    rx_echo_match = (f != nullptr) && idx < f->len && f->data[idx] == byte;
+}
+
+static void rx_echo_cancel() {
+    rx_is_echo = false;
+    rx_echo_match = false;
+    if (parse_rx_state == TPUART_RX_END_ECHO) {
+        reset_rx_state();
+    }
+}
+
+// Đánh dấu lỗi bit-level (parity...) cho byte sắp parse, báo trong U_FRAME_STATE_IND
+// Ở IDLE: áp dụng cho frame nếu byte đó là control byte, bị xoá nếu không bắt đầu frame
+void knx_mark_BUS_error(uint8_t error_flags) {
+    rx_frame_state |= error_flags;
+}
+
+/*
+ * Không có byte mới trên bus quá lâu: kết thúc frame đang nhận.
+ * Echo đã khớp nhưng không có ACK từ bus (hoặc echo bị cắt ngang) → L_DATA_CON âm
+ */
+void knx_BUS_gap_timeout() {
+    if (parse_rx_state == TPUART_RX_IDLE) {
+        return;
+    }
+    TRACE(TRACE_RX_GAP, parse_rx_state, rx_is_echo);
+    if (parse_rx_state != TPUART_RX_ACK && parse_rx_state != TPUART_RX_END_ECHO) {
+        metric_inc(METRIC_RX_GAP_ABORTS); // Chưa nhận hết checksum
+    }
+    if (rx_is_echo) {
+        metric_inc(METRIC_ECHO_LOST);
+        TRACE_TRIGGER(TRACE_TRIG_ECHO_LOST);
+        LOG_DEBUG(LOG_CAT_ECHO_ACK, "Echo without bus ACK - negative confirmation");
+        confirm_frame(false);
+    }
+    // ACK window của frame đã qua: U_ACK_REQ đến muộn (hoặc cho frame hỏng) không được áp dụng cho frame sau
+    reset_pending_ack();
+    reset_rx_state();
+}
+
 void knx_parse_BUS_byte(uint8_t byte) {
+    TRACE(TRACE_RX_BYTE, byte, parse_rx_state | (rx_frame_state << 8));
     switch (parse_rx_state) {
         case TPUART_RX_IDLE:
             // Kiểm tra control byte đầu: L_DATA_STANDARD_IND hoặc L_DATA_EXTENDED_IND
@@ -228,49 +755,56 @@ void knx_parse_BUS_byte(uint8_t byte) {
                 rx_buf_idx = 1; // Bắt đầu từ byte 1 (đã có control byte)
                 rx_buf_len = 0; // Chưa biết độ dài
                 is_extended_frame = false; // Standard frame
-                MCU_SERIAL.write(byte); // Forward control byte đầu
+                rx_forward_begin(byte); // Forward control byte đầu
                 parse_rx_state = TPUART_RX_DATA;
                // DEBUG_SERIAL.write(0XAA);
             } else if ((byte & L_DATA_MASK) == L_DATA_EXTENDED_IND) {
                 rx_buf_idx = 1;
                 rx_buf_len = 0;
                 is_extended_frame = true; // Extended frame
-                MCU_SERIAL.write(byte); // Forward control byte đầu
+                rx_forward_begin(byte); // Forward control byte đầu
                 parse_rx_state = TPUART_RX_DATA;
               //  DEBUG_SERIAL.write(0XBB);
+            } else if ((byte & L_ACKN_MASK) == L_ACKN_IND) {
+                // Ký tự ACK / NACK / BUSY ngoài frame → L_ACKN_IND cho host
+                host_link_write_service(byte);
+                rx_frame_state = 0;
+                break;
             } else {
-                // Các control byte khác (L_ACKN_IND, L_DATA_CON, etc.) → forward ngay
-                MCU_SERIAL.write(byte);
-
+                // Byte rời khác (nhiễu, frame bị cắt): không forward - host có thể hiểu nhầm
+                // thành L_DATA_CON / U_STATE_IND không thuộc frame nào
+                metric_inc(METRIC_RX_STRAY_BYTES);
+                rx_frame_state = 0;
+                break;
             }
+            // Frame đầu tiên sau khi gửi là echo của frame đầu queue
+            rx_is_echo = is_get_echo_frame();
+            rx_echo_match = rx_is_echo;
+            rx_echo_check(0, byte);
             break;
 
         case TPUART_RX_DATA:
             // Forward data byte lên MCU
-            MCU_SERIAL.write(byte);
+            rx_forward_byte(byte);
+            rx_xor ^= byte;
+            rx_echo_check(rx_buf_idx, byte);
             rx_buf_idx++;
+            rx_forward_decide();
             
-            // Tính toán độ dài frame khi đã có đủ thông tin
-            // Format TP frame: header (8/9) + payload + checksum (1)
-            // rx_buf_idx bắt đầu từ 1 (sau control byte đầu), nên cần nhận thêm header + payload byte
-            if (rx_buf_len == 0) {
-                if (!is_extended_frame && rx_buf_idx == 6) {
-                    // Standard frame: byte 5 (index 5, tức byte thứ 6 của frame) chứa payload length (4 bit thấp)
-                    // Header = 8 byte, payload từ byte này
-                    uint8_t payload_length = byte & 0x0F;
-                    rx_buf_len = 8 + payload_length; // Header (8) + payload (không tính checksum)
-                } else if (is_extended_frame && rx_buf_idx == 7) {
-                    // Extended frame: byte 6 (index 6, tức byte thứ 7 của frame) chứa payload length
-                    // Header = 9 byte, payload từ byte này
-                    uint8_t payload_length = byte;
-                    rx_buf_len = 9 + payload_length; // Header (9) + payload (không tính checksum)
+            // Byte LG (standard: byte 5, 4 bit thấp; extended: byte 6) → độ dài cả frame gồm checksum
+            // rx_buf_idx đã tăng qua byte vừa nhận
+            if (rx_buf_len == 0 && rx_buf_idx == knx_frame_len_offset(is_extended_frame) + 1) {
+                uint16_t frame_len = knx_frame_total_len(is_extended_frame, byte);
+                if (frame_len > KNX_MAX_FRAME_LEN) {
+                    // Độ dài không hợp lệ: kết thúc frame ở KNX_MAX_FRAME_LEN byte
+                    // thay vì nhận tiếp tới khi bus im lặng
+                    rx_frame_state |= CHECKSUM_LENGTH_ERROR;
+                    frame_len = KNX_MAX_FRAME_LEN;
                 }
+                rx_buf_len = (uint8_t)frame_len;
             }
             
-            // Kiểm tra đã nhận đủ frame chưa (trừ checksum)
-            // rx_buf_len = header + payload, cần thêm 1 byte checksum
-
-            //Note: cần check lại length xem chuyển state ở đoạn nào
+            // Đã nhận đủ frame trừ byte cuối → byte tiếp theo là checksum
             if (rx_buf_len > 0 && rx_buf_idx >= rx_buf_len - 1) {
                 // Đã nhận đủ data, byte tiếp theo là checksum
                 parse_rx_state = TPUART_RX_CHECKSUM;
@@ -279,16 +813,50 @@ void knx_parse_BUS_byte(uint8_t byte) {
             
         case TPUART_RX_CHECKSUM:
             // Checksum byte - forward lên MCU
-            MCU_SERIAL.write(byte);
+            rx_forward_byte(byte);
+            // O(1): XOR các byte trước đã tích luỹ trong rx_xor, độ dài đã kiểm tra ở byte length
+            if ((uint8_t)(rx_xor ^ byte) != 0xFF) {
+                rx_frame_state |= CHECKSUM_LENGTH_ERROR;
+            }
+            metric_inc(METRIC_RX_FRAMES);
+            if (rx_frame_state & CHECKSUM_LENGTH_ERROR) {
+                metric_inc(METRIC_RX_CHECKSUM_ERRORS);
+            }
+            rx_frame_ok = (rx_frame_state & (CHECKSUM_LENGTH_ERROR | PARITY_BIT_ERROR)) == 0;
+            if (!rx_frame_ok && pending_ack) {
+                // Không ACK frame hỏng: bên gửi không thấy ACK sẽ lặp lại frame
+                metric_inc(METRIC_RX_ACK_SUPPRESSED);
+                reset_pending_ack();
+            }
+            if (rx_frame_ok && rx_is_repeat) {
+                metric_inc(METRIC_RX_REPEATS);
+            }
+            if (rx_repeat_hold) {
+                rx_repeat_decide();
+            }
+            host_link_frame_end(rx_frame_state);
+            if (rx_forward && rx_frame_ok && !rx_is_echo && rx_dedup_is_enabled() && rx_held_len == rx_buf_idx + 1) {
+                rx_dedup_insert(knx_frame_view_t(rx_held, rx_held_len), hal_millis(), pending_ack);
+                rx_dedup_noted = true;
+            }
             set_rx_checksum();
             rx_checksum_byte = true;
             
-            // Kiểm tra xem có phải echo frame không
-            if (is_get_echo_frame()&& pending_ack) {
-                parse_rx_state = TPUART_RX_END_ECHO;
-            } else {
-                parse_rx_state = TPUART_RX_ACK;
+            // Kiểm tra xem có phải echo frame không (frame đầu queue đang chờ echo)
+            if (rx_is_echo) {
+                rx_echo_check(rx_buf_idx, byte);
+                Frame *f = peek_frame();
+                if (rx_echo_match && rx_frame_ok && f != nullptr && rx_buf_idx + 1 == f->len) {
+                    // Echo khớp → chờ ACK từ bus
+                    parse_rx_state = TPUART_RX_END_ECHO;
+                    break;
+                }
+                // Frame trên bus khác frame đã gửi (collision / frame của thiết bị khác)
+                LOG_DEBUG(LOG_CAT_ECHO_ACK, "Echo mismatch - negative confirmation");
+                metric_inc(METRIC_ECHO_MISMATCH);
+                confirm_frame(false);
             }
+            parse_rx_state = TPUART_RX_ACK;
             break;
             
         case TPUART_RX_ACK:
@@ -299,19 +867,69 @@ void knx_parse_BUS_byte(uint8_t byte) {
             break;
             
         case TPUART_RX_END_ECHO:
-            // Frame echo hoàn thành → gửi L_DATA_CON | SUCCESS lên MCU
+            // Byte ACK từ bus sau echo: chỉ ACK (0xCC) mới là gửi thành công
             reset_rx_state();
-            reset_echo_frame(); // Reset echo flag
-            MCU_SERIAL.write(L_DATA_CON | SUCCESS);
+            if (byte != KNX_BUS_ACK) {
+                metric_inc(METRIC_ECHO_BUS_NACK);
+            }
+            confirm_frame(byte == KNX_BUS_ACK);
             parse_rx_state = TPUART_RX_IDLE;
             break;
     }
 }
+// Frame hợp lệ trên bus đã nhận xong checksum, đang chờ ký tự ACK
+bool is_rx_waiting_ack() {
+    return parse_rx_state == TPUART_RX_ACK && rx_frame_ok;
+}
+
+tpuart_tx_state_t tpuart_tx_state() {
+    return parse_tx_state;
+}
+
+uint8_t tpuart_tx_index() {
+    return tx_buf_idx;
+}
+
+uint16_t tpuart_tx_busy_bytes() {
+    return tx_busy_bytes;
+}
+
+tpuart_rx_state_t tpuart_rx_state() {
+    return parse_rx_state;
+}
+
+uint8_t tpuart_rx_index() {
+    return rx_buf_idx;
+}
+
+// Đang nhận dở frame từ host
+bool is_tx_frame_pending() {
+    return parse_tx_state != TPUART_TX_IDLE;
+}
+
+// Frame dở dang mà host không gửi thêm byte nào (marker mode không có gap reset)
+bool is_tx_frame_stalled(uint32_t now_ms) {
+    return is_tx_frame_pending() && (now_ms - tx_last_byte_ms) > RECOVERY_PARSER_STALL_MS;
+}
+
 void reset_rx_state() {
+    TRACE(TRACE_RX_RESET, parse_rx_state, rx_buf_idx);
+    host_link_frame_abort(); // Frame đang gửi dở lên MCU (nếu có)
     parse_rx_state = TPUART_RX_IDLE;
     rx_buf_idx = 0;
     rx_buf_len = 0;
     is_extended_frame = false;
+    rx_held_len = 0;
+    rx_hold = false;
+    rx_forward = true;
+    rx_is_repeat = false;
+    rx_repeat_hold = false;
+    rx_dedup_noted = false;
+    rx_xor = 0;
+    rx_frame_state = 0;
+    rx_frame_ok = false;
+    rx_is_echo = false;
+    rx_echo_match = false;
 }
 
 
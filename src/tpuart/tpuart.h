@@ -53,6 +53,11 @@
 #define L_DATA_CON_MASK 0x7F
 #define SUCCESS 0x80
 
+// Ký tự ACK trên bus KNX (gửi sau checksum 15 bit time)
+#define KNX_BUS_ACK 0xCC
+#define KNX_BUS_NACK 0x0C
+#define KNX_BUS_BUSY 0xC0
+
 // control services, device specific
 #define U_RESET_IND 0x03
 #define U_STATE_MASK 0x07
@@ -76,6 +81,7 @@
 #define U_FRAME_END_IND 0xCB
 #define U_STOP_MODE_IND 0x2B
 #define U_SYSTEM_STAT_IND 0x4B
+#define U_CHANNEL_IND 0xFC          // Coupler: byte đầu mỗi frame bus = U_CHANNEL_IND | line (host_link.h)
 
 /*
  * NCN51xx Register handling
@@ -106,9 +112,18 @@ typedef enum{
     TPUART_TX_LENGTH,
     TPUART_TX_DATA,
     TPUART_TX_CHECKSUM,
+    TPUART_TX_CRC_HI,
+    TPUART_TX_CRC_LO,
     TPUART_TX_END,
+    TPUART_TX_DIAG,     // Chờ sub-command sau U_DIAG_REQ
+    TPUART_TX_DIAG_LEN, // Sub-command có tham số: chờ độ dài
+    TPUART_TX_DIAG_ARG, // Tham số của sub-command
 } tpuart_tx_state_t;
 
+// Số byte host gửi cho 1 frame dài nhất: tối đa 3 byte cho mỗi byte frame ([START/CONT/END|i][data], 0xCB gửi 2 lần)
+// + CRC 4 byte + marker - cũng là số byte tối đa bỏ qua ở TPUART_TX_END khi chờ marker
+#define TPUART_TX_MAX_FRAME_BYTES (3 * KNX_MAX_FRAME_LEN + 5)
+
 //RX State
 typedef enum{
     TPUART_RX_IDLE,
@@ -123,15 +138,21 @@ typedef enum{
 } tpuart_rx_state_t;
 
 
-#define MAX_QUEUE 50  // tối đa 5 frame chờ gửi
+// Trạng thái xác nhận của từng frame trong queue
+typedef enum {
+    FRAME_QUEUED = 0,  // Chờ gửi xuống bus
+    FRAME_SENT,        // Đã gửi, chờ echo để trả L_DATA_CON (chỉ frame đầu queue)
+} frame_state_t;
+
+// Record trong queue TX (KNX_TX_QUEUE_BYTES byte): header 4 byte + data đúng độ dài thật
 struct Frame {
-  uint8_t data[KNX_BUFFER_MAX_SIZE];
-  uint8_t len;
+  uint8_t len;         // 0 = wrap marker (chỉ nằm trong ring, không bao giờ trả ra ngoài)
+  uint8_t state;       // frame_state_t
+  uint8_t nack_after;  // Số frame từ host bị từ chối ngay sau frame này (L_DATA_CON âm trả sau nó)
+  uint8_t check;       // CRC của data[0..len) - kiểm tra record còn nguyên sau warm restart
+  uint8_t data[];
 };
 
-extern Frame queue[MAX_QUEUE];
-extern volatile uint8_t q_head;
-extern volatile uint8_t q_tail;
 extern volatile uint8_t q_count;
 
 
@@ -139,23 +160,46 @@ int parse_TPUART_frame(uint8_t *in, int len_in, uint8_t *buffer_out);
 
 // TX STATE
 void knx_parse_MCU_byte(uint8_t byte);
+// Trạng thái parser (fuzz / chẩn đoán): tx / rx = *_state_t, idx = vị trí byte trong buffer / frame
+tpuart_tx_state_t tpuart_tx_state();
+uint8_t tpuart_tx_index();
+uint16_t tpuart_tx_busy_bytes(); // Số byte đã nhận từ lần cuối parser ở IDLE (0xCB đơn cắt frame → IDLE ngay trong byte sau)
+tpuart_rx_state_t tpuart_rx_state();
+uint8_t tpuart_rx_index();
 
 // Hàm thêm frame vào queue
 bool enqueue_frame(const uint8_t *data, uint8_t len);
-// Hàm lấy frame ra khỏi queue
-bool dequeue_frame(Frame *f);
+// Hàm lấy frame ra khỏi queue (data / len có thể nullptr)
+bool dequeue_frame(uint8_t *data, uint8_t *len);
+// Frame đầu queue (frame đang gửi / sắp gửi), nullptr nếu queue rỗng - con trỏ vào ring, hợp lệ tới lần dequeue
+Frame *peek_frame();
+// millis() lúc frame đầu queue được đưa xuống bus (FRAME_SENT)
+uint32_t frame_sent_time();
+// Sau khi sửa data của frame trong queue
+void frame_update_check(Frame *f);
+// Dung lượng: byte đang dùng (gồm phần bỏ trống trước wrap) / số frame len byte còn thêm được
+uint16_t queue_bytes_used();
+uint16_t queue_frames_free(uint8_t len);
+// Trả L_DATA_CON cho frame đầu queue rồi bỏ nó khỏi queue
+void confirm_frame(bool success);
+// Warm restart (queue nằm trong .noinit)
+void queue_clear();
+bool queue_validate();
 
 void reset_tx_state();
+bool is_tx_frame_pending();
+bool is_tx_frame_stalled(uint32_t now_ms);
 void set_tx_complete();
 void reset_rx_state();
 bool is_tx_complete();
 
-// Echo frame handling
+// Echo frame handling (theo frame đầu queue)
 void set_echo_frame();
 bool is_get_echo_frame();
-void reset_echo_frame();
 // RX STATE
 void knx_parse_BUS_byte(uint8_t byte);
+void knx_mark_BUS_error(uint8_t error_flags);
+void knx_BUS_gap_timeout();
 
 void set_rx_checksum();
 void reset_rx_checksum();
@@ -165,8 +209,14 @@ void reset_rx_state();
 
 // ACK handling functions
 bool is_pending_ack();
+// Chỉ true cho frame đúng checksum / độ dài / parity (frame hỏng không được ACK)
+bool is_rx_waiting_ack();
 void reset_pending_ack();
 uint8_t get_ack_value();
+// Đặt ACK cho frame đang nhận như khi host gửi U_ACK_REQ | value (coupler)
+void set_pending_ack(uint8_t value);
+// Gateway đã gửi ký tự ACK cho frame vừa nhận (rx_dedup ACK lại bản lặp giống vậy)
+void ack_sent(uint8_t ack);
 
 //RX
 #endif
@@ -0,0 +1,159 @@
+#include "trace.h"
+
+#if KNX_TRACE_ENABLE
+
+#include "hal/hal.h"
+#include "logger.h"
+#include "tpuart/host_diag.h"
+
+#define TRACE_MAGIC 0x54524331u  // "TRC1"
+#define TRACE_MASK (KNX_TRACE_DEPTH - 1)
+#define TRACE_ENTRIES_PER_MSG 7  // 7 x 8 byte / U_DIAG_IND
+
+typedef struct {
+    uint32_t magic;
+    volatile uint32_t head;        // Tổng số entry đã ghi (index = head & TRACE_MASK)
+    volatile uint32_t frozen_at;   // head lúc freeze (hợp lệ khi frozen)
+    volatile uint8_t frozen;
+    volatile uint8_t reason;       // trace_trigger_t
+    volatile uint8_t post_remaining;
+    volatile uint8_t triggered;
+} trace_hdr_t;
+
+// .noinit: không bị startup xoá / khởi tạo → giữ được qua reset (không qua mất nguồn)
+static trace_hdr_t trace_hdr __attribute__((section(".noinit")));
+static trace_entry_t trace_ring[KNX_TRACE_DEPTH] __attribute__((section(".noinit")));
+
+static void trace_clear(void) {
+    trace_hdr.head = 0;
+    trace_hdr.frozen_at = 0;
+    trace_hdr.frozen = 0;
+    trace_hdr.reason = TRACE_TRIG_NONE;
+    trace_hdr.post_remaining = 0;
+    trace_hdr.triggered = 0;
+    memset(trace_ring, 0, sizeof(trace_ring));
+    trace_hdr.magic = TRACE_MAGIC;
+}
+
+void trace_init(void) {
+    hal_cycles_init();
+
+    uint32_t reset_flags = hal_reset_flags();
+
+    if (trace_hdr.magic != TRACE_MAGIC || (reset_flags & HAL_RESET_FLAG_POR)) {
+        // Mất nguồn: RAM không còn ý nghĩa
+        trace_clear();
+    } else if (!trace_hdr.frozen) {
+        // Reset không qua mất nguồn (watchdog, software, chân NRST...): giữ lại trace trước lúc reset cho host đọc
+        trace_hdr.frozen = 1;
+        trace_hdr.reason = TRACE_TRIG_RESET;
+        trace_hdr.frozen_at = trace_hdr.head;
+    }
+
+    if (trace_hdr.frozen) {
+        LOG_WARN(LOG_CAT_SYSTEM, "Trace frozen before reset (reason %d, %lu entries) - dump with DIAG_TRACE_DUMP",
+                 trace_hdr.reason, trace_hdr.frozen_at);
+    } else {
+        TRACE(TRACE_BOOT, 0, reset_flags >> 24);
+    }
+}
+
+void trace_record(uint8_t event, uint8_t a, uint16_t b) {
+    if (trace_hdr.frozen) {
+        return;
+    }
+    uint32_t idx = __atomic_fetch_add(&trace_hdr.head, 1, __ATOMIC_RELAXED);
+    trace_entry_t *e = &trace_ring[idx & TRACE_MASK];
+    e->cycles = hal_cycles();
+    e->event = event;
+    e->a = a;
+    e->b = b;
+
+    // Đếm ngược sau trigger (chỉ 1 context thắng khi về 0)
+    if (trace_hdr.triggered) {
+        uint8_t left = __atomic_sub_fetch(&trace_hdr.post_remaining, 1, __ATOMIC_RELAXED);
+        if (left == 0) {
+            trace_hdr.frozen_at = idx + 1;
+            trace_hdr.frozen = 1;
+        }
+    }
+}
+
+void trace_trigger(uint8_t reason) {
+    if (trace_hdr.frozen || trace_hdr.triggered || !(KNX_TRACE_TRIGGER_MASK & TRACE_TRIG_BIT(reason))) {
+        return;
+    }
+    trace_hdr.reason = reason;
+    trace_hdr.post_remaining = KNX_TRACE_POST_TRIGGER + 1; // Gồm cả entry TRACE_TRIGGER
+    trace_hdr.triggered = 1;
+    trace_record(TRACE_TRIGGER, reason, 0);
+}
+
+void trace_arm(void) {
+    uint32_t irq = hal_irq_save();
+    trace_clear();
+    hal_irq_restore(irq);
+}
+
+bool trace_is_frozen(void) {
+    return trace_hdr.frozen != 0;
+}
+
+// Dump đang gửi: ring tạm dừng ghi, khoảng [dump_start, dump_start + dump_count) chụp lúc bắt đầu
+static bool dump_was_frozen;
+static uint32_t dump_start;
+static uint32_t dump_count;
+
+/*
+ * Message đầu: [frozen] [reason] [số entry u16] [depth u16] [SystemCoreClock u32]
+ * Tiếp theo:   [index bắt đầu u16] [tối đa 7 entry x 8 byte], entry cũ nhất trước
+ * Gửi dần qua host_diag_report; ring đang ghi được tạm dừng tới khi dump xong (hoặc bị huỷ) rồi ghi tiếp.
+ */
+static bool trace_dump_next(uint16_t idx, uint8_t *payload, uint8_t *len) {
+    if (idx == 0) {
+        dump_was_frozen = trace_hdr.frozen;
+        trace_hdr.frozen = 1;
+        uint32_t end = dump_was_frozen ? trace_hdr.frozen_at : trace_hdr.head;
+        dump_count = end < KNX_TRACE_DEPTH ? end : KNX_TRACE_DEPTH;
+        dump_start = end - dump_count;
+
+        payload[0] = dump_was_frozen;
+        payload[1] = trace_hdr.reason;
+        payload[2] = (uint8_t)dump_count;
+        payload[3] = (uint8_t)(dump_count >> 8);
+        payload[4] = (uint8_t)KNX_TRACE_DEPTH;
+        payload[5] = (uint8_t)(KNX_TRACE_DEPTH >> 8);
+        uint32_t clk = hal_cycles_per_us() * 1000000;
+        memcpy(&payload[6], &clk, 4);
+        *len = 10;
+        return true;
+    }
+
+    uint32_t i = (uint32_t)(idx - 1) * TRACE_ENTRIES_PER_MSG;
+    if (i >= dump_count) {
+        return false;
+    }
+    uint8_t n = dump_count - i < TRACE_ENTRIES_PER_MSG ? dump_count - i : TRACE_ENTRIES_PER_MSG;
+    payload[0] = (uint8_t)i;
+    payload[1] = (uint8_t)(i >> 8);
+    for (uint8_t k = 0; k < n; k++) {
+        // trace_entry_t không padding, little-endian như trên dây
+        memcpy(&payload[2 + k * sizeof(trace_entry_t)], &trace_ring[(dump_start + i + k) & TRACE_MASK], sizeof(trace_entry_t));
+    }
+    *len = 2 + n * sizeof(trace_entry_t);
+    return true;
+}
+
+static void trace_dump_end(void) {
+    trace_hdr.frozen = dump_was_frozen;
+}
+
+static_assert(2 + TRACE_ENTRIES_PER_MSG * sizeof(trace_entry_t) <= DIAG_PAYLOAD_MAX, "trace dump message too long");
+
+static const host_diag_report_t trace_dump_report = {DIAG_TRACE_DUMP, trace_dump_next, trace_dump_end};
+
+void trace_send_dump(void) {
+    host_diag_report(&trace_dump_report);
+}
+
+#endif // KNX_TRACE_ENABLE
@@ -0,0 +1,99 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+
+/*
+ * Trace ring cho sự kiện giao thức (post-mortem)
+ *
+ * Mỗi entry 8 byte: [DWT cycle u32] [event u8] [a u8] [b u16]
+ * Ring nằm trong section .noinit (noinit.ld) → còn nguyên sau reset.
+ *
+ * Trigger: sự kiện lỗi (echo timeout, lỡ ACK window...) nằm trong KNX_TRACE_TRIGGER_MASK
+ * → ghi thêm KNX_TRACE_POST_TRIGGER entry rồi freeze, ring giữ nguyên tới khi host dump + arm lại.
+ * Reset không qua mất nguồn (watchdog, software, chân NRST) khi ring chưa freeze → freeze ngay lúc khởi động;
+ * chỉ power-on reset mới xoá ring.
+ *
+ * Host: [U_DIAG_REQ] [DIAG_TRACE_DUMP / DIAG_TRACE_ARM / DIAG_TRACE_FREEZE] (xem tpuart/host_diag.h)
+ *
+ * Chi phí 1 entry: 1 lần LDREX/STREX + 2 store, không tắt interrupt → để bật cả ở bản production.
+ */
+
+typedef enum {
+    TRACE_NONE = 0,
+    // RX bus: a = byte, b = parse_rx_state trước khi xử lý | (cờ U_FRAME_STATE_IND của frame << 8)
+    //         → bit 15: PARITY_BIT_ERROR (gồm cả byte này), bit 14: CHECKSUM_LENGTH_ERROR
+    TRACE_RX_BYTE,
+    TRACE_RX_RESET,         // a = parse_rx_state lúc reset
+    TRACE_RX_GAP,           // a = parse_rx_state, b = 1 nếu đang nhận echo
+    // Host → gateway: a = byte, b = parse_tx_state trước khi xử lý
+    TRACE_HOST_BYTE,
+    TRACE_TX_RESET,         // a = parse_tx_state lúc reset
+    // Queue: a = len / success, b = q_count sau thao tác
+    TRACE_Q_PUSH,
+    TRACE_Q_REJECT,
+    TRACE_Q_CONFIRM,
+    TRACE_ECHO_SENT,        // b = q_count
+    TRACE_ECHO_TIMEOUT,
+    // DMA PWM TX: a = số byte (frame) / 0 (ACK)
+    TRACE_DMA_START,
+    TRACE_DMA_DONE,
+    TRACE_TX_RESULT,        // a = knx_error_t
+    // ACK: a = ack value, b = µs từ checksum
+    TRACE_ACK_ARM,
+    TRACE_ACK_SEND,
+    TRACE_ACK_MISS,
+    TRACE_TRIGGER,          // a = trace_trigger_t
+    TRACE_BOOT,             // a = trace_trigger_t của lần freeze trước (nếu có)
+    TRACE_RECOVERY,         // a = recovery_subsystem_t, b = số lần trong window
+    TRACE_WARM_START,       // a = recovery_reason_t, b = số frame giữ lại trong queue
+    TRACE_EVENT_COUNT
+} trace_event_t;
+
+// Nguồn trigger (bit trong KNX_TRACE_TRIGGER_MASK)
+typedef enum {
+    TRACE_TRIG_NONE = 0,
+    TRACE_TRIG_ECHO_TIMEOUT,
+    TRACE_TRIG_ACK_MISS,
+    TRACE_TRIG_ECHO_LOST,   // Echo không có ACK từ bus / bị cắt
+    TRACE_TRIG_HOST,        // DIAG_TRACE_FREEZE
+    TRACE_TRIG_RESET,       // Reset bất thường
+} trace_trigger_t;
+
+#define TRACE_TRIG_BIT(t) (1u << (t))
+
+typedef struct {
+    uint32_t cycles;
+    uint8_t event;
+    uint8_t a;
+    uint16_t b;
+} trace_entry_t;
+
+#if KNX_TRACE_ENABLE
+
+void trace_init(void);
+void trace_record(uint8_t event, uint8_t a, uint16_t b);
+void trace_trigger(uint8_t reason);
+
+// Xoá ring và bắt đầu ghi lại
+void trace_arm(void);
+bool trace_is_frozen(void);
+// Gửi toàn bộ ring lên host (U_DIAG_IND, entry cũ nhất trước), dần dần qua host_diag_report
+void trace_send_dump(void);
+
+#define TRACE(event, a, b) trace_record((event), (uint8_t)(a), (uint16_t)(b))
+#define TRACE_TRIGGER(reason) trace_trigger(reason)
+
+#else
+
+static inline void trace_init(void) {}
+
+#define TRACE(event, a, b)
+#define TRACE_TRIGGER(reason)
+
+#endif // KNX_TRACE_ENABLE
+
+#endif // TRACE_H
@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""
+So sánh output microbenchmark (src/bench.cpp) với baseline đã ghi lại.
+
+    .pio/build/native_bench/program > bench.txt
+    python3 tools/bench_compare.py tools/bench_baseline_native.txt bench.txt
+    python3 tools/bench_compare.py tools/bench_baseline_f103.txt capture.txt --threshold 5
+
+Chỉ đọc các dòng "BENCH <tên> <giá trị> <đơn vị>/op [...]" (output serial của target có lẫn log vẫn được).
+Exit code 1 nếu có case chậm hơn baseline quá --threshold % (native mặc định 25% vì nhiễu CPU scaling,
+cycle trên target gần như cố định nên dùng ngưỡng nhỏ). Chênh lệch tuyệt đối < --min-delta (mặc định 1 ns / cycle)
+không tính - case rất nhỏ như "empty" dao động vài chục % mà không có ý nghĩa.
+Ghi baseline mới: chép nguyên output vào file baseline rồi commit - thay đổi hiện ra trong diff.
+"""
+
+import argparse
+import re
+import sys
+
+BENCH_RE = re.compile(r"BENCH\s+(\S+)\s+([0-9.]+)\s+(\S+)/op(?:\s+([0-9.]+)%bit)?")
+
+
+def load(path):
+    stream = sys.stdin if path == "-" else open(path, encoding="utf-8", errors="replace")
+    results = {}
+    with stream:
+        for line in stream:
+            m = BENCH_RE.search(line)
+            if m:
+                results[m.group(1)] = (float(m.group(2)), m.group(3), m.group(4))
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline")
+    parser.add_argument("current", help="file output của bench, '-' = stdin")
+    parser.add_argument("--threshold", type=float, default=25.0, help="%% chậm hơn baseline bị coi là regression")
+    parser.add_argument("--min-delta", type=float, default=1.0, help="chênh lệch tuyệt đối tối thiểu (ns / cycle)")
+    args = parser.parse_args()
+
+    base = load(args.baseline)
+    cur = load(args.current)
+    if not cur:
+        print("no BENCH lines in %s" % args.current, file=sys.stderr)
+        return 2
+
+    regressions = 0
+    print("%-24s %12s %12s %8s" % ("case", "baseline", "current", "delta"))
+    for name in list(base) + [n for n in cur if n not in base]:
+        if name not in cur:
+            print("%-24s %12.1f %12s %8s  missing" % (name, base[name][0], "-", ""))
+            continue
+        value, unit, pct_bit = cur[name]
+        note = " %s%% bit" % pct_bit if pct_bit else ""
+        if name not in base:
+            print("%-24s %12s %9.1f %-2s %8s  new%s" % (name, "-", value, unit, "", note))
+            continue
+        ref, ref_unit, _ = base[name]
+        if ref_unit != unit:
+            print("%-24s unit changed (%s -> %s)" % (name, ref_unit, unit))
+            continue
+        delta = (value - ref) / ref * 100 if ref else 0.0
+        flag = ""
+        if delta > args.threshold and value - ref >= args.min_delta:
+            flag = "  REGRESSION"
+            regressions += 1
+        print("%-24s %9.1f %-2s %9.1f %-2s %+7.1f%%%s%s" % (name, ref, unit, value, unit, delta, note, flag))
+
+    if regressions:
+        print("%d case(s) slower than baseline by more than %.0f%%" % (regressions, args.threshold))
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,23 @@
+"""
+PlatformIO extra_script cho env:native_fuzz_*.
+
+- Có clang: build bằng clang với libFuzzer + ASan + UBSan (KNX_LIBFUZZER=1),
+  chạy: .pio/build/native_fuzz_host/program -max_total_time=60 -dict=src/native/fuzz/tpuart.dict corpus/
+- Không có clang: g++ + ASan + UBSan, main() là driver ngẫu nhiên trong src/native/fuzz/fuzz_driver.cpp
+"""
+
+import shutil
+
+Import("env")  # noqa: F821 - do PlatformIO cung cấp
+
+SANITIZERS = "address,undefined"
+
+if shutil.which("clang++"):
+    env.Replace(CC="clang", CXX="clang++", LINK="clang++")  # noqa: F821
+    flags = ["-fsanitize=fuzzer," + SANITIZERS]
+    env.Append(CPPDEFINES=[("KNX_LIBFUZZER", 1)])  # noqa: F821
+else:
+    flags = ["-fsanitize=" + SANITIZERS]
+    print("fuzz_env: clang++ not found - building the random driver (no coverage) with g++")
+
+env.Append(CCFLAGS=flags + ["-g", "-O1", "-fno-omit-frame-pointer"], LINKFLAGS=flags)  # noqa: F821
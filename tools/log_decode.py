@@ -0,0 +1,210 @@
+#!/usr/bin/env python3
+"""
+Giải mã log nhị phân của firmware build với LOGGER_DEFERRED=1.
+
+    python3 tools/log_decode.py .pio/build/bluepill_f103c8_deferred_log/firmware.elf /dev/ttyUSB0
+    python3 tools/log_decode.py firmware.elf capture.bin
+    cat capture.bin | python3 tools/log_decode.py firmware.elf -
+
+Record (xem src/logger_deferred.h):
+    [0xA5] [len] [hdr] [fmt u32] [timestamp ms u32] [args...]
+Byte ASCII nằm ngoài record (DEBUG_SERIAL.print trực tiếp) được in ra nguyên văn.
+Đọc từ serial cần pyserial (19200 8E1, giống DEBUG_SERIAL).
+"""
+
+import re
+import struct
+import sys
+
+LOG_REC_SYNC = 0xA5
+LOG_REC_HEX_FLAG = 0x80
+
+LEVEL_NAMES = ["ERROR", "WARN ", "INFO ", "DEBUG", "TRACE"]
+CATEGORY_NAMES = ["SYS  ", "UART ", "KNX_T", "KNX_R", "QUEUE", "ECHO ", "VALID", "ERROR"]
+
+FMT_SPEC = re.compile(r"%([-+ #0]*)(\d*)(?:\.(\d+))?(hh|h|ll|l|z|j|t)?([diouxXcsfFeEgGp%])")
+
+
+class ElfImage:
+    """Các section được nạp vào bộ nhớ của file ELF (đủ để đọc string trong .rodata)."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            data = f.read()
+        if data[:4] != b"\x7fELF":
+            raise ValueError("%s: not an ELF file" % path)
+        is64 = data[4] == 2
+        endian = "<" if data[5] == 1 else ">"
+        if is64:
+            shoff, = struct.unpack_from(endian + "Q", data, 0x28)
+            shentsize, shnum = struct.unpack_from(endian + "HH", data, 0x3A)
+            sh_fmt = endian + "IIQQQQIIQQ"
+        else:
+            shoff, = struct.unpack_from(endian + "I", data, 0x20)
+            shentsize, shnum = struct.unpack_from(endian + "HH", data, 0x2E)
+            sh_fmt = endian + "IIIIIIIIII"
+        self.sections = []
+        for i in range(shnum):
+            fields = struct.unpack_from(sh_fmt, data, shoff + i * shentsize)
+            sh_type, sh_flags, sh_addr, sh_offset, sh_size = fields[1:6]
+            SHT_NOBITS, SHF_ALLOC = 8, 0x2
+            if sh_type == SHT_NOBITS or not (sh_flags & SHF_ALLOC) or sh_addr == 0:
+                continue
+            self.sections.append((sh_addr, data[sh_offset:sh_offset + sh_size]))
+
+    def read_cstring(self, addr):
+        for base, blob in self.sections:
+            if base <= addr < base + len(blob):
+                start = addr - base
+                end = blob.find(b"\0", start)
+                if end < 0:
+                    end = len(blob)
+                return blob[start:end].decode("utf-8", "replace")
+        return None
+
+
+class ArgReader:
+    def __init__(self, payload):
+        self.buf = payload
+        self.pos = 0
+
+    def take(self, n):
+        if self.pos + n > len(self.buf):
+            raise IndexError
+        out = self.buf[self.pos:self.pos + n]
+        self.pos += n
+        return out
+
+    def u32(self):
+        return struct.unpack("<I", self.take(4))[0]
+
+    def i32(self):
+        return struct.unpack("<i", self.take(4))[0]
+
+    def u64(self):
+        return struct.unpack("<Q", self.take(8))[0]
+
+    def i64(self):
+        return struct.unpack("<q", self.take(8))[0]
+
+    def f64(self):
+        return struct.unpack("<d", self.take(8))[0]
+
+    def blob(self):
+        n = self.take(1)[0]
+        return self.take(n)
+
+    def string(self):
+        return self.blob().decode("utf-8", "replace")
+
+
+def render(fmt, args):
+    """printf → Python %, tham số lấy từ record theo từng conversion."""
+
+    def convert(m):
+        flags, width, prec, length, conv = m.groups()
+        if conv == "%":
+            return "%"
+        spec = "%" + flags + width + ("." + prec if prec is not None else "")
+        try:
+            if conv == "s":
+                return (spec + "s") % args.string()
+            if conv in "fFeEgG":
+                return (spec + conv) % args.f64()
+            wide = length == "ll"
+            if conv in "di":
+                return (spec + "d") % (args.i64() if wide else args.i32())
+            value = args.u64() if wide else args.u32()
+            if conv == "c":
+                return (spec + "c") % chr(value & 0xFF)
+            if conv == "p":
+                return "0x%08x" % value
+            return (spec + ("d" if conv == "u" else conv)) % value
+        except IndexError:
+            return "<?>"
+
+    return FMT_SPEC.sub(convert, fmt)
+
+
+def decode_record(elf, rec):
+    hdr = rec[0]
+    fmt_addr, timestamp = struct.unpack_from("<II", rec, 1)
+    args = ArgReader(rec[9:])
+    level = (hdr >> 4) & 0x07
+    category = hdr & 0x0F
+    level_name = LEVEL_NAMES[level] if level < len(LEVEL_NAMES) else "L%d   " % level
+    cat_name = CATEGORY_NAMES[category] if category < len(CATEGORY_NAMES) else "C%-4d" % category
+
+    if fmt_addr == 0:
+        try:
+            text = "*** %d log record(s) dropped (ring full)" % args.u32()
+        except IndexError:
+            text = "*** log records dropped"
+    else:
+        fmt = elf.read_cstring(fmt_addr)
+        if fmt is None:
+            text = "<unknown format 0x%08x> %s" % (fmt_addr, rec[9:].hex(" "))
+        elif hdr & LOG_REC_HEX_FLAG:
+            try:
+                data = args.blob()
+            except IndexError:
+                data = b""
+            text = "%s: %s" % (fmt, " ".join("%02X" % b for b in data))
+        else:
+            text = render(fmt, args)
+    return "[%8u] %s [%s] %s" % (timestamp, level_name, cat_name, text)
+
+
+def decode_stream(elf, read, out):
+    text = bytearray()
+    while True:
+        b = read(1)
+        if not b:
+            break
+        if b[0] != LOG_REC_SYNC:
+            if b in (b"\n", b"\r"):
+                if text:
+                    out.write(text.decode("utf-8", "replace") + "\n")
+                    text.clear()
+            else:
+                text += b
+            continue
+        if text:
+            out.write(text.decode("utf-8", "replace") + "\n")
+            text.clear()
+        n = read(1)
+        if not n:
+            break
+        rec = read(n[0])
+        if len(rec) < n[0]:
+            break
+        if len(rec) < 9:
+            continue  # Record hỏng → đồng bộ lại ở byte 0xA5 tiếp theo
+        out.write(decode_record(elf, rec) + "\n")
+        out.flush()
+
+
+def open_input(path):
+    if path == "-":
+        return sys.stdin.buffer
+    if path.startswith("/dev/") or path.upper().startswith("COM"):
+        import serial  # pyserial
+        return serial.Serial(path, 19200, parity=serial.PARITY_EVEN, timeout=None)
+    return open(path, "rb")
+
+
+def main(argv):
+    if len(argv) != 3:
+        sys.stderr.write(__doc__)
+        return 2
+    elf = ElfImage(argv[1])
+    src = open_input(argv[2])
+    try:
+        decode_stream(elf, src.read, sys.stdout)
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))